@@ -0,0 +1,466 @@
+/**
+ * @file hp_bench.cpp
+ * @brief Microbenchmarks for the CN105 codec and the Matter conversions
+ *
+ * Covers the per-frame hot paths: checksum, SET and info request
+ * encoding, decoding of every 0x62 reply the library interprets, the
+ * byte map lookups and the Matter attribute conversions. Replies are
+ * served from memory by a replay transport on a VirtualClock, so the
+ * numbers are pure CPU cost without bus or sleep time.
+ *
+ * Each benchmark is calibrated to run for at least --min-time ms and
+ * repeated --reps times; the fastest repetition is reported. Heap use
+ * is counted through operator new, so it covers C++ allocations only.
+ *
+ * Usage: hp_bench [--json <file>] [--filter <substring>]
+ *                 [--min-time <ms>] [--reps <n>]
+ *
+ * Compare two runs with scripts/bench_compare.py.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+
+#include "heat_pump.h"
+#include "heat_pump_impl.h"
+#include "matter_conversions.h"
+#include "heatpump_state.h"
+
+#define BENCH_FORMAT_VERSION 1
+
+/* Heap accounting, operator new is the only allocator the code under test could reach */
+static std::atomic<uint64_t> alloc_count{0};
+static std::atomic<uint64_t> alloc_bytes{0};
+
+void *operator new(size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/**
+ * @brief Keep a value alive so the compiler cannot drop the work producing it
+ */
+template <typename T>
+static inline void keep(T const &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Serves one prebuilt frame from memory, rewound before each decode
+ */
+class ReplayTransport {
+  public:
+    void load(const uint8_t *data, size_t len)
+    {
+        frame = data;
+        frame_len = len;
+        pos = 0;
+    }
+    void rewind() { pos = 0; }
+
+    bool configure(int bitrate)
+    {
+        (void)bitrate;
+        return true;
+    }
+    int read(unsigned char *ch)
+    {
+        if (pos >= frame_len) {
+            return -1;
+        }
+        *ch = frame[pos++];
+        return 0;
+    }
+    void write(unsigned char ch) { (void)ch; }
+    int lineErrors() { return 0; }
+
+  private:
+    const uint8_t *frame = NULL;
+    size_t frame_len = 0;
+    size_t pos = 0;
+};
+
+/**
+ * @brief Protocol core with the codec exposed
+ */
+class BenchHeatPump : public HeatPumpT<ReplayTransport, VirtualClock> {
+  public:
+    using HeatPumpT::checkSum;
+    using HeatPumpT::createPacket;
+    using HeatPumpT::createInfoPacket;
+    using HeatPumpT::readPacket;
+
+    using HeatPumpT::RCVD_PKT_SETTINGS;
+    using HeatPumpT::RCVD_PKT_ROOM_TEMP;
+    using HeatPumpT::RCVD_PKT_STATUS;
+    using HeatPumpT::RCVD_PKT_TIMER;
+    using HeatPumpT::RCVD_PKT_FUNCTIONS;
+};
+
+/**
+ * @brief A 0x62 reply frame with a valid checksum
+ */
+struct Reply {
+    const char *name;
+    uint8_t bytes[22];
+    int expected;
+};
+
+static void make_reply(Reply &reply, const char *name, const uint8_t data[16], int expected)
+{
+    static const uint8_t header[5] = { 0xfc, 0x62, 0x01, 0x30, 0x10 };
+    int sum = 0;
+
+    reply.name = name;
+    reply.expected = expected;
+    for (int i = 0; i < 5; i++) {
+        reply.bytes[i] = header[i];
+        sum += header[i];
+    }
+    for (int i = 0; i < 16; i++) {
+        reply.bytes[5 + i] = data[i];
+        sum += data[i];
+    }
+    reply.bytes[21] = (0xfc - sum) & 0xff;
+}
+
+struct Result {
+    const char *name;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+    uint64_t iterations;
+};
+
+struct Options {
+    const char *json = NULL;
+    const char *filter = NULL;
+    double min_time_ms = 50;
+    int reps = 5;
+};
+
+static Options opts;
+static std::vector<Result> results;
+
+/**
+ * @brief Time fn(i) for i in [0, iterations) and return the elapsed ns
+ */
+template <typename Fn>
+static double time_loop(Fn &fn, uint64_t iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+template <typename Fn>
+static void bench(const char *name, Fn fn)
+{
+    if (opts.filter && strstr(name, opts.filter) == NULL) {
+        return;
+    }
+
+    /* Grow the iteration count until one repetition takes min_time */
+    uint64_t iterations = 1;
+    double ns = time_loop(fn, iterations);
+    while (ns < opts.min_time_ms * 1e6 && iterations < (1ULL << 40)) {
+        double scale = ns > 0 ? opts.min_time_ms * 1e6 / ns * 1.2 : 10;
+        scale = scale < 2 ? 2 : (scale > 10 ? 10 : scale);
+        iterations = (uint64_t)(iterations * scale);
+        ns = time_loop(fn, iterations);
+    }
+
+    double best = ns;
+    uint64_t count0 = alloc_count.load();
+    uint64_t bytes0 = alloc_bytes.load();
+    for (int r = 0; r < opts.reps; r++) {
+        ns = time_loop(fn, iterations);
+        best = ns < best ? ns : best;
+    }
+    uint64_t total = iterations * (uint64_t)opts.reps;
+
+    Result res;
+    res.name = name;
+    res.ns_per_op = best / (double)iterations;
+    res.allocs_per_op = (double)(alloc_count.load() - count0) / (double)total;
+    res.bytes_per_op = (double)(alloc_bytes.load() - bytes0) / (double)total;
+    res.iterations = iterations;
+    results.push_back(res);
+
+    printf("%-28s %10.1f ns/op %8.1f B/op %6.2f allocs/op %12llu\n", res.name, res.ns_per_op,
+           res.bytes_per_op, res.allocs_per_op, (unsigned long long)res.iterations);
+}
+
+static void json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static int write_json(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fprintf(f, "{\n  \"format\": %d,\n  \"compiler\": ", BENCH_FORMAT_VERSION);
+    json_string(f, __VERSION__);
+    fprintf(f, ",\n  \"min_time_ms\": %g,\n  \"reps\": %d,\n  \"results\": [\n", opts.min_time_ms,
+            opts.reps);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        fprintf(f, "    {\"name\": ");
+        json_string(f, r.name);
+        fprintf(f, ", \"ns_per_op\": %.3f, \"bytes_per_op\": %.3f, \"allocs_per_op\": %.3f, "
+                   "\"iterations\": %llu}%s\n",
+                r.ns_per_op, r.bytes_per_op, r.allocs_per_op, (unsigned long long)r.iterations,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+static int parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--json") == 0 && val) {
+            opts.json = val;
+        } else if (strcmp(arg, "--filter") == 0 && val) {
+            opts.filter = val;
+        } else if (strcmp(arg, "--min-time") == 0 && val) {
+            opts.min_time_ms = atof(val);
+        } else if (strcmp(arg, "--reps") == 0 && val) {
+            opts.reps = atoi(val);
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--json <file>] [--filter <substring>] [--min-time <ms>] "
+                    "[--reps <n>]\n",
+                    argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    if (opts.min_time_ms <= 0 || opts.reps <= 0) {
+        fprintf(stderr, "--min-time and --reps must be positive\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_args(argc, argv) != 0) {
+        return 2;
+    }
+
+    static BenchHeatPump hp;
+    uint8_t packet[22];
+
+    /* Encoding */
+    static const heatpumpSettings settings[4] = {
+        { "ON", "HEAT", 2100, "AUTO", "AUTO", "|", false, false },
+        { "ON", "COOL", 2450, "2", "3", "<<", false, false },
+        { "OFF", "DRY", 1800, "QUIET", "SWING", "SWING", false, false },
+        { "ON", "AUTO", 2200, "4", "1", "<>", false, false },
+    };
+    static const uint8_t info_types[6] = { 0x02, 0x03, 0x06, 0x04, 0x05, 0x09 };
+
+    hp.createPacket(packet, settings[0]);
+    bench("checksum", [&](uint64_t i) {
+        packet[8] = (uint8_t)i;
+        keep(hp.checkSum(packet, 21));
+    });
+    bench("create_packet", [&](uint64_t i) {
+        hp.createPacket(packet, settings[i & 3]);
+        keep(packet);
+    });
+    bench("create_info_packet", [&](uint64_t i) {
+        hp.createInfoPacket(packet, info_types[i % 6]);
+        keep(packet);
+    });
+
+    /* Decoding, one benchmark per 0x62 reply the library interprets */
+    static const uint8_t settings_data[16] = { 0x02, 0, 0, 0x01, 0x01, 0x0a, 0x00, 0x00,
+                                               0, 0, 0x03, 0xaa, 0, 0, 0, 0 };
+    static const uint8_t room_data[16] = { 0x03, 0, 0, 0x0b, 0, 0, 0xaa, 0,
+                                           0, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t timers_data[16] = { 0x05, 0, 0, 0x03, 0x06, 0x0c, 0x05, 0x0b,
+                                             0, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t status_data[16] = { 0x06, 0, 0, 0x2a, 0x01, 0, 0, 0,
+                                             0, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t functions1_data[16] = { 0x20, 0x65, 0x66, 0x67, 0x69, 0x6a, 0x6b, 0x6d,
+                                                 0x6e, 0x6f, 0x71, 0x72, 0x73, 0x75, 0x76, 0x77 };
+    static const uint8_t functions2_data[16] = { 0x22, 0x79, 0x7a, 0x7b, 0x7d, 0x7e, 0x7f, 0x81,
+                                                 0x82, 0x83, 0x85, 0x86, 0x87, 0x89, 0x8a, 0x8b };
+    static Reply replies[6];
+    make_reply(replies[0], "decode_settings", settings_data, hp.RCVD_PKT_SETTINGS);
+    make_reply(replies[1], "decode_room_temp", room_data, hp.RCVD_PKT_ROOM_TEMP);
+    make_reply(replies[2], "decode_timers", timers_data, hp.RCVD_PKT_TIMER);
+    make_reply(replies[3], "decode_status", status_data, hp.RCVD_PKT_STATUS);
+    make_reply(replies[4], "decode_functions1", functions1_data, hp.RCVD_PKT_FUNCTIONS);
+    make_reply(replies[5], "decode_functions2", functions2_data, hp.RCVD_PKT_FUNCTIONS);
+
+    for (Reply &reply : replies) {
+        hp.getTransport().load(reply.bytes, sizeof(reply.bytes));
+        int got = hp.readPacket();
+        if (got != reply.expected) {
+            fprintf(stderr, "%s: readPacket() returned %d, expected %d\n", reply.name, got,
+                    reply.expected);
+            return 1;
+        }
+        bench(reply.name, [&](uint64_t) {
+            hp.getTransport().rewind();
+            keep(hp.readPacket());
+        });
+    }
+
+    /* Value table lookups, as the codec does them; names ignore case */
+    static const char *fan_names[6] = { "AUTO", "QUIET", "1", "2", "3", "4" };
+    bench("lookup_value_str", [&](uint64_t i) {
+        keep(cn105::Fans::decode(cn105::FAN[i % cn105::Fans::count]));
+    });
+    bench("lookup_value_int", [&](uint64_t i) {
+        keep(cn105::Temps::decode(cn105::TEMP[i % cn105::Temps::count]));
+    });
+    bench("lookup_index_str", [&](uint64_t i) {
+        keep(cn105::Fans::indexOf(fan_names[i % cn105::Fans::count]));
+    });
+    bench("lookup_index_int", [&](uint64_t i) {
+        keep(cn105::Temps::indexOf(16 + (int)(i % cn105::Temps::count)));
+    });
+
+    /* Matter attribute conversions */
+    static const uint8_t modes[5] = { MATTER_THERMOSTAT_MODE_HEAT, MATTER_THERMOSTAT_MODE_COOL,
+                                      MATTER_THERMOSTAT_MODE_AUTO, MATTER_THERMOSTAT_MODE_DRY,
+                                      MATTER_THERMOSTAT_MODE_FAN_ONLY };
+    bench("matter_mode_to_hp", [&](uint64_t i) { keep(matter_mode_to_hp(modes[i % 5])); });
+    bench("matter_fan_to_hp", [&](uint64_t i) { keep(matter_fan_to_hp((uint8_t)(i % 6))); });
+    bench("matter_vane_to_hp", [&](uint64_t i) { keep(matter_vane_to_hp((uint8_t)(i % 7))); });
+    bench("matter_wide_vane_to_hp",
+          [&](uint64_t i) { keep(matter_wide_vane_to_hp((uint8_t)(i % 7))); });
+    /* Read side, run for every attribute read served from the driver snapshot */
+    static const char *const hp_modes[5] = { "HEAT", "COOL", "AUTO", "DRY", "FAN" };
+    static const char *const hp_vanes[7] = { "AUTO", "1", "2", "3", "4", "5", "SWING" };
+    bench("matter_mode_from_hp", [&](uint64_t i) { keep(matter_mode_from_hp(hp_modes[i % 5])); });
+    bench("matter_fan_from_hp",
+          [&](uint64_t i) { keep(matter_fan_from_hp(cn105::FAN_MAP[i % 6])); });
+    bench("matter_vane_from_hp", [&](uint64_t i) { keep(matter_vane_from_hp(hp_vanes[i % 7])); });
+    bench("matter_running_state", [&](uint64_t i) {
+        heatpump_settings_t settings = {};
+        heatpump_status_t status = {};
+        settings.power = "ON";
+        settings.mode = hp_modes[i % 5];
+        settings.temperature = HP_TEMP_C(21);
+        status.operating = true;
+        status.roomTemperature = (hp_temp_t)(HP_TEMP_C(20) + (i & 3) * HP_TEMP_HALF);
+        keep(matter_running_state(&settings, &status));
+    });
+    bench("matter_encode_full_state", [&](uint64_t i) {
+        heatpump_settings_t settings = {};
+        heatpump_status_t status = {};
+        heatpump_timers_t timers = {};
+        uint8_t out[MATTER_HP_FULL_STATE_LEN];
+        settings.power = "ON";
+        settings.mode = hp_modes[i % 5];
+        settings.fan = cn105::FAN_MAP[i % 6];
+        settings.vane = hp_vanes[i % 7];
+        settings.wideVane = "|";
+        settings.temperature = HP_TEMP_C(21);
+        status.roomTemperature = (hp_temp_t)(HP_TEMP_C(20) + (i & 3) * HP_TEMP_HALF);
+        status.compressorFrequency = (int)(i & 127);
+        timers.mode = "NONE";
+        matter_encode_full_state(&settings, &status, &timers, HP_LINK_HEALTHY, out);
+        keep(out);
+    });
+    bench("matter_setpoint_to_hp", [&](uint64_t i) {
+        hp_temp_t temp;
+        keep(matter_setpoint_to_hp((int16_t)(1500 + (i & 1023) * 2), &temp));
+        keep(temp);
+    });
+    bench("half_degrees_round_trip", [&](uint64_t i) {
+        hp_temp_t temp = (hp_temp_t)(1000 + (i & 2047));
+        keep(temp);
+        keep(cn105::fromHalfDegrees(cn105::toHalfDegrees(temp)));
+    });
+
+    /* Driver publish path: pack after every sync, compare with the last */
+    heatpumpSettings hs_a = {"ON", "HEAT", HP_TEMP_C(21), "AUTO", "AUTO", "|", false, true};
+    heatpumpSettings hs_b = hs_a;
+    bench("settings_compare", [&](uint64_t i) {
+        hs_b.temperature = (hp_temp_t)(HP_TEMP_C(21) + (i & 1) * HP_TEMP_HALF);
+        keep(hs_a == hs_b);
+    });
+    bench("state_pack", [&](uint64_t i) {
+        heatpump_settings_t settings = {"ON", cn105::MODE_MAP[i % 5], HP_TEMP_C(21),
+                                        cn105::FAN_MAP[i % 6], cn105::VANE_MAP[i % 7],
+                                        cn105::WIDEVANE_MAP[i % 7], false, true, false};
+        heatpump_status_t status = {(hp_temp_t)(HP_TEMP_C(20) + (i & 3) * HP_TEMP_HALF), true,
+                                    (int)(i & 127), false};
+        heatpump_timers_t timers = {"NONE", 0, 0, 0, 0};
+        heatpump_state_t state = {};
+        heatpump_state_put_settings(&state, &settings);
+        heatpump_state_put_status(&state, &status, &timers);
+        keep(state);
+    });
+    bench("state_diff", [&](uint64_t i) {
+        heatpump_state_t a = {0x123456789ull, 0x7d0ull};
+        heatpump_state_t b = {0x123456789ull ^ ((i & 1) << 4), 0x7d0ull};
+        keep(a);
+        heatpump_state_t changed = heatpump_state_diff(&a, &b);
+        keep(heatpump_state_changed(&changed, HP_STATE_SETPOINT, HP_STATUS_ROOM_TEMP));
+    });
+    bench("state_unpack", [&](uint64_t i) {
+        heatpump_state_t state = {0x123456780ull | (i & 1), 0x7d0ull};
+        heatpump_settings_t settings;
+        heatpump_status_t status;
+        keep(state);
+        heatpump_state_get_settings(&state, &settings);
+        heatpump_state_get_status(&state, &status);
+        keep(settings);
+        keep(status);
+    });
+
+    if (opts.json && write_json(opts.json) != 0) {
+        return 1;
+    }
+    return 0;
+}
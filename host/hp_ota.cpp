@@ -0,0 +1,271 @@
+/**
+ * @file hp_ota.cpp
+ * @brief Apply a delta or compressed OTA image on a Linux host
+ *
+ * Runs the decoder the OTA requestor uses (src/ota_delta.cpp) against a
+ * base image file, feeding it the image in BDX-sized blocks from a file
+ * or from a local provider (scripts/ota_delta.py serve), and reports the
+ * transfer time and the bytes saved against sending the full image.
+ *
+ * Usage: hp_ota [--base FILE] (--image FILE | --provider HOST:PORT)
+ *               [--out FILE] [--block BYTES]
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "ota_delta.h"
+
+namespace {
+
+struct files {
+    std::vector<uint8_t> base;
+    FILE *out = nullptr;
+};
+
+int read_base(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    const files *f = static_cast<const files *>(ctx);
+    if (offset + len > f->base.size()) {
+        return -EINVAL;
+    }
+    memcpy(buf, f->base.data() + offset, len);
+    return 0;
+}
+
+int write_out(void *ctx, const uint8_t *data, size_t len)
+{
+    files *f = static_cast<files *>(ctx);
+    if (f->out != nullptr && fwrite(data, 1, len, f->out) != len) {
+        return -EIO;
+    }
+    return 0;
+}
+
+bool load(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr) {
+        perror(path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+int connect_provider(const char *spec)
+{
+    std::string host(spec);
+    std::string port = "5541";
+    size_t colon = host.rfind(':');
+    if (colon != std::string::npos) {
+        port = host.substr(colon + 1);
+        host.resize(colon);
+    }
+
+    addrinfo hints = {};
+    addrinfo *res;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) {
+        fprintf(stderr, "cannot resolve %s\n", spec);
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        perror(spec);
+    }
+    return fd;
+}
+
+bool read_all(int fd, uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Ask the provider for the block at @a offset, BDX BlockQuery style
+ *
+ * @return Block length, 0 at the end of the image, -1 on error
+ */
+ssize_t query_block(int fd, uint32_t offset, uint8_t *buf, uint32_t max)
+{
+    uint8_t query[8];
+    uint8_t len_le[4];
+
+    for (int i = 0; i < 4; i++) {
+        query[i] = (uint8_t)(offset >> (8 * i));
+        query[4 + i] = (uint8_t)(max >> (8 * i));
+    }
+    if (write(fd, query, sizeof(query)) != (ssize_t)sizeof(query) ||
+        !read_all(fd, len_le, sizeof(len_le))) {
+        return -1;
+    }
+    uint32_t len = (uint32_t)len_le[0] | ((uint32_t)len_le[1] << 8) |
+                   ((uint32_t)len_le[2] << 16) | ((uint32_t)len_le[3] << 24);
+    if (len > max || !read_all(fd, buf, len)) {
+        return -1;
+    }
+    return (ssize_t)len;
+}
+
+double now_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--base FILE] (--image FILE | --provider HOST:PORT)\n"
+            "          [--out FILE] [--block BYTES]\n",
+            prog);
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    const char *base_path = nullptr;
+    const char *image_path = nullptr;
+    const char *provider = nullptr;
+    const char *out_path = nullptr;
+    uint32_t block = 1024;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--base") == 0) {
+            base_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--image") == 0) {
+            image_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--provider") == 0) {
+            provider = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--out") == 0) {
+            out_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--block") == 0) {
+            block = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((image_path == nullptr) == (provider == nullptr) || block == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    static files f;
+    std::vector<uint8_t> image;
+    int fd = -1;
+
+    if (base_path != nullptr && !load(base_path, f.base)) {
+        return 1;
+    }
+    if (image_path != nullptr && !load(image_path, image)) {
+        return 1;
+    }
+    if (provider != nullptr && (fd = connect_provider(provider)) < 0) {
+        return 1;
+    }
+    if (out_path != nullptr && (f.out = fopen(out_path, "wb")) == nullptr) {
+        perror(out_path);
+        return 1;
+    }
+
+    static ota_delta_t d;
+    const ota_delta_io_t io = { read_base, write_out, &f };
+    std::vector<uint8_t> buf(block);
+    uint32_t offset = 0;
+    double decode_ms = 0;
+    double start = now_ms();
+    int ret = 0;
+
+    ota_delta_init(&d, &io);
+    for (;;) {
+        ssize_t n;
+        if (fd >= 0) {
+            n = query_block(fd, offset, buf.data(), block);
+            if (n < 0) {
+                fprintf(stderr, "provider closed the transfer at %u bytes\n", offset);
+                ret = -EIO;
+                break;
+            }
+        } else {
+            n = offset < image.size() ? (ssize_t)std::min<size_t>(block, image.size() - offset) : 0;
+            memcpy(buf.data(), image.data() + offset, (size_t)n);
+        }
+        if (n == 0) {
+            break;
+        }
+
+        double t0 = now_ms();
+        ret = ota_delta_feed(&d, buf.data(), (size_t)n);
+        decode_ms += now_ms() - t0;
+        if (ret != 0) {
+            break;
+        }
+        offset += (uint32_t)n;
+    }
+    if (ret == 0) {
+        double t0 = now_ms();
+        ret = ota_delta_finish(&d);
+        decode_ms += now_ms() - t0;
+    }
+    double total_ms = now_ms() - start;
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (f.out != nullptr) {
+        fclose(f.out);
+    }
+
+    const ota_delta_header_t &h = d.header;
+    printf("image        %s%s\n", h.flags & OTA_DELTA_FLAG_DELTA ? "delta" : "full",
+           h.flags & OTA_DELTA_FLAG_COMPRESSED ? ", compressed" : "");
+    printf("transferred  %u bytes in %u blocks of %u\n", d.received,
+           (d.received + block - 1) / block, block);
+    printf("new image    %u bytes, %u written\n", h.target_size, d.written);
+    if (h.target_size > 0) {
+        printf("saved        %d bytes (%.1f%%), %u fewer blocks\n",
+               (int)(h.target_size - d.received),
+               (h.target_size - (double)d.received) * 100.0 / h.target_size,
+               (h.target_size + block - 1) / block - (d.received + block - 1) / block);
+    }
+    printf("time         %.1f ms, decoding %.1f ms\n", total_ms, decode_ms);
+    if (ret != 0) {
+        printf("result       %s\n", ret == -ESTALE ? "base is not the image the delta was made against"
+                                                     : strerror(-ret));
+        return 1;
+    }
+    printf("result       ok, CRC %08x\n", d.crc);
+    return 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file hp_probe.cpp
+ * @brief Query a heat pump over a host serial port or pty
+ *
+ * Connects with the same protocol core that runs on the MCU, requests
+ * the full state once and prints it together with the link counters.
+ *
+ * Usage: hp_probe <device> [bitrate]
+ *   bitrate 0 (default) probes 2400 then 9600 baud
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "heat_pump.h"
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <device> [bitrate]\n", argv[0]);
+        return 2;
+    }
+
+    static HeatPump hp;
+    int bitrate = argc > 2 ? atoi(argv[2]) : 0;
+
+    if (!hp.getTransport().open(argv[1])) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (!hp.connect(bitrate)) {
+        fprintf(stderr, "no CONNECT reply on %s\n", argv[1]);
+        return 1;
+    }
+
+    int replies = hp.burstSync();
+    heatpumpSettings settings = hp.getSettings();
+    heatpumpStatus status = hp.getStatus();
+    heatpumpProfile profile = hp.getProfile();
+
+    printf("bitrate      %d\n", profile.bitrate);
+    printf("replies      %d/4\n", replies);
+    printf("power        %s\n", settings.power ? settings.power : "?");
+    printf("mode         %s\n", settings.mode ? settings.mode : "?");
+    printf("setpoint     " HP_TEMP_FMT "\n", HP_TEMP_ARGS(settings.temperature));
+    printf("fan          %s\n", settings.fan ? settings.fan : "?");
+    printf("vane         %s\n", settings.vane ? settings.vane : "?");
+    printf("wide vane    %s\n", settings.wideVane ? settings.wideVane : "?");
+    printf("room         " HP_TEMP_FMT "\n", HP_TEMP_ARGS(status.roomTemperature));
+    printf("operating    %d\n", status.operating);
+    printf("compressor   %d Hz\n", status.compressorFrequency);
+
+    heatpumpStats stats = hp.getStats();
+    printf("checksum     %u\n", stats.checksumErrors);
+    printf("framing      %u\n", stats.framingErrors);
+    printf("timeouts     %u\n", stats.timeouts);
+    return replies == 4 ? 0 : 1;
+}
@@ -0,0 +1,777 @@
+/**
+ * @file hp_test.cpp
+ * @brief Protocol tests for the CN105 library against a scripted unit
+ *
+ * HeatPumpT runs on a fake transport that answers like an indoor unit
+ * (CONNECT, SET, info requests and function codes) and on a
+ * VirtualClock, so timeouts, retries and backoff are checked in virtual
+ * time. Every byte the library reads costs one character time on the
+ * line, as on a real 2400 baud link. The packed state and the Matter
+ * conversions the driver builds on top are checked against it too.
+ *
+ * Usage: hp_test [<filter substring>]
+ *
+ * Registered with CTest; exits non-zero if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "heat_pump.h"
+#include "heat_pump_impl.h"
+#include "heatpump_state.h"
+#include "matter_conversions.h"
+
+static int checks;
+static int failures;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        checks++;                                                           \
+        if (!(cond)) {                                                      \
+            failures++;                                                     \
+            printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                      \
+    do {                                                                    \
+        checks++;                                                           \
+        long long va_ = (long long)(a), vb_ = (long long)(b);               \
+        if (va_ != vb_) {                                                   \
+            failures++;                                                     \
+            printf("  %s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, \
+                   #a, #b, va_, vb_);                                       \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_STR(a, b) CHECK(strcmp((a), (b)) == 0)
+
+/**
+ * @brief A frame the library wrote, and when
+ */
+struct SentFrame {
+    std::vector<uint8_t> bytes;
+    int64_t at_ms;
+
+    uint8_t command() const { return bytes[1]; }
+    uint8_t code() const { return bytes.size() > 5 ? bytes[5] : 0; }
+    const uint8_t *data() const { return bytes.data() + cn105::HEADER_LEN; }
+};
+
+/**
+ * @brief Indoor unit, answering on the fake line
+ *
+ * Info requests are answered from the raw data blocks below (data[0] is
+ * the code), SET frames update the settings block the way the unit
+ * applies them.
+ */
+class FakeUnit {
+  public:
+    VirtualClock *clock = NULL;
+
+    uint8_t settings[cn105::DATA_LEN] = { 0x02 };
+    uint8_t room_temp[cn105::DATA_LEN] = { 0x03 };
+    uint8_t status[cn105::DATA_LEN] = { 0x06 };
+    uint8_t timers[cn105::DATA_LEN] = { 0x05 };
+    uint8_t functions1[cn105::DATA_LEN] = { 0x20 };
+    uint8_t functions2[cn105::DATA_LEN] = { 0x22 };
+
+    int bitrate = 2400;       /* answers only at this rate */
+    int line_bitrate = 0;     /* rate the library configured */
+    int byte_ms = 4;          /* one character at 2400 baud, 8E1 */
+    int drop_set_acks = 0;    /* SET frames to leave unanswered */
+    int ignore_sets = 0;      /* settings SETs to ack without applying */
+    bool silent = false;      /* answer nothing */
+    bool noise = false;       /* the line reads 0x00 without end, nothing else */
+    long abort_after = -1;    /* bytes read before on_abort() is called */
+    void (*on_abort)(void *) = NULL;
+    void *abort_arg = NULL;
+
+    std::vector<SentFrame> sent;
+    std::deque<uint8_t> line;
+    long bytes_read = 0;
+
+    /* Queue bytes for the library, e.g. a corrupt or unsolicited frame */
+    void inject(const uint8_t *bytes, size_t len) { line.insert(line.end(), bytes, bytes + len); }
+
+    void reply(uint8_t command, const uint8_t *data, int len)
+    {
+        uint8_t frame[cn105::HEADER_LEN + 255 + 1] = { cn105::START, command, cn105::HEADER_2,
+                                                       cn105::HEADER_3, (uint8_t)len };
+        memcpy(frame + cn105::HEADER_LEN, data, len);
+        frame[cn105::HEADER_LEN + len] = cn105::checksum(frame, cn105::HEADER_LEN + len);
+        inject(frame, cn105::HEADER_LEN + len + 1);
+    }
+
+    int read(unsigned char *ch)
+    {
+        if (noise) {
+            *ch = 0x00;
+        } else if (line.empty()) {
+            return -1;
+        } else {
+            *ch = line.front();
+            line.pop_front();
+        }
+        clock->advance(byte_ms);
+        if (++bytes_read == abort_after && on_abort) {
+            on_abort(abort_arg);
+        }
+        return 0;
+    }
+
+    void write(unsigned char ch)
+    {
+        pending.push_back(ch);
+        if (pending.size() >= (size_t)cn105::HEADER_LEN &&
+            pending.size() == (size_t)(cn105::HEADER_LEN + pending[4] + 1)) {
+            sent.push_back({ pending, clock->nowMs() });
+            pending.clear();
+            answer(sent.back());
+        }
+    }
+
+    size_t count(uint8_t command, uint8_t code) const
+    {
+        size_t n = 0;
+        for (const SentFrame &f : sent) {
+            n += f.command() == command && f.code() == code;
+        }
+        return n;
+    }
+
+  private:
+    std::vector<uint8_t> pending;
+
+    void answer(const SentFrame &f)
+    {
+        static const uint8_t ack[cn105::DATA_LEN] = {};
+        const uint8_t *d = f.data();
+
+        if (silent || line_bitrate != bitrate) {
+            return;
+        }
+        switch (f.command()) {
+            case cn105::CMD_CONNECT: {
+                static const uint8_t ok[1] = { 0x00 };
+                reply(cn105::CMD_CONNECT_ACK, ok, 1);
+                break;
+            }
+            case cn105::CMD_SET:
+                if (drop_set_acks > 0) {
+                    drop_set_acks--;
+                    break;
+                }
+                if (f.code() == cn105::SetSettings::code) {
+                    if (ignore_sets > 0) {
+                        ignore_sets--;
+                    } else {
+                        apply(d);
+                    }
+                } else if (f.code() == cn105::SetFunctions1::code) {
+                    memcpy(functions1 + 1, d + 1, cn105::FUNCTIONS_LEN);
+                } else if (f.code() == cn105::SetFunctions2::code) {
+                    memcpy(functions2 + 1, d + 1, cn105::FUNCTIONS_LEN);
+                }
+                reply(cn105::CMD_SET_ACK, ack, cn105::DATA_LEN);
+                break;
+            case cn105::CMD_GET:
+                reply(cn105::CMD_GET_REPLY, block(f.code()), cn105::DATA_LEN);
+                break;
+        }
+    }
+
+    const uint8_t *block(uint8_t code)
+    {
+        static uint8_t other[cn105::DATA_LEN];
+
+        switch (code) {
+            case 0x02: return settings;
+            case 0x03: return room_temp;
+            case 0x05: return timers;
+            case 0x06: return status;
+            case 0x20: return functions1;
+            case 0x22: return functions2;
+        }
+        memset(other, 0, sizeof(other));
+        other[0] = code;
+        return other;
+    }
+
+    /* The unit takes the flagged fields of a settings SET */
+    void apply(const uint8_t *d)
+    {
+        using Msg = cn105::SetSettings;
+
+        if (d[1] & Msg::Power::flag) {
+            settings[cn105::Settings::Power::offset] = d[Msg::Power::offset];
+        }
+        if (d[1] & Msg::Mode::flag) {
+            settings[cn105::Settings::Mode::offset] = d[Msg::Mode::offset];
+        }
+        if (d[1] & Msg::Temp::flag) {
+            settings[cn105::Settings::Temp::offset] = d[Msg::Temp::offset];
+            settings[cn105::Settings::TempHalf::offset] = d[Msg::TempHalf::offset];
+        }
+        if (d[1] & Msg::Fan::flag) {
+            settings[cn105::Settings::Fan::offset] = d[Msg::Fan::offset];
+        }
+        if (d[1] & Msg::Vane::flag) {
+            settings[cn105::Settings::Vane::offset] = d[Msg::Vane::offset];
+        }
+        if (d[2] & Msg::WideVane::flag) {
+            settings[cn105::Settings::WideVane::offset] = d[Msg::WideVane::offset];
+        }
+    }
+};
+
+/**
+ * @brief Byte transport onto a FakeUnit
+ */
+class FakeTransport {
+  public:
+    void attach(FakeUnit *unit) { this->unit = unit; }
+
+    bool configure(int bitrate)
+    {
+        unit->line_bitrate = bitrate;
+        return true;
+    }
+    int read(unsigned char *ch) { return unit->read(ch); }
+    void write(unsigned char ch) { unit->write(ch); }
+    int lineErrors() { return 0; }
+
+  private:
+    FakeUnit *unit = NULL;
+};
+
+/* Reads single frames in the framing tests */
+class TestHeatPump : public HeatPumpT<FakeTransport, VirtualClock> {
+  public:
+    using HeatPumpT::readPacket;
+};
+
+/**
+ * @brief A unit and the library wired together
+ */
+struct Rig {
+    FakeUnit unit;
+    TestHeatPump hp;
+
+    explicit Rig(int64_t start_ms = 0)
+    {
+        hp.getClock().set(start_ms);
+        unit.clock = &hp.getClock();
+        hp.getTransport().attach(&unit);
+        /* power ON, HEAT, 22 C (table), fan AUTO, vane AUTO, wide | */
+        unit.settings[3] = 0x01;
+        unit.settings[4] = 0x01;
+        unit.settings[5] = 0x09;
+        unit.settings[10] = 0x03;
+        unit.room_temp[3] = 0x0b;
+        for (int i = 0; i < 14; i++) {
+            unit.functions1[1 + i] = (uint8_t)(((101 + i - 100) << 2) + 1);
+            unit.functions2[1 + i] = (uint8_t)(((115 + i - 100) << 2) + 1);
+        }
+    }
+
+    int64_t now() { return hp.getClock().nowMs(); }
+
+    /* Handshake and initial state, as the driver brings the link up */
+    bool up()
+    {
+        return hp.connect(unit.bitrate) && hp.burstSync() == 4;
+    }
+
+    /* Run sync() every 100 ms for a while, as the driver loop does */
+    void run(int64_t ms)
+    {
+        int64_t end = now() + ms;
+        while (now() < end) {
+            hp.sync();
+            hp.getClock().advance(100);
+        }
+    }
+};
+
+static void test_connect(void)
+{
+    Rig r;
+
+    CHECK(r.hp.connect(2400));
+    CHECK(r.hp.isConnected());
+    CHECK_EQ(r.unit.sent.size(), 1);
+    CHECK_EQ(r.unit.sent[0].bytes.size(), cn105::CONNECT_LEN);
+    CHECK(memcmp(r.unit.sent[0].bytes.data(), cn105::CONNECT.bytes, cn105::CONNECT_LEN) == 0);
+    CHECK_EQ(r.hp.getStats().connectAttempts, 1);
+    CHECK_EQ(r.hp.getStats().received[FRAME_CONNECT], 1);
+}
+
+static void test_connect_probe(void)
+{
+    Rig r;
+
+    /* bitrate 0 tries 2400, then 9600 */
+    r.unit.bitrate = 9600;
+    CHECK(r.hp.connect(0));
+    CHECK_EQ(r.hp.getProfile().bitrate, 9600);
+    CHECK_EQ(r.hp.getStats().connectAttempts, 2);
+
+    Rig silent;
+    silent.unit.silent = true;
+    CHECK(!silent.hp.connect(0));
+    CHECK(!silent.hp.isConnected());
+}
+
+static void test_update_ack(void)
+{
+    Rig r;
+
+    CHECK(r.up());
+    r.unit.sent.clear();
+    r.hp.setTemperature(HP_TEMP_C(24));
+    r.hp.setFanSpeed("3");
+    CHECK(r.hp.update());
+
+    /* SET, then the settings request that confirms it */
+    CHECK_EQ(r.unit.count(cn105::CMD_SET, cn105::SetSettings::code), 1);
+    CHECK_EQ(r.unit.count(cn105::CMD_GET, cn105::Settings::code), 1);
+    const uint8_t *d = r.unit.sent[0].data();
+    CHECK_EQ(d[1], cn105::SetSettings::Temp::flag | cn105::SetSettings::Fan::flag);
+    CHECK_EQ(d[cn105::SetSettings::Temp::offset], 0x07);   /* 24 C */
+    CHECK_EQ(d[cn105::SetSettings::Fan::offset], 0x05);    /* "3" */
+    CHECK_EQ(r.hp.getStats().setConfirmed, 1);
+    CHECK_EQ(r.hp.getStats().setRetries, 0);
+    CHECK_EQ(r.hp.getTemperature(), HP_TEMP_C(24));
+    CHECK_STR(r.hp.getFanSpeed(), "3");
+}
+
+static void test_update_retry_backoff(void)
+{
+    Rig r;
+
+    CHECK(r.up());
+    r.unit.sent.clear();
+    r.unit.drop_set_acks = 1;
+    r.hp.setPowerSetting("OFF");
+    CHECK(r.hp.update());
+    CHECK_EQ(r.unit.count(cn105::CMD_SET, cn105::SetSettings::code), 2);
+    CHECK_EQ(r.hp.getStats().setRetries, 1);
+    CHECK_EQ(r.hp.getStats().setConfirmed, 1);
+    /* resent as is, after the backoff */
+    CHECK(r.unit.sent[0].bytes == r.unit.sent[1].bytes);
+    CHECK(r.unit.sent[1].at_ms - r.unit.sent[0].at_ms >= 100);
+    CHECK_STR(r.hp.getPowerSetting(), "OFF");
+
+    /* every attempt unanswered: three SETs, backoff doubling */
+    Rig f;
+    CHECK(f.up());
+    f.unit.sent.clear();
+    f.unit.drop_set_acks = 3;
+    f.hp.setModeSetting("COOL");
+    CHECK(!f.hp.update());
+    CHECK_EQ(f.unit.sent.size(), 3);
+    CHECK_EQ(f.hp.getStats().setFailed, 1);
+    CHECK_EQ(f.hp.getStats().setRetries, 2);
+    int64_t gap1 = f.unit.sent[1].at_ms - f.unit.sent[0].at_ms;
+    int64_t gap2 = f.unit.sent[2].at_ms - f.unit.sent[1].at_ms;
+    CHECK(gap2 - gap1 >= 100);
+}
+
+static void test_schema_fields(void)
+{
+    uint8_t data[cn105::DATA_LEN] = {};
+
+    /* table fields take the library's values, unknown ones the first */
+    static_assert(cn105::Modes::count == 5, "modes");
+    static_assert(cn105::sameValue(cn105::Modes::decode(0x03), "COOL"), "decode");
+    CHECK_EQ(cn105::Fans::encode("quiet"), 0x01);
+    CHECK_EQ(cn105::Fans::encode("TURBO"), 0x00);
+    CHECK(cn105::Vanes::lookup("swing") == cn105::VANE_MAP[6]);
+
+    /* wide vane and its adjust bit share a byte and a flag */
+    cn105::SetSettings::WideVane::put(data, "<>");
+    cn105::SetSettings::WideVaneAdj::put(data, true);
+    CHECK_EQ(data[13], 0x88);
+    CHECK_EQ(data[2], cn105::SetSettings::WideVane::flag);
+    CHECK_EQ(data[1], 0);
+
+    /* setpoint both ways */
+    memset(data, 0, sizeof(data));
+    cn105::SetSettings::Temp::put(data, HP_TEMP_C(22));
+    cn105::SetSettings::TempHalf::put(data, 2250);
+    CHECK_EQ(data[5], 0x09);
+    CHECK_EQ(data[14], 0x80 + 45);
+    CHECK_EQ(data[1], cn105::SetSettings::Temp::flag);
+
+    /* remote temperature, the legacy byte counts half degrees from 10 C */
+    memset(data, 0, sizeof(data));
+    cn105::SetRemoteTemp::Legacy::put(data, 2150);
+    cn105::SetRemoteTemp::TempHalf::put(data, 2150);
+    CHECK_EQ(data[2], 3 + 23);
+    CHECK_EQ(data[3], 0x80 + 43);
+}
+
+static void test_update_not_applied(void)
+{
+    /* acked, but the settings that follow show it was not applied */
+    Rig r;
+
+    CHECK(r.up());
+    r.unit.sent.clear();
+    r.unit.ignore_sets = 1;
+    r.hp.setVaneSetting("SWING");
+    CHECK(r.hp.update());
+    CHECK_EQ(r.unit.count(cn105::CMD_SET, cn105::SetSettings::code), 2);
+    CHECK_EQ(r.unit.count(cn105::CMD_GET, cn105::Settings::code), 2);
+    CHECK_EQ(r.hp.getStats().setRetries, 1);
+    CHECK_EQ(r.hp.getStats().setConfirmed, 1);
+    CHECK_STR(r.hp.getVaneSetting(), "SWING");
+
+    Rig f;
+    CHECK(f.up());
+    f.unit.ignore_sets = 3;
+    f.hp.setVaneSetting("SWING");
+    CHECK(!f.hp.update());
+    CHECK_EQ(f.hp.getStats().setFailed, 1);
+    CHECK_STR(f.hp.getVaneSetting(), "AUTO");
+}
+
+static void test_decode_settings(void)
+{
+    Rig r;
+
+    /* ON, COOL with i-See, 22.5 C in half degrees, fan 3, vane SWING,
+     * wide <> with the adjust bit */
+    r.unit.settings[3] = 0x01;
+    r.unit.settings[4] = 0x03 + cn105::ISEE_MODE_OFFSET;
+    r.unit.settings[5] = 0x09;
+    r.unit.settings[6] = 0x05;
+    r.unit.settings[7] = 0x07;
+    r.unit.settings[10] = 0x88;
+    r.unit.settings[11] = 0x80 + 45;
+    CHECK(r.up());
+
+    heatpumpSettings s = r.hp.getSettings();
+    CHECK_STR(s.power, "ON");
+    CHECK_STR(s.mode, "COOL");
+    CHECK(s.iSee);
+    CHECK_EQ(s.temperature, 2250);
+    CHECK_STR(s.fan, "3");
+    CHECK_STR(s.vane, "SWING");
+    CHECK_STR(s.wideVane, "<>");
+    CHECK(r.hp.getProfile().tempMode);
+    CHECK(r.hp.getProfile().wideVaneAdj);
+
+    /* whole degree unit: the table value */
+    Rig w;
+    w.unit.settings[5] = 0x0c;
+    CHECK(w.up());
+    CHECK_EQ(w.hp.getTemperature(), HP_TEMP_C(19));
+    CHECK(!w.hp.getProfile().tempMode);
+    CHECK(!w.hp.getIseeBool());
+}
+
+static void test_decode_room_temp(void)
+{
+    Rig r;
+
+    r.unit.room_temp[3] = 0x0b;
+    r.unit.room_temp[6] = 0x80 + 43;   /* 21.5 C, wins over the table */
+    CHECK(r.up());
+    CHECK_EQ(r.hp.getRoomTemperature(), 2150);
+
+    Rig w;
+    w.unit.room_temp[3] = 0x0b;        /* 21 C */
+    CHECK(w.up());
+    CHECK_EQ(w.hp.getRoomTemperature(), HP_TEMP_C(21));
+}
+
+static void test_decode_status_timers(void)
+{
+    Rig r;
+
+    r.unit.status[3] = 42;
+    r.unit.status[4] = 0x01;
+    r.unit.timers[3] = 0x03;   /* BOTH */
+    r.unit.timers[4] = 6;      /* on after 60 min */
+    r.unit.timers[5] = 12;
+    r.unit.timers[6] = 3;
+    r.unit.timers[7] = 9;
+    CHECK(r.up());
+
+    heatpumpStatus st = r.hp.getStatus();
+    CHECK(st.operating);
+    CHECK_EQ(st.compressorFrequency, 42);
+    CHECK_STR(st.timers.mode, "BOTH");
+    CHECK_EQ(st.timers.onMinutesSet, 60);
+    CHECK_EQ(st.timers.offMinutesSet, 120);
+    CHECK_EQ(st.timers.onMinutesRemaining, 30);
+    CHECK_EQ(st.timers.offMinutesRemaining, 90);
+}
+
+static void test_fixed_point(void)
+{
+    /* 0.01 C from the wire through the packed state to Matter */
+    Rig r;
+
+    r.unit.settings[11] = 0x80 + 45;   /* 22.5 C */
+    r.unit.room_temp[6] = 0x80 + 43;   /* 21.5 C */
+    CHECK(r.up());
+
+    heatpumpSettings hs = r.hp.getSettings();
+    heatpumpStatus hst = r.hp.getStatus();
+    heatpump_settings_t settings = { hs.power, hs.mode, hs.temperature, hs.fan, hs.vane,
+                                     hs.wideVane, hs.iSee, true, false };
+    heatpump_status_t status = { hst.roomTemperature, hst.operating, hst.compressorFrequency,
+                                 false };
+    heatpump_timers_t timers = { hst.timers.mode, 0, 0, 0, 0 };
+    heatpump_state_t state = {};
+    heatpump_state_put_settings(&state, &settings);
+    heatpump_state_put_status(&state, &status, &timers);
+
+    heatpump_settings_t out_settings;
+    heatpump_status_t out_status;
+    heatpump_timers_t out_timers;
+    heatpump_state_get_settings(&state, &out_settings);
+    heatpump_state_get_status(&state, &out_status);
+    heatpump_state_get_timers(&state, &out_timers);
+    CHECK_EQ(out_settings.temperature, 2250);
+    CHECK_EQ(out_status.roomTemperature, 2150);
+    CHECK_STR(out_settings.mode, "HEAT");
+
+    uint8_t full[MATTER_HP_FULL_STATE_LEN];
+    matter_encode_full_state(&out_settings, &out_status, &out_timers, HP_LINK_HEALTHY, full);
+    CHECK_EQ(full[6] | (full[7] << 8), 2250);
+    CHECK_EQ(full[8] | (full[9] << 8), 2150);
+
+    /* a Matter setpoint is rounded to what the unit reports back */
+    hp_temp_t temp;
+    CHECK_EQ(matter_setpoint_to_hp(2237, &temp), 0);
+    CHECK_EQ(temp, 2250);
+    CHECK_EQ(matter_setpoint_to_hp(3300, &temp), -EINVAL);
+    r.hp.setTemperature(2237);
+    CHECK(r.hp.update());
+    CHECK_EQ(r.unit.settings[11], 0x80 + 45);
+    CHECK_EQ(r.hp.getTemperature(), 2250);
+}
+
+static void test_state_diff(void)
+{
+    /* one changed field shows up as exactly its bits */
+    heatpump_settings_t settings = { "ON", "COOL", 2250, "AUTO", "AUTO", "|", false, true,
+                                     false };
+    heatpump_state_t a = {}, b;
+
+    heatpump_state_put_settings(&a, &settings);
+    b = a;
+    settings.fan = "QUIET";
+    heatpump_state_put_settings(&b, &settings);
+
+    heatpump_state_t diff = heatpump_state_diff(&a, &b);
+    CHECK(heatpump_state_changed(&diff, HP_STATE_FAN, 0));
+    CHECK(!heatpump_state_changed(&diff, ~HP_STATE_FAN, UINT64_MAX));
+    CHECK_EQ(heatpump_state_get(b.settings, HP_STATE_FAN), HP_FAN_QUIET);
+
+    /* a name outside the enumeration */
+    settings.fan = "TURBO";
+    heatpump_state_put_settings(&b, &settings);
+    CHECK_EQ(heatpump_state_get(b.settings, HP_STATE_FAN), HP_STATE_UNKNOWN);
+}
+
+static void test_clock_wrap(void)
+{
+    /* just before 2^32 ms, where a 32-bit uptime wraps (49.7 days) */
+    const int64_t wrap = (int64_t)1 << 32;
+    Rig r(wrap - 5000);
+
+    CHECK(r.up());
+    uint32_t polls = r.hp.getStats().polls;
+    r.run(20000);
+    CHECK(r.now() > wrap);
+    CHECK(r.hp.isConnected());
+    CHECK_EQ(r.hp.getStats().reconnects, 0);
+    CHECK_EQ(r.hp.getStats().timeouts, 0);
+    CHECK(r.hp.getStats().polls - polls >= 5);
+    CHECK_EQ(r.hp.linkHealth(), LINK_HEALTHY);
+
+    /* and a command right across it */
+    r.hp.setTemperature(HP_TEMP_C(25));
+    CHECK(r.hp.update());
+    CHECK_EQ(r.hp.getTemperature(), HP_TEMP_C(25));
+}
+
+static void test_function_set(void)
+{
+    /* what the driver does for a FUNCTION_SET on cached codes */
+    Rig r;
+
+    CHECK(r.up());
+    heatpumpFunctions functions = r.hp.getFunctions(true);
+    CHECK(functions.isValid());
+    CHECK_EQ(functions.getValue(102), 1);
+    int64_t stamp = r.hp.getFunctionsStamp();
+    CHECK(stamp != 0);
+
+    functions = r.hp.getFunctions();
+    CHECK(functions.setValue(102, 3));
+    r.unit.sent.clear();
+    CHECK(r.hp.setFunctions(functions));
+    /* only the half that changed */
+    CHECK_EQ(r.unit.count(cn105::CMD_SET, cn105::SetFunctions1::code), 1);
+    CHECK_EQ(r.unit.count(cn105::CMD_SET, cn105::SetFunctions2::code), 0);
+    CHECK_EQ(r.unit.functions1[2], ((102 - 100) << 2) + 3);
+
+    /* a changed stamp is what makes the driver save the record */
+    CHECK(r.hp.getFunctionsStamp() > stamp);
+    heatpumpFunctions saved = r.hp.getFunctions();
+    CHECK(saved.isValid());
+    CHECK_EQ(saved.getValue(102), 3);
+    CHECK_EQ(saved.getValue(101), 1);
+
+    /* nothing to send, nothing new to save */
+    stamp = r.hp.getFunctionsStamp();
+    CHECK(r.hp.setFunctions(saved));
+    CHECK_EQ(r.hp.getFunctionsStamp(), stamp);
+
+    /* unacked: unconfirmed, the next call reads the unit again */
+    CHECK(saved.setValue(120, 2));
+    r.unit.drop_set_acks = 1;
+    CHECK(!r.hp.setFunctions(saved));
+    CHECK_EQ(r.hp.getFunctionsStamp(), 0);
+}
+
+static void test_bad_length(void)
+{
+    /* a header claiming more data than a frame holds, then a good reply */
+    static const uint8_t corrupt[] = { cn105::START, cn105::CMD_GET_REPLY, cn105::HEADER_2,
+                                       cn105::HEADER_3, 0xff, 0x03, 0x00, 0x00 };
+    Rig r;
+
+    CHECK(r.up());
+    r.unit.inject(corrupt, sizeof(corrupt));
+    r.unit.room_temp[6] = 0x80 + 47;   /* 23.5 C */
+    r.unit.reply(cn105::CMD_GET_REPLY, r.unit.room_temp, cn105::DATA_LEN);
+
+    CHECK_EQ(r.hp.readPacket(), 0);    /* RCVD_PKT_FAIL */
+    CHECK_EQ(r.hp.getStats().framingErrors, 1);
+    CHECK_EQ(r.hp.readPacket(), 3);    /* RCVD_PKT_ROOM_TEMP */
+    CHECK_EQ(r.hp.getRoomTemperature(), 2350);
+    CHECK(r.unit.line.empty());
+}
+
+static void abort_exchange(void *arg)
+{
+    static_cast<TestHeatPump *>(arg)->abortExchange();
+}
+
+static void test_noisy_line(void)
+{
+    /* a line that never stops delivering must not hold a command */
+    Rig r;
+
+    CHECK(r.up());
+    r.unit.noise = true;
+    r.hp.setTemperature(HP_TEMP_C(25));
+    int64_t start = r.now();
+    CHECK(!r.hp.update());
+    CHECK(r.now() - start < 10000);
+    CHECK_EQ(r.hp.getStats().setFailed, 1);
+
+    start = r.now();
+    CHECK(!r.hp.getFunctions(true).isValid());
+    CHECK(r.now() - start < 10000);
+
+    r.hp.resetLink();
+    CHECK(!r.hp.isConnected());
+}
+
+static void test_abort_update(void)
+{
+    Rig r;
+
+    CHECK(r.up());
+    r.unit.drop_set_acks = 3;
+    r.unit.on_abort = abort_exchange;
+    r.unit.abort_arg = &r.hp;
+    r.unit.noise = true;
+    r.unit.abort_after = r.unit.bytes_read + 10;
+    r.hp.setTemperature(HP_TEMP_C(25));
+    int64_t start = r.now();
+    CHECK(!r.hp.update());
+    /* the attempt in flight ends, no further ones, no backoff */
+    CHECK(r.now() - start < 200);
+    CHECK_EQ(r.unit.count(cn105::CMD_SET, cn105::SetSettings::code), 1);
+
+    /* until the link is reset, then it works again */
+    r.unit.noise = false;
+    r.unit.line.clear();
+    r.hp.resetLink();
+    r.unit.drop_set_acks = 0;
+    CHECK(r.up());
+    CHECK(r.hp.update());
+    CHECK_EQ(r.hp.getTemperature(), HP_TEMP_C(25));
+}
+
+static void test_abort_functions(void)
+{
+    Rig r;
+
+    CHECK(r.up());
+    r.unit.on_abort = abort_exchange;
+    r.unit.abort_arg = &r.hp;
+    r.unit.abort_after = r.unit.bytes_read + 3;   /* inside the first reply */
+    int64_t start = r.now();
+    CHECK(!r.hp.getFunctions(true).isValid());
+    /* the five 100 ms rereads are skipped */
+    CHECK(r.now() - start < 300);
+    CHECK_EQ(r.unit.count(cn105::CMD_GET, cn105::GetFunctions2::code), 1);
+}
+
+struct Test {
+    const char *name;
+    void (*run)(void);
+};
+
+static const Test tests[] = {
+    { "connect", test_connect },
+    { "connect_probe", test_connect_probe },
+    { "update_ack", test_update_ack },
+    { "update_retry_backoff", test_update_retry_backoff },
+    { "schema_fields", test_schema_fields },
+    { "update_not_applied", test_update_not_applied },
+    { "decode_settings", test_decode_settings },
+    { "decode_room_temp", test_decode_room_temp },
+    { "decode_status_timers", test_decode_status_timers },
+    { "fixed_point", test_fixed_point },
+    { "state_diff", test_state_diff },
+    { "clock_wrap", test_clock_wrap },
+    { "function_set", test_function_set },
+    { "bad_length", test_bad_length },
+    { "noisy_line", test_noisy_line },
+    { "abort_update", test_abort_update },
+    { "abort_functions", test_abort_functions },
+};
+
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    int run = 0;
+
+    for (const Test &t : tests) {
+        if (filter && strstr(t.name, filter) == NULL) {
+            continue;
+        }
+        int before = failures;
+        t.run();
+        printf("%-24s %s\n", t.name, failures == before ? "ok" : "FAILED");
+        run++;
+    }
+    printf("%d tests, %d checks, %d failed\n", run, checks, failures);
+    return failures == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+/**
+ * @file heatpump_state.h
+ * @brief Heat pump state packed into two 64-bit words
+ *
+ * The driver keeps and publishes its state in this form. Every field
+ * has a fixed place in one of the words, so two states compare with one
+ * XOR per word: the result is zero when nothing changed, and otherwise
+ * the changed bits, which the HP_STATE_* and HP_STATUS_* masks below
+ * turn into the changed fields. The string-based structures of
+ * heatpump_types.h are unpacked from it for the public getters.
+ *
+ * Pure functions with no kernel dependencies, shared by the driver and
+ * the host benchmarks (host/hp_bench.cpp).
+ */
+
+#ifndef HEATPUMP_STATE_H
+#define HEATPUMP_STATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "heatpump_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Packed heat pump state
+ */
+typedef struct {
+    uint64_t settings;  /**< HP_STATE_* fields: settings, operating and flags */
+    uint64_t status;    /**< HP_STATUS_* fields: room temperature, compressor, timers */
+} heatpump_state_t;
+
+/** @brief Mask of a field of @a width bits at bit @a shift */
+#define HP_STATE_FIELD(shift, width) ((((uint64_t)1 << (width)) - 1) << (shift))
+
+/**
+ * @name Settings word
+ * Enumerated fields hold the heatpump_*_e index, or HP_STATE_UNKNOWN
+ * for a value the unit reported that is not in the enumeration.
+ * @{
+ */
+#define HP_STATE_POWER          HP_STATE_FIELD(0, 1)   /**< 1 = "ON" */
+#define HP_STATE_MODE           HP_STATE_FIELD(1, 3)   /**< heatpump_mode_e */
+#define HP_STATE_SETPOINT       HP_STATE_FIELD(4, 16)  /**< hp_temp_t */
+#define HP_STATE_FAN            HP_STATE_FIELD(20, 3)  /**< heatpump_fan_e */
+#define HP_STATE_VANE           HP_STATE_FIELD(23, 3)  /**< heatpump_vane_e */
+#define HP_STATE_WIDE_VANE      HP_STATE_FIELD(26, 3)  /**< heatpump_wide_vane_e */
+#define HP_STATE_ISEE           HP_STATE_FIELD(29, 1)  /**< i-See sensor enabled */
+#define HP_STATE_OPERATING      HP_STATE_FIELD(30, 1)  /**< Compressor running */
+#define HP_STATE_CONNECTED      HP_STATE_FIELD(31, 1)  /**< CN105 handshake done */
+#define HP_STATE_SETTINGS_STALE HP_STATE_FIELD(32, 1)  /**< Settings not confirmed by the unit */
+#define HP_STATE_STATUS_STALE   HP_STATE_FIELD(33, 1)  /**< Status not confirmed by the unit */
+#define HP_STATE_LINK_HEALTH    HP_STATE_FIELD(34, 2)  /**< heatpump_link_health_e */
+/** @} */
+
+/**
+ * @name Status word
+ * Timers are kept in the unit's 10 minute steps.
+ * @{
+ */
+#define HP_STATUS_ROOM_TEMP     HP_STATE_FIELD(0, 16)  /**< hp_temp_t */
+#define HP_STATUS_COMPRESSOR    HP_STATE_FIELD(16, 8)  /**< Compressor frequency in Hz */
+#define HP_STATUS_TIMER_MODE    HP_STATE_FIELD(24, 2)  /**< "NONE", "OFF", "ON", "BOTH" */
+#define HP_STATUS_ON_SET        HP_STATE_FIELD(26, 8)
+#define HP_STATUS_ON_REMAINING  HP_STATE_FIELD(34, 8)
+#define HP_STATUS_OFF_SET       HP_STATE_FIELD(42, 8)
+#define HP_STATUS_OFF_REMAINING HP_STATE_FIELD(50, 8)
+#define HP_STATUS_TIMERS        (HP_STATUS_TIMER_MODE | HP_STATUS_ON_SET | HP_STATUS_ON_REMAINING | \
+                                 HP_STATUS_OFF_SET | HP_STATUS_OFF_REMAINING)
+/** @} */
+
+/** @brief Enumerated field value for a string outside the enumeration */
+#define HP_STATE_UNKNOWN 7
+
+/** @brief Timer step of the HP_STATUS_ON_* and HP_STATUS_OFF_* fields */
+#define HP_STATE_TIMER_STEP_MINUTES 10
+
+/*
+ * Names of the enumerated fields, the CN105 value tables of the HeatPump
+ * library (heat_pump_schema.h) in C. Constant expressions in C++, where
+ * the driver checks at build time that both list the same names.
+ */
+#ifdef __cplusplus
+#define HP_STATE_NAME_TABLE static constexpr const char *const
+#else
+#define HP_STATE_NAME_TABLE static const char *const
+#endif
+
+HP_STATE_NAME_TABLE heatpump_state_power_names[] = { "OFF", "ON" };
+HP_STATE_NAME_TABLE heatpump_state_mode_names[] = { "HEAT", "DRY", "COOL", "FAN", "AUTO" };
+HP_STATE_NAME_TABLE heatpump_state_fan_names[] = { "AUTO", "QUIET", "1", "2", "3", "4" };
+HP_STATE_NAME_TABLE heatpump_state_vane_names[] = { "AUTO", "1", "2", "3", "4", "5", "SWING" };
+HP_STATE_NAME_TABLE heatpump_state_wide_vane_names[] = { "<<", "<", "|", ">", ">>", "<>",
+                                                         "SWING" };
+HP_STATE_NAME_TABLE heatpump_state_timer_names[] = { "NONE", "OFF", "ON", "BOTH" };
+
+/**
+ * @brief Read a field
+ *
+ * @param word Settings or status word
+ * @param field HP_STATE_* or HP_STATUS_* mask
+ * @return Field value
+ */
+static inline uint32_t heatpump_state_get(uint64_t word, uint64_t field)
+{
+    return (uint32_t)((word & field) >> __builtin_ctzll(field));
+}
+
+/**
+ * @brief Write a field
+ *
+ * @param word Settings or status word
+ * @param field HP_STATE_* or HP_STATUS_* mask
+ * @param value New value, truncated to the field width
+ * @return The word with the field replaced
+ */
+static inline uint64_t heatpump_state_set(uint64_t word, uint64_t field, uint32_t value)
+{
+    return (word & ~field) | (((uint64_t)value << __builtin_ctzll(field)) & field);
+}
+
+/**
+ * @brief Bits that differ between two states
+ *
+ * Test the result with heatpump_state_changed() or against the field
+ * masks.
+ */
+static inline heatpump_state_t heatpump_state_diff(const heatpump_state_t *a,
+                                                   const heatpump_state_t *b)
+{
+    heatpump_state_t diff = { a->settings ^ b->settings, a->status ^ b->status };
+    return diff;
+}
+
+/**
+ * @brief Check a diff for changes
+ *
+ * @param diff Result of heatpump_state_diff()
+ * @param settings_fields HP_STATE_* fields of interest
+ * @param status_fields HP_STATUS_* fields of interest
+ * @return true if any of the fields changed
+ */
+static inline bool heatpump_state_changed(const heatpump_state_t *diff, uint64_t settings_fields,
+                                          uint64_t status_fields)
+{
+    return ((diff->settings & settings_fields) | (diff->status & status_fields)) != 0;
+}
+
+/**
+ * @brief Index of a string in a name table
+ *
+ * The HeatPump library's strings are literals with the same text as
+ * these tables, which the linker merges, so the pointers are compared
+ * first and strcmp() only runs for strings from elsewhere.
+ *
+ * @return Index, HP_STATE_UNKNOWN if not found
+ */
+static inline uint32_t heatpump_state_index(const char *const *names, size_t count,
+                                            const char *value)
+{
+    if (value == NULL) {
+        return HP_STATE_UNKNOWN;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (names[i] == value) {
+            return (uint32_t)i;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(names[i], value) == 0) {
+            return (uint32_t)i;
+        }
+    }
+    return HP_STATE_UNKNOWN;
+}
+
+/**
+ * @brief Name for an enumerated field value
+ *
+ * @return Name, NULL for HP_STATE_UNKNOWN
+ */
+static inline const char *heatpump_state_name(const char *const *names, size_t count,
+                                              uint32_t index)
+{
+    return index < count ? names[index] : NULL;
+}
+
+#define HP_STATE_NAMES(names) names, sizeof(names) / sizeof(names[0])
+
+static inline uint32_t heatpump_state_minutes_to_steps(int minutes)
+{
+    int steps = minutes / HP_STATE_TIMER_STEP_MINUTES;
+    return steps < 0 ? 0 : steps > 255 ? 255 : (uint32_t)steps;
+}
+
+/**
+ * @brief Pack settings into a state
+ *
+ * Sets every settings field, the connected flag and the settings stale
+ * flag; the status word and the other flags are kept.
+ */
+static inline void heatpump_state_put_settings(heatpump_state_t *state,
+                                               const heatpump_settings_t *settings)
+{
+    uint64_t w = state->settings;
+
+    w = heatpump_state_set(w, HP_STATE_POWER,
+                           heatpump_state_index(HP_STATE_NAMES(heatpump_state_power_names),
+                                                settings->power) == 1);
+    w = heatpump_state_set(w, HP_STATE_MODE,
+                           heatpump_state_index(HP_STATE_NAMES(heatpump_state_mode_names),
+                                                settings->mode));
+    w = heatpump_state_set(w, HP_STATE_SETPOINT, (uint16_t)settings->temperature);
+    w = heatpump_state_set(w, HP_STATE_FAN,
+                           heatpump_state_index(HP_STATE_NAMES(heatpump_state_fan_names),
+                                                settings->fan));
+    w = heatpump_state_set(w, HP_STATE_VANE,
+                           heatpump_state_index(HP_STATE_NAMES(heatpump_state_vane_names),
+                                                settings->vane));
+    w = heatpump_state_set(w, HP_STATE_WIDE_VANE,
+                           heatpump_state_index(HP_STATE_NAMES(heatpump_state_wide_vane_names),
+                                                settings->wideVane));
+    w = heatpump_state_set(w, HP_STATE_ISEE, settings->iSee);
+    w = heatpump_state_set(w, HP_STATE_CONNECTED, settings->connected);
+    w = heatpump_state_set(w, HP_STATE_SETTINGS_STALE, settings->stale);
+    state->settings = w;
+}
+
+/**
+ * @brief Pack status and timers into a state
+ *
+ * Sets the status word, the operating flag and the status stale flag.
+ * The compressor frequency saturates at 255 Hz and timers at 2550
+ * minutes, beyond anything the unit reports.
+ */
+static inline void heatpump_state_put_status(heatpump_state_t *state,
+                                             const heatpump_status_t *status,
+                                             const heatpump_timers_t *timers)
+{
+    int frequency = status->compressorFrequency;
+    uint32_t timer_mode = heatpump_state_index(HP_STATE_NAMES(heatpump_state_timer_names),
+                                               timers->mode);
+    uint64_t w = 0;
+
+    w = heatpump_state_set(w, HP_STATUS_ROOM_TEMP, (uint16_t)status->roomTemperature);
+    w = heatpump_state_set(w, HP_STATUS_COMPRESSOR,
+                           frequency < 0 ? 0 : frequency > 255 ? 255 : (uint32_t)frequency);
+    w = heatpump_state_set(w, HP_STATUS_TIMER_MODE, timer_mode == HP_STATE_UNKNOWN ? 0 : timer_mode);
+    w = heatpump_state_set(w, HP_STATUS_ON_SET,
+                           heatpump_state_minutes_to_steps(timers->onMinutesSet));
+    w = heatpump_state_set(w, HP_STATUS_ON_REMAINING,
+                           heatpump_state_minutes_to_steps(timers->onMinutesRemaining));
+    w = heatpump_state_set(w, HP_STATUS_OFF_SET,
+                           heatpump_state_minutes_to_steps(timers->offMinutesSet));
+    w = heatpump_state_set(w, HP_STATUS_OFF_REMAINING,
+                           heatpump_state_minutes_to_steps(timers->offMinutesRemaining));
+    state->status = w;
+
+    state->settings = heatpump_state_set(state->settings, HP_STATE_OPERATING, status->operating);
+    state->settings = heatpump_state_set(state->settings, HP_STATE_STATUS_STALE, status->stale);
+}
+
+/**
+ * @brief Unpack the settings of a state
+ */
+static inline void heatpump_state_get_settings(const heatpump_state_t *state,
+                                               heatpump_settings_t *settings)
+{
+    uint64_t w = state->settings;
+
+    settings->power = heatpump_state_power_names[heatpump_state_get(w, HP_STATE_POWER)];
+    settings->mode = heatpump_state_name(HP_STATE_NAMES(heatpump_state_mode_names),
+                                         heatpump_state_get(w, HP_STATE_MODE));
+    settings->temperature = (hp_temp_t)(uint16_t)heatpump_state_get(w, HP_STATE_SETPOINT);
+    settings->fan = heatpump_state_name(HP_STATE_NAMES(heatpump_state_fan_names),
+                                        heatpump_state_get(w, HP_STATE_FAN));
+    settings->vane = heatpump_state_name(HP_STATE_NAMES(heatpump_state_vane_names),
+                                         heatpump_state_get(w, HP_STATE_VANE));
+    settings->wideVane = heatpump_state_name(HP_STATE_NAMES(heatpump_state_wide_vane_names),
+                                             heatpump_state_get(w, HP_STATE_WIDE_VANE));
+    settings->iSee = heatpump_state_get(w, HP_STATE_ISEE);
+    settings->connected = heatpump_state_get(w, HP_STATE_CONNECTED);
+    settings->stale = heatpump_state_get(w, HP_STATE_SETTINGS_STALE);
+}
+
+/**
+ * @brief Unpack the status of a state
+ */
+static inline void heatpump_state_get_status(const heatpump_state_t *state,
+                                             heatpump_status_t *status)
+{
+    status->roomTemperature = (hp_temp_t)(uint16_t)heatpump_state_get(state->status,
+                                                                      HP_STATUS_ROOM_TEMP);
+    status->operating = heatpump_state_get(state->settings, HP_STATE_OPERATING);
+    status->compressorFrequency = (int)heatpump_state_get(state->status, HP_STATUS_COMPRESSOR);
+    status->stale = heatpump_state_get(state->settings, HP_STATE_STATUS_STALE);
+}
+
+/**
+ * @brief Unpack the timers of a state
+ */
+static inline void heatpump_state_get_timers(const heatpump_state_t *state,
+                                             heatpump_timers_t *timers)
+{
+    uint64_t w = state->status;
+
+    timers->mode = heatpump_state_timer_names[heatpump_state_get(w, HP_STATUS_TIMER_MODE)];
+    timers->onMinutesSet = (int)heatpump_state_get(w, HP_STATUS_ON_SET) *
+                           HP_STATE_TIMER_STEP_MINUTES;
+    timers->onMinutesRemaining = (int)heatpump_state_get(w, HP_STATUS_ON_REMAINING) *
+                                 HP_STATE_TIMER_STEP_MINUTES;
+    timers->offMinutesSet = (int)heatpump_state_get(w, HP_STATUS_OFF_SET) *
+                            HP_STATE_TIMER_STEP_MINUTES;
+    timers->offMinutesRemaining = (int)heatpump_state_get(w, HP_STATUS_OFF_REMAINING) *
+                                  HP_STATE_TIMER_STEP_MINUTES;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEATPUMP_STATE_H */
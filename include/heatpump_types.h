@@ -13,6 +13,8 @@
 #define HEATPUMP_TYPES_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "heat_pump_temp.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,12 +28,13 @@ extern "C" {
 typedef struct {
     const char* power;        /**< Power state: "ON", "OFF" */
     const char* mode;         /**< Operating mode: "HEAT", "DRY", "COOL", "FAN", "AUTO" */
-    float temperature;        /**< Target temperature in Celsius (16-31°C) */
+    hp_temp_t temperature;    /**< Target temperature in 0.01°C (16-31°C) */
     const char* fan;          /**< Fan speed: "AUTO", "QUIET", "1", "2", "3", "4" */
     const char* vane;         /**< Vertical vane position: "AUTO", "1", "2", "3", "4", "5", "SWING" */
     const char* wideVane;     /**< Horizontal vane position: "<<", "<", "|", ">", ">>", "<>", "SWING" */
     bool iSee;               /**< i-See sensor enabled/disabled */
     bool connected;          /**< Connection status with heat pump */
+    bool stale;              /**< Restored from flash, not yet confirmed by the heat pump */
 } heatpump_settings_t;
 
 /**
@@ -40,9 +43,10 @@ typedef struct {
  * Contains read-only status information from the heat pump
  */
 typedef struct {
-    float roomTemperature;       /**< Current room temperature in Celsius */
+    hp_temp_t roomTemperature;   /**< Current room temperature in 0.01°C */
     bool operating;              /**< True if heat pump is actively heating/cooling */
     int compressorFrequency;     /**< Compressor frequency in Hz (0 when off) */
+    bool stale;                  /**< Restored from flash, not yet confirmed by the heat pump */
 } heatpump_status_t;
 
 /**
@@ -58,6 +62,32 @@ typedef struct {
     int offMinutesRemaining;    /**< Minutes remaining for OFF timer */
 } heatpump_timers_t;
 
+/**
+ * @brief Heat pump capability profile
+ *
+ * Details learned from the unit while connected, kept so they are
+ * known again immediately after a reboot
+ */
+typedef struct {
+    uint32_t bitrate;            /**< Baud rate the unit answered on */
+    bool halfDegreeSetpoint;     /**< Setpoint reported in 0.5°C steps */
+    bool wideVaneAdjust;         /**< Wide vane adjustment flag reported */
+} heatpump_profile_t;
+
+/**
+ * @brief CN105 link health, from the last few exchanges
+ */
+typedef enum {
+    HP_LINK_HEALTHY = 0,  /**< Replies arrive intact */
+    HP_LINK_DEGRADED,     /**< Recent errors, polling at half rate */
+    HP_LINK_DOWN          /**< No link, reconnecting */
+} heatpump_link_health_e;
+
+/**
+ * @brief Size of the raw function code block (0x20 + 0x22 replies)
+ */
+#define HP_FUNCTION_DATA_LEN 30
+
 /**
  * @brief Heat pump operating modes enumeration
  */
@@ -108,10 +138,10 @@ typedef enum {
 } heatpump_wide_vane_e;
 
 /**
- * @brief Temperature limits
+ * @brief Setpoint limits
  */
-#define HP_TEMP_MIN 16.0f
-#define HP_TEMP_MAX 31.0f
+#define HP_TEMP_MIN HP_TEMP_C(16)
+#define HP_TEMP_MAX HP_TEMP_C(31)
 
 /**
  * @brief Serial communication parameters for CN105
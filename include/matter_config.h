@@ -31,17 +31,20 @@ extern "C" {
 #define MATTER_CLUSTER_TEMP_MEASUREMENT 0x0402  /**< Temperature Measurement cluster */
 
 /**
- * @brief Custom Vendor-Specific Cluster IDs
+ * @brief Custom Vendor-Specific Cluster ID
  * 
- * These clusters provide access to Mitsubishi-specific features
- * not available in standard Matter clusters.
+ * A single cluster carries the Mitsubishi-specific features not
+ * available in standard Matter clusters, so they cost one set of
+ * cluster metadata and one descriptor entry.
  * 
  * Vendor ID range: 0xFFF1XXXX (example vendor ID)
  */
-#define MATTER_CLUSTER_VANE_CONTROL     0xFFF1FC01  /**< Vertical vane control */
-#define MATTER_CLUSTER_WIDE_VANE_CONTROL 0xFFF1FC02 /**< Horizontal vane control */
-#define MATTER_CLUSTER_HP_STATUS        0xFFF1FC03  /**< Heat pump status information */
-#define MATTER_CLUSTER_ISEE_CONTROL     0xFFF1FC04  /**< i-See sensor control */
+#define MATTER_CLUSTER_HP_EXTENSION     0xFFF1FC00  /**< Mitsubishi extension cluster */
+
+/**
+ * @brief On/Off Cluster Attributes
+ */
+#define MATTER_ATTR_ON_OFF                      0x0000  /**< Power state */
 
 /**
  * @brief Thermostat Cluster Attributes
@@ -50,8 +53,26 @@ extern "C" {
 #define MATTER_ATTR_OCCUPIED_COOLING_SETPOINT   0x0011  /**< Cooling setpoint */
 #define MATTER_ATTR_OCCUPIED_HEATING_SETPOINT   0x0012  /**< Heating setpoint */
 #define MATTER_ATTR_SYSTEM_MODE                 0x001C  /**< System mode (off/heat/cool/auto) */
+#define MATTER_ATTR_NUM_WEEKLY_TRANSITIONS      0x0021  /**< Schedule transitions supported */
+#define MATTER_ATTR_NUM_DAILY_TRANSITIONS       0x0022  /**< Schedule transitions per day */
 #define MATTER_ATTR_THERMOSTAT_RUNNING_STATE    0x0029  /**< Running state */
 
+/**
+ * @brief Thermostat Cluster Commands (Schedule Configuration feature)
+ */
+#define MATTER_CMD_SET_WEEKLY_SCHEDULE          0x01    /**< Replace the transitions of some days */
+#define MATTER_CMD_GET_WEEKLY_SCHEDULE          0x02    /**< Read the transitions of some days */
+#define MATTER_CMD_CLEAR_WEEKLY_SCHEDULE        0x03    /**< Remove all transitions */
+
+/**
+ * @brief Thermostat ScheduleForSequence mode bits
+ */
+#define MATTER_SCHEDULE_MODE_HEAT_SETPOINT      0x01    /**< Transitions carry a heating setpoint */
+#define MATTER_SCHEDULE_MODE_COOL_SETPOINT      0x02    /**< Transitions carry a cooling setpoint */
+
+/** Matter epoch (2000-01-01 00:00 UTC) in Unix seconds */
+#define MATTER_EPOCH_UNIX_S                     946684800LL
+
 /**
  * @brief Fan Control Cluster Attributes
  */
@@ -60,6 +81,50 @@ extern "C" {
 #define MATTER_ATTR_PERCENT_SETTING             0x0002  /**< Fan speed percentage */
 #define MATTER_ATTR_PERCENT_CURRENT             0x0003  /**< Current fan speed percentage */
 
+/**
+ * @brief Temperature Measurement Cluster Attributes
+ */
+#define MATTER_ATTR_MEASURED_VALUE              0x0000  /**< Room temperature */
+
+/**
+ * @brief Mitsubishi Extension Cluster Attributes
+ */
+#define MATTER_ATTR_HP_VANE_POSITION            0x0000  /**< Vertical vane position (0-6) */
+#define MATTER_ATTR_HP_WIDE_VANE_POSITION       0x0001  /**< Horizontal vane position (0-6) */
+#define MATTER_ATTR_HP_COMPRESSOR_FREQUENCY     0x0002  /**< Compressor frequency in Hz */
+#define MATTER_ATTR_HP_OPERATING                0x0003  /**< Actively heating/cooling */
+#define MATTER_ATTR_HP_ISEE_ENABLED             0x0004  /**< i-See sensor enabled */
+#define MATTER_ATTR_HP_LINK_HEALTH              0x0005  /**< CN105 link health (heatpump_link_health_e) */
+#define MATTER_ATTR_HP_TIMER_MODE               0x0006  /**< Timer mode (MATTER_HP_TIMER_*) */
+#define MATTER_ATTR_HP_ON_TIMER_REMAINING       0x0007  /**< Minutes until the on timer fires */
+#define MATTER_ATTR_HP_OFF_TIMER_REMAINING      0x0008  /**< Minutes until the off timer fires */
+#define MATTER_ATTR_HP_FULL_STATE               0x0010  /**< All of the above in one octet string */
+
+/**
+ * @brief Mitsubishi Extension Cluster Commands
+ */
+#define MATTER_CMD_HP_READ_HISTORY              0x0000  /**< Bulk read of on-device history */
+
+/**
+ * @brief Timer Mode Values
+ */
+#define MATTER_HP_TIMER_NONE 0x00
+#define MATTER_HP_TIMER_OFF  0x01
+#define MATTER_HP_TIMER_ON   0x02
+#define MATTER_HP_TIMER_BOTH 0x03
+
+/**
+ * @brief FullState layout (version 1, little endian)
+ */
+#define MATTER_HP_FULL_STATE_VERSION    1
+#define MATTER_HP_FULL_STATE_LEN        18
+
+#define MATTER_HP_STATE_FLAG_POWER      0x01    /**< Power on */
+#define MATTER_HP_STATE_FLAG_OPERATING  0x02    /**< Compressor running */
+#define MATTER_HP_STATE_FLAG_ISEE       0x04    /**< i-See sensor enabled */
+#define MATTER_HP_STATE_FLAG_STALE      0x08    /**< Restored from flash, not yet confirmed */
+#define MATTER_HP_STATE_FLAG_CONNECTED  0x10    /**< CN105 link up */
+
 /**
  * @brief Thermostat System Mode Values
  */
@@ -70,6 +135,13 @@ extern "C" {
 #define MATTER_THERMOSTAT_MODE_DRY      0x08  /**< Precool/Dehumidify */
 #define MATTER_THERMOSTAT_MODE_FAN_ONLY 0x07
 
+/**
+ * @brief Thermostat Running State Bits
+ */
+#define MATTER_RUNNING_STATE_HEAT       0x0001
+#define MATTER_RUNNING_STATE_COOL       0x0002
+#define MATTER_RUNNING_STATE_FAN        0x0004
+
 /**
  * @brief Fan Mode Values
  */
@@ -81,33 +153,33 @@ extern "C" {
 #define MATTER_FAN_MODE_AUTO   0x05
 #define MATTER_FAN_MODE_SMART  0x06
 
+/** FanModeSequence: Off/Low/Med/High/Auto */
+#define MATTER_FAN_MODE_SEQUENCE_OFF_LOW_MED_HIGH_AUTO 0x02
+
 /**
  * @brief Matter Endpoint Configuration
  */
 #define MATTER_ENDPOINT_ROOT        0   /**< Root endpoint */
 #define MATTER_ENDPOINT_THERMOSTAT  1   /**< Thermostat endpoint */
 
-/**
- * @brief Temperature Conversion Macros
- * 
- * Matter uses temperature in units of 0.01°C (hundredths of degrees)
- */
-#define CELSIUS_TO_MATTER_TEMP(temp) ((int16_t)((temp) * 100))
-#define MATTER_TEMP_TO_CELSIUS(temp) ((float)(temp) / 100.0f)
-
 /**
  * @brief Default Configuration Values
  */
-#define DEFAULT_MIN_SETPOINT_CELSIUS    16.0f   /**< Minimum temperature setpoint */
-#define DEFAULT_MAX_SETPOINT_CELSIUS    31.0f   /**< Maximum temperature setpoint */
-#define DEFAULT_SETPOINT_CELSIUS        22.0f   /**< Default temperature setpoint */
+#define DEFAULT_MIN_SETPOINT    1600    /**< Minimum temperature setpoint, 0.01°C */
+#define DEFAULT_MAX_SETPOINT    3100    /**< Maximum temperature setpoint, 0.01°C */
+#define DEFAULT_SETPOINT        2200    /**< Default temperature setpoint, 0.01°C */
 
 /**
  * @brief Matter Stack Configuration
  * 
- * TODO: These values need to be tuned based on actual testing
+ * The stack size comes from Kconfig; use the 'heatpump resources'
+ * report to tune it.
  */
+#ifdef CONFIG_APP_MATTER_THREAD_STACK_SIZE
+#define MATTER_THREAD_STACK_SIZE    CONFIG_APP_MATTER_THREAD_STACK_SIZE
+#else
 #define MATTER_THREAD_STACK_SIZE    4096    /**< Matter task stack size */
+#endif
 #define MATTER_THREAD_PRIORITY      5       /**< Matter task priority */
 
 /**
@@ -116,11 +188,18 @@ extern "C" {
 #define HP_STATUS_UPDATE_INTERVAL_MS    5000    /**< Status polling interval */
 #define HP_SETTINGS_UPDATE_INTERVAL_MS  1000    /**< Settings update interval */
 
+/**
+ * @brief OTA Configuration
+ *
+ * BDX block size asked of the OTA provider. Each block is decoded
+ * before the next is requested, so this bounds the receive buffer only.
+ */
+#define OTA_BDX_BLOCK_SIZE              1024
+
 /* Configuration placeholders for future implementation */
 /* TODO: Implement actual Matter integration */
 /* TODO: Add commissioning configuration */
 /* TODO: Add network credential storage configuration */
-/* TODO: Add OTA update configuration */
 /* TODO: Add factory reset configuration */
 
 #ifdef __cplusplus
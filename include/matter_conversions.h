@@ -0,0 +1,295 @@
+/**
+ * @file matter_conversions.h
+ * @brief Conversions between Matter attribute values and heat pump settings
+ *
+ * Pure functions with no kernel dependencies, shared by the attribute
+ * handlers and the host benchmarks (host/hp_bench.cpp).
+ */
+
+#ifndef MATTER_CONVERSIONS_H
+#define MATTER_CONVERSIONS_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include "heatpump_types.h"
+#include "matter_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Heat pump mode for a Matter thermostat system mode
+ *
+ * @param mode MATTER_THERMOSTAT_MODE_* value other than OFF
+ * @return Heat pump mode string, NULL if unsupported
+ */
+static inline const char *matter_mode_to_hp(uint8_t mode)
+{
+    switch (mode) {
+        case MATTER_THERMOSTAT_MODE_HEAT:     return "HEAT";
+        case MATTER_THERMOSTAT_MODE_COOL:     return "COOL";
+        case MATTER_THERMOSTAT_MODE_AUTO:     return "AUTO";
+        case MATTER_THERMOSTAT_MODE_DRY:      return "DRY";
+        case MATTER_THERMOSTAT_MODE_FAN_ONLY: return "FAN";
+        default:                              return NULL;
+    }
+}
+
+/**
+ * @brief Matter thermostat system mode for a heat pump mode
+ *
+ * @param mode Heat pump mode string
+ * @return MATTER_THERMOSTAT_MODE_* value, -EINVAL if unknown
+ */
+static inline int matter_mode_from_hp(const char *mode)
+{
+    static const struct {
+        const char *hp;
+        uint8_t matter;
+    } modes[] = {
+        { "HEAT", MATTER_THERMOSTAT_MODE_HEAT },
+        { "COOL", MATTER_THERMOSTAT_MODE_COOL },
+        { "AUTO", MATTER_THERMOSTAT_MODE_AUTO },
+        { "DRY",  MATTER_THERMOSTAT_MODE_DRY },
+        { "FAN",  MATTER_THERMOSTAT_MODE_FAN_ONLY },
+    };
+
+    for (size_t i = 0; mode != NULL && i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(mode, modes[i].hp) == 0) {
+            return modes[i].matter;
+        }
+    }
+    return -EINVAL;
+}
+
+/**
+ * @brief Heat pump fan speed for a Matter fan mode
+ *
+ * Matter OFF maps to QUIET since the indoor fan cannot be stopped
+ * while the unit is powered.
+ *
+ * @param mode MATTER_FAN_MODE_* value
+ * @return Heat pump fan string, NULL if unsupported
+ */
+static inline const char *matter_fan_to_hp(uint8_t mode)
+{
+    switch (mode) {
+        case MATTER_FAN_MODE_OFF:    return "QUIET";
+        case MATTER_FAN_MODE_LOW:    return "1";
+        case MATTER_FAN_MODE_MEDIUM: return "2";
+        case MATTER_FAN_MODE_HIGH:   return "4";
+        case MATTER_FAN_MODE_ON:     return "3";
+        case MATTER_FAN_MODE_AUTO:   return "AUTO";
+        default:                     return NULL;
+    }
+}
+
+/**
+ * @brief Heat pump vane setting for a vane control position (0-6)
+ *
+ * @return Heat pump vane string, NULL if out of range
+ */
+static inline const char *matter_vane_to_hp(uint8_t position)
+{
+    static const char *const vane[] = { "AUTO", "1", "2", "3", "4", "5", "SWING" };
+
+    return position < sizeof(vane) / sizeof(vane[0]) ? vane[position] : NULL;
+}
+
+/**
+ * @brief Heat pump wide vane setting for a wide vane control position (0-6)
+ *
+ * @return Heat pump wide vane string, NULL if out of range
+ */
+static inline const char *matter_wide_vane_to_hp(uint8_t position)
+{
+    static const char *const wide_vane[] = { "<<", "<", "|", ">", ">>", "<>", "SWING" };
+
+    return position < sizeof(wide_vane) / sizeof(wide_vane[0]) ? wide_vane[position] : NULL;
+}
+
+/**
+ * @brief Matter fan mode for a heat pump fan speed
+ *
+ * Inverse of matter_fan_to_hp(), so a written mode reads back unchanged.
+ *
+ * @param fan Heat pump fan string
+ * @return MATTER_FAN_MODE_* value, -EINVAL if unknown
+ */
+static inline int matter_fan_from_hp(const char *fan)
+{
+    static const uint8_t modes[] = {
+        MATTER_FAN_MODE_OFF, MATTER_FAN_MODE_LOW, MATTER_FAN_MODE_MEDIUM,
+        MATTER_FAN_MODE_HIGH, MATTER_FAN_MODE_ON, MATTER_FAN_MODE_AUTO,
+    };
+
+    for (size_t i = 0; fan != NULL && i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(fan, matter_fan_to_hp(modes[i])) == 0) {
+            return modes[i];
+        }
+    }
+    return -EINVAL;
+}
+
+/**
+ * @brief Vane control position (0-6) for a heat pump vane setting
+ *
+ * @return Position, -EINVAL if unknown
+ */
+static inline int matter_vane_from_hp(const char *vane)
+{
+    const char *name;
+
+    for (uint8_t i = 0; vane != NULL && (name = matter_vane_to_hp(i)) != NULL; i++) {
+        if (strcmp(vane, name) == 0) {
+            return i;
+        }
+    }
+    return -EINVAL;
+}
+
+/**
+ * @brief Wide vane control position (0-6) for a heat pump wide vane setting
+ *
+ * @return Position, -EINVAL if unknown
+ */
+static inline int matter_wide_vane_from_hp(const char *wide_vane)
+{
+    const char *name;
+
+    for (uint8_t i = 0; wide_vane != NULL && (name = matter_wide_vane_to_hp(i)) != NULL; i++) {
+        if (strcmp(wide_vane, name) == 0) {
+            return i;
+        }
+    }
+    return -EINVAL;
+}
+
+/**
+ * @brief Thermostat ThermostatRunningState for the heat pump state
+ *
+ * The unit only reports whether the compressor runs, so the heat or
+ * cool bit follows the mode; in AUTO it follows the side of the
+ * setpoint the room is on.
+ *
+ * @param settings Current settings
+ * @param status Current status
+ * @return MATTER_RUNNING_STATE_* bits
+ */
+static inline uint16_t matter_running_state(const heatpump_settings_t *settings,
+                                            const heatpump_status_t *status)
+{
+    if (!status->operating || settings->power == NULL || strcmp(settings->power, "ON") != 0) {
+        return 0;
+    }
+
+    switch (matter_mode_from_hp(settings->mode)) {
+        case MATTER_THERMOSTAT_MODE_HEAT:
+            return MATTER_RUNNING_STATE_HEAT;
+        case MATTER_THERMOSTAT_MODE_COOL:
+        case MATTER_THERMOSTAT_MODE_DRY:
+            return MATTER_RUNNING_STATE_COOL;
+        case MATTER_THERMOSTAT_MODE_FAN_ONLY:
+            return MATTER_RUNNING_STATE_FAN;
+        case MATTER_THERMOSTAT_MODE_AUTO:
+            return status->roomTemperature < settings->temperature ? MATTER_RUNNING_STATE_HEAT
+                                                                   : MATTER_RUNNING_STATE_COOL;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Extension cluster timer mode for a heat pump timer mode
+ *
+ * @param mode Heat pump timer mode string ("NONE", "OFF", "ON", "BOTH")
+ * @return MATTER_HP_TIMER_* value, -EINVAL if unknown
+ */
+static inline int matter_timer_mode_from_hp(const char *mode)
+{
+    static const char *const modes[] = { "NONE", "OFF", "ON", "BOTH" };
+
+    for (size_t i = 0; mode != NULL && i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(mode, modes[i]) == 0) {
+            return (int)i;
+        }
+    }
+    return -EINVAL;
+}
+
+static inline void matter_put_le16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief Encode the extension cluster FullState attribute
+ *
+ * Values with no Matter equivalent are encoded as 0xFF.
+ *
+ * @param settings Current settings
+ * @param status Current status
+ * @param timers Current timers
+ * @param link_health heatpump_link_health_e value
+ * @param out Receives MATTER_HP_FULL_STATE_LEN bytes
+ */
+static inline void matter_encode_full_state(const heatpump_settings_t *settings,
+                                            const heatpump_status_t *status,
+                                            const heatpump_timers_t *timers,
+                                            uint8_t link_health,
+                                            uint8_t out[MATTER_HP_FULL_STATE_LEN])
+{
+    bool power = settings->power != NULL && strcmp(settings->power, "ON") == 0;
+    int mode = power ? matter_mode_from_hp(settings->mode) : MATTER_THERMOSTAT_MODE_OFF;
+    int fan = matter_fan_from_hp(settings->fan);
+    int vane = matter_vane_from_hp(settings->vane);
+    int wide_vane = matter_wide_vane_from_hp(settings->wideVane);
+    int timer_mode = matter_timer_mode_from_hp(timers->mode);
+
+    out[0] = MATTER_HP_FULL_STATE_VERSION;
+    out[1] = (power ? MATTER_HP_STATE_FLAG_POWER : 0) |
+             (status->operating ? MATTER_HP_STATE_FLAG_OPERATING : 0) |
+             (settings->iSee ? MATTER_HP_STATE_FLAG_ISEE : 0) |
+             (settings->stale || status->stale ? MATTER_HP_STATE_FLAG_STALE : 0) |
+             (link_health != HP_LINK_DOWN ? MATTER_HP_STATE_FLAG_CONNECTED : 0);
+    out[2] = mode < 0 ? 0xFF : (uint8_t)mode;
+    out[3] = fan < 0 ? 0xFF : (uint8_t)fan;
+    out[4] = vane < 0 ? 0xFF : (uint8_t)vane;
+    out[5] = wide_vane < 0 ? 0xFF : (uint8_t)wide_vane;
+    matter_put_le16(&out[6], (uint16_t)settings->temperature);
+    matter_put_le16(&out[8], (uint16_t)status->roomTemperature);
+    matter_put_le16(&out[10], (uint16_t)status->compressorFrequency);
+    out[12] = link_health;
+    out[13] = timer_mode < 0 ? 0xFF : (uint8_t)timer_mode;
+    matter_put_le16(&out[14], (uint16_t)timers->onMinutesRemaining);
+    matter_put_le16(&out[16], (uint16_t)timers->offMinutesRemaining);
+}
+
+/**
+ * @brief Heat pump setpoint for a Matter setpoint, with a range check
+ *
+ * Both are in 0.01°C. The result is rounded to the 0.5°C the unit
+ * supports, so it equals what the unit reports back.
+ *
+ * @param matter_temp Setpoint in 0.01°C
+ * @param temp Rounded setpoint, set even when out of range
+ * @return 0 on success, -EINVAL if outside HP_TEMP_MIN..HP_TEMP_MAX
+ */
+static inline int matter_setpoint_to_hp(int16_t matter_temp, hp_temp_t *temp)
+{
+    *temp = hp_temp_round(matter_temp, HP_TEMP_HALF);
+
+    if (*temp < HP_TEMP_MIN || *temp > HP_TEMP_MAX) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATTER_CONVERSIONS_H */
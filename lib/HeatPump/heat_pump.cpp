@@ -17,7 +17,10 @@
   License along with this library; if not, write to the Free Software
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
+#include <string.h>
+
 #include "heat_pump.h"
+#include "heat_pump_impl.h"
 
 // Structures //////////////////////////////////////////////////////////////////
 
@@ -68,792 +71,6 @@ bool operator!=(const heatpumpTimers& lhs, const heatpumpTimers& rhs) {
 }
 
 
-// Constructor /////////////////////////////////////////////////////////////////
-
-HeatPump::HeatPump() {
-  lastWanted = k_uptime_get_32();
-  lastSend = 0;
-  infoMode = 0;
-  lastRecv = k_uptime_get_32() - (PACKET_SENT_INTERVAL_MS * 10);
-  autoUpdate = false;
-  firstRun = true;
-  tempMode = false;
-  waitForRead = false;
-  externalUpdate = false;
-  wideVaneAdj = false;
-  functions = heatpumpFunctions();
-}
-
-// Public Methods //////////////////////////////////////////////////////////////
-
-bool HeatPump::connect(const struct device *dev, int bitrate) {
-  if (dev != NULL) {
-    uart_dev = dev;
-  }
-  bool retry = false;
-  if(bitrate == 0) {
-    bitrate = 2400;
-    retry = true;
-  }
-  struct uart_config cfg;
-  cfg.baudrate = bitrate;
-  cfg.parity = UART_CFG_PARITY_EVEN;
-  cfg.stop_bits = UART_CFG_STOP_BITS_1;
-  cfg.data_bits = UART_CFG_DATA_BITS_8;
-  cfg.flow_ctrl = UART_CFG_FLOW_CTRL_NONE;
-  uart_configure(uart_dev, &cfg);
-  if(onConnectCallback) {
-    onConnectCallback();
-  }
-  
-  // settle before we start sending packets
-  k_msleep(2000);
-
-  // send the CONNECT packet twice - need to copy the CONNECT packet locally
-  uint8_t packet[CONNECT_LEN];
-  memcpy(packet, CONNECT, CONNECT_LEN);
-  //for(int count = 0; count < 2; count++) {
-  writePacket(packet, CONNECT_LEN);
-  while(!canRead()) { k_msleep(10); }
-  int packetType = readPacket();
-  if (packetType != RCVD_PKT_CONNECT_SUCCESS && retry)
-  {
-    return connect(dev, 9600);
-  }
-  connected = (packetType == RCVD_PKT_CONNECT_SUCCESS);
-  return connected;
-  //}
-}
-
-bool HeatPump::update() {
-  while(!canSend(false)) { k_msleep(10); }
-
-  // Flush the serial buffer before updating settings to clear out
-  // any remaining responses that would prevent us from receiving
-  // RCVD_PKT_UPDATE_SUCCESS
-  readAllPackets();
-
-  uint8_t packet[PACKET_LEN] = {};
-  createPacket(packet, wantedSettings);
-  writePacket(packet, PACKET_LEN);
-
-  while(!canRead()) { k_msleep(10); }
-  int packetType = readPacket();
-
-  if(packetType == RCVD_PKT_UPDATE_SUCCESS) {
-    // call sync() to get the latest settings from the heatpump for autoUpdate, which should now have the updated settings
-    if(autoUpdate) {
-      while(!canSend(true)) {
-        k_msleep(10);
-      }
-	    sync(RQST_PKT_SETTINGS);
-    } else {
-      // No auto update, but the next time we sync, fetch the updated settings first
-      infoMode = 0;
-    }
-
-    return true;
-  } else {
-    return false;
-  }
-}
-
-void HeatPump::sync(uint8_t packetType) {
-  if((!connected) || (k_uptime_get_32() - lastRecv > (PACKET_SENT_INTERVAL_MS * 10))) {
-    connect(NULL);
-  }
-  else if(canRead()) {
-    readAllPackets();
-  }
-  else if(autoUpdate && !firstRun && wantedSettings != currentSettings && packetType == PACKET_TYPE_DEFAULT) {
-    update();
-  }
-  else if(canSend(true)) {
-    uint8_t packet[PACKET_LEN] = {};
-    createInfoPacket(packet, packetType);
-    writePacket(packet, PACKET_LEN);
-  }
-}
-
-void HeatPump::enableExternalUpdate() {
-  autoUpdate = true;
-  externalUpdate = true;
-}
-
-void HeatPump::disableExternalUpdate() {
-  externalUpdate = false;
-}
-
-void HeatPump::enableAutoUpdate() {
-  autoUpdate = true;
-}
-
-void HeatPump::disableAutoUpdate() {
-  autoUpdate = false;
-}
-
-heatpumpSettings HeatPump::getSettings() {
-  return currentSettings;
-}
-
-heatpumpSettings HeatPump::getWantedSettings() {
-  return wantedSettings;
-}
-
-unsigned long HeatPump::getLastWanted() {
-  return lastWanted;
-}
-
-void HeatPump::setFastSync(bool setting) {
-  fastSync = setting;
-}
-
-bool HeatPump::isConnected() {
-  return connected;
-}
-
-void HeatPump::setSettings(heatpumpSettings settings) {
-  setPowerSetting(settings.power);
-  setModeSetting(settings.mode);
-  setTemperature(settings.temperature);
-  setFanSpeed(settings.fan);
-  setVaneSetting(settings.vane);
-  setWideVaneSetting(settings.wideVane);
-}
-
-bool HeatPump::getPowerSettingBool() {
-  return currentSettings.power == POWER_MAP[1] ? true : false;
-}
-
-void HeatPump::setPowerSetting(bool setting) {
-  wantedSettings.power = lookupByteMapIndex(POWER_MAP, 2, POWER_MAP[setting ? 1 : 0]) > -1 ? POWER_MAP[setting ? 1 : 0] : POWER_MAP[0];
-  lastWanted = k_uptime_get_32();
-}
-
-const char* HeatPump::getPowerSetting() {
-  return currentSettings.power;
-}
-
-void HeatPump::setPowerSetting(const char* setting) {
-  int index = lookupByteMapIndex(POWER_MAP, 2, setting);
-  if (index > -1) {
-    wantedSettings.power = POWER_MAP[index];
-  } else {
-    wantedSettings.power = POWER_MAP[0];
-  }
-  lastWanted = k_uptime_get_32();
-}
-
-const char* HeatPump::getModeSetting() {
-  return currentSettings.mode;
-}
-
-void HeatPump::setModeSetting(const char* setting) {
-  int index = lookupByteMapIndex(MODE_MAP, 5, setting);
-  if (index > -1) {
-    wantedSettings.mode = MODE_MAP[index];
-  } else {
-    wantedSettings.mode = MODE_MAP[0];
-  }
-  lastWanted = k_uptime_get_32();
-}
-
-float HeatPump::getTemperature() {
-  return currentSettings.temperature;
-}
-
-void HeatPump::setTemperature(float setting) {
-  if(!tempMode){
-    wantedSettings.temperature = lookupByteMapIndex(TEMP_MAP, 16, (int)(setting + 0.5f)) > -1 ? setting : TEMP_MAP[0];
-  }
-  else {
-    setting = setting * 2.0f;
-    setting = roundf(setting);
-    setting = setting / 2.0f;
-    wantedSettings.temperature = setting < 10 ? 10 : (setting > 31 ? 31 : setting);
-  }
-  lastWanted = k_uptime_get_32();
-}
-
-void HeatPump::setRemoteTemperature(float setting) {
-  uint8_t packet[PACKET_LEN] = {};
-  
-  prepareSetPacket(packet, PACKET_LEN);
-  
-  packet[5] = 0x07;
-  if(setting > 0) {
-    packet[6] = 0x01;
-    setting = setting * 2.0f;
-    setting = roundf(setting);
-    setting = setting / 2.0f;
-    float temp1 = 3.0f + ((setting - 10.0f) * 2.0f);
-    packet[7] = (int)temp1;
-    float temp2 = (setting * 2.0f) + 128.0f;
-    packet[8] = (int)temp2;
-  }
-  else {
-    packet[6] = 0x00;
-    packet[8] = 0x80; //MHK1 send 80, even though it could be 00, since ControlByte is 00
-  } 
-  // add the checksum
-  uint8_t chkSum = checkSum(packet, 21);
-  packet[21] = chkSum;
-  while(!canSend(false)) { k_msleep(10); }
-  writePacket(packet, PACKET_LEN);
-}
-
-const char* HeatPump::getFanSpeed() {
-  return currentSettings.fan;
-}
-
-
-void HeatPump::setFanSpeed(const char* setting) {
-  int index = lookupByteMapIndex(FAN_MAP, 6, setting);
-  if (index > -1) {
-    wantedSettings.fan = FAN_MAP[index];
-  } else {
-    wantedSettings.fan = FAN_MAP[0];
-  }
-  lastWanted = k_uptime_get_32();
-}
-
-const char* HeatPump::getVaneSetting() {
-  return currentSettings.vane;
-}
-
-void HeatPump::setVaneSetting(const char* setting) {
-  int index = lookupByteMapIndex(VANE_MAP, 7, setting);
-  if (index > -1) {
-    wantedSettings.vane = VANE_MAP[index];
-  } else {
-    wantedSettings.vane = VANE_MAP[0];
-  }
-  lastWanted = k_uptime_get_32();
-}
-
-const char* HeatPump::getWideVaneSetting() {
-  return currentSettings.wideVane;
-}
-
-void HeatPump::setWideVaneSetting(const char* setting) {
-  int index = lookupByteMapIndex(WIDEVANE_MAP, 7, setting);
-  if (index > -1) {
-    wantedSettings.wideVane = WIDEVANE_MAP[index];
-  } else {
-    wantedSettings.wideVane = WIDEVANE_MAP[0];
-  }
-  lastWanted = k_uptime_get_32();
-}
-
-bool HeatPump::getIseeBool() { //no setter yet
-  return currentSettings.iSee;
-}
-
-heatpumpStatus HeatPump::getStatus() {
-  return currentStatus;
-}
-
-float HeatPump::getRoomTemperature() {
-  return currentStatus.roomTemperature;
-}
-
-bool HeatPump::getOperating() {
-  return currentStatus.operating;
-}
-
-float HeatPump::FahrenheitToCelsius(int tempF) {
-  float temp = (tempF - 32) / 1.8f;                
-  return roundf(temp*2.0f)/2.0f;
-}
-
-int HeatPump::CelsiusToFahrenheit(float tempC) {
-  float temp = (tempC * 1.8f) + 32.0f;
-  return (int)(temp + 0.5f);
-}
-
-void HeatPump::setOnConnectCallback(ON_CONNECT_CALLBACK_SIGNATURE) {
-  this->onConnectCallback = onConnectCallback;
-}
-
-void HeatPump::setSettingsChangedCallback(SETTINGS_CHANGED_CALLBACK_SIGNATURE) {
-  this->settingsChangedCallback = settingsChangedCallback;
-}
-
-void HeatPump::setStatusChangedCallback(STATUS_CHANGED_CALLBACK_SIGNATURE) {
-  this->statusChangedCallback = statusChangedCallback;
-}
-
-void HeatPump::setPacketCallback(PACKET_CALLBACK_SIGNATURE) {
-  this->packetCallback = packetCallback;
-}
-
-void HeatPump::setRoomTempChangedCallback(ROOM_TEMP_CHANGED_CALLBACK_SIGNATURE) {
-  this->roomTempChangedCallback = roomTempChangedCallback;
-}
-
-//#### WARNING, THE FOLLOWING METHOD CAN F--K YOUR HP UP, USE WISELY ####
-void HeatPump::sendCustomPacket(uint8_t data[], int packetLength) {
-  while(!canSend(false)) { k_msleep(10); }
-
-  int plen = packetLength + 2;
-  plen = (plen > PACKET_LEN) ? PACKET_LEN : plen;
-  uint8_t packet[PACKET_LEN];
-  packet[0] = HEADER[0];
-
-  // add data
-  for (int i = 0; i < packetLength; i++) {
-    packet[(i+1)] = data[i]; 
-  }
-
-  // add checksum
-  uint8_t chkSum = checkSum(packet, (plen-1));
-  packet[(plen-1)] = chkSum;
-
-  writePacket(packet, plen);
-}
-
-// Private Methods //////////////////////////////////////////////////////////////
-
-int HeatPump::lookupByteMapIndex(const int valuesMap[], int len, int lookupValue) {
-  for (int i = 0; i < len; i++) {
-    if (valuesMap[i] == lookupValue) {
-      return i;
-    }
-  }
-  return -1;
-}
-
-int HeatPump::lookupByteMapIndex(const char* valuesMap[], int len, const char* lookupValue) {
-  auto ieq = [](const char* a, const char* b) -> bool {
-    if (a == nullptr || b == nullptr) {
-      return false;
-    }
-    while (*a && *b) {
-      unsigned char ca = (unsigned char)*a;
-      unsigned char cb = (unsigned char)*b;
-      if (ca >= 'A' && ca <= 'Z') {
-        ca = (unsigned char)(ca - 'A' + 'a');
-      }
-      if (cb >= 'A' && cb <= 'Z') {
-        cb = (unsigned char)(cb - 'A' + 'a');
-      }
-      if (ca != cb) {
-        return false;
-      }
-      ++a;
-      ++b;
-    }
-    return *a == '\0' && *b == '\0';
-  };
-  for (int i = 0; i < len; i++) {
-    if (ieq(valuesMap[i], lookupValue)) {
-      return i;
-    }
-  }
-  return -1;
-}
-
-
-const char* HeatPump::lookupByteMapValue(const char* valuesMap[], const uint8_t byteMap[], int len, uint8_t byteValue) {
-  for (int i = 0; i < len; i++) {
-    if (byteMap[i] == byteValue) {
-      return valuesMap[i];
-    }
-  }
-  return valuesMap[0];
-}
-
-int HeatPump::lookupByteMapValue(const int valuesMap[], const uint8_t byteMap[], int len, uint8_t byteValue) {
-  for (int i = 0; i < len; i++) {
-    if (byteMap[i] == byteValue) {
-      return valuesMap[i];
-    }
-  }
-  return valuesMap[0];
-}
-
-bool HeatPump::canSend(bool isInfo) {
-  return (k_uptime_get_32() - (isInfo ? PACKET_INFO_INTERVAL_MS : PACKET_SENT_INTERVAL_MS)) > lastSend;
-}  
-
-bool HeatPump::canRead() {
-  return (waitForRead && (k_uptime_get_32() - PACKET_SENT_INTERVAL_MS) > lastSend);
-}
-
-uint8_t HeatPump::checkSum(uint8_t bytes[], int len) {
-  uint8_t sum = 0;
-  for (int i = 0; i < len; i++) {
-    sum += bytes[i];
-  }
-  return (0xfc - sum) & 0xff;
-}
-
-void HeatPump::createPacket(uint8_t *packet, heatpumpSettings settings) {
-  prepareSetPacket(packet, PACKET_LEN);
-  
-  if(settings.power != currentSettings.power) {
-    packet[8]  = POWER[lookupByteMapIndex(POWER_MAP, 2, settings.power)];
-    packet[6] += CONTROL_PACKET_1[0];
-  }
-  if(settings.mode!= currentSettings.mode) {
-    packet[9]  = MODE[lookupByteMapIndex(MODE_MAP, 5, settings.mode)];
-    packet[6] += CONTROL_PACKET_1[1];
-  }
-  if(!tempMode && settings.temperature!= currentSettings.temperature) {
-    packet[10] = TEMP[lookupByteMapIndex(TEMP_MAP, 16, settings.temperature)];
-    packet[6] += CONTROL_PACKET_1[2];
-  }
-  else if(tempMode && settings.temperature!= currentSettings.temperature) {
-    float temp = (settings.temperature * 2) + 128;
-    packet[19] = (int)temp;
-    packet[6] += CONTROL_PACKET_1[2];
-  }
-  if(settings.fan!= currentSettings.fan) {
-    packet[11] = FAN[lookupByteMapIndex(FAN_MAP, 6, settings.fan)];
-    packet[6] += CONTROL_PACKET_1[3];
-  }
-  if(settings.vane!= currentSettings.vane) {
-    packet[12] = VANE[lookupByteMapIndex(VANE_MAP, 7, settings.vane)];
-    packet[6] += CONTROL_PACKET_1[4];
-  }
-  if(settings.wideVane!= currentSettings.wideVane) {
-    packet[18] = WIDEVANE[lookupByteMapIndex(WIDEVANE_MAP, 7, settings.wideVane)] | (wideVaneAdj ? 0x80 : 0x00);
-    packet[7] += CONTROL_PACKET_2[0];
-  }
-  // add the checksum
-  uint8_t chkSum = checkSum(packet, 21);
-  packet[21] = chkSum;
-}
-
-void HeatPump::createInfoPacket(uint8_t *packet, uint8_t packetType) {
-  // add the header to the packet
-  for (int i = 0; i < INFOHEADER_LEN; i++) {
-    packet[i] = INFOHEADER[i];
-  }
-  
-  // set the mode - settings or room temperature
-  if(packetType != PACKET_TYPE_DEFAULT) {
-    packet[5] = INFOMODE[packetType];
-  } else {
-    // request current infoMode, and increment for the next request
-    packet[5] = INFOMODE[infoMode];
-    // if enable fastSync we only request RQST_PKT_SETTINGS, RQST_PKT_ROOM_TEMP and RQST_PKT_STATUS, so the sync will be 2x faster
-    if (infoMode == (fastSync ? 2 : (INFOMODE_LEN - 1))) {
-      infoMode = 0;
-    } else {
-      infoMode++;
-    }
-  }
-
-  // pad the packet out
-  for (int i = 0; i < 15; i++) {
-    packet[i + 6] = 0x00;
-  }
-
-  // add the checksum
-  uint8_t chkSum = checkSum(packet, 21);
-  packet[21] = chkSum;
-}
-
-void HeatPump::writePacket(uint8_t *packet, int length) {
-  for (int i = 0; i < length; i++) {
-    uart_poll_out(uart_dev, (unsigned char)packet[i]);
-  }
-
-  if(packetCallback) {
-    packetCallback(packet, length, (char*)"packetSent");
-  }
-  waitForRead = true;
-  lastSend = k_uptime_get_32();
-}
-
-int HeatPump::readPacket() {
-  uint8_t header[INFOHEADER_LEN] = {};
-  uint8_t data[PACKET_LEN] = {};
-  bool foundStart = false;
-  int dataSum = 0;
-  uint8_t checksum = 0;
-  uint8_t dataLength = 0;
-  
-  waitForRead = false;
-
-  unsigned char ch = 0;
-  uint32_t start_ts = k_uptime_get_32();
-  while(!foundStart && (k_uptime_get_32() - start_ts) < 500) {
-    if (uart_poll_in(uart_dev, &ch) == 0) {
-      header[0] = ch;
-      if(header[0] == HEADER[0]) {
-        foundStart = true;
-        k_msleep(100);
-      }
-    } else {
-      k_msleep(1);
-    }
-  }
-  if(!foundStart) {
-    return RCVD_PKT_FAIL;
-  }
-  for(int i=1;i<5;i++) {
-    uint32_t t0 = k_uptime_get_32();
-    while (uart_poll_in(uart_dev, &ch) != 0) {
-      if ((k_uptime_get_32() - t0) > 200) {
-        return RCVD_PKT_FAIL;
-      }
-      k_msleep(1);
-    }
-    header[i] = ch;
-  }
-  if(header[0] == HEADER[0] && header[2] == HEADER[2] && header[3] == HEADER[3]) {
-    dataLength = header[4];
-    for(int i=0;i<dataLength;i++) {
-      uint32_t t1 = k_uptime_get_32();
-      while (uart_poll_in(uart_dev, &ch) != 0) {
-        if ((k_uptime_get_32() - t1) > 500) {
-          return RCVD_PKT_FAIL;
-        }
-        k_msleep(1);
-      }
-      data[i] = ch;
-    }
-    uint32_t t2 = k_uptime_get_32();
-    while (uart_poll_in(uart_dev, &ch) != 0) {
-      if ((k_uptime_get_32() - t2) > 200) {
-        return RCVD_PKT_FAIL;
-      }
-      k_msleep(1);
-    }
-    data[dataLength] = ch;
-    for (int i = 0; i < INFOHEADER_LEN; i++) {
-      dataSum += header[i];
-    }
-    for (int i = 0; i < dataLength; i++) {
-      dataSum += data[i];
-    }
-    checksum = (0xfc - dataSum) & 0xff;
-    if(data[dataLength] == checksum) {
-      lastRecv = k_uptime_get_32();
-      if(packetCallback) {
-        uint8_t packet[37];
-        for(int i=0; i<INFOHEADER_LEN; i++) {
-          packet[i] = header[i];
-        }
-        for(int i=0; i<(dataLength+1); i++) {
-          packet[(i+5)] = data[i];
-        }
-        packetCallback(packet, PACKET_LEN, (char*)"packetRecv");
-      }
-      if(header[1] == 0x62) {
-        switch(data[0]) {
-          case 0x02: {
-            heatpumpSettings receivedSettings;
-            receivedSettings.power       = lookupByteMapValue(POWER_MAP, POWER, 2, data[3]);
-            receivedSettings.iSee = data[4] > 0x08 ? true : false;
-            receivedSettings.mode = lookupByteMapValue(MODE_MAP, MODE, 5, receivedSettings.iSee  ? (data[4] - 0x08) : data[4]);
-            if(data[11] != 0x00) {
-              int temp = data[11];
-              temp -= 128;
-              receivedSettings.temperature = (float)temp / 2;
-              tempMode =  true;
-            } else {
-              receivedSettings.temperature = lookupByteMapValue(TEMP_MAP, TEMP, 16, data[5]);
-            }
-            receivedSettings.fan         = lookupByteMapValue(FAN_MAP, FAN, 6, data[6]);
-            receivedSettings.vane        = lookupByteMapValue(VANE_MAP, VANE, 7, data[7]);
-            receivedSettings.wideVane    = lookupByteMapValue(WIDEVANE_MAP, WIDEVANE, 7, data[10] & 0x0F);
-            wideVaneAdj = (data[10] & 0xF0) == 0x80 ? true : false;
-            if(settingsChangedCallback && receivedSettings != currentSettings) {
-              currentSettings = receivedSettings;
-              settingsChangedCallback();
-            } else {
-              currentSettings = receivedSettings;
-            }
-            if(firstRun || (autoUpdate && externalUpdate && k_uptime_get_32() - lastWanted > AUTOUPDATE_GRACE_PERIOD_IGNORE_EXTERNAL_UPDATES_MS)) {
-              wantedSettings = currentSettings;
-              firstRun = false;
-            }
-            return RCVD_PKT_SETTINGS;
-          }
-          case 0x03: {
-            heatpumpStatus receivedStatus;
-            if(data[6] != 0x00) {
-              int temp = data[6];
-              temp -= 128;
-              receivedStatus.roomTemperature = (float)temp / 2;
-            } else {
-              receivedStatus.roomTemperature = lookupByteMapValue(ROOM_TEMP_MAP, ROOM_TEMP, 32, data[3]);
-            }
-            if((statusChangedCallback || roomTempChangedCallback) && currentStatus.roomTemperature != receivedStatus.roomTemperature) {
-              currentStatus.roomTemperature = receivedStatus.roomTemperature;
-              if(statusChangedCallback) {
-                statusChangedCallback(currentStatus);
-              }
-              if(roomTempChangedCallback) {
-                roomTempChangedCallback(currentStatus.roomTemperature);
-              }
-            } else {
-              currentStatus.roomTemperature = receivedStatus.roomTemperature;
-            }
-            return RCVD_PKT_ROOM_TEMP;
-          }
-          case 0x04: {
-            break;
-          }
-          case 0x05: {
-            heatpumpTimers receivedTimers;
-            receivedTimers.mode                = lookupByteMapValue(TIMER_MODE_MAP, TIMER_MODE, 4, data[3]);
-            receivedTimers.onMinutesSet        = data[4] * TIMER_INCREMENT_MINUTES;
-            receivedTimers.onMinutesRemaining  = data[6] * TIMER_INCREMENT_MINUTES;
-            receivedTimers.offMinutesSet       = data[5] * TIMER_INCREMENT_MINUTES;
-            receivedTimers.offMinutesRemaining = data[7] * TIMER_INCREMENT_MINUTES;
-            if(statusChangedCallback && currentStatus.timers != receivedTimers) {
-              currentStatus.timers = receivedTimers;
-              statusChangedCallback(currentStatus);
-            } else {
-              currentStatus.timers = receivedTimers;
-            }
-            return RCVD_PKT_TIMER;
-          }
-          case 0x06: {
-            heatpumpStatus receivedStatus;
-            receivedStatus.operating = data[4];
-            receivedStatus.compressorFrequency = data[3];
-            if(statusChangedCallback && currentStatus.operating != receivedStatus.operating) {
-              currentStatus.operating = receivedStatus.operating;
-              currentStatus.compressorFrequency = receivedStatus.compressorFrequency;
-              statusChangedCallback(currentStatus);
-            } else {
-              currentStatus.operating = receivedStatus.operating;
-              currentStatus.compressorFrequency = receivedStatus.compressorFrequency;
-            }
-            return RCVD_PKT_STATUS;
-          }
-          case 0x09: {
-            break;
-          }
-          case 0x20:
-          case 0x22: {
-            if (dataLength == 0x10) {
-              if (data[0] == 0x20) {
-                functions.setData1(&data[1]);
-              } else {
-                functions.setData2(&data[1]);
-              }
-              return RCVD_PKT_FUNCTIONS;
-            }
-            break;
-          }
-        }
-      }
-      if(header[1] == 0x61) {
-        return RCVD_PKT_UPDATE_SUCCESS;
-      } else if(header[1] == 0x7a) {
-        connected = true;
-        return RCVD_PKT_CONNECT_SUCCESS;
-      }
-    }
-  }
-  return RCVD_PKT_FAIL;
-}
-
-void HeatPump::readAllPackets() {
-  for (;;) {
-    int r = readPacket();
-    if (r == RCVD_PKT_FAIL) {
-      break;
-    }
-  }
-}
-
-void HeatPump::prepareInfoPacket(uint8_t* packet, int length) {
-  memset(packet, 0, length * sizeof(uint8_t));
-  
-  for (int i = 0; i < INFOHEADER_LEN && i < length; i++) {
-    packet[i] = INFOHEADER[i];
-  }  
-}
-
-void HeatPump::prepareSetPacket(uint8_t* packet, int length) {
-  memset(packet, 0, length * sizeof(uint8_t));
-  
-  for (int i = 0; i < HEADER_LEN && i < length; i++) {
-    packet[i] = HEADER[i];
-  }  
-}
-
-heatpumpFunctions HeatPump::getFunctions() {
-  functions.clear();
-  
-  uint8_t packet1[PACKET_LEN] = {};
-  uint8_t packet2[PACKET_LEN] = {};
-
-  prepareInfoPacket(packet1, PACKET_LEN);
-  packet1[5] = FUNCTIONS_GET_PART1;
-  packet1[21] = checkSum(packet1, 21);
-
-  prepareInfoPacket(packet2, PACKET_LEN);
-  packet2[5] = FUNCTIONS_GET_PART2;
-  packet2[21] = checkSum(packet2, 21);
-  
-  while(!canSend(false)) { k_msleep(10); }
-  writePacket(packet1, PACKET_LEN);
-  readPacket();
-
-  while(!canSend(false)) { k_msleep(10); }
-  writePacket(packet2, PACKET_LEN);
-  readPacket();
-
-  // retry reading a few times in case responses were related
-  // to other requests
-  for (int i = 0; i < 5 && !functions.isValid(); ++i) {
-    k_msleep(100);
-    readPacket();
-  }
-
-  return functions;
-}
-
-bool HeatPump::setFunctions(heatpumpFunctions const& functions) {
-  if (!functions.isValid()) {
-    return false;
-  }
-
-  uint8_t packet1[PACKET_LEN] = {};
-  uint8_t packet2[PACKET_LEN] = {};
-
-  prepareSetPacket(packet1, PACKET_LEN);
-  packet1[5] = FUNCTIONS_SET_PART1;
-  
-  prepareSetPacket(packet2, PACKET_LEN);
-  packet2[5] = FUNCTIONS_SET_PART2;
-  
-  functions.getData1(&packet1[6]);
-  functions.getData2(&packet2[6]);
-
-  // sanity check, we expect data byte 15 (index 20) to be 0
-  if (packet1[20] != 0 || packet2[20] != 0)
-    return false;
-    
-  // make sure all the other data bytes are set
-  for (int i = 6; i < 20; ++i) {
-    if (packet1[i] == 0 || packet2[i] == 0)
-      return false;
-  }
-
-  packet1[21] = checkSum(packet1, 21);
-  packet2[21] = checkSum(packet2, 21);
-  
-  while(!canSend(false)) { k_msleep(10); }
-  writePacket(packet1, PACKET_LEN);
-  readPacket();
-
-  while(!canSend(false)) { k_msleep(10); }
-  writePacket(packet2, PACKET_LEN);
-  readPacket();
-
-  return true;
-}
-
-
 heatpumpFunctions::heatpumpFunctions() {
   clear();
 }
@@ -864,11 +81,13 @@ bool heatpumpFunctions::isValid() const {
 
 void heatpumpFunctions::setData1(uint8_t* data) {
   memcpy(raw, data, 15);
+  indexCodes(0, 15);
   _isValid1 = true;
 }
 
 void heatpumpFunctions::setData2(uint8_t* data) {
   memcpy(raw + 15, data, 15);
+  indexCodes(15, 15);
   _isValid2 = true;
 }
 
@@ -880,47 +99,65 @@ void heatpumpFunctions::getData2(uint8_t* data) const {
   memcpy(data, raw + 15, 15);
 }
 
+bool heatpumpFunctions::equalData1(const heatpumpFunctions& rhs) const {
+  return _isValid1 == rhs._isValid1 && memcmp(raw, rhs.raw, 15) == 0;
+}
+
+bool heatpumpFunctions::equalData2(const heatpumpFunctions& rhs) const {
+  return _isValid2 == rhs._isValid2 && memcmp(raw + 15, rhs.raw + 15, 15) == 0;
+}
+
 void heatpumpFunctions::clear() {
   memset(raw, 0, sizeof(raw));
+  memset(slot, -1, sizeof(slot));
   _isValid1 = false;
   _isValid2 = false;
 }
 
-int heatpumpFunctions::getCode(uint8_t b) {
+// rebuild the code -> raw[] position table for one half
+void heatpumpFunctions::indexCodes(int first, int count) {
+  for (int c = 0; c < (int)sizeof(slot); ++c) {
+    if (slot[c] >= first && slot[c] < first + count) {
+      slot[c] = -1;
+    }
+  }
+  for (int i = first; i < first + count; ++i) {
+    int code = getCode(raw[i]);
+    if (code >= FUNCTION_CODE_FIRST && code <= FUNCTION_CODE_LAST) {
+      slot[code - FUNCTION_CODE_FIRST] = (int8_t)i;
+    }
+  }
+}
+
+int heatpumpFunctions::getCode(uint8_t b) const {
   return ((b >> 2) & 0xff) + 100;
 }
 
-int heatpumpFunctions::getValue(uint8_t b) {
+int heatpumpFunctions::getValue(uint8_t b) const {
   return b & 3;
 }
     
-int heatpumpFunctions::getValue(int code) {
-  if (code > 128 || code < 101)
+int heatpumpFunctions::getValue(int code) const {
+  if (code > FUNCTION_CODE_LAST || code < FUNCTION_CODE_FIRST)
     return 0;
-    
-  for (int i = 0; i < MAX_FUNCTION_CODE_COUNT; ++i) {
-    if (getCode(raw[i]) == code)
-      return getValue(raw[i]);
-  }
 
-  return 0;
+  int i = slot[code - FUNCTION_CODE_FIRST];
+  return i < 0 ? 0 : getValue(raw[i]);
 }
 
 bool heatpumpFunctions::setValue(int code, int value) {
-  if (code > 128 || code < 101)
+  if (code > FUNCTION_CODE_LAST || code < FUNCTION_CODE_FIRST)
     return false;
 
   if (value < 1 || value > 3)
     return false;
-    
-  for (int i = 0; i < MAX_FUNCTION_CODE_COUNT; ++i) {
-    if (getCode(raw[i]) == code) {
-      raw[i] = ((code - 100) << 2) + value;
-      return true;
-    }
-  }
 
-  return false;
+  int i = slot[code - FUNCTION_CODE_FIRST];
+  if (i < 0)
+    return false;
+
+  raw[i] = ((code - 100) << 2) + value;
+  return true;
 }
 
 heatpumpFunctionCodes heatpumpFunctions::getAllCodes() {
@@ -928,16 +165,24 @@ heatpumpFunctionCodes heatpumpFunctions::getAllCodes() {
   for (int i = 0; i < MAX_FUNCTION_CODE_COUNT; ++i) {
     int code = getCode(raw[i]);
     result.code[i] = code;
-    result.valid[i] = (code >= 101 && code <= 128);
+    result.valid[i] = (code >= FUNCTION_CODE_FIRST && code <= FUNCTION_CODE_LAST);
   }
 
   return result;
 }
 
-bool heatpumpFunctions::operator==(const heatpumpFunctions& rhs) {
-  return this->isValid() == rhs.isValid() && memcmp(this->raw, rhs.raw, MAX_FUNCTION_CODE_COUNT * sizeof(int)) == 0;
+bool heatpumpFunctions::operator==(const heatpumpFunctions& rhs) const {
+  return this->isValid() == rhs.isValid() && memcmp(this->raw, rhs.raw, sizeof(raw)) == 0;
 }
 
-bool heatpumpFunctions::operator!=(const heatpumpFunctions& rhs) {
+bool heatpumpFunctions::operator!=(const heatpumpFunctions& rhs) const {
   return !(*this==rhs);
-}
\ No newline at end of file
+}
+
+// Platform instantiation //////////////////////////////////////////////////////
+
+#ifdef __ZEPHYR__
+template class HeatPumpT<ZephyrUartTransport, ZephyrClock>;
+#else
+template class HeatPumpT<PosixSerialTransport, PosixClock>;
+#endif
@@ -18,10 +18,12 @@
 #define LIB_HEATPUMP_HEAT_PUMP_H
 
 #include <stdint.h>
-#include <math.h>
 
-#include <zephyr/kernel.h>
-#include <zephyr/drivers/uart.h>
+#include "heat_pump_clock.h"
+#include "heat_pump_schema.h"
+#include "heat_pump_temp.h"
+#include "heat_pump_trace.h"
+#include "heat_pump_transport.h"
 
 /* 
  * Callback function definitions.
@@ -31,12 +33,12 @@
 #define SETTINGS_CHANGED_CALLBACK_SIGNATURE void (*settingsChangedCallback)()
 #define STATUS_CHANGED_CALLBACK_SIGNATURE void (*statusChangedCallback)(heatpumpStatus newStatus)
 #define PACKET_CALLBACK_SIGNATURE void (*packetCallback)(uint8_t* packet, unsigned int length, char* packetDirection)
-#define ROOM_TEMP_CHANGED_CALLBACK_SIGNATURE void (*roomTempChangedCallback)(float currentRoomTemperature)
+#define ROOM_TEMP_CHANGED_CALLBACK_SIGNATURE void (*roomTempChangedCallback)(hp_temp_t currentRoomTemperature)
 
 struct heatpumpSettings {
   const char* power;
   const char* mode;
-  float temperature;
+  hp_temp_t temperature; // 0.01 degree C
   const char* fan;
   const char* vane; //vertical vane, up/down
   const char* wideVane; //horizontal vane, left/right
@@ -59,13 +61,60 @@ bool operator==(const heatpumpTimers& lhs, const heatpumpTimers& rhs);
 bool operator!=(const heatpumpTimers& lhs, const heatpumpTimers& rhs);
 
 struct heatpumpStatus {
-  float roomTemperature;
+  hp_temp_t roomTemperature; // 0.01 degree C
   bool operating; // if true, the heatpump is operating to reach the desired temperature
   heatpumpTimers timers;
   int compressorFrequency;
 };
 
+struct heatpumpProfile {
+  int bitrate;      // baud rate the unit answered CONNECT on
+  bool tempMode;    // setpoint in 0.5 degree steps (data[11] in settings)
+  bool wideVaneAdj; // wide vane adjustment flag (data[10] & 0xF0)
+};
+
+// frame types counted in heatpumpStats, by the command byte of a request
+// and of its reply (0x61 SET acknowledgements count as FRAME_SET)
+enum heatpumpFrameType {
+  FRAME_CONNECT = 0,
+  FRAME_SET,
+  FRAME_REMOTE_TEMP,
+  FRAME_SETTINGS,
+  FRAME_ROOM_TEMP,
+  FRAME_STATUS,
+  FRAME_TIMERS,
+  FRAME_FUNCTIONS,
+  FRAME_OTHER,
+  FRAME_TYPE_COUNT
+};
+
+// link classification from the last few exchanges, see linkHealth()
+enum heatpumpLinkHealth {
+  LINK_HEALTHY = 0,
+  LINK_DEGRADED,  // errors seen, polling at half rate
+  LINK_DOWN       // not connected, or reconnecting
+};
+
+struct heatpumpStats {
+  uint32_t sent[FRAME_TYPE_COUNT];
+  uint32_t received[FRAME_TYPE_COUNT];
+  uint32_t checksumErrors;  // complete frame, bad checksum
+  uint32_t framingErrors;   // start byte followed by a bad header or length
+  uint32_t timeouts;        // expected reply missing or cut short in readPacket()
+  uint32_t lineErrors;      // UART framing, parity, overrun or break flags
+  uint32_t connectAttempts;
+  uint32_t reconnects;      // link dropped and sync() had to reconnect
+  uint32_t polls;           // info requests sent by sync()
+  uint32_t commandWaitMaxMs; // longest a command waited for the bus
+  uint32_t setConfirmed;    // settings SETs acked and seen in the next settings reply
+  uint32_t setUnconfirmed;  // acked, but no settings reply to check them against
+  uint32_t setFailed;       // not acked or not applied after SET_ATTEMPTS
+  uint32_t setRetries;      // SET frames sent again
+};
+
 #define MAX_FUNCTION_CODE_COUNT 30
+#define FUNCTION_CODE_FIRST 101
+#define FUNCTION_CODE_LAST  128
 
 struct heatpumpFunctionCodes {
   bool valid[MAX_FUNCTION_CODE_COUNT];
@@ -75,11 +124,14 @@ struct heatpumpFunctionCodes {
 class heatpumpFunctions  {
   private:
     uint8_t raw[MAX_FUNCTION_CODE_COUNT];
+    // raw[] position of each code, -1 if the unit did not report it
+    int8_t slot[FUNCTION_CODE_LAST - FUNCTION_CODE_FIRST + 1];
     bool _isValid1;
     bool _isValid2;
 
-    int getCode(uint8_t b);
-    int getValue(uint8_t b);
+    int getCode(uint8_t b) const;
+    int getValue(uint8_t b) const;
+    void indexCodes(int first, int count);
 
   public:
     heatpumpFunctions();
@@ -91,46 +143,44 @@ class heatpumpFunctions  {
     void setData2(uint8_t* data);
     void getData1(uint8_t* data) const;
     void getData2(uint8_t* data) const;
+    bool equalData1(const heatpumpFunctions& rhs) const;
+    bool equalData2(const heatpumpFunctions& rhs) const;
     
     void clear();
 
-    int getValue(int code);
+    int getValue(int code) const;
     bool setValue(int code, int value);
 
     heatpumpFunctionCodes getAllCodes();   
 
-    bool operator==(const heatpumpFunctions& rhs);
-    bool operator!=(const heatpumpFunctions& rhs);
+    bool operator==(const heatpumpFunctions& rhs) const;
+    bool operator!=(const heatpumpFunctions& rhs) const;
 };
 
-class HeatPump
+// The protocol core is parameterised on a transport policy (CN105 byte
+// I/O, see heat_pump_transport.h) and a clock policy (timebase, see
+// heat_pump_clock.h), so it builds on the MCU and on a host without any
+// virtual dispatch. HeatPump below is the platform default.
+template <typename Transport, typename Clock>
+class HeatPumpT
 {
-  private:
-    static const int PACKET_LEN = 22;
+  // the frame codec is protected so host benchmarks and emulators can
+  // drive it without a bus; the message layout and value tables are in
+  // heat_pump_schema.h
+  protected:
+    static const int PACKET_LEN = cn105::FRAME_LEN;
     static const int PACKET_SENT_INTERVAL_MS = 1000;
     static const int PACKET_INFO_INTERVAL_MS = 2000;
+    static const int PACKET_REPLY_TIMEOUT_MS = 500;
     static const int PACKET_TYPE_DEFAULT = 99;
+    static const int SET_ATTEMPTS = 3;
+    static const int SET_RETRY_BACKOFF_MS = 100;
+    // failed exchanges: in a row before the link is down, and among the
+    // last 8 before it is degraded
+    static const int LINK_DOWN_STREAK = 3;
+    static const int LINK_DEGRADED_ERRORS = 2;
     static const int AUTOUPDATE_GRACE_PERIOD_IGNORE_EXTERNAL_UPDATES_MS = 30000;
 
-    static const int CONNECT_LEN = 8;
-    const uint8_t CONNECT[CONNECT_LEN] = {0xfc, 0x5a, 0x01, 0x30, 0x02, 0xca, 0x01, 0xa8};
-    static const int HEADER_LEN  = 8;
-    const uint8_t HEADER[HEADER_LEN]  = {0xfc, 0x41, 0x01, 0x30, 0x10, 0x01, 0x00, 0x00};
-
-    static const int INFOHEADER_LEN  = 5;
-    const uint8_t INFOHEADER[INFOHEADER_LEN]  = {0xfc, 0x42, 0x01, 0x30, 0x10};
-    
- 
-    static const int INFOMODE_LEN = 6;
-    const uint8_t INFOMODE[INFOMODE_LEN] = {
-      0x02, // request a settings packet - RQST_PKT_SETTINGS
-      0x03, // request the current room temp - RQST_PKT_ROOM_TEMP
-      0x06, // request status - RQST_PKT_STATUS
-      0x04, // unknown
-      0x05, // request the timers - RQST_PKT_TIMERS
-      0x09  // request standby mode (maybe?) RQST_PKT_STANDBY
-    };
-
     const int RCVD_PKT_FAIL            = 0;
     const int RCVD_PKT_CONNECT_SUCCESS = 1;
     const int RCVD_PKT_SETTINGS        = 2;
@@ -140,52 +190,39 @@ class HeatPump
     const int RCVD_PKT_TIMER           = 6;
     const int RCVD_PKT_FUNCTIONS       = 7;
 
-    const uint8_t CONTROL_PACKET_1[5] = {0x01,    0x02,  0x04,  0x08, 0x10};
-                                   //{"POWER","MODE","TEMP","FAN","VANE"};
-    const uint8_t CONTROL_PACKET_2[1] = {0x01};
-                                   //{"WIDEVANE"};
-    const uint8_t POWER[2]            = {0x00, 0x01};
-    const char* POWER_MAP[2]       = {"OFF", "ON"};
-    const uint8_t MODE[5]             = {0x01,   0x02,  0x03, 0x07, 0x08};
-    const char* MODE_MAP[5]        = {"HEAT", "DRY", "COOL", "FAN", "AUTO"};
-    const uint8_t TEMP[16]            = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
-    const int TEMP_MAP[16]         = {31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16};
-    const uint8_t FAN[6]              = {0x00,  0x01,   0x02, 0x03, 0x05, 0x06};
-    const char* FAN_MAP[6]         = {"AUTO", "QUIET", "1", "2", "3", "4"};
-    const uint8_t VANE[7]             = {0x00,  0x01, 0x02, 0x03, 0x04, 0x05, 0x07};
-    const char* VANE_MAP[7]        = {"AUTO", "1", "2", "3", "4", "5", "SWING"};
-    const uint8_t WIDEVANE[7]         = {0x01, 0x02, 0x03, 0x04, 0x05, 0x08, 0x0c};
-    const char* WIDEVANE_MAP[7]    = {"<<", "<",  "|",  ">",  ">>", "<>", "SWING"};
-    const uint8_t ROOM_TEMP[32]       = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
-                                      0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
-    const int ROOM_TEMP_MAP[32]    = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25,
-                                      26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41};
-    const uint8_t TIMER_MODE[4]       = {0x00,  0x01,  0x02, 0x03};
-    const char* TIMER_MODE_MAP[4]  = {"NONE", "OFF", "ON", "BOTH"};
-
-    static const int TIMER_INCREMENT_MINUTES = 10;
-
-    const uint8_t FUNCTIONS_SET_PART1 = 0x1F;
-    const uint8_t FUNCTIONS_GET_PART1 = 0x20;
-    const uint8_t FUNCTIONS_SET_PART2 = 0x21;
-    const uint8_t FUNCTIONS_GET_PART2 = 0x22;
+    const char* lookupByteMapValue(const char* const valuesMap[], const uint8_t byteMap[], int len, uint8_t uint8_tValue);
+    int    lookupByteMapValue(const int valuesMap[], const uint8_t byteMap[], int len, uint8_t byteValue);
+    int    lookupByteMapIndex(const char* const valuesMap[], int len, const char* lookupValue);
+    int    lookupByteMapIndex(const int valuesMap[], int len, int lookupValue);
+
+    uint8_t checkSum(uint8_t bytes[], int len);
+    void createPacket(uint8_t *packet, heatpumpSettings settings);
+    void createInfoPacket(uint8_t *packet, uint8_t packetType);
+    int readPacket(int startTimeoutMs = PACKET_REPLY_TIMEOUT_MS);
 
+  private:
     // these settings will be initialised in connect()
     heatpumpSettings currentSettings {};
     heatpumpSettings wantedSettings {};
     // Hacks
-    unsigned long lastWanted;
+    int64_t lastWanted;
 
     // initialise to all off, then it will update shortly after connect;
-    heatpumpStatus currentStatus {0, false, {TIMER_MODE_MAP[0], 0, 0, 0, 0}, 0};
+    heatpumpStatus currentStatus {0, false, {cn105::TIMER_MODE_MAP[0], 0, 0, 0, 0}, 0};
 
+    // function codes, read once and then served from here; functionsStamp
+    // is the uptime at which the unit last confirmed them, by a read or an
+    // acked write (0 = unconfirmed), and changes whenever they do
     heatpumpFunctions functions;
+    int64_t functionsStamp = 0;
   
-    const struct device *uart_dev {nullptr};
-    unsigned long lastSend;
+    Transport transport;
+    Clock clock;
+    int bitrate = 2400;
+    int64_t lastSend;
     bool waitForRead;
     int infoMode;
-    unsigned long lastRecv;
+    int64_t lastRecv;
     bool connected = false;
     bool autoUpdate;
     bool firstRun;
@@ -193,22 +230,33 @@ class HeatPump
     bool externalUpdate;
     bool wideVaneAdj;
     bool fastSync = false;
-
-    const char* lookupByteMapValue(const char* valuesMap[], const uint8_t byteMap[], int len, uint8_t uint8_tValue);
-    int    lookupByteMapValue(const int valuesMap[], const uint8_t byteMap[], int len, uint8_t byteValue);
-    int    lookupByteMapIndex(const char* valuesMap[], int len, const char* lookupValue);
-    int    lookupByteMapIndex(const int valuesMap[], int len, int lookupValue);
+    heatpumpStats stats {};
+    // one bit per exchange, newest in bit 0, set when it failed
+    uint8_t linkHistory = 0;
+    uint8_t linkFailStreak = 0;
+    // set from another thread or an ISR, see abortExchange()
+    volatile bool aborted = false;
+    volatile uint8_t lastFrame = FRAME_OTHER;
+    // from a request written to the read that answers it
+    HpTraceSpan exchangeSpan = HP_TRACE_SPAN(HP_TRACE_XCHG);
+
+    // remote temperature waiting for a free bus slot, sent from sync()
+    hp_temp_t remoteTemperature = 0;
+    bool remoteTempPending = false;
 
     bool canSend(bool isInfo);
     bool canRead();
-    uint8_t checkSum(uint8_t bytes[], int len);
-    void createPacket(uint8_t *packet, heatpumpSettings settings);
-    void createInfoPacket(uint8_t *packet, uint8_t packetType);
-    int readPacket();
     void readAllPackets();
+    int readFrame(int startTimeoutMs);
+    void claimBus();
+    void drainLine();
+    bool awaitReply(int expected);
+    bool settingsApplied(const heatpumpSettings& sent, const uint8_t *data);
+    void noteExchange(bool ok);
     void writePacket(uint8_t *packet, int length);
-    void prepareInfoPacket(uint8_t* packet, int length);
-    void prepareSetPacket(uint8_t* packet, int length);
+    void sendRemoteTemperature();
+    static int frameType(uint8_t command, uint8_t code);
+    void resetTimers();
 
     // callbacks
     ON_CONNECT_CALLBACK_SIGNATURE {nullptr};
@@ -218,18 +266,20 @@ class HeatPump
     ROOM_TEMP_CHANGED_CALLBACK_SIGNATURE {nullptr};
 
   public:
-    // indexes for INFOMODE array (public so they can be optionally passed to sync())
+    // indexes for cn105::INFO_REQUESTS (public so they can be optionally passed to sync())
     const int RQST_PKT_SETTINGS  = 0;
     const int RQST_PKT_ROOM_TEMP = 1;
-    const int RQST_PKT_TIMERS    = 3;
-    const int RQST_PKT_STATUS    = 4;
+    const int RQST_PKT_STATUS    = 2;
+    const int RQST_PKT_TIMERS    = 4;
     const int RQST_PKT_STANDBY   = 5;
 
     // general
-    HeatPump();
-    bool connect(const struct device *dev, int bitrate = 2400);
+    HeatPumpT();
+    // bitrate 0 probes 2400 then 9600 baud
+    bool connect(int bitrate = 2400);
     bool update();
     void sync(uint8_t packetType = PACKET_TYPE_DEFAULT);
+    int burstSync();
     void enableExternalUpdate();
     void disableExternalUpdate();
     void enableAutoUpdate();
@@ -246,9 +296,9 @@ class HeatPump
     void setPowerSetting(const char* setting);
     const char* getModeSetting();
     void setModeSetting(const char* setting);
-    float getTemperature();
-    void setTemperature(float setting);
-    void setRemoteTemperature(float setting);
+    hp_temp_t getTemperature();
+    void setTemperature(hp_temp_t setting);
+    void setRemoteTemperature(hp_temp_t setting);
     const char* getFanSpeed();
     void setFanSpeed(const char* setting);
     const char* getVaneSetting();
@@ -258,22 +308,44 @@ class HeatPump
     bool getIseeBool();
     void setFastSync(bool setting);
     // hacks
-    unsigned long getLastWanted();
+    int64_t getLastWanted();
 
     // status
     heatpumpStatus getStatus();
-    float getRoomTemperature();
+    hp_temp_t getRoomTemperature();
     bool getOperating();
     bool isConnected();
+    heatpumpLinkHealth linkHealth();
+    // a settings change or remote temperature still waiting for sync()
+    bool hasPendingWrite();
+
+    // profile, restore before connect() so a reboot starts where we left off
+    heatpumpProfile getProfile();
+    void setProfile(const heatpumpProfile& profile);
+
+    // link counters, for diagnostics
+    heatpumpStats getStats();
+    void resetStats();
+
+    // deadline recovery: abortExchange() may be called from another
+    // thread or an ISR and makes every wait in progress fail at once, so
+    // nested retries unwind in milliseconds; until resetLink() drops the
+    // link (the next sync() reconnects) every exchange keeps failing
+    void abortExchange();
+    void resetLink();
+    // type of the last frame written, the exchange in flight if any
+    heatpumpFrameType lastSentFrame();
 
     // functions
     // NOTE: These methods have been tested with a PVA (P-series air handler) unit and has not been tested with anything else. Use at your own risk.
-    heatpumpFunctions getFunctions();
+    heatpumpFunctions getFunctions(bool refresh = false);
     bool setFunctions(heatpumpFunctions const& functions);
+    int64_t getFunctionsStamp();
+    void restoreFunctions(heatpumpFunctions const& functions);
     
     // helpers
-    float FahrenheitToCelsius(int tempF);
-    int CelsiusToFahrenheit(float tempC);
+    hp_temp_t FahrenheitToCelsius(int tempF);
+    int CelsiusToFahrenheit(hp_temp_t tempC);
 
     // callbacks
     void setOnConnectCallback(ON_CONNECT_CALLBACK_SIGNATURE);
@@ -285,5 +357,14 @@ class HeatPump
     // expert users only!
     void sendCustomPacket(uint8_t data[], int len); 
 
+    // policies, e.g. to open the transport or advance a VirtualClock
+    Transport& getTransport() { return transport; }
+    Clock& getClock() { return clock; }
 };
+
+#ifdef __ZEPHYR__
+typedef HeatPumpT<ZephyrUartTransport, ZephyrClock> HeatPump;
+#else
+typedef HeatPumpT<PosixSerialTransport, PosixClock> HeatPump;
+#endif
 #endif // LIB_HEATPUMP_HEAT_PUMP_H
\ No newline at end of file
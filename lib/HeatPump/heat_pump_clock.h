@@ -0,0 +1,73 @@
+/*
+  heat_pump_clock.h - Timebase policies for the HeatPump library
+  Copyright (c) 2025 Joel Winarske.  All right reserved.
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef LIB_HEATPUMP_HEAT_PUMP_CLOCK_H
+#define LIB_HEATPUMP_HEAT_PUMP_CLOCK_H
+
+#include <stdint.h>
+
+#ifdef __ZEPHYR__
+#include <zephyr/kernel.h>
+#else
+#include <time.h>
+#endif
+
+// All protocol timing (send/info intervals, reply timeouts, link loss,
+// the external update grace period) is measured against the clock policy
+// HeatPumpT is instantiated with. A clock policy provides:
+//
+//   int64_t nowMs();          // monotonic time in milliseconds
+//   void sleepMs(int32_t ms); // block for (at least) ms milliseconds
+//
+// Times are 64-bit milliseconds, so they do not wrap in practice.
+
+#ifdef __ZEPHYR__
+// kernel uptime, the default clock on target
+class ZephyrClock {
+  public:
+    int64_t nowMs() { return k_uptime_get(); }
+    void sleepMs(int32_t ms) { k_msleep(ms); }
+};
+#else
+// CLOCK_MONOTONIC, the default clock on a host
+class PosixClock {
+  public:
+    int64_t nowMs() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+    void sleepMs(int32_t ms) {
+      struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+      while(nanosleep(&ts, &ts) != 0) {}
+    }
+};
+#endif
+
+// virtual time: sleeping advances the clock instantly, so timing
+// scenarios that take minutes on a real bus run in microseconds
+class VirtualClock {
+  public:
+    explicit VirtualClock(int64_t start = 0) : now(start) {}
+    int64_t nowMs() { return now; }
+    void sleepMs(int32_t ms) { now += ms; }
+    void advance(int64_t ms) { now += ms; }
+    void set(int64_t ms) { now = ms; }
+
+  private:
+    int64_t now;
+};
+
+#endif // LIB_HEATPUMP_HEAT_PUMP_CLOCK_H
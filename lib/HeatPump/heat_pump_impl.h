@@ -0,0 +1,1143 @@
+/*
+  heat_pump_impl.h - Mitsubishi Heat Pump control library, protocol core
+  Copyright (c) 2025 Joel Winarske.  All right reserved.
+  Copyright (c) 2017 Al Betschart.  All right reserved.
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+// Member definitions of HeatPumpT. heat_pump.cpp instantiates the
+// platform default (HeatPump); include this header only to instantiate
+// other transport/clock combinations, e.g. a fake unit on a VirtualClock.
+#ifndef LIB_HEATPUMP_HEAT_PUMP_IMPL_H
+#define LIB_HEATPUMP_HEAT_PUMP_IMPL_H
+
+#include <string.h>
+
+#include "heat_pump.h"
+
+// Constructor /////////////////////////////////////////////////////////////////
+
+template <typename Transport, typename Clock>
+HeatPumpT<Transport, Clock>::HeatPumpT() {
+  resetTimers();
+  infoMode = 0;
+  autoUpdate = false;
+  firstRun = true;
+  tempMode = false;
+  waitForRead = false;
+  externalUpdate = false;
+  wideVaneAdj = false;
+  functions = heatpumpFunctions();
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::connect(int bitrate) {
+  bool retry = false;
+  if(bitrate == 0) {
+    bitrate = 2400;
+    retry = true;
+  }
+  HpTraceSpan span = HP_TRACE_SPAN(HP_TRACE_CONNECT);
+  span.begin(bitrate);
+  if(!transport.configure(bitrate)) {
+    connected = false;
+    return false;
+  }
+  stats.connectAttempts++;
+  if(onConnectCallback) {
+    onConnectCallback();
+  }
+  
+  // settle before we start sending packets
+  clock.sleepMs(2000);
+
+  // send the CONNECT packet twice - need to copy the CONNECT packet locally
+  uint8_t packet[cn105::CONNECT_LEN];
+  memcpy(packet, cn105::CONNECT.bytes, cn105::CONNECT_LEN);
+  //for(int count = 0; count < 2; count++) {
+  writePacket(packet, cn105::CONNECT_LEN);
+  while(!canRead() && !aborted) { clock.sleepMs(10); }
+  int packetType = readPacket();
+  if (packetType != RCVD_PKT_CONNECT_SUCCESS && retry && !aborted)
+  {
+    return connect(9600);
+  }
+  connected = (packetType == RCVD_PKT_CONNECT_SUCCESS);
+  span.setResult(connected);
+  if(connected) {
+    this->bitrate = bitrate;
+    linkHistory = 0;
+    linkFailStreak = 0;
+  }
+  return connected;
+  //}
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::update() {
+  // A SET is a transaction: the frame carries absolute values, so it is
+  // resent as is (with backoff) until the unit acks it and the settings
+  // reply that follows shows the changed fields applied.
+  uint8_t packet[PACKET_LEN] = {};
+  heatpumpSettings sent = wantedSettings;
+  createPacket(packet, sent);
+
+  for(int attempt = 0; attempt < SET_ATTEMPTS && !aborted; attempt++) {
+    if(attempt > 0) {
+      stats.setRetries++;
+      clock.sleepMs(SET_RETRY_BACKOFF_MS << (attempt - 1));
+    }
+    claimBus();
+    writePacket(packet, PACKET_LEN);
+    if(!awaitReply(RCVD_PKT_UPDATE_SUCCESS)) {
+      continue;
+    }
+
+    // acked, now ask for the settings to see what the unit applied
+    uint8_t request[PACKET_LEN];
+    createInfoPacket(request, RQST_PKT_SETTINGS);
+    claimBus();
+    writePacket(request, PACKET_LEN);
+    if(!awaitReply(RCVD_PKT_SETTINGS)) {
+      // delivered but unchecked; the next poll fetches the settings first
+      stats.setUnconfirmed++;
+      infoMode = 0;
+      return true;
+    }
+    if(settingsApplied(sent, cn105::SetSettings::data(packet))) {
+      stats.setConfirmed++;
+      return true;
+    }
+  }
+  stats.setFailed++;
+  return false;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::sync(uint8_t packetType) {
+  // one step per call, in priority order: keep the link up, finish the
+  // exchange in flight, then wanted settings, then a queued remote
+  // temperature, and only then the periodic info polls. Commands issued
+  // through update() do not wait for sync() at all, see claimBus().
+  HpTraceSpan span = HP_TRACE_SPAN(HP_TRACE_POLL);
+  span.begin(packetType);
+  if((!connected) || linkFailStreak >= LINK_DOWN_STREAK || (clock.nowMs() - lastRecv > (PACKET_SENT_INTERVAL_MS * 10))) {
+    if(connected) {
+      stats.reconnects++;
+    }
+    span.setResult(TRACE_STEP_CONNECT);
+    connect(bitrate);
+  }
+  else if(canRead()) {
+    span.setResult(TRACE_STEP_READ);
+    readAllPackets();
+  }
+  else if(autoUpdate && !firstRun && wantedSettings != currentSettings && packetType == PACKET_TYPE_DEFAULT && canSend(false)) {
+    span.setResult(TRACE_STEP_UPDATE);
+    update();
+  }
+  else if(remoteTempPending && packetType == PACKET_TYPE_DEFAULT && canSend(false)) {
+    span.setResult(TRACE_STEP_REMOTE_TEMP);
+    sendRemoteTemperature();
+  }
+  else if(canSend(true)) {
+    uint8_t packet[PACKET_LEN] = {};
+    span.setResult(TRACE_STEP_INFO);
+    createInfoPacket(packet, packetType);
+    writePacket(packet, PACKET_LEN);
+    stats.polls++;
+  }
+  else {
+    span.setResult(TRACE_STEP_IDLE);
+  }
+}
+
+// Request settings, room temperature, status and timers back to back,
+// reading each reply before the next request instead of waiting out the
+// info interval, so the full state is known one exchange after another
+// right after connect(). Returns the number of requests answered.
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::burstSync() {
+  const int requests[] = {RQST_PKT_SETTINGS, RQST_PKT_ROOM_TEMP, RQST_PKT_STATUS, RQST_PKT_TIMERS};
+  int received = 0;
+
+  if(!connected) {
+    return 0;
+  }
+  for(int i = 0; i < 4 && !aborted; i++) {
+    uint8_t packet[PACKET_LEN] = {};
+    createInfoPacket(packet, requests[i]);
+    writePacket(packet, PACKET_LEN);
+    if(readPacket() != RCVD_PKT_FAIL) {
+      received++;
+    }
+  }
+  return received;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::enableExternalUpdate() {
+  autoUpdate = true;
+  externalUpdate = true;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::disableExternalUpdate() {
+  externalUpdate = false;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::enableAutoUpdate() {
+  autoUpdate = true;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::disableAutoUpdate() {
+  autoUpdate = false;
+}
+
+template <typename Transport, typename Clock>
+heatpumpSettings HeatPumpT<Transport, Clock>::getSettings() {
+  return currentSettings;
+}
+
+template <typename Transport, typename Clock>
+heatpumpSettings HeatPumpT<Transport, Clock>::getWantedSettings() {
+  return wantedSettings;
+}
+
+template <typename Transport, typename Clock>
+int64_t HeatPumpT<Transport, Clock>::getLastWanted() {
+  return lastWanted;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setFastSync(bool setting) {
+  fastSync = setting;
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::isConnected() {
+  return connected;
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::hasPendingWrite() {
+  return remoteTempPending || (autoUpdate && !firstRun && wantedSettings != currentSettings);
+}
+
+// Down after LINK_DOWN_STREAK failed exchanges in a row (sync() then
+// reconnects at once instead of waiting for the 10 s receive timeout),
+// degraded with LINK_DEGRADED_ERRORS failures among the last 8.
+template <typename Transport, typename Clock>
+heatpumpLinkHealth HeatPumpT<Transport, Clock>::linkHealth() {
+  if(!connected || linkFailStreak >= LINK_DOWN_STREAK) {
+    return LINK_DOWN;
+  }
+  int errors = 0;
+  for(uint8_t h = linkHistory; h != 0; h &= h - 1) {
+    errors++;
+  }
+  return errors >= LINK_DEGRADED_ERRORS ? LINK_DEGRADED : LINK_HEALTHY;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::abortExchange() {
+  aborted = true;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::resetLink() {
+  connected = false;
+  waitForRead = false;
+  // drop what a stuck exchange left buffered, the reconnect copes with
+  // whatever a line that keeps delivering adds after that
+  aborted = false;
+  drainLine();
+}
+
+// Drop buffered bytes, at most a few frames' worth so that a noisy line
+// (or a floating RX pin reading 0x00) cannot hold the caller here.
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::drainLine() {
+  unsigned char ch;
+  for(int i = 0; i < PACKET_LEN * 4 && !aborted && transport.read(&ch) == 0; i++) {}
+}
+
+template <typename Transport, typename Clock>
+heatpumpFrameType HeatPumpT<Transport, Clock>::lastSentFrame() {
+  return (heatpumpFrameType)lastFrame;
+}
+
+template <typename Transport, typename Clock>
+heatpumpProfile HeatPumpT<Transport, Clock>::getProfile() {
+  return {bitrate, tempMode, wideVaneAdj};
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setProfile(const heatpumpProfile& profile) {
+  if(profile.bitrate > 0) {
+    bitrate = profile.bitrate;
+  }
+  tempMode = profile.tempMode;
+  wideVaneAdj = profile.wideVaneAdj;
+}
+
+template <typename Transport, typename Clock>
+heatpumpStats HeatPumpT<Transport, Clock>::getStats() {
+  return stats;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::resetStats() {
+  stats = {};
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setSettings(heatpumpSettings settings) {
+  setPowerSetting(settings.power);
+  setModeSetting(settings.mode);
+  setTemperature(settings.temperature);
+  setFanSpeed(settings.fan);
+  setVaneSetting(settings.vane);
+  setWideVaneSetting(settings.wideVane);
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::getPowerSettingBool() {
+  return currentSettings.power == cn105::Powers::decode(0x01);
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setPowerSetting(bool setting) {
+  wantedSettings.power = cn105::Powers::decode(setting ? 0x01 : 0x00);
+  lastWanted = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+const char* HeatPumpT<Transport, Clock>::getPowerSetting() {
+  return currentSettings.power;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setPowerSetting(const char* setting) {
+  wantedSettings.power = cn105::Powers::lookup(setting);
+  lastWanted = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+const char* HeatPumpT<Transport, Clock>::getModeSetting() {
+  return currentSettings.mode;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setModeSetting(const char* setting) {
+  wantedSettings.mode = cn105::Modes::lookup(setting);
+  lastWanted = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+hp_temp_t HeatPumpT<Transport, Clock>::getTemperature() {
+  return currentSettings.temperature;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setTemperature(hp_temp_t setting) {
+  // wanted is what the unit will report back, so the comparison in
+  // settingsApplied() and the change callbacks stay exact
+  if(!tempMode){
+    hp_temp_t whole = hp_temp_round(setting, HP_TEMP_SCALE);
+    wantedSettings.temperature = cn105::Temps::indexOf(whole / HP_TEMP_SCALE) > -1 ? whole : HP_TEMP_C(cn105::TEMP_MAP[0]);
+  }
+  else {
+    setting = hp_temp_round(setting, HP_TEMP_HALF);
+    wantedSettings.temperature = setting < HP_TEMP_C(10) ? HP_TEMP_C(10) : (setting > HP_TEMP_C(31) ? HP_TEMP_C(31) : setting);
+  }
+  lastWanted = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setRemoteTemperature(hp_temp_t setting) {
+  // queued rather than sent here; sync() writes it in the next free slot
+  // ahead of the info polls, and a newer value replaces one still waiting
+  remoteTemperature = setting;
+  remoteTempPending = true;
+}
+
+template <typename Transport, typename Clock>
+const char* HeatPumpT<Transport, Clock>::getFanSpeed() {
+  return currentSettings.fan;
+}
+
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setFanSpeed(const char* setting) {
+  wantedSettings.fan = cn105::Fans::lookup(setting);
+  lastWanted = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+const char* HeatPumpT<Transport, Clock>::getVaneSetting() {
+  return currentSettings.vane;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setVaneSetting(const char* setting) {
+  wantedSettings.vane = cn105::Vanes::lookup(setting);
+  lastWanted = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+const char* HeatPumpT<Transport, Clock>::getWideVaneSetting() {
+  return currentSettings.wideVane;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setWideVaneSetting(const char* setting) {
+  wantedSettings.wideVane = cn105::WideVanes::lookup(setting);
+  lastWanted = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::getIseeBool() { //no setter yet
+  return currentSettings.iSee;
+}
+
+template <typename Transport, typename Clock>
+heatpumpStatus HeatPumpT<Transport, Clock>::getStatus() {
+  return currentStatus;
+}
+
+template <typename Transport, typename Clock>
+hp_temp_t HeatPumpT<Transport, Clock>::getRoomTemperature() {
+  return currentStatus.roomTemperature;
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::getOperating() {
+  return currentStatus.operating;
+}
+
+template <typename Transport, typename Clock>
+hp_temp_t HeatPumpT<Transport, Clock>::FahrenheitToCelsius(int tempF) {
+  // (F - 32) / 1.8 degrees, to the nearest half degree
+  return hp_temp_round((tempF - 32) * 500 / 9, HP_TEMP_HALF);
+}
+
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::CelsiusToFahrenheit(hp_temp_t tempC) {
+  return hp_temp_round((int32_t)tempC * 18 / 10 + HP_TEMP_C(32), HP_TEMP_SCALE) / HP_TEMP_SCALE;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setOnConnectCallback(ON_CONNECT_CALLBACK_SIGNATURE) {
+  this->onConnectCallback = onConnectCallback;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setSettingsChangedCallback(SETTINGS_CHANGED_CALLBACK_SIGNATURE) {
+  this->settingsChangedCallback = settingsChangedCallback;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setStatusChangedCallback(STATUS_CHANGED_CALLBACK_SIGNATURE) {
+  this->statusChangedCallback = statusChangedCallback;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setPacketCallback(PACKET_CALLBACK_SIGNATURE) {
+  this->packetCallback = packetCallback;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::setRoomTempChangedCallback(ROOM_TEMP_CHANGED_CALLBACK_SIGNATURE) {
+  this->roomTempChangedCallback = roomTempChangedCallback;
+}
+
+//#### WARNING, THE FOLLOWING METHOD CAN F--K YOUR HP UP, USE WISELY ####
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::sendCustomPacket(uint8_t data[], int packetLength) {
+  while(!canSend(false)) { clock.sleepMs(10); }
+
+  int plen = packetLength + 2;
+  plen = (plen > PACKET_LEN) ? PACKET_LEN : plen;
+  uint8_t packet[PACKET_LEN];
+  packet[0] = cn105::START;
+
+  // add data
+  for (int i = 0; i < packetLength; i++) {
+    packet[(i+1)] = data[i]; 
+  }
+
+  // add checksum
+  uint8_t chkSum = checkSum(packet, (plen-1));
+  packet[(plen-1)] = chkSum;
+
+  writePacket(packet, plen);
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::lookupByteMapIndex(const int valuesMap[], int len, int lookupValue) {
+  for (int i = 0; i < len; i++) {
+    if (valuesMap[i] == lookupValue) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::lookupByteMapIndex(const char* const valuesMap[], int len, const char* lookupValue) {
+  for (int i = 0; i < len; i++) {
+    if (cn105::sameValue(valuesMap[i], lookupValue)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+template <typename Transport, typename Clock>
+const char* HeatPumpT<Transport, Clock>::lookupByteMapValue(const char* const valuesMap[], const uint8_t byteMap[], int len, uint8_t byteValue) {
+  for (int i = 0; i < len; i++) {
+    if (byteMap[i] == byteValue) {
+      return valuesMap[i];
+    }
+  }
+  return valuesMap[0];
+}
+
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::lookupByteMapValue(const int valuesMap[], const uint8_t byteMap[], int len, uint8_t byteValue) {
+  for (int i = 0; i < len; i++) {
+    if (byteMap[i] == byteValue) {
+      return valuesMap[i];
+    }
+  }
+  return valuesMap[0];
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::canSend(bool isInfo) {
+  int interval = isInfo ? PACKET_INFO_INTERVAL_MS : PACKET_SENT_INTERVAL_MS;
+  // right after a failed exchange poll again at once to tell noise from
+  // a lost link; otherwise a degraded link gets half the poll traffic.
+  // Commands are never slowed.
+  if(isInfo && linkFailStreak > 0) {
+    interval = PACKET_SENT_INTERVAL_MS;
+  } else if(isInfo && linkHealth() == LINK_DEGRADED) {
+    interval *= 2;
+  }
+  return (clock.nowMs() - interval) > lastSend;
+}  
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::canRead() {
+  return (waitForRead && (clock.nowMs() - PACKET_SENT_INTERVAL_MS) > lastSend);
+}
+
+// timestamps relative to the current clock: nothing sent recently, and
+// the link considered lost until the first reply
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::resetTimers() {
+  int64_t now = clock.nowMs();
+  lastWanted = now;
+  lastSend = now - PACKET_INFO_INTERVAL_MS - 1;
+  lastRecv = now - (PACKET_SENT_INTERVAL_MS * 10);
+}
+
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::frameType(uint8_t command, uint8_t code) {
+  using namespace cn105;
+  switch(command) {
+    case CMD_CONNECT:
+    case CMD_CONNECT_ACK:
+      return FRAME_CONNECT;
+    case CMD_SET_ACK:
+      return FRAME_SET;
+    case CMD_SET:
+      if(code == SetSettings::code) return FRAME_SET;
+      if(code == SetRemoteTemp::code) return FRAME_REMOTE_TEMP;
+      if(code == SetFunctions1::code || code == SetFunctions2::code) return FRAME_FUNCTIONS;
+      break;
+    case CMD_GET:
+    case CMD_GET_REPLY:
+      if(code == Settings::code) return FRAME_SETTINGS;
+      if(code == RoomTemp::code) return FRAME_ROOM_TEMP;
+      if(code == Timers::code) return FRAME_TIMERS;
+      if(code == Status::code) return FRAME_STATUS;
+      if(code == Functions1::code || code == Functions2::code) return FRAME_FUNCTIONS;
+      break;
+  }
+  return FRAME_OTHER;
+}
+
+template <typename Transport, typename Clock>
+uint8_t HeatPumpT<Transport, Clock>::checkSum(uint8_t bytes[], int len) {
+  return cn105::checksum(bytes, len);
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::createPacket(uint8_t *packet, heatpumpSettings settings) {
+  using Msg = cn105::SetSettings;
+  Msg::begin(packet);
+  uint8_t *data = Msg::data(packet);
+
+  if(settings.power != currentSettings.power) {
+    Msg::Power::put(data, settings.power);
+  }
+  if(settings.mode!= currentSettings.mode) {
+    Msg::Mode::put(data, settings.mode);
+  }
+  if(!tempMode && settings.temperature!= currentSettings.temperature) {
+    Msg::Temp::put(data, settings.temperature);
+  }
+  else if(tempMode && settings.temperature!= currentSettings.temperature) {
+    Msg::TempHalf::put(data, settings.temperature);
+  }
+  if(settings.fan!= currentSettings.fan) {
+    Msg::Fan::put(data, settings.fan);
+  }
+  if(settings.vane!= currentSettings.vane) {
+    Msg::Vane::put(data, settings.vane);
+  }
+  if(settings.wideVane!= currentSettings.wideVane) {
+    Msg::WideVane::put(data, settings.wideVane);
+    Msg::WideVaneAdj::put(data, wideVaneAdj);
+  }
+  Msg::finish(packet);
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::createInfoPacket(uint8_t *packet, uint8_t packetType) {
+  // the requests are constant frames, checksum included
+  int request;
+  if(packetType != PACKET_TYPE_DEFAULT) {
+    request = packetType;
+  } else {
+    // request current infoMode, and increment for the next request
+    request = infoMode;
+    // if enable fastSync we only request RQST_PKT_SETTINGS, RQST_PKT_ROOM_TEMP and RQST_PKT_STATUS, so the sync will be 2x faster
+    if (infoMode == (fastSync ? 2 : (cn105::INFO_REQUEST_COUNT - 1))) {
+      infoMode = 0;
+    } else {
+      infoMode++;
+    }
+  }
+  memcpy(packet, cn105::INFO_REQUESTS[request].bytes, PACKET_LEN);
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::writePacket(uint8_t *packet, int length) {
+  uint8_t type = (uint8_t)frameType(packet[1], length > 5 ? packet[5] : 0);
+
+  exchangeSpan.begin(type);
+  HP_TRACE_BEGIN(HP_TRACE_TX, type, 0);
+  for (int i = 0; i < length; i++) {
+    transport.write((unsigned char)packet[i]);
+  }
+  HP_TRACE_END(HP_TRACE_TX, length, 0);
+  lastFrame = type;
+  stats.sent[lastFrame]++;
+
+  if(packetCallback) {
+    packetCallback(packet, length, (char*)"packetSent");
+  }
+  waitForRead = true;
+  lastSend = clock.nowMs();
+}
+
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::readPacket(int startTimeoutMs) {
+  // the read that answers a request ends its exchange, reply or not
+  bool answering = waitForRead;
+  int packetType = readFrame(startTimeoutMs);
+
+  if(answering) {
+    exchangeSpan.setResult(packetType);
+    exchangeSpan.end();
+  }
+  return packetType;
+}
+
+template <typename Transport, typename Clock>
+int HeatPumpT<Transport, Clock>::readFrame(int startTimeoutMs) {
+  HpTraceSpan rx = HP_TRACE_SPAN(HP_TRACE_RX);
+  uint8_t header[cn105::HEADER_LEN] = {};
+  uint8_t data[PACKET_LEN] = {};
+  bool foundStart = false;
+  int dataSum = 0;
+  uint8_t checksum = 0;
+  uint8_t dataLength = 0;
+  // readAllPackets() drains until nothing is left, only a missing
+  // reply to our own request counts as a timeout
+  bool expected = waitForRead;
+  
+  waitForRead = false;
+
+  unsigned char ch = 0;
+  int64_t start_ts = clock.nowMs();
+  // look at least once, so a zero timeout reads only what is buffered
+  while(!foundStart && !aborted) {
+    bool received = transport.read(&ch) == 0;
+    if(received && ch == cn105::START) {
+      header[0] = ch;
+      foundStart = true;
+      rx.begin(0);
+      clock.sleepMs(100);
+    } else if((clock.nowMs() - start_ts) >= startTimeoutMs) {
+      break;
+    } else if(!received) {
+      clock.sleepMs(1);
+    }
+  }
+  if(!foundStart) {
+    if(expected) {
+      stats.timeouts++;
+      noteExchange(false);
+    }
+    return RCVD_PKT_FAIL;
+  }
+  for(int i=1;i<5;i++) {
+    int64_t t0 = clock.nowMs();
+    while (transport.read(&ch) != 0) {
+      if (aborted || (clock.nowMs() - t0) > 200) {
+        stats.timeouts++;
+        noteExchange(false);
+        return RCVD_PKT_FAIL;
+      }
+      clock.sleepMs(1);
+    }
+    header[i] = ch;
+  }
+  // a length the data block cannot hold is a corrupt header like any
+  // other: count it and resync on the next start byte
+  if(header[0] == cn105::START && header[2] == cn105::HEADER_2 && header[3] == cn105::HEADER_3 &&
+     header[4] <= cn105::DATA_LEN) {
+    dataLength = header[4];
+    for(int i=0;i<dataLength;i++) {
+      int64_t t1 = clock.nowMs();
+      while (transport.read(&ch) != 0) {
+        if (aborted || (clock.nowMs() - t1) > 500) {
+          stats.timeouts++;
+          noteExchange(false);
+          return RCVD_PKT_FAIL;
+        }
+        clock.sleepMs(1);
+      }
+      data[i] = ch;
+    }
+    int64_t t2 = clock.nowMs();
+    while (transport.read(&ch) != 0) {
+      if (aborted || (clock.nowMs() - t2) > 200) {
+        stats.timeouts++;
+        noteExchange(false);
+        return RCVD_PKT_FAIL;
+      }
+      clock.sleepMs(1);
+    }
+    data[dataLength] = ch;
+    for (int i = 0; i < cn105::HEADER_LEN; i++) {
+      dataSum += header[i];
+    }
+    for (int i = 0; i < dataLength; i++) {
+      dataSum += data[i];
+    }
+    checksum = (0xfc - dataSum) & 0xff;
+    if(data[dataLength] == checksum) {
+      lastRecv = clock.nowMs();
+      noteExchange(true);
+      rx.setResult(frameType(header[1], data[0]));
+      stats.received[frameType(header[1], data[0])]++;
+      if(packetCallback) {
+        uint8_t packet[37];
+        for(int i=0; i<cn105::HEADER_LEN; i++) {
+          packet[i] = header[i];
+        }
+        for(int i=0; i<(dataLength+1); i++) {
+          packet[(i+5)] = data[i];
+        }
+        packetCallback(packet, PACKET_LEN, (char*)"packetRecv");
+      }
+      if(header[1] == cn105::CMD_GET_REPLY) {
+        switch(data[0]) {
+          case cn105::Settings::code: {
+            using Msg = cn105::Settings;
+            heatpumpSettings receivedSettings;
+            receivedSettings.power       = Msg::Power::get(data);
+            receivedSettings.mode        = Msg::Mode::get(data);
+            receivedSettings.iSee        = Msg::Mode::iSee(data);
+            receivedSettings.temperature = Msg::Setpoint::get(data);
+            receivedSettings.fan         = Msg::Fan::get(data);
+            receivedSettings.vane        = Msg::Vane::get(data);
+            receivedSettings.wideVane    = Msg::WideVane::get(data);
+            if(Msg::Setpoint::halfDegrees(data)) {
+              tempMode = true;
+            }
+            wideVaneAdj = Msg::WideVaneAdj::get(data);
+            if(settingsChangedCallback && receivedSettings != currentSettings) {
+              currentSettings = receivedSettings;
+              settingsChangedCallback();
+            } else {
+              currentSettings = receivedSettings;
+            }
+            if(firstRun || (autoUpdate && externalUpdate && clock.nowMs() - lastWanted > AUTOUPDATE_GRACE_PERIOD_IGNORE_EXTERNAL_UPDATES_MS)) {
+              wantedSettings = currentSettings;
+              firstRun = false;
+            }
+            return RCVD_PKT_SETTINGS;
+          }
+          case cn105::RoomTemp::code: {
+            using Msg = cn105::RoomTemp;
+            heatpumpStatus receivedStatus;
+            receivedStatus.roomTemperature = Msg::Temperature::get(data);
+            if((statusChangedCallback || roomTempChangedCallback) && currentStatus.roomTemperature != receivedStatus.roomTemperature) {
+              currentStatus.roomTemperature = receivedStatus.roomTemperature;
+              if(statusChangedCallback) {
+                statusChangedCallback(currentStatus);
+              }
+              if(roomTempChangedCallback) {
+                roomTempChangedCallback(currentStatus.roomTemperature);
+              }
+            } else {
+              currentStatus.roomTemperature = receivedStatus.roomTemperature;
+            }
+            return RCVD_PKT_ROOM_TEMP;
+          }
+          case cn105::Unknown04::code: {
+            break;
+          }
+          case cn105::Timers::code: {
+            using Msg = cn105::Timers;
+            heatpumpTimers receivedTimers;
+            receivedTimers.mode                = Msg::Mode::get(data);
+            receivedTimers.onMinutesSet        = Msg::OnSet::get(data);
+            receivedTimers.onMinutesRemaining  = Msg::OnRemaining::get(data);
+            receivedTimers.offMinutesSet       = Msg::OffSet::get(data);
+            receivedTimers.offMinutesRemaining = Msg::OffRemaining::get(data);
+            if(statusChangedCallback && currentStatus.timers != receivedTimers) {
+              currentStatus.timers = receivedTimers;
+              statusChangedCallback(currentStatus);
+            } else {
+              currentStatus.timers = receivedTimers;
+            }
+            return RCVD_PKT_TIMER;
+          }
+          case cn105::Status::code: {
+            using Msg = cn105::Status;
+            heatpumpStatus receivedStatus;
+            receivedStatus.operating = Msg::Operating::get(data);
+            receivedStatus.compressorFrequency = Msg::Compressor::get(data);
+            if(statusChangedCallback && currentStatus.operating != receivedStatus.operating) {
+              currentStatus.operating = receivedStatus.operating;
+              currentStatus.compressorFrequency = receivedStatus.compressorFrequency;
+              statusChangedCallback(currentStatus);
+            } else {
+              currentStatus.operating = receivedStatus.operating;
+              currentStatus.compressorFrequency = receivedStatus.compressorFrequency;
+            }
+            return RCVD_PKT_STATUS;
+          }
+          case cn105::Standby::code: {
+            break;
+          }
+          case cn105::Functions1::code:
+          case cn105::Functions2::code: {
+            if (dataLength == cn105::DATA_LEN) {
+              if (data[0] == cn105::Functions1::code) {
+                functions.setData1(&data[1]);
+              } else {
+                functions.setData2(&data[1]);
+              }
+              return RCVD_PKT_FUNCTIONS;
+            }
+            break;
+          }
+        }
+      }
+      if(header[1] == cn105::CMD_SET_ACK) {
+        return RCVD_PKT_UPDATE_SUCCESS;
+      } else if(header[1] == cn105::CMD_CONNECT_ACK) {
+        connected = true;
+        return RCVD_PKT_CONNECT_SUCCESS;
+      }
+    } else {
+      stats.checksumErrors++;
+      noteExchange(false);
+    }
+  } else {
+    stats.framingErrors++;
+    noteExchange(false);
+  }
+  return RCVD_PKT_FAIL;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::readAllPackets() {
+  // the reply we are waiting for, then only what is already buffered, so
+  // draining does not hold the bus for another reply timeout
+  int timeout = PACKET_REPLY_TIMEOUT_MS;
+  while (readPacket(timeout) != RCVD_PKT_FAIL) {
+    timeout = 0;
+  }
+}
+
+// Read frames until the reply we wait for, within one send interval.
+// Stray frames (a late poll reply, say) are still decoded but do not
+// count as the answer, so they cannot fail or fake an exchange.
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::awaitReply(int expected) {
+  int64_t start = clock.nowMs();
+  while(clock.nowMs() - start < PACKET_SENT_INTERVAL_MS) {
+    int packetType = readPacket();
+    if(packetType == expected) {
+      return true;
+    }
+    if(packetType == RCVD_PKT_FAIL) {
+      return false;
+    }
+    // ours is still outstanding
+    waitForRead = true;
+  }
+  waitForRead = false;
+  return false;
+}
+
+// Whether the latest settings show every field a SET frame flagged,
+// compared as encoded on the wire (a whole degree unit keeps 21 for 21.5)
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::settingsApplied(const heatpumpSettings& sent, const uint8_t *data) {
+  using Msg = cn105::SetSettings;
+  const heatpumpSettings& now = currentSettings;
+  uint8_t flags1 = data[Msg::Power::flagOffset];
+  uint8_t flags2 = data[Msg::WideVane::flagOffset];
+
+  if((flags1 & Msg::Power::flag) && now.power != sent.power) {
+    return false;
+  }
+  if((flags1 & Msg::Mode::flag) && now.mode != sent.mode) {
+    return false;
+  }
+  if(flags1 & Msg::Temp::flag) {
+    bool same = tempMode ? cn105::toHalfDegrees(now.temperature) == cn105::toHalfDegrees(sent.temperature)
+                         : hp_temp_whole(now.temperature) == hp_temp_whole(sent.temperature);
+    if(!same) {
+      return false;
+    }
+  }
+  if((flags1 & Msg::Fan::flag) && now.fan != sent.fan) {
+    return false;
+  }
+  if((flags1 & Msg::Vane::flag) && now.vane != sent.vane) {
+    return false;
+  }
+  if((flags2 & Msg::WideVane::flag) && now.wideVane != sent.wideVane) {
+    return false;
+  }
+  return true;
+}
+
+// Record the outcome of one exchange: a valid frame, or a missing,
+// truncated or corrupt one. UART error flags raised meanwhile fail it too.
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::noteExchange(bool ok) {
+  if(transport.lineErrors() != 0) {
+    stats.lineErrors++;
+    ok = false;
+  }
+  linkHistory = (uint8_t)((linkHistory << 1) | (ok ? 0 : 1));
+  if(ok) {
+    linkFailStreak = 0;
+  } else if(linkFailStreak < 255) {
+    linkFailStreak++;
+  }
+}
+
+// The command lane. A user command takes the very next bus slot: it
+// waits for the reply to the request in flight (or for that reply to
+// time out) instead of the send/info intervals, so background polling
+// delays it by at most one reply window, PACKET_REPLY_TIMEOUT_MS plus
+// the frame itself.
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::claimBus() {
+  int64_t start = clock.nowMs();
+
+  if(waitForRead) {
+    readPacket();
+  }
+  // drop leftovers of earlier exchanges so the next reply read is ours
+  drainLine();
+
+  uint32_t waited = (uint32_t)(clock.nowMs() - start);
+  if(waited > stats.commandWaitMaxMs) {
+    stats.commandWaitMaxMs = waited;
+  }
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::sendRemoteTemperature() {
+  using Msg = cn105::SetRemoteTemp;
+  uint8_t packet[PACKET_LEN];
+  hp_temp_t setting = remoteTemperature;
+
+  Msg::begin(packet);
+  uint8_t *data = Msg::data(packet);
+  if(setting > 0) {
+    Msg::Enable::put(data, 0x01);
+    Msg::Legacy::put(data, setting);
+    Msg::TempHalf::put(data, setting);
+  }
+  else {
+    Msg::Enable::put(data, 0x00);
+    Msg::TempHalf::put(data, 0); //MHK1 send 80 (0 degrees), even though it could be 00, since ControlByte is 00
+  }
+  Msg::finish(packet);
+  remoteTempPending = false;
+  writePacket(packet, PACKET_LEN);
+}
+
+template <typename Transport, typename Clock>
+heatpumpFunctions HeatPumpT<Transport, Clock>::getFunctions(bool refresh) {
+  // function codes are installer settings, so after the first successful
+  // read (or a restore from storage) they are answered from the cache
+  if (!refresh && functions.isValid()) {
+    return functions;
+  }
+
+  heatpumpFunctions cached = functions;
+  functions.clear();
+  
+  uint8_t packet1[PACKET_LEN];
+  uint8_t packet2[PACKET_LEN];
+
+  cn105::GetFunctions1::begin(packet1);
+  cn105::GetFunctions2::begin(packet2);
+  
+  claimBus();
+  writePacket(packet1, PACKET_LEN);
+  readPacket();
+
+  claimBus();
+  writePacket(packet2, PACKET_LEN);
+  readPacket();
+
+  // retry reading a few times in case responses were related
+  // to other requests
+  for (int i = 0; i < 5 && !functions.isValid() && !aborted; ++i) {
+    clock.sleepMs(100);
+    readPacket();
+  }
+
+  heatpumpFunctions result = functions;
+  if (result.isValid()) {
+    // 0 means unconfirmed, which a virtual clock can legitimately read
+    functionsStamp = clock.nowMs() > 0 ? clock.nowMs() : 1;
+  } else {
+    // keep serving the previous codes rather than nothing
+    functions = cached;
+  }
+  return result;
+}
+
+template <typename Transport, typename Clock>
+bool HeatPumpT<Transport, Clock>::setFunctions(heatpumpFunctions const& functions) {
+  if (!functions.isValid()) {
+    return false;
+  }
+
+  // only diff against codes the unit confirmed since boot; restored codes
+  // may belong to a different unit
+  if (functionsStamp == 0 && !getFunctions(true).isValid()) {
+    return false;
+  }
+
+  bool send1 = !functions.equalData1(this->functions);
+  bool send2 = !functions.equalData2(this->functions);
+  if (!send1 && !send2) {
+    return true;
+  }
+
+  uint8_t packet1[PACKET_LEN];
+  uint8_t packet2[PACKET_LEN];
+
+  cn105::SetFunctions1::begin(packet1);
+  cn105::SetFunctions2::begin(packet2);
+  uint8_t *data1 = cn105::SetFunctions1::data(packet1);
+  uint8_t *data2 = cn105::SetFunctions2::data(packet2);
+  
+  functions.getData1(&data1[1]);
+  functions.getData2(&data2[1]);
+
+  // sanity check, we expect the last data byte to be 0
+  if (data1[cn105::FUNCTIONS_LEN] != 0 || data2[cn105::FUNCTIONS_LEN] != 0)
+    return false;
+    
+  // make sure all the other data bytes are set
+  for (int i = 1; i < cn105::FUNCTIONS_LEN; ++i) {
+    if (data1[i] == 0 || data2[i] == 0)
+      return false;
+  }
+
+  cn105::SetFunctions1::finish(packet1);
+  cn105::SetFunctions2::finish(packet2);
+  
+  bool acked = true;
+  if (send1) {
+    claimBus();
+    writePacket(packet1, PACKET_LEN);
+    if (awaitReply(RCVD_PKT_UPDATE_SUCCESS)) {
+      this->functions.setData1(&data1[1]);
+    } else {
+      acked = false;
+    }
+  }
+
+  if (send2) {
+    claimBus();
+    writePacket(packet2, PACKET_LEN);
+    if (awaitReply(RCVD_PKT_UPDATE_SUCCESS)) {
+      this->functions.setData2(&data2[1]);
+    } else {
+      acked = false;
+    }
+  }
+
+  if (!acked) {
+    // unknown what the unit applied, read it again next time
+    functionsStamp = 0;
+    this->functions.clear();
+  } else {
+    // confirmed again; the stamp moves on so callers see the new codes
+    int64_t now = clock.nowMs();
+    functionsStamp = now > functionsStamp ? now : functionsStamp + 1;
+  }
+  return acked;
+}
+
+template <typename Transport, typename Clock>
+int64_t HeatPumpT<Transport, Clock>::getFunctionsStamp() {
+  return functionsStamp;
+}
+
+template <typename Transport, typename Clock>
+void HeatPumpT<Transport, Clock>::restoreFunctions(heatpumpFunctions const& functions) {
+  if (functions.isValid()) {
+    this->functions = functions;
+    functionsStamp = 0;
+  }
+}
+
+#endif // LIB_HEATPUMP_HEAT_PUMP_IMPL_H
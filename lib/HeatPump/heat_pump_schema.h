@@ -0,0 +1,383 @@
+/*
+  heat_pump_schema.h - CN105 message schema for the HeatPump library
+  Copyright (c) 2025 Joel Winarske.  All right reserved.
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef LIB_HEATPUMP_HEAT_PUMP_SCHEMA_H
+#define LIB_HEATPUMP_HEAT_PUMP_SCHEMA_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "heat_pump_temp.h"
+
+// Every CN105 message and field in one place. A frame is
+//
+//   0xfc <command> 0x01 0x30 <length> <data[0..length-1]> <checksum>
+//
+// and data[0] is the message code for everything but CONNECT. Field
+// offsets below are indexes into data[], so frame byte = offset + 5.
+//
+// Fields are types, so get()/put() compile to a single masked byte
+// access, and constant frames (CONNECT, the info requests) are built
+// by constexpr functions, checksum included, and live in flash. A field
+// also carries its encoding: one backed by a value table reads and
+// writes the library's value ("HEAT", 22 degrees), a temperature field
+// hp_temp_t, whatever the bytes on the wire are.
+//
+// Adding a message: declare it with its command, code and fields here,
+// use Msg::begin()/Msg::finish() to encode it and Msg::Field::get() to
+// decode it.
+
+namespace cn105 {
+
+// framing
+inline constexpr uint8_t START = 0xfc;
+inline constexpr uint8_t HEADER_2 = 0x01;
+inline constexpr uint8_t HEADER_3 = 0x30;
+inline constexpr int HEADER_LEN = 5;
+inline constexpr int DATA_LEN = 16;
+inline constexpr int FRAME_LEN = HEADER_LEN + DATA_LEN + 1;
+
+// frame commands (byte 1)
+inline constexpr uint8_t CMD_SET = 0x41;
+inline constexpr uint8_t CMD_GET = 0x42;
+inline constexpr uint8_t CMD_CONNECT = 0x5a;
+inline constexpr uint8_t CMD_SET_ACK = 0x61;
+inline constexpr uint8_t CMD_GET_REPLY = 0x62;
+inline constexpr uint8_t CMD_CONNECT_ACK = 0x7a;
+
+constexpr uint8_t checksum(const uint8_t *bytes, int len) {
+  int sum = 0;
+  for (int i = 0; i < len; i++) {
+    sum += bytes[i];
+  }
+  return (0xfc - sum) & 0xff;
+}
+
+template <int N>
+struct Frame {
+  uint8_t bytes[N];
+};
+
+// header, code and a zero payload, checksum included
+constexpr Frame<FRAME_LEN> makeFrame(uint8_t command, uint8_t code) {
+  Frame<FRAME_LEN> f {};
+  f.bytes[0] = START;
+  f.bytes[1] = command;
+  f.bytes[2] = HEADER_2;
+  f.bytes[3] = HEADER_3;
+  f.bytes[4] = DATA_LEN;
+  f.bytes[5] = code;
+  f.bytes[FRAME_LEN - 1] = checksum(f.bytes, FRAME_LEN - 1);
+  return f;
+}
+
+// one byte of data[], or the bits of it selected by Mask (unshifted)
+template <uint8_t Offset, uint8_t Mask = 0xff>
+struct Field {
+  static_assert(Offset > 0 && Offset < DATA_LEN, "field outside the data block");
+  static constexpr uint8_t offset = Offset;
+  static constexpr uint8_t mask = Mask;
+
+  static constexpr uint8_t get(const uint8_t *data) { return data[Offset] & Mask; }
+  static void put(uint8_t *data, uint8_t value) {
+    data[Offset] = (data[Offset] & ~Mask) | (value & Mask);
+  }
+};
+
+// a SET field; writing it also raises its bit in the control flags
+// (data[1] or data[2]) so the unit applies it
+template <uint8_t Offset, uint8_t FlagOffset, uint8_t Flag, uint8_t Mask = 0xff>
+struct SetField : Field<Offset, Mask> {
+  static_assert(FlagOffset == 1 || FlagOffset == 2, "control flags are data[1] and data[2]");
+  static constexpr uint8_t flagOffset = FlagOffset;
+  static constexpr uint8_t flag = Flag;
+
+  static void put(uint8_t *data, uint8_t value) {
+    Field<Offset, Mask>::put(data, value);
+    data[FlagOffset] |= Flag;
+  }
+};
+
+// number of entries of a table, std::size() without <iterator>
+template <typename T, int N>
+constexpr int countOf(const T (&)[N]) { return N; }
+
+// names compare ignoring case, numbers as numbers
+constexpr bool sameValue(int a, int b) { return a == b; }
+constexpr bool sameValue(const char *a, const char *b) {
+  if (a == nullptr || b == nullptr) {
+    return false;
+  }
+  for (; *a && *b; a++, b++) {
+    char ca = (*a >= 'A' && *a <= 'Z') ? (char)(*a - 'A' + 'a') : *a;
+    char cb = (*b >= 'A' && *b <= 'Z') ? (char)(*b - 'A' + 'a') : *b;
+    if (ca != cb) {
+      return false;
+    }
+  }
+  return *a == '\0' && *b == '\0';
+}
+
+// the values a field takes: Bytes[i] on the wire is Values[i] in the
+// library. Unknown bytes and values map to the first entry.
+template <const auto& Bytes, const auto& Values>
+struct Table {
+  static constexpr int count = countOf(Bytes);
+  static_assert(countOf(Values) == count, "a value for every byte");
+
+  static constexpr auto decode(uint8_t byte) {
+    for (int i = 0; i < count; i++) {
+      if (Bytes[i] == byte) {
+        return Values[i];
+      }
+    }
+    return Values[0];
+  }
+  using Value = decltype(decode(0));
+
+  // index of a value, -1 if the table has none
+  static constexpr int indexOf(Value value) {
+    for (int i = 0; i < count; i++) {
+      if (sameValue(Values[i], value)) {
+        return i;
+      }
+    }
+    return -1;
+  }
+  // the table's own entry for a value, so names compare by pointer
+  static constexpr Value lookup(Value value) {
+    int i = indexOf(value);
+    return Values[i < 0 ? 0 : i];
+  }
+  // the value at an index, the first one out of range
+  static constexpr Value at(int index) { return Values[index >= 0 && index < count ? index : 0]; }
+  static constexpr uint8_t encode(Value value) {
+    int i = indexOf(value);
+    return Bytes[i < 0 ? 0 : i];
+  }
+};
+
+// a field holding one of a table's values
+template <typename Base, typename Values>
+struct Named : Base {
+  using Value = typename Values::Value;
+
+  static constexpr Value get(const uint8_t *data) { return Values::decode(Base::get(data)); }
+  static void put(uint8_t *data, Value value) { Base::put(data, Values::encode(value)); }
+};
+
+// a field that is either Set or 0
+template <typename Base, uint8_t Set>
+struct Flag : Base {
+  static constexpr bool get(const uint8_t *data) { return Base::get(data) == Set; }
+  static void put(uint8_t *data, bool on) { Base::put(data, on ? Set : 0); }
+};
+
+// a count of Unit steps, e.g. timer minutes
+template <typename Base, int Unit>
+struct Scaled : Base {
+  static constexpr int get(const uint8_t *data) { return Base::get(data) * Unit; }
+};
+
+template <uint8_t Command, uint8_t Code>
+struct Message {
+  static constexpr uint8_t command = Command;
+  static constexpr uint8_t code = Code;
+  // the message with an all-zero payload, e.g. an info request
+  static constexpr Frame<FRAME_LEN> empty = makeFrame(Command, Code);
+
+  static uint8_t *data(uint8_t *packet) { return packet + HEADER_LEN; }
+  // start a frame: header, code, zero payload
+  static void begin(uint8_t *packet) { memcpy(packet, empty.bytes, FRAME_LEN); }
+  // seal it once the fields are written
+  static void finish(uint8_t *packet) {
+    packet[FRAME_LEN - 1] = checksum(packet, FRAME_LEN - 1);
+  }
+};
+
+// temperatures in half degrees offset by 128, used by units that
+// support 0.5 degree setpoints and by the remote temperature frame
+inline uint8_t toHalfDegrees(hp_temp_t temp) {
+  return (uint8_t)(hp_temp_round(temp, HP_TEMP_HALF) / HP_TEMP_HALF + 128);
+}
+constexpr hp_temp_t fromHalfDegrees(uint8_t value) { return (hp_temp_t)(((int)value - 128) * HP_TEMP_HALF); }
+
+// a temperature as a table byte, in whole degrees
+template <typename Base, typename Degrees>
+struct WholeDegrees : Base {
+  static constexpr hp_temp_t get(const uint8_t *data) { return HP_TEMP_C(Degrees::decode(Base::get(data))); }
+  static void put(uint8_t *data, hp_temp_t temp) { Base::put(data, Degrees::encode(hp_temp_whole(temp))); }
+};
+
+// a temperature in half degrees; 0 on units that only have whole ones
+template <typename Base>
+struct HalfDegrees : Base {
+  static constexpr bool present(const uint8_t *data) { return Base::get(data) != 0; }
+  static constexpr hp_temp_t get(const uint8_t *data) { return fromHalfDegrees(Base::get(data)); }
+  static void put(uint8_t *data, hp_temp_t temp) { Base::put(data, toHalfDegrees(temp)); }
+};
+
+// a temperature reported both ways, the half degree byte where present
+template <typename Whole, typename Half>
+struct TempPair {
+  static constexpr bool halfDegrees(const uint8_t *data) { return Half::present(data); }
+  static constexpr hp_temp_t get(const uint8_t *data) {
+    return Half::present(data) ? Half::get(data) : Whole::get(data);
+  }
+};
+
+// value tables: the byte on the wire and the library's name for it
+inline constexpr uint8_t POWER[2]            = {0x00, 0x01};
+inline constexpr const char* POWER_MAP[2]    = {"OFF", "ON"};
+inline constexpr uint8_t MODE[5]             = {0x01,   0x02,  0x03, 0x07, 0x08};
+inline constexpr const char* MODE_MAP[5]     = {"HEAT", "DRY", "COOL", "FAN", "AUTO"};
+inline constexpr uint8_t TEMP[16]            = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+inline constexpr int TEMP_MAP[16]            = {31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16};
+inline constexpr uint8_t FAN[6]              = {0x00,  0x01,   0x02, 0x03, 0x05, 0x06};
+inline constexpr const char* FAN_MAP[6]      = {"AUTO", "QUIET", "1", "2", "3", "4"};
+inline constexpr uint8_t VANE[7]             = {0x00,  0x01, 0x02, 0x03, 0x04, 0x05, 0x07};
+inline constexpr const char* VANE_MAP[7]     = {"AUTO", "1", "2", "3", "4", "5", "SWING"};
+inline constexpr uint8_t WIDEVANE[7]         = {0x01, 0x02, 0x03, 0x04, 0x05, 0x08, 0x0c};
+inline constexpr const char* WIDEVANE_MAP[7] = {"<<", "<",  "|",  ">",  ">>", "<>", "SWING"};
+inline constexpr uint8_t ROOM_TEMP[32]       = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+                                                0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
+inline constexpr int ROOM_TEMP_MAP[32]       = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25,
+                                                26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41};
+inline constexpr uint8_t TIMER_MODE[4]       = {0x00,  0x01,  0x02, 0x03};
+inline constexpr const char* TIMER_MODE_MAP[4] = {"NONE", "OFF", "ON", "BOTH"};
+
+using Powers     = Table<POWER, POWER_MAP>;
+using Modes      = Table<MODE, MODE_MAP>;
+using Temps      = Table<TEMP, TEMP_MAP>;
+using Fans       = Table<FAN, FAN_MAP>;
+using Vanes      = Table<VANE, VANE_MAP>;
+using WideVanes  = Table<WIDEVANE, WIDEVANE_MAP>;
+using RoomTemps  = Table<ROOM_TEMP, ROOM_TEMP_MAP>;
+using TimerModes = Table<TIMER_MODE, TIMER_MODE_MAP>;
+
+inline constexpr uint8_t ISEE_MODE_OFFSET = 0x08;
+inline constexpr uint8_t WIDEVANE_ADJUST = 0x80;
+inline constexpr int TIMER_INCREMENT_MINUTES = 10;
+
+// MODE, plus ISEE_MODE_OFFSET while the i-See sensor is active
+template <typename Base>
+struct ISeeMode : Named<Base, Modes> {
+  static constexpr bool iSee(const uint8_t *data) { return Base::get(data) > ISEE_MODE_OFFSET; }
+  static constexpr const char* get(const uint8_t *data) {
+    uint8_t mode = Base::get(data);
+    return Modes::decode(iSee(data) ? (uint8_t)(mode - ISEE_MODE_OFFSET) : mode);
+  }
+};
+
+// the remote temperature for older units, 3 + (t - 10) * 2
+template <typename Base>
+struct LegacyRemoteTemp : Base {
+  static void put(uint8_t *data, hp_temp_t temp) {
+    Base::put(data, (uint8_t)(3 + (hp_temp_round(temp, HP_TEMP_HALF) - HP_TEMP_C(10)) / HP_TEMP_HALF));
+  }
+};
+
+// CONNECT, the only message without a code byte
+inline constexpr int CONNECT_LEN = 8;
+constexpr Frame<CONNECT_LEN> makeConnectFrame() {
+  Frame<CONNECT_LEN> f {{START, CMD_CONNECT, HEADER_2, HEADER_3, 0x02, 0xca, 0x01, 0x00}};
+  f.bytes[CONNECT_LEN - 1] = checksum(f.bytes, CONNECT_LEN - 1);
+  return f;
+}
+inline constexpr Frame<CONNECT_LEN> CONNECT = makeConnectFrame();
+static_assert(CONNECT.bytes[CONNECT_LEN - 1] == 0xa8, "CONNECT checksum");
+
+// settings change, only fields with their control flag set are applied
+struct SetSettings : Message<CMD_SET, 0x01> {
+  using Power       = Named<SetField<3, 1, 0x01>, Powers>;
+  using Mode        = Named<SetField<4, 1, 0x02>, Modes>;
+  using Temp        = WholeDegrees<SetField<5, 1, 0x04>, Temps>;
+  using Fan         = Named<SetField<6, 1, 0x08>, Fans>;
+  using Vane        = Named<SetField<7, 1, 0x10>, Vanes>;
+  using WideVane    = Named<SetField<13, 2, 0x01, 0x0f>, WideVanes>;
+  using WideVaneAdj = Flag<SetField<13, 2, 0x01, 0xf0>, WIDEVANE_ADJUST>;
+  using TempHalf    = HalfDegrees<SetField<14, 1, 0x04>>;  // instead of Temp
+};
+
+// remote room temperature, Enable 0 reverts to the internal sensor
+struct SetRemoteTemp : Message<CMD_SET, 0x07> {
+  using Enable   = Field<1>;
+  using Legacy   = LegacyRemoteTemp<Field<2>>;
+  using TempHalf = HalfDegrees<Field<3>>;
+};
+
+// function codes, 15 bytes each from data[1]
+inline constexpr int FUNCTIONS_LEN = 15;
+struct SetFunctions1 : Message<CMD_SET, 0x1f> {};
+struct SetFunctions2 : Message<CMD_SET, 0x21> {};
+struct GetFunctions1 : Message<CMD_GET, 0x20> {};
+struct GetFunctions2 : Message<CMD_GET, 0x22> {};
+
+// info requests and their replies share the code
+struct Settings : Message<CMD_GET_REPLY, 0x02> {
+  using Power       = Named<Field<3>, Powers>;
+  using Mode        = ISeeMode<Field<4>>;
+  using Temp        = WholeDegrees<Field<5>, Temps>;
+  using Fan         = Named<Field<6>, Fans>;
+  using Vane        = Named<Field<7>, Vanes>;
+  using WideVane    = Named<Field<10, 0x0f>, WideVanes>;
+  using WideVaneAdj = Flag<Field<10, 0xf0>, WIDEVANE_ADJUST>;
+  using TempHalf    = HalfDegrees<Field<11>>;
+  using Setpoint    = TempPair<Temp, TempHalf>;
+};
+
+struct RoomTemp : Message<CMD_GET_REPLY, 0x03> {
+  using Temp        = WholeDegrees<Field<3>, RoomTemps>;
+  using TempHalf    = HalfDegrees<Field<6>>;
+  using Temperature = TempPair<Temp, TempHalf>;
+};
+
+// requested in the rotation, contents unknown
+struct Unknown04 : Message<CMD_GET_REPLY, 0x04> {};
+
+struct Timers : Message<CMD_GET_REPLY, 0x05> {
+  using Mode         = Named<Field<3>, TimerModes>;
+  using OnSet        = Scaled<Field<4>, TIMER_INCREMENT_MINUTES>;  // minutes
+  using OffSet       = Scaled<Field<5>, TIMER_INCREMENT_MINUTES>;
+  using OnRemaining  = Scaled<Field<6>, TIMER_INCREMENT_MINUTES>;
+  using OffRemaining = Scaled<Field<7>, TIMER_INCREMENT_MINUTES>;
+};
+
+struct Status : Message<CMD_GET_REPLY, 0x06> {
+  using Compressor = Field<3>;         // Hz
+  using Operating  = Field<4>;
+};
+
+// standby mode (maybe?), not decoded
+struct Standby : Message<CMD_GET_REPLY, 0x09> {};
+
+struct Functions1 : Message<CMD_GET_REPLY, 0x20> {};
+struct Functions2 : Message<CMD_GET_REPLY, 0x22> {};
+
+// info requests in sync() rotation order; the RQST_PKT_* indexes of
+// HeatPumpT point into this table
+inline constexpr int INFO_REQUEST_COUNT = 6;
+inline constexpr Frame<FRAME_LEN> INFO_REQUESTS[INFO_REQUEST_COUNT] = {
+  makeFrame(CMD_GET, Settings::code),
+  makeFrame(CMD_GET, RoomTemp::code),
+  makeFrame(CMD_GET, Status::code),
+  makeFrame(CMD_GET, Unknown04::code),
+  makeFrame(CMD_GET, Timers::code),
+  makeFrame(CMD_GET, Standby::code),
+};
+
+} // namespace cn105
+
+#endif // LIB_HEATPUMP_HEAT_PUMP_SCHEMA_H
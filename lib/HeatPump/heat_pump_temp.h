@@ -0,0 +1,60 @@
+/*
+  heat_pump_temp.h - Fixed-point temperatures for the HeatPump library
+  Copyright (c) 2025 Joel Winarske.  All right reserved.
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef LIB_HEATPUMP_HEAT_PUMP_TEMP_H
+#define LIB_HEATPUMP_HEAT_PUMP_TEMP_H
+
+#include <stdint.h>
+
+// Every temperature, from the frame decoders to the Matter attributes,
+// is a hp_temp_t in hundredths of a degree Celsius, the unit Matter
+// uses. The unit works in half or whole degrees, which are exact in
+// this scale, so values compare with == and pass to Matter unchanged.
+// Plain C, the application's C code includes it too.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int16_t hp_temp_t;
+
+#define HP_TEMP_SCALE 100
+#define HP_TEMP_HALF  (HP_TEMP_SCALE / 2)
+
+// whole degrees, for constants
+#define HP_TEMP_C(degrees) ((hp_temp_t)((degrees) * HP_TEMP_SCALE))
+
+// round to a multiple of step, halves away from zero
+static inline hp_temp_t hp_temp_round(int32_t temp, int32_t step) {
+  int32_t half = step / 2;
+  return (hp_temp_t)((temp >= 0 ? (temp + half) / step : -((-temp + half) / step)) * step);
+}
+
+// nearest whole degree, as an int
+static inline int hp_temp_whole(hp_temp_t temp) {
+  return hp_temp_round(temp, HP_TEMP_SCALE) / HP_TEMP_SCALE;
+}
+
+// for logs and shells: printf(HP_TEMP_FMT, HP_TEMP_ARGS(t)) prints "-0.5"
+#define HP_TEMP_FMT "%s%d.%d"
+#define HP_TEMP_ARGS(temp)                                                   \
+  ((temp) < 0 ? "-" : ""), ((temp) < 0 ? -(temp) : (temp)) / HP_TEMP_SCALE,  \
+  (((temp) < 0 ? -(temp) : (temp)) % HP_TEMP_SCALE) / 10
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIB_HEATPUMP_HEAT_PUMP_TEMP_H
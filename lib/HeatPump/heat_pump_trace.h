@@ -0,0 +1,109 @@
+/*
+  heat_pump_trace.h - Trace points for the HeatPump library
+  Copyright (c) 2025 Joel Winarske.  All right reserved.
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef LIB_HEATPUMP_HEAT_PUMP_TRACE_H
+#define LIB_HEATPUMP_HEAT_PUMP_TRACE_H
+
+#include <stdint.h>
+
+// Begin/end pairs around the protocol's units of work. On Zephyr with
+// the CTF tracing format each is a named event ("<name>_begin" and
+// "<name>_end", two 32-bit arguments), written by the tracing backend
+// next to the kernel's own events; anywhere else they compile to
+// nothing. Names stay under the 20 bytes CTF keeps of a name.
+//
+//   name           begin arg0          end arg0
+//   cn105_tx       frame type          frame length
+//   cn105_rx       -                   frame type
+//   cn105_xchg     request frame type  reply packet type (0 = none)
+//   cn105_poll     info type, 99 next  step taken, hpTraceStep
+//   cn105_connect  bitrate             1 if connected
+//
+// The application adds its own (hp_submit, hp_cmd, hp_callback) with
+// the same macros. Frame types are heatpumpFrameType values.
+
+#define HP_TRACE_TX      "cn105_tx"
+#define HP_TRACE_RX      "cn105_rx"
+#define HP_TRACE_XCHG    "cn105_xchg"
+#define HP_TRACE_POLL    "cn105_poll"
+#define HP_TRACE_CONNECT "cn105_connect"
+
+// what one sync() call did
+enum hpTraceStep {
+  TRACE_STEP_CONNECT = 0,
+  TRACE_STEP_READ,
+  TRACE_STEP_UPDATE,
+  TRACE_STEP_REMOTE_TEMP,
+  TRACE_STEP_INFO,
+  TRACE_STEP_IDLE
+};
+
+#if defined(__ZEPHYR__) && defined(CONFIG_TRACING_CTF)
+#include <zephyr/tracing/tracing.h>
+
+#define HP_TRACE_ENABLED 1
+#define HP_TRACE_BEGIN(name, arg0, arg1) \
+  sys_trace_named_event(name "_begin", (uint32_t)(arg0), (uint32_t)(arg1))
+#define HP_TRACE_END(name, arg0, arg1) \
+  sys_trace_named_event(name "_end", (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define HP_TRACE_ENABLED 0
+#define HP_TRACE_BEGIN(name, arg0, arg1) do { (void)(arg0); (void)(arg1); } while(0)
+#define HP_TRACE_END(name, arg0, arg1) do { (void)(arg0); (void)(arg1); } while(0)
+#endif
+
+#ifdef __cplusplus
+// A span whose end has several ways out, or lies in another function:
+// begin() emits the begin event, end() or the destructor the end event
+// with the result set last. Empty when tracing is off.
+#define HP_TRACE_SPAN(name) HpTraceSpan(name "_begin", name "_end")
+
+class HpTraceSpan {
+  public:
+#if HP_TRACE_ENABLED
+    HpTraceSpan(const char *beginName, const char *endName)
+      : beginName(beginName), endName(endName) {}
+    ~HpTraceSpan() { end(); }
+
+    void begin(uint32_t arg) {
+      end();
+      result = 0;
+      sys_trace_named_event(beginName, arg, 0);
+      open = true;
+    }
+    void end() {
+      if(open) {
+        open = false;
+        sys_trace_named_event(endName, result, 0);
+      }
+    }
+    void setResult(uint32_t value) { result = value; }
+
+  private:
+    const char *beginName;
+    const char *endName;
+    uint32_t result = 0;
+    bool open = false;
+#else
+    HpTraceSpan(const char *, const char *) {}
+
+    void begin(uint32_t) {}
+    void end() {}
+    void setResult(uint32_t) {}
+#endif
+};
+#endif
+
+#endif // LIB_HEATPUMP_HEAT_PUMP_TRACE_H
@@ -0,0 +1,118 @@
+/*
+  heat_pump_transport.h - CN105 byte transport policies for the HeatPump library
+  Copyright (c) 2025 Joel Winarske.  All right reserved.
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef LIB_HEATPUMP_HEAT_PUMP_TRANSPORT_H
+#define LIB_HEATPUMP_HEAT_PUMP_TRANSPORT_H
+
+#include <stdint.h>
+
+#ifdef __ZEPHYR__
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <errno.h>
+#else
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+// The CN105 link is 8 data bits, even parity, 1 stop bit at 2400 or
+// 9600 baud. A transport policy provides:
+//
+//   bool configure(int bitrate);  // (re)configure the line, false on failure
+//   int read(unsigned char *ch);  // 0 and one byte if available, -1 otherwise;
+//                                 // never blocks, the caller polls with the clock
+//   void write(unsigned char ch); // send one byte
+//   int lineErrors();             // framing, parity, overrun or break seen
+//                                 // since the last call, 0 if none or unknown
+
+#ifdef __ZEPHYR__
+// polled Zephyr UART, the default transport on target
+class ZephyrUartTransport {
+  public:
+    void setDevice(const struct device *dev) { this->dev = dev; }
+
+    bool configure(int bitrate) {
+      struct uart_config cfg;
+      cfg.baudrate = bitrate;
+      cfg.parity = UART_CFG_PARITY_EVEN;
+      cfg.stop_bits = UART_CFG_STOP_BITS_1;
+      cfg.data_bits = UART_CFG_DATA_BITS_8;
+      cfg.flow_ctrl = UART_CFG_FLOW_CTRL_NONE;
+      if(dev == nullptr) {
+        return false;
+      }
+      // emulated UARTs (the native_sim pty) have no line settings
+      int ret = uart_configure(dev, &cfg);
+      return ret == 0 || ret == -ENOSYS;
+    }
+    int read(unsigned char *ch) { return uart_poll_in(dev, ch) == 0 ? 0 : -1; }
+    void write(unsigned char ch) { uart_poll_out(dev, ch); }
+    // UART_ERROR_* flags; drivers without error reporting return -ENOSYS
+    int lineErrors() {
+      int err = uart_err_check(dev);
+      return err > 0 ? err : 0;
+    }
+
+  private:
+    const struct device *dev = nullptr;
+};
+#else
+// serial port or pty on a POSIX host, the default transport there
+class PosixSerialTransport {
+  public:
+    ~PosixSerialTransport() { close(); }
+
+    bool open(const char *path) {
+      close();
+      fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+      return fd >= 0;
+    }
+    void close() {
+      if(fd >= 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+
+    // a pty accepts but ignores the speed and parity
+    bool configure(int bitrate) {
+      struct termios tio;
+      if(fd < 0 || tcgetattr(fd, &tio) != 0) {
+        return false;
+      }
+      cfmakeraw(&tio);
+      tio.c_cflag |= PARENB | CLOCAL | CREAD;
+      tio.c_cflag &= ~(PARODD | CSTOPB);
+      speed_t speed = bitrate == 9600 ? B9600 : B2400;
+      cfsetispeed(&tio, speed);
+      cfsetospeed(&tio, speed);
+      return tcsetattr(fd, TCSANOW, &tio) == 0;
+    }
+    int read(unsigned char *ch) { return fd >= 0 && ::read(fd, ch, 1) == 1 ? 0 : -1; }
+    void write(unsigned char ch) {
+      if(fd >= 0) {
+        (void)::write(fd, &ch, 1);
+      }
+    }
+    // parity and framing errors are not reported through read()
+    int lineErrors() { return 0; }
+
+  private:
+    int fd = -1;
+};
+#endif
+
+#endif // LIB_HEATPUMP_HEAT_PUMP_TRANSPORT_H
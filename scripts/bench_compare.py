@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Compare two hp_bench JSON reports, e.g. from the base and head commit:
+#
+#   ./build-host/hp_bench --json base.json
+#   (check out the change, rebuild)
+#   ./build-host/hp_bench --json head.json
+#   scripts/bench_compare.py base.json head.json
+#
+# Exits 1 when a benchmark got slower than --threshold percent or
+# started allocating, so it can gate CI.
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        report = json.load(f)
+    if report.get("format") != 1:
+        sys.exit(f"{path}: unsupported report format {report.get('format')}")
+    return {r["name"]: r for r in report["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two hp_bench reports")
+    parser.add_argument("base", help="report of the reference build")
+    parser.add_argument("head", help="report of the build under test")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="slowdown in percent reported as a regression (default 10)")
+    args = parser.parse_args()
+
+    base = load(args.base)
+    head = load(args.head)
+    regressions = 0
+
+    print(f"{'benchmark':28} {'base ns':>10} {'head ns':>10} {'delta':>8} {'B/op':>12}")
+    for name in list(base) + [n for n in head if n not in base]:
+        if name not in head:
+            print(f"{name:28} {base[name]['ns_per_op']:10.1f} {'-':>10}  removed")
+            continue
+        if name not in base:
+            print(f"{name:28} {'-':>10} {head[name]['ns_per_op']:10.1f}  new")
+            continue
+
+        b, h = base[name], head[name]
+        delta = (h["ns_per_op"] - b["ns_per_op"]) / b["ns_per_op"] * 100 if b["ns_per_op"] else 0
+        bytes_col = f"{b['bytes_per_op']:.0f}->{h['bytes_per_op']:.0f}"
+        flag = ""
+        if delta > args.threshold:
+            flag = "  SLOWER"
+            regressions += 1
+        elif delta < -args.threshold:
+            flag = "  faster"
+        if h["bytes_per_op"] > b["bytes_per_op"]:
+            flag += "  ALLOCATES"
+            regressions += 1
+        print(f"{name:28} {b['ns_per_op']:10.1f} {h['ns_per_op']:10.1f} {delta:+7.1f}% "
+              f"{bytes_col:>12}{flag}")
+
+    if regressions:
+        print(f"\n{regressions} regression(s) beyond {args.threshold:g}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Matter write latency benchmark on native_sim against an emulated
+# heat pump. Runs the firmware, attaches the CN105 emulator to the pty
+# of its second UART and collects the "latency:" report:
+#
+#   west build -b native_sim -- -DCONF_FILE=prj_native_sim.conf
+#   scripts/latency_bench.py --json latency.json build/zephyr/zephyr.exe
+#
+# The emulator paces its replies like a 2400 baud link plus a fixed unit
+# response time, so the numbers track the firmware and the protocol
+# schedule rather than the host. With --pty it only serves a pty, e.g.
+# for host/hp_probe.
+
+import argparse
+import json
+import os
+import re
+import select
+import subprocess
+import sys
+import threading
+import time
+import tty
+
+HEADER_SET = 0x41
+HEADER_INFO = 0x42
+HEADER_CONNECT = 0x5A
+
+
+def frame(command, data):
+    body = bytes([0xFC, command, 0x01, 0x30, len(data)]) + bytes(data)
+    return body + bytes([(0xFC - sum(body)) & 0xFF])
+
+
+class EmulatedUnit:
+    """Answers CONNECT, SET and info requests like an indoor unit."""
+
+    def __init__(self, fd, baud, reply_delay_ms):
+        self.fd = fd
+        self.byte_time = 11.0 / baud if baud else 0.0
+        self.reply_delay = reply_delay_ms / 1000.0
+        # raw CN105 values: power ON, HEAT, 22C, fan AUTO, vane AUTO, wide |
+        self.settings = {"power": 0x01, "mode": 0x01, "temp": 0x09, "fan": 0x00,
+                         "vane": 0x00, "wide": 0x03, "temp_half": 0x00}
+        self.stop = threading.Event()
+
+    def send(self, data):
+        time.sleep(self.reply_delay)
+        for b in data:
+            os.write(self.fd, bytes([b]))
+            if self.byte_time:
+                time.sleep(self.byte_time)
+
+    def apply_set(self, pkt):
+        if pkt[5] != 0x01:
+            return  # remote temperature and function writes are acked only
+        s = self.settings
+        if pkt[6] & 0x01:
+            s["power"] = pkt[8]
+        if pkt[6] & 0x02:
+            s["mode"] = pkt[9]
+        if pkt[6] & 0x04:
+            if pkt[19]:
+                s["temp_half"] = pkt[19]
+            else:
+                s["temp"] = pkt[10]
+        if pkt[6] & 0x08:
+            s["fan"] = pkt[11]
+        if pkt[6] & 0x10:
+            s["vane"] = pkt[12]
+        if pkt[7] & 0x01:
+            s["wide"] = pkt[18]
+
+    def info(self, code):
+        d = [0] * 16
+        d[0] = code
+        s = self.settings
+        if code == 0x02:
+            d[3], d[4], d[5], d[6], d[7] = s["power"], s["mode"], s["temp"], s["fan"], s["vane"]
+            d[10], d[11] = s["wide"], s["temp_half"]
+        elif code == 0x03:
+            d[3], d[6] = 0x0B, 0xAA  # 21.0C
+        elif code == 0x06:
+            d[3], d[4] = 42, s["power"]
+        return frame(0x62, d)
+
+    def run(self):
+        buf = b""
+        while not self.stop.is_set():
+            r, _, _ = select.select([self.fd], [], [], 0.1)
+            if not r:
+                continue
+            try:
+                buf += os.read(self.fd, 64)
+            except OSError:
+                return
+            while buf:
+                if buf[0] != 0xFC:
+                    buf = buf[1:]
+                    continue
+                if len(buf) < 5 or len(buf) < 6 + buf[4]:
+                    break
+                pkt, buf = buf[:6 + buf[4]], buf[6 + buf[4]:]
+                if (0xFC - sum(pkt[:-1])) & 0xFF != pkt[-1]:
+                    continue
+                if pkt[1] == HEADER_CONNECT:
+                    self.send(frame(0x7A, [0x00]))
+                elif pkt[1] == HEADER_SET:
+                    self.apply_set(pkt)
+                    self.send(frame(0x61, [0] * 16))
+                elif pkt[1] == HEADER_INFO:
+                    self.send(self.info(pkt[5]))
+
+
+def open_raw(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    return fd
+
+
+def serve_pty(args):
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    print(f"emulated heat pump on {os.ttyname(slave)}", flush=True)
+    unit = EmulatedUnit(master, args.baud, args.reply_delay_ms)
+    try:
+        unit.run()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+LATENCY = re.compile(r"latency: (\w+) (wire|ack|confirm) n=(\d+)"
+                     r"(?: p50=(\d+) p95=(\d+) p99=(\d+) max=(\d+))?")
+COUNTS = re.compile(r"latency: (\w+) failed=(\d+) unconfirmed=(\d+)")
+PTY = re.compile(r"uart_1 connected to pseudotty: (\S+)")
+
+
+def run_firmware(args):
+    proc = subprocess.Popen([args.exe] + args.exe_args, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, text=True, bufsize=1)
+    unit = None
+    results = {}
+    deadline = time.time() + args.timeout
+    done = False
+
+    try:
+        for line in proc.stdout:
+            if args.verbose:
+                sys.stdout.write(line)
+            m = PTY.search(line)
+            if m and unit is None:
+                unit = EmulatedUnit(open_raw(m.group(1)), args.baud, args.reply_delay_ms)
+                threading.Thread(target=unit.run, daemon=True).start()
+            m = LATENCY.search(line)
+            if m:
+                entry = results.setdefault(m.group(1), {})
+                stage = {"n": int(m.group(3))}
+                if m.group(4):
+                    stage.update(p50_us=int(m.group(4)), p95_us=int(m.group(5)),
+                                 p99_us=int(m.group(6)), max_us=int(m.group(7)))
+                entry[m.group(2)] = stage
+            m = COUNTS.search(line)
+            if m:
+                entry = results.setdefault(m.group(1), {})
+                entry["failed"] = int(m.group(2))
+                entry["unconfirmed"] = int(m.group(3))
+            if "latency: done" in line or "latency: heat pump not connected" in line:
+                done = "done" in line
+                break
+            if time.time() > deadline:
+                break
+    finally:
+        if unit:
+            unit.stop.set()
+        proc.terminate()
+        proc.wait()
+
+    if unit is None:
+        print("firmware did not report the uart_1 pty; is boards/native_sim.overlay applied?",
+              file=sys.stderr)
+        return 1
+    if not done:
+        print("no complete latency report", file=sys.stderr)
+        return 1
+
+    print(f"{'handler':10} {'stage':8} {'n':>4} {'p50 ms':>9} {'p95 ms':>9} {'p99 ms':>9}")
+    for handler, stages in results.items():
+        for stage in ("wire", "ack", "confirm"):
+            s = stages.get(stage, {"n": 0})
+            if s["n"]:
+                print(f"{handler:10} {stage:8} {s['n']:4} {s['p50_us'] / 1000:9.1f} "
+                      f"{s['p95_us'] / 1000:9.1f} {s['p99_us'] / 1000:9.1f}")
+            else:
+                print(f"{handler:10} {stage:8} {0:4}")
+        if stages.get("failed") or stages.get("unconfirmed"):
+            print(f"{handler:10} failed={stages['failed']} unconfirmed={stages['unconfirmed']}")
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"format": 1, "baud": args.baud, "reply_delay_ms": args.reply_delay_ms,
+                       "results": results}, f, indent=2)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Matter write latency benchmark on native_sim")
+    parser.add_argument("--baud", type=int, default=2400,
+                        help="emulated line speed, 0 for no pacing (default 2400)")
+    parser.add_argument("--reply-delay-ms", type=float, default=20,
+                        help="emulated unit response time (default 20)")
+    parser.add_argument("--json", help="write the results as JSON")
+    parser.add_argument("--timeout", type=float, default=1800,
+                        help="give up after this many seconds (default 1800)")
+    parser.add_argument("--pty", action="store_true",
+                        help="only serve the emulator on a new pty")
+    parser.add_argument("-v", "--verbose", action="store_true", help="echo the firmware output")
+    parser.add_argument("exe", nargs="?", help="native_sim zephyr.exe")
+    parser.add_argument("exe_args", nargs=argparse.REMAINDER, help="arguments for zephyr.exe")
+    args = parser.parse_args()
+
+    if args.pty:
+        return serve_pty(args)
+    if not args.exe:
+        parser.error("zephyr.exe is required unless --pty is given")
+    return run_firmware(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Decode the dictionary-encoded log the firmware writes to RTT (see the
+# logging section of prj.conf), from a capture or live from the J-Link
+# RTT telnet port:
+#
+#   scripts/log_decode.py rtt.bin      # RTT channel 0, e.g. from JLinkRTTLogger
+#   scripts/log_decode.py --rtt localhost:19021
+#
+# The database is generated by the build (build/zephyr/log_dictionary.json)
+# and must come from the same build as the running firmware. The decoding
+# itself is Zephyr's dictionary parser, found through ZEPHYR_BASE.
+
+import argparse
+import logging
+import os
+import socket
+import sys
+
+
+def load_parser(zephyr_base, db_path):
+    sys.path.insert(0, os.path.join(zephyr_base, "scripts", "logging", "dictionary"))
+    try:
+        import dictionary_parser
+        from dictionary_parser.log_database import LogDatabase
+    except ImportError as e:
+        sys.exit(f"Zephyr dictionary parser not found under {zephyr_base}: {e}")
+
+    database = LogDatabase.read_json_database(db_path)
+    if database is None:
+        sys.exit(f"cannot read log database {db_path}")
+    return dictionary_parser.get_parser(database)
+
+
+def consumed(result, length):
+    """Bytes the parser used; older parsers return a bool for the whole buffer."""
+    if isinstance(result, bool):
+        return length if result else 0
+    return result
+
+
+def decode_file(parser, path, hex_input):
+    with open(path, "rb") as f:
+        data = f.read()
+    if hex_input:
+        data = bytes.fromhex(data.decode("ascii", "ignore").replace("\n", "").strip())
+    if consumed(parser.parse_log_data(data), len(data)) == 0 and data:
+        return 1
+    return 0
+
+
+def decode_rtt(parser, spec):
+    host, _, port = spec.rpartition(":")
+    sock = socket.create_connection((host or "localhost", int(port)))
+    pending = b""
+    try:
+        while True:
+            chunk = sock.recv(4096)
+            if not chunk:
+                break
+            pending += chunk
+            # a message cut by the end of a read stays for the next one
+            used = consumed(parser.parse_log_data(pending), len(pending))
+            pending = pending[used:]
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sock.close()
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the firmware's dictionary log")
+    parser.add_argument("capture", nargs="?", help="binary RTT capture")
+    parser.add_argument("--rtt", metavar="HOST:PORT", help="read live from an RTT telnet port")
+    parser.add_argument("--db", default="build/zephyr/log_dictionary.json",
+                        help="log database of the running build")
+    parser.add_argument("--hex", action="store_true", help="the capture is hex text")
+    parser.add_argument("--zephyr-base", default=os.environ.get("ZEPHYR_BASE", ""),
+                        help="Zephyr tree (default: $ZEPHYR_BASE)")
+    args = parser.parse_args()
+
+    if (args.capture is None) == (args.rtt is None):
+        parser.error("give a capture file or --rtt")
+    if not args.zephyr_base:
+        parser.error("set ZEPHYR_BASE or pass --zephyr-base")
+
+    # the Zephyr parser prints decoded messages through logging
+    logging.basicConfig(format="%(message)s", level=logging.INFO)
+    log_parser = load_parser(args.zephyr_base, args.db)
+
+    if args.rtt:
+        return decode_rtt(log_parser, args.rtt)
+    return decode_file(log_parser, args.capture, args.hex)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
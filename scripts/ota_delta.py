@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Build compressed and delta OTA images for the firmware, and serve them
+# to host/hp_ota as a local OTA provider:
+#
+#   scripts/ota_delta.py make --base old.signed.bin new.signed.bin update.hpod
+#   scripts/ota_delta.py serve update.hpod --rate 8000
+#   ./build-host/hp_ota --provider localhost:5541 --base old.signed.bin --out new.bin
+#
+# Without --base the image is the new firmware, compressed. The format is
+# described in src/ota_delta.h. Wrap the result in a Matter OTA file with
+# the SDK's src/app/ota_image_tool.py before publishing it.
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = b"HPOD"
+VERSION = 1
+FLAG_COMPRESSED = 0x01
+FLAG_DELTA = 0x02
+
+OP_END, OP_COPY, OP_DIFF, OP_DATA = 0, 1, 2, 3
+
+KEY = 8             # bytes hashed to find a match in the base
+MIN_MATCH = 24      # shortest match worth a COPY elsewhere in the base
+ALIGNED_COPY = 64   # shorter unchanged runs stay inside a DIFF
+
+WINDOW = 4096
+MAX_MATCH = 3 + 15 + 255
+
+
+def varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return out
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def match_len(a, i, b, j, limit=None):
+    """Length of the common prefix of a[i:] and b[j:]."""
+    n = min(len(a) - i, len(b) - j)
+    if limit is not None:
+        n = min(n, limit)
+    length = 0
+    for step in (256, 16, 1):
+        while length + step <= n and a[i + length:i + length + step] == b[j + length:j + length + step]:
+            length += step
+    return length
+
+
+def diff_ops(base, target):
+    """Operation list turning base into target, see src/ota_delta.h."""
+    index = {}
+    for i in range(len(base) - KEY, -1, -1):
+        index[base[i:i + KEY]] = i  # lowest offset wins
+
+    ops = bytearray()
+    bp = 0      # base position of the decoder
+    ps = 0      # start of the bytes not emitted yet
+    t = 0
+
+    def flush(end):
+        nonlocal bp
+        pending = target[ps:end]
+        if not pending:
+            return
+        aligned = base[bp:bp + len(pending)]
+        same = sum(1 for x, y in zip(pending, aligned) if x == y) if len(aligned) == len(pending) else 0
+        if same * 2 >= len(pending):
+            ops.append(OP_DIFF)
+            ops.extend(varint(0) + varint(len(pending)))
+            ops.extend((x - y) & 0xFF for x, y in zip(pending, aligned))
+            bp += len(pending)
+        else:
+            ops.append(OP_DATA)
+            ops.extend(varint(len(pending)))
+            ops.extend(pending)
+
+    def copy(at, length):
+        nonlocal bp
+        ops.append(OP_COPY)
+        ops.extend(varint(zigzag(at - bp)) + varint(length))
+        bp = at + length
+
+    while t < len(target):
+        ap = bp + (t - ps)
+        run = match_len(base, ap, target, t) if ap < len(base) else 0
+        if run >= ALIGNED_COPY:
+            flush(t)
+            copy(ap, run)
+            t += run
+            ps = t
+            continue
+        if run > 0:
+            t += run
+            continue
+        at = index.get(target[t:t + KEY], -1)
+        if at >= 0:
+            length = match_len(base, at, target, t)
+            if length >= MIN_MATCH:
+                flush(t)
+                copy(at, length)
+                t += length
+                ps = t
+                continue
+        t += 1
+
+    flush(len(target))
+    ops.append(OP_END)
+    return bytes(ops)
+
+
+def lzss(data):
+    """LZSS with a 4 KB window, see src/ota_delta.cpp."""
+    out = bytearray()
+    chains = {}
+    flags_at = 0
+    bit = 8
+    i = 0
+    n = len(data)
+
+    while i < n:
+        if bit == 8:
+            flags_at = len(out)
+            out.append(0)
+            bit = 0
+
+        best, best_dist = 0, 0
+        key = data[i:i + 3]
+        chain = chains.get(key) if len(key) == 3 else None
+        if chain:
+            for p in reversed(chain):
+                dist = i - p
+                if dist > WINDOW:
+                    break
+                length = match_len(data, p, data, i, MAX_MATCH)
+                if length > best:
+                    best, best_dist = length, dist
+                    if length == MAX_MATCH:
+                        break
+
+        step = 1
+        if best >= 3:
+            d = best_dist - 1
+            extra = best - 3
+            if extra >= 15:
+                out += bytes([d & 0xFF, ((d >> 8) << 4) | 15, extra - 15])
+            else:
+                out += bytes([d & 0xFF, ((d >> 8) << 4) | extra])
+            step = best
+        else:
+            out[flags_at] |= 1 << bit
+            out.append(data[i])
+        bit += 1
+
+        for k in range(i, min(i + step, n - 2)):
+            c = chains.setdefault(data[k:k + 3], [])
+            c.append(k)
+            if len(c) > 32:
+                del c[:16]
+        i += step
+
+    return bytes(out)
+
+
+def make(args):
+    with open(args.target, "rb") as f:
+        target = f.read()
+    flags = 0
+    base = b""
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+        payload = diff_ops(base, target)
+        flags |= FLAG_DELTA
+    else:
+        payload = target
+    if not args.no_compress:
+        compressed = lzss(payload)
+        if len(compressed) < len(payload):
+            payload = compressed
+            flags |= FLAG_COMPRESSED
+
+    header = MAGIC + struct.pack("<BBHIIII", VERSION, flags, 0, len(base), zlib.crc32(base),
+                                 len(target), zlib.crc32(target))
+    with open(args.output, "wb") as f:
+        f.write(header + payload)
+
+    size = len(header) + len(payload)
+    print(f"{args.output}: {size} bytes for a {len(target)} byte image "
+          f"({'delta' if flags & FLAG_DELTA else 'full'}"
+          f"{', compressed' if flags & FLAG_COMPRESSED else ''}), "
+          f"saves {len(target) - size} bytes ({(len(target) - size) * 100 / len(target):.1f}%)")
+    return 0
+
+
+def serve(args):
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind(("", args.port))
+    srv.listen(1)
+    print(f"serving {args.image} ({len(image)} bytes) on port {args.port}", flush=True)
+
+    while True:
+        conn, peer = srv.accept()
+        start = time.time()
+        sent = 0
+        with conn:
+            # receiver-driven like BDX: each query is offset and maximum
+            # length, each answer a length and the block, empty at the end
+            while True:
+                query = conn.recv(8, socket.MSG_WAITALL)
+                if len(query) < 8:
+                    break
+                offset, length = struct.unpack("<II", query)
+                block = image[offset:offset + length]
+                if args.rate:
+                    time.sleep(len(block) / args.rate)
+                conn.sendall(struct.pack("<I", len(block)) + block)
+                sent += len(block)
+        print(f"{peer[0]}: {sent} bytes in {time.time() - start:.1f} s", flush=True)
+        if args.once:
+            return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Delta OTA image builder and local provider")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("make", help="build an image")
+    p.add_argument("--base", help="firmware the devices run now, for a delta image")
+    p.add_argument("--no-compress", action="store_true", help="leave the payload uncompressed")
+    p.add_argument("target", help="new firmware")
+    p.add_argument("output", help="image to write")
+    p.set_defaults(func=make)
+
+    p = sub.add_parser("serve", help="serve an image to host/hp_ota")
+    p.add_argument("image")
+    p.add_argument("--port", type=int, default=5541)
+    p.add_argument("--rate", type=float, default=0,
+                   help="pace the transfer at this many bytes/s, e.g. 8000 for a Thread hop")
+    p.add_argument("--once", action="store_true", help="exit after one transfer")
+    p.set_defaults(func=serve)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -4,12 +4,26 @@
  * 
  * Handles Matter cluster attribute operations and converts
  * between Matter data formats and heat pump formats.
+ *
+ * Attributes backed by the heat pump are not kept in Matter attribute
+ * storage: matter_attribute_read() converts them from a driver snapshot
+ * on every read and matter_attribute_write() hands writes to the driver
+ * command queue, like a Matter AttributeAccessInterface.
  */
 
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include "attribute_handlers.h"
 #include "matter_config.h"
+#include "matter_conversions.h"
 #include "heatpump_driver.h"
+#ifdef CONFIG_APP_HISTORY
+#include "history.h"
+#endif
+#ifdef CONFIG_APP_SCHEDULE
+#include "schedule.h"
+#endif
 
 LOG_MODULE_REGISTER(attribute_handlers, CONFIG_LOG_DEFAULT_LEVEL);
 
@@ -20,36 +34,15 @@ LOG_MODULE_REGISTER(attribute_handlers, CONFIG_LOG_DEFAULT_LEVEL);
  */
 int handle_thermostat_mode_write(uint8_t mode)
 {
-    const char *hp_mode = NULL;
-    
+    if (mode == MATTER_THERMOSTAT_MODE_OFF) {
+        return heatpump_set_power("OFF");
+    }
+
     /* Convert Matter mode to heat pump mode */
-    switch (mode) {
-        case MATTER_THERMOSTAT_MODE_OFF:
-            return heatpump_set_power("OFF");
-        
-        case MATTER_THERMOSTAT_MODE_HEAT:
-            hp_mode = "HEAT";
-            break;
-        
-        case MATTER_THERMOSTAT_MODE_COOL:
-            hp_mode = "COOL";
-            break;
-        
-        case MATTER_THERMOSTAT_MODE_AUTO:
-            hp_mode = "AUTO";
-            break;
-        
-        case MATTER_THERMOSTAT_MODE_DRY:
-            hp_mode = "DRY";
-            break;
-        
-        case MATTER_THERMOSTAT_MODE_FAN_ONLY:
-            hp_mode = "FAN";
-            break;
-        
-        default:
-            LOG_ERR("Unsupported thermostat mode: %d", mode);
-            return -EINVAL;
+    const char *hp_mode = matter_mode_to_hp(mode);
+    if (hp_mode == NULL) {
+        LOG_ERR("Unsupported thermostat mode: %d", mode);
+        return -EINVAL;
     }
     
     /* Ensure power is on */
@@ -62,19 +55,20 @@ int handle_thermostat_mode_write(uint8_t mode)
 /**
  * @brief Handle temperature setpoint attribute write
  * 
- * Converts Matter temperature (0.01°C units) to Celsius
+ * Matter and the driver both use 0.01°C; the setpoint is rounded to
+ * the unit's 0.5°C steps
  */
 int handle_temperature_setpoint_write(int16_t matter_temp)
 {
-    float celsius = MATTER_TEMP_TO_CELSIUS(matter_temp);
+    hp_temp_t temp;
     
     /* Validate temperature range */
-    if (celsius < HP_TEMP_MIN || celsius > HP_TEMP_MAX) {
-        LOG_ERR("Temperature out of range: %.1f°C", static_cast<double>(celsius));
+    if (matter_setpoint_to_hp(matter_temp, &temp) != 0) {
+        LOG_ERR("Temperature out of range: %d (0.01°C)", matter_temp);
         return -EINVAL;
     }
     
-    return heatpump_set_temperature(celsius);
+    return heatpump_set_temperature(temp);
 }
 
 /**
@@ -84,33 +78,11 @@ int handle_temperature_setpoint_write(int16_t matter_temp)
  */
 int handle_fan_mode_write(uint8_t mode)
 {
-    const char *hp_fan = NULL;
-    
     /* Convert Matter fan mode to heat pump fan */
-    switch (mode) {
-        case MATTER_FAN_MODE_OFF:
-            hp_fan = "QUIET";  /* Map OFF to QUIET */
-            break;
-        
-        case MATTER_FAN_MODE_LOW:
-            hp_fan = "1";
-            break;
-        
-        case MATTER_FAN_MODE_MEDIUM:
-            hp_fan = "2";
-            break;
-        
-        case MATTER_FAN_MODE_HIGH:
-            hp_fan = "4";
-            break;
-        
-        case MATTER_FAN_MODE_AUTO:
-            hp_fan = "AUTO";
-            break;
-        
-        default:
-            LOG_ERR("Unsupported fan mode: %d", mode);
-            return -EINVAL;
+    const char *hp_fan = matter_fan_to_hp(mode);
+    if (hp_fan == NULL) {
+        LOG_ERR("Unsupported fan mode: %d", mode);
+        return -EINVAL;
     }
     
     return heatpump_set_fan(hp_fan);
@@ -129,26 +101,36 @@ int handle_local_temperature_read(int16_t *matter_temp)
         return -EIO;
     }
     
-    *matter_temp = CELSIUS_TO_MATTER_TEMP(status.roomTemperature);
+    *matter_temp = status.roomTemperature;
     return 0;
 }
 
 /**
  * @brief Read thermostat running state attribute
  * 
- * Returns whether heat pump is actively heating/cooling
+ * Reports heating, cooling or fan according to the mode while the
+ * compressor runs
  */
 int handle_running_state_read(uint16_t *state)
 {
-    heatpump_status_t status;
+    heatpump_snapshot_t snap;
     
-    if (heatpump_get_status(&status) != 0) {
+    if (heatpump_get_snapshot(&snap) != 0) {
         return -EIO;
     }
     
-    /* TODO: Map heat pump operating state to Matter running state bits */
-    *state = status.operating ? 0x0001 : 0x0000;
-    
+    *state = matter_running_state(&snap.settings, &snap.status);
+    return 0;
+}
+
+/**
+ * @brief Read heat pump status link health attribute
+ * 
+ * Reports whether the CN105 link is healthy, degraded or down
+ */
+int handle_link_health_read(uint8_t *health)
+{
+    *health = (uint8_t)heatpump_get_link_health();
     return 0;
 }
 
@@ -159,20 +141,11 @@ int handle_running_state_read(uint16_t *state)
  */
 int handle_vane_position_write(uint8_t position)
 {
-    const char *vane = NULL;
-    
     /* Map position to vane string */
-    switch (position) {
-        case 0: vane = "AUTO"; break;
-        case 1: vane = "1"; break;
-        case 2: vane = "2"; break;
-        case 3: vane = "3"; break;
-        case 4: vane = "4"; break;
-        case 5: vane = "5"; break;
-        case 6: vane = "SWING"; break;
-        default:
-            LOG_ERR("Invalid vane position: %d", position);
-            return -EINVAL;
+    const char *vane = matter_vane_to_hp(position);
+    if (vane == NULL) {
+        LOG_ERR("Invalid vane position: %d", position);
+        return -EINVAL;
     }
     
     return heatpump_set_vane(vane);
@@ -185,21 +158,424 @@ int handle_vane_position_write(uint8_t position)
  */
 int handle_wide_vane_position_write(uint8_t position)
 {
-    const char *wide_vane = NULL;
-    
     /* Map position to wide vane string */
-    switch (position) {
-        case 0: wide_vane = "<<"; break;
-        case 1: wide_vane = "<"; break;
-        case 2: wide_vane = "|"; break;
-        case 3: wide_vane = ">"; break;
-        case 4: wide_vane = ">>"; break;
-        case 5: wide_vane = "<>"; break;
-        case 6: wide_vane = "SWING"; break;
-        default:
-            LOG_ERR("Invalid wide vane position: %d", position);
-            return -EINVAL;
+    const char *wide_vane = matter_wide_vane_to_hp(position);
+    if (wide_vane == NULL) {
+        LOG_ERR("Invalid wide vane position: %d", position);
+        return -EINVAL;
     }
     
     return heatpump_set_wide_vane(wide_vane);
 }
+
+/*
+ * Snapshot-backed attributes. Each read converts one field of a driver
+ * snapshot; each write goes through the handlers above.
+ */
+
+static int read_on_off(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->settings.power != NULL && strcmp(snap->settings.power, "ON") == 0;
+    return 0;
+}
+
+static int read_room_temperature(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->status.roomTemperature;
+    return 0;
+}
+
+static int read_setpoint(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->settings.temperature;
+    return 0;
+}
+
+static int read_system_mode(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    int32_t on_off;
+
+    (void)read_on_off(snap, &on_off);
+    if (!on_off) {
+        *value = MATTER_THERMOSTAT_MODE_OFF;
+        return 0;
+    }
+    int mode = matter_mode_from_hp(snap->settings.mode);
+    if (mode < 0) {
+        return -ENODATA;
+    }
+    *value = mode;
+    return 0;
+}
+
+static int read_running_state(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = matter_running_state(&snap->settings, &snap->status);
+    return 0;
+}
+
+#ifdef CONFIG_APP_SCHEDULE
+static int read_schedule_transitions(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    ARG_UNUSED(snap);
+    *value = CONFIG_APP_SCHEDULE_MAX_TRANSITIONS;
+    return 0;
+}
+#endif
+
+static int read_fan_mode(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    int mode = matter_fan_from_hp(snap->settings.fan);
+    if (mode < 0) {
+        return -ENODATA;
+    }
+    *value = mode;
+    return 0;
+}
+
+static int read_fan_mode_sequence(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    ARG_UNUSED(snap);
+    *value = MATTER_FAN_MODE_SEQUENCE_OFF_LOW_MED_HIGH_AUTO;
+    return 0;
+}
+
+static int read_vane_position(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    int position = matter_vane_from_hp(snap->settings.vane);
+    if (position < 0) {
+        return -ENODATA;
+    }
+    *value = position;
+    return 0;
+}
+
+static int read_wide_vane_position(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    int position = matter_wide_vane_from_hp(snap->settings.wideVane);
+    if (position < 0) {
+        return -ENODATA;
+    }
+    *value = position;
+    return 0;
+}
+
+static int read_compressor_frequency(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->status.compressorFrequency;
+    return 0;
+}
+
+static int read_operating(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->status.operating;
+    return 0;
+}
+
+static int read_link_health(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->link_health;
+    return 0;
+}
+
+static int read_isee(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->settings.iSee;
+    return 0;
+}
+
+static int read_timer_mode(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    int mode = matter_timer_mode_from_hp(snap->timers.mode);
+    if (mode < 0) {
+        return -ENODATA;
+    }
+    *value = mode;
+    return 0;
+}
+
+static int read_on_timer_remaining(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->timers.onMinutesRemaining;
+    return 0;
+}
+
+static int read_off_timer_remaining(const heatpump_snapshot_t *snap, int32_t *value)
+{
+    *value = snap->timers.offMinutesRemaining;
+    return 0;
+}
+
+static int write_on_off(int32_t value)
+{
+    return heatpump_set_power(value ? "ON" : "OFF");
+}
+
+static int write_setpoint(int32_t value)
+{
+    if (value < INT16_MIN || value > INT16_MAX) {
+        return -EINVAL;
+    }
+    return handle_temperature_setpoint_write((int16_t)value);
+}
+
+static int write_system_mode(int32_t value)
+{
+    if (value < 0 || value > UINT8_MAX) {
+        return -EINVAL;
+    }
+    return handle_thermostat_mode_write((uint8_t)value);
+}
+
+static int write_fan_mode(int32_t value)
+{
+    if (value < 0 || value > UINT8_MAX) {
+        return -EINVAL;
+    }
+    return handle_fan_mode_write((uint8_t)value);
+}
+
+static int write_vane_position(int32_t value)
+{
+    if (value < 0 || value > UINT8_MAX) {
+        return -EINVAL;
+    }
+    return handle_vane_position_write((uint8_t)value);
+}
+
+static int write_wide_vane_position(int32_t value)
+{
+    if (value < 0 || value > UINT8_MAX) {
+        return -EINVAL;
+    }
+    return handle_wide_vane_position_write((uint8_t)value);
+}
+
+/**
+ * @brief Attribute served from the driver snapshot
+ */
+struct attribute_entry {
+    uint32_t cluster;
+    uint16_t attribute;
+    int (*read)(const heatpump_snapshot_t *snap, int32_t *value);
+    int (*write)(int32_t value);  /* NULL for read-only attributes */
+};
+
+static const struct attribute_entry attributes[] = {
+    { MATTER_CLUSTER_ON_OFF, MATTER_ATTR_ON_OFF, read_on_off, write_on_off },
+    { MATTER_CLUSTER_THERMOSTAT, MATTER_ATTR_LOCAL_TEMPERATURE, read_room_temperature, NULL },
+    { MATTER_CLUSTER_THERMOSTAT, MATTER_ATTR_OCCUPIED_COOLING_SETPOINT, read_setpoint,
+      write_setpoint },
+    { MATTER_CLUSTER_THERMOSTAT, MATTER_ATTR_OCCUPIED_HEATING_SETPOINT, read_setpoint,
+      write_setpoint },
+    { MATTER_CLUSTER_THERMOSTAT, MATTER_ATTR_SYSTEM_MODE, read_system_mode, write_system_mode },
+    { MATTER_CLUSTER_THERMOSTAT, MATTER_ATTR_THERMOSTAT_RUNNING_STATE, read_running_state, NULL },
+#ifdef CONFIG_APP_SCHEDULE
+    { MATTER_CLUSTER_THERMOSTAT, MATTER_ATTR_NUM_WEEKLY_TRANSITIONS, read_schedule_transitions,
+      NULL },
+    { MATTER_CLUSTER_THERMOSTAT, MATTER_ATTR_NUM_DAILY_TRANSITIONS, read_schedule_transitions,
+      NULL },
+#endif
+    { MATTER_CLUSTER_FAN_CONTROL, MATTER_ATTR_FAN_MODE, read_fan_mode, write_fan_mode },
+    { MATTER_CLUSTER_FAN_CONTROL, MATTER_ATTR_FAN_MODE_SEQUENCE, read_fan_mode_sequence, NULL },
+    { MATTER_CLUSTER_TEMP_MEASUREMENT, MATTER_ATTR_MEASURED_VALUE, read_room_temperature, NULL },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_VANE_POSITION, read_vane_position,
+      write_vane_position },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_WIDE_VANE_POSITION, read_wide_vane_position,
+      write_wide_vane_position },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_COMPRESSOR_FREQUENCY, read_compressor_frequency,
+      NULL },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_OPERATING, read_operating, NULL },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_ISEE_ENABLED, read_isee, NULL },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_LINK_HEALTH, read_link_health, NULL },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_TIMER_MODE, read_timer_mode, NULL },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_ON_TIMER_REMAINING, read_on_timer_remaining,
+      NULL },
+    { MATTER_CLUSTER_HP_EXTENSION, MATTER_ATTR_HP_OFF_TIMER_REMAINING, read_off_timer_remaining,
+      NULL },
+};
+
+static const struct attribute_entry *attribute_find(uint32_t cluster, uint32_t attribute)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(attributes); i++) {
+        if (attributes[i].cluster == cluster && attributes[i].attribute == attribute) {
+            return &attributes[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Read an attribute served from the driver snapshot
+ */
+int matter_attribute_read(uint32_t cluster, uint32_t attribute, int32_t *value)
+{
+    const struct attribute_entry *entry = attribute_find(cluster, attribute);
+    heatpump_snapshot_t snap;
+
+    if (entry == NULL) {
+        return -ENOENT;
+    }
+    if (heatpump_get_snapshot(&snap) != 0) {
+        return -EIO;
+    }
+    return entry->read(&snap, value);
+}
+
+/**
+ * @brief Write an attribute served from the driver snapshot
+ */
+int matter_attribute_write(uint32_t cluster, uint32_t attribute, int32_t value)
+{
+    const struct attribute_entry *entry = attribute_find(cluster, attribute);
+
+    if (entry == NULL) {
+        return -ENOENT;
+    }
+    if (entry->write == NULL) {
+        return -EACCES;
+    }
+    return entry->write(value);
+}
+
+/**
+ * @brief Check whether an attribute is served from the driver snapshot
+ */
+bool matter_attribute_is_served(uint32_t cluster, uint32_t attribute)
+{
+    return attribute_find(cluster, attribute) != NULL;
+}
+
+/**
+ * @brief Read the extension cluster FullState attribute
+ *
+ * Encodes one snapshot, so a controller gets every extension value in
+ * a single read or subscription report.
+ */
+int handle_full_state_read(uint8_t *buf, size_t size, size_t *len)
+{
+    heatpump_snapshot_t snap;
+
+    if (size < MATTER_HP_FULL_STATE_LEN) {
+        return -ENOSPC;
+    }
+    if (heatpump_get_snapshot(&snap) != 0) {
+        return -EIO;
+    }
+
+    matter_encode_full_state(&snap.settings, &snap.status, &snap.timers,
+                             (uint8_t)snap.link_health, buf);
+    *len = MATTER_HP_FULL_STATE_LEN;
+    return 0;
+}
+
+#ifdef CONFIG_APP_HISTORY
+/**
+ * @brief Handle the heat pump extension ReadHistory command
+ * 
+ * Fills the response with encoded history blocks of the requested
+ * tier, starting at since_s (device uptime in seconds). The response
+ * header carries the current uptime so the controller can map sample
+ * times to wall-clock time.
+ */
+int handle_read_history_command(uint8_t tier, uint32_t since_s,
+                                uint8_t *response, size_t response_size,
+                                size_t *response_len)
+{
+    if (tier >= HISTORY_TIER_COUNT) {
+        LOG_ERR("Invalid history tier: %d", tier);
+        return -EINVAL;
+    }
+
+    int ret = history_export((history_tier_e)tier, since_s, response, response_size);
+    if (ret < 0) {
+        return ret;
+    }
+
+    *response_len = (size_t)ret;
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_SCHEDULE
+/**
+ * @brief Handle the thermostat SetWeeklySchedule command
+ *
+ * Matter weekly schedule transitions carry no system mode, so the
+ * stored transitions keep the mode the unit is in.
+ */
+int handle_set_weekly_schedule_command(uint8_t days, uint8_t mode,
+                                       const schedule_transition_t *transitions,
+                                       size_t count)
+{
+    static schedule_transition_t steps[CONFIG_APP_SCHEDULE_MAX_TRANSITIONS];
+
+    if ((days & ~SCHEDULE_DAY_ALL) != 0) {
+        LOG_ERR("Away schedules are not supported");
+        return -EINVAL;
+    }
+    if (count > ARRAY_SIZE(steps)) {
+        return -ENOSPC;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        steps[i] = {};
+        steps[i].transition_time = transitions[i].transition_time;
+        steps[i].heating_setpoint = (mode & MATTER_SCHEDULE_MODE_HEAT_SETPOINT)
+                                        ? transitions[i].heating_setpoint
+                                        : SCHEDULE_SETPOINT_NONE;
+        steps[i].cooling_setpoint = (mode & MATTER_SCHEDULE_MODE_COOL_SETPOINT)
+                                        ? transitions[i].cooling_setpoint
+                                        : SCHEDULE_SETPOINT_NONE;
+        steps[i].system_mode = SCHEDULE_MODE_KEEP;
+        steps[i].preset = SCHEDULE_PRESET_NONE;
+    }
+
+    return schedule_set_days(days, steps, count);
+}
+
+/**
+ * @brief Handle the thermostat GetWeeklySchedule command
+ */
+int handle_get_weekly_schedule_command(uint8_t days, uint8_t mode,
+                                       schedule_transition_t *transitions,
+                                       size_t max, size_t *count)
+{
+    int n = schedule_get_days(days, transitions, max);
+    if (n < 0) {
+        return n;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!(mode & MATTER_SCHEDULE_MODE_HEAT_SETPOINT)) {
+            transitions[i].heating_setpoint = SCHEDULE_SETPOINT_NONE;
+        }
+        if (!(mode & MATTER_SCHEDULE_MODE_COOL_SETPOINT)) {
+            transitions[i].cooling_setpoint = SCHEDULE_SETPOINT_NONE;
+        }
+    }
+    *count = (size_t)n;
+    return 0;
+}
+
+/**
+ * @brief Handle the thermostat ClearWeeklySchedule command
+ */
+int handle_clear_weekly_schedule_command(void)
+{
+    return schedule_clear();
+}
+
+/**
+ * @brief Handle a Time Synchronization update
+ *
+ * The schedule runs on local time, so the UTC time is shifted by the
+ * time zone and DST offsets in effect.
+ */
+void handle_time_sync_update(uint64_t utc_us, int32_t time_zone_s, int32_t dst_s)
+{
+    int64_t local_s = (int64_t)(utc_us / 1000000U) + MATTER_EPOCH_UNIX_S + time_zone_s + dst_s;
+
+    schedule_set_local_time(local_s);
+}
+#endif
@@ -0,0 +1,204 @@
+/**
+ * @file attribute_handlers.h
+ * @brief Matter attribute read/write handlers
+ *
+ * Entry points called by the Matter attribute glue. Writes block until
+ * the CN105 SET exchange has completed (or failed).
+ */
+
+#ifndef ATTRIBUTE_HANDLERS_H
+#define ATTRIBUTE_HANDLERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#ifdef CONFIG_APP_SCHEDULE
+#include "schedule.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Read an attribute served from the driver snapshot
+ *
+ * AttributeAccessInterface-style entry point: the Matter glue registers
+ * it for the On/Off, Thermostat, Fan Control, Temperature Measurement
+ * and heat pump extension clusters on the thermostat endpoint, so these attributes
+ * have no copy in Matter attribute storage. The value is converted from
+ * heatpump_get_snapshot() at the time of the read.
+ *
+ * @param cluster MATTER_CLUSTER_* ID
+ * @param attribute Attribute ID within the cluster
+ * @param value Attribute value in the Matter representation of its type
+ * @return 0 on success, -ENOENT if the attribute is not served here (the
+ *         glue falls back to attribute storage), -ENODATA if the unit
+ *         reported a value with no Matter equivalent
+ */
+int matter_attribute_read(uint32_t cluster, uint32_t attribute, int32_t *value);
+
+/**
+ * @brief Write an attribute served from the driver snapshot
+ *
+ * Blocks until the driver has completed the SET exchange, like the
+ * individual write handlers below.
+ *
+ * @param cluster MATTER_CLUSTER_* ID
+ * @param attribute Attribute ID within the cluster
+ * @param value New value in the Matter representation of its type
+ * @return 0 on success, -ENOENT if the attribute is not served here,
+ *         -EACCES if it is read-only, -EINVAL if out of range,
+ *         negative errno on failure
+ */
+int matter_attribute_write(uint32_t cluster, uint32_t attribute, int32_t value);
+
+/**
+ * @brief Check whether an attribute is served from the driver snapshot
+ *
+ * @return true if matter_attribute_read() handles it
+ */
+bool matter_attribute_is_served(uint32_t cluster, uint32_t attribute);
+
+/**
+ * @brief Thermostat SystemMode write
+ *
+ * @param mode MATTER_THERMOSTAT_MODE_* value
+ * @return 0 on success, negative errno on failure
+ */
+int handle_thermostat_mode_write(uint8_t mode);
+
+/**
+ * @brief Thermostat setpoint write
+ *
+ * @param matter_temp Setpoint in 0.01°C
+ * @return 0 on success, -EINVAL if out of range, negative errno on failure
+ */
+int handle_temperature_setpoint_write(int16_t matter_temp);
+
+/**
+ * @brief Fan Control FanMode write
+ *
+ * @param mode MATTER_FAN_MODE_* value
+ * @return 0 on success, negative errno on failure
+ */
+int handle_fan_mode_write(uint8_t mode);
+
+/**
+ * @brief Thermostat LocalTemperature read
+ *
+ * @param matter_temp Room temperature in 0.01°C
+ * @return 0 on success, -EIO if the driver has no status
+ */
+int handle_local_temperature_read(int16_t *matter_temp);
+
+/**
+ * @brief Thermostat ThermostatRunningState read
+ *
+ * @param state Running state bitmap
+ * @return 0 on success, -EIO if the driver has no status
+ */
+int handle_running_state_read(uint16_t *state);
+
+/**
+ * @brief Heat pump extension FullState read
+ *
+ * Octet string of MATTER_HP_FULL_STATE_LEN bytes, see MATTER_CLUSTERS.md.
+ *
+ * @param buf Output buffer
+ * @param size Size of @a buf
+ * @param len Bytes written to @a buf
+ * @return 0 on success, -ENOSPC if @a buf is too small, -EIO if the
+ *         driver has no state
+ */
+int handle_full_state_read(uint8_t *buf, size_t size, size_t *len);
+
+/**
+ * @brief Heat pump extension LinkHealth read
+ *
+ * @param health HP_LINK_HEALTHY, HP_LINK_DEGRADED or HP_LINK_DOWN
+ * @return 0
+ */
+int handle_link_health_read(uint8_t *health);
+
+/**
+ * @brief Vane control position write (0 auto, 1-5, 6 swing)
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int handle_vane_position_write(uint8_t position);
+
+/**
+ * @brief Wide vane control position write (0-4 left to right, 5 split, 6 swing)
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int handle_wide_vane_position_write(uint8_t position);
+
+#ifdef CONFIG_APP_HISTORY
+/**
+ * @brief Heat pump extension ReadHistory command
+ *
+ * @param tier History tier (history_tier_e)
+ * @param since_s Oldest sample wanted, device uptime in seconds
+ * @param response Response buffer
+ * @param response_size Size of @a response
+ * @param response_len Bytes written to @a response
+ * @return 0 on success, negative errno on failure
+ */
+int handle_read_history_command(uint8_t tier, uint32_t since_s,
+                                uint8_t *response, size_t response_size,
+                                size_t *response_len);
+#endif
+
+#ifdef CONFIG_APP_SCHEDULE
+/**
+ * @brief Thermostat SetWeeklySchedule command
+ *
+ * @param days Matter DayOfWeekForSequence bitmap (Away is not supported)
+ * @param mode MATTER_SCHEDULE_MODE_* bits; setpoints not flagged are ignored
+ * @param transitions Transitions; only the time and setpoints are used
+ * @param count Number of @a transitions
+ * @return 0 on success, -EINVAL for invalid fields, -ENOSPC if the
+ *         schedule is full, negative errno on other failures
+ */
+int handle_set_weekly_schedule_command(uint8_t days, uint8_t mode,
+                                       const schedule_transition_t *transitions,
+                                       size_t count);
+
+/**
+ * @brief Thermostat GetWeeklySchedule command
+ *
+ * @param days Matter DaysToReturn bitmap
+ * @param mode MATTER_SCHEDULE_MODE_* bits to return; others are cleared
+ * @param transitions Response buffer
+ * @param max Size of @a transitions
+ * @param count Transitions written to @a transitions
+ * @return 0 on success, negative errno on failure
+ */
+int handle_get_weekly_schedule_command(uint8_t days, uint8_t mode,
+                                       schedule_transition_t *transitions,
+                                       size_t max, size_t *count);
+
+/**
+ * @brief Thermostat ClearWeeklySchedule command
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int handle_clear_weekly_schedule_command(void);
+
+/**
+ * @brief Time Synchronization update
+ *
+ * @param utc_us UTCTime, microseconds since the Matter epoch
+ * @param time_zone_s Offset of the current TimeZone entry in seconds
+ * @param dst_s Offset of the current DSTOffset entry in seconds
+ */
+void handle_time_sync_update(uint64_t utc_us, int32_t time_zone_s, int32_t dst_s);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATTRIBUTE_HANDLERS_H */
@@ -16,17 +16,89 @@
 #include <zephyr/devicetree.h>
 #include "../lib/HeatPump/heat_pump.h"
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/barrier.h>
+#include "log_ratelimit.h"
+#include <string.h>
+#ifdef CONFIG_APP_HEATPUMP_PERSIST
+#include "state_persist.h"
+#endif
+#ifdef CONFIG_APP_SCHEDULE
+#include "schedule.h"
+#endif
+#ifdef CONFIG_APP_ICD
+#include "icd.h"
+#endif
+#ifdef CONFIG_APP_LATENCY_BENCH
+#include "latency_bench.h"
+#endif
+#ifdef CONFIG_APP_LINK_WATCHDOG
+#include "link_watchdog.h"
+#endif
 
 LOG_MODULE_REGISTER(heatpump_driver, CONFIG_LOG_DEFAULT_LEVEL);
 
 /* Thread configuration */
-#define HEATPUMP_THREAD_STACK_SIZE 2048
+#define HEATPUMP_THREAD_STACK_SIZE CONFIG_APP_HEATPUMP_THREAD_STACK_SIZE
 #define HEATPUMP_THREAD_PRIORITY   5
 #define HEATPUMP_UPDATE_INTERVAL_MS 100  /* Poll heat pump every 100ms */
+#define HEATPUMP_CONNECT_RETRY_MS  5000  /* Pause between failed handshakes */
+#define HEATPUMP_CONNECT_TIMEOUT_MS 15000 /* heatpump_connect() wait limit */
+
+/* Command queue configuration */
+#define HEATPUMP_COMMAND_QUEUE_DEPTH 8
+
+/* Driver trace points, next to the library's (heat_pump_trace.h):
+ * hp_submit spans posting a command from the caller's thread until it
+ * is queued, or done when the caller waits; hp_cmd its execution on the
+ * driver thread (arg0 the command type, end arg0 the result), and
+ * hp_callback an application callback (arg0 an hp_trace_callback) */
+#define HP_TRACE_SUBMIT   "hp_submit"
+#define HP_TRACE_CMD      "hp_cmd"
+#define HP_TRACE_CALLBACK "hp_callback"
+
+enum hp_trace_callback {
+    HP_TRACE_CB_STATE,
+    HP_TRACE_CB_SETTINGS,
+    HP_TRACE_CB_STATUS,
+};
+
+/**
+ * @brief Command types handled by the driver thread
+ */
+enum hp_command_type {
+    HP_CMD_SETTINGS,     /* Apply settings fields and send one SET frame */
+    HP_CMD_REMOTE_TEMP,  /* Queue a remote temperature frame */
+    HP_CMD_SYNC,         /* Poll now */
+    HP_CMD_FUNCTION_GET, /* Read one function code (cached) */
+    HP_CMD_FUNCTION_SET, /* Change one function code */
+    HP_CMD_FUNCTIONS_REFRESH, /* Re-read all function codes from the unit */
+    HP_CMD_RESET_STATS   /* Clear the link counters */
+};
+
+/**
+ * @brief Command queued for the driver thread
+ *
+ * The driver thread is the only user of the CN105 UART. Callers post
+ * commands and, when they need the outcome, block on @a done until the
+ * thread has executed the command and stored it in @a result.
+ */
+struct hp_command {
+    heatpumpSettings settings;  /* Only fields in @a fields are applied */
+    hp_temp_t remote_temperature;
+    int function_code;
+    int function_value;         /* New value for FUNCTION_SET */
+    int *function_out;          /* Receives the value for FUNCTION_GET */
+    struct k_sem *done;         /* Given on completion, NULL for fire-and-forget */
+    int *result;
+    uint8_t type;
+    uint8_t fields;             /* HEATPUMP_FIELD_* mask */
+};
+
+K_MSGQ_DEFINE(hp_command_queue, sizeof(struct hp_command), HEATPUMP_COMMAND_QUEUE_DEPTH, 4);
 
 /* Memory slab configuration for packet buffers */
 #define PACKET_BUFFER_SIZE  64  /* Max packet size is 22 bytes, rounded to 64 for alignment */
-#define NUM_PACKET_BUFFERS  4   /* Pre-allocate 4 packet buffers for concurrent operations */
+#define NUM_PACKET_BUFFERS  CONFIG_APP_HEATPUMP_PACKET_BUFFERS
 
 /**
  * @brief Packet buffer structure for memory slab
@@ -41,17 +113,80 @@ struct packet_buffer {
 /* Define and initialize the packet buffer memory slab */
 K_MEM_SLAB_DEFINE(packet_slab, sizeof(struct packet_buffer), NUM_PACKET_BUFFERS, 4);
 
-/* Static variables for driver state */
-static heatpump_settings_t current_settings;
-static heatpump_status_t current_status;
-static heatpump_timers_t current_timers;
-static bool connected = false;
+/* Static variables for driver state. Only the driver thread writes these;
+ * other threads read them through atomic_get() */
+static atomic_t connected = ATOMIC_INIT(0);
+static atomic_t link_health = ATOMIC_INIT(HP_LINK_DOWN);
+
+/* Published state, packed (heatpump_state.h). Only the driver thread
+ * writes it, in hp_publish_state(): state_seq is odd while the words are
+ * being replaced, and readers copy them without a lock, retrying until
+ * they saw the same even sequence before and after. The writer holds
+ * state_lock across the update so a reader that preempts it never spins
+ * on an odd sequence; on SMP a reader waits at most for the two stores.
+ * The words are plain memory, so full fences order them against the
+ * sequence on both sides: a reader that saw an even, unchanged sequence
+ * around its copy copied one whole state. */
+static heatpump_state_t state;
+static atomic_t state_seq;
+static struct k_spinlock state_lock;
+
+/* Set once the heat pump has reported; until then the cache holds defaults
+ * or the state restored from flash and is published as stale */
+static bool settings_confirmed = false;
+static bool status_confirmed = false;
+
+/* Boot timing, filled in by the driver thread */
+static heatpump_boot_metrics_t boot_metrics;
+
+/* Diagnostics baseline, written by the driver thread on reset */
+static uint32_t stats_since_ms;
+static uint64_t stats_thread_cycles;
+static uint64_t stats_total_cycles;
+static uint32_t queue_peak;
+
+#ifdef CONFIG_APP_LINK_WATCHDOG
+/* Frame in flight when a deadline passed, set by the expiry handler and
+ * taken by the driver thread; counters are the thread's own */
+static atomic_t overrun_frame;
+static uint32_t deadline_overruns[HEATPUMP_FRAME_TYPES];
+static uint32_t loop_overruns;
+#endif
+
+BUILD_ASSERT(HEATPUMP_FRAME_TYPES == FRAME_TYPE_COUNT, "frame type count mismatch");
+BUILD_ASSERT((int)HP_LINK_HEALTHY == (int)LINK_HEALTHY && (int)HP_LINK_DEGRADED == (int)LINK_DEGRADED &&
+             (int)HP_LINK_DOWN == (int)LINK_DOWN, "link health mismatch");
+
+/* The packed state indexes the library's value tables */
+template <typename Values, size_t N>
+static constexpr bool hp_same_names(const char *const (&names)[N])
+{
+    if ((int)N != Values::count) {
+        return false;
+    }
+    for (size_t i = 0; i < N; i++) {
+        if (!cn105::sameValue(names[i], Values::at((int)i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BUILD_ASSERT(hp_same_names<cn105::Powers>(heatpump_state_power_names), "power names mismatch");
+BUILD_ASSERT(hp_same_names<cn105::Modes>(heatpump_state_mode_names), "mode names mismatch");
+BUILD_ASSERT(hp_same_names<cn105::Fans>(heatpump_state_fan_names), "fan names mismatch");
+BUILD_ASSERT(hp_same_names<cn105::Vanes>(heatpump_state_vane_names), "vane names mismatch");
+BUILD_ASSERT(hp_same_names<cn105::WideVanes>(heatpump_state_wide_vane_names),
+             "wide vane names mismatch");
+BUILD_ASSERT(hp_same_names<cn105::TimerModes>(heatpump_state_timer_names),
+             "timer mode names mismatch");
 
 /* Callback functions */
 static heatpump_settings_callback_t settings_callback = NULL;
 static heatpump_status_callback_t status_callback = NULL;
+static heatpump_state_callback_t state_callback = NULL;
 
-/* UART device (assigned when CN105 transport is implemented) */
+/* CN105 UART, handed to the library transport in heatpump_init() */
 static const struct device *uart_dev;
 static HeatPump s_hp;
 
@@ -66,16 +201,119 @@ static void hp_on_connect_callback(void);
 static void hp_settings_changed_callback(void);
 static void hp_status_changed_callback(heatpumpStatus newStatus);
 static void hp_packet_callback(uint8_t* packet, unsigned int length, char* packetDirection);
-static void hp_room_temp_changed_callback(float currentRoomTemperature);
+static void hp_room_temp_changed_callback(hp_temp_t currentRoomTemperature);
+
+/**
+ * @brief Hand the confirmed state to the write-behind store
+ */
+static void hp_persist_state(void)
+{
+#ifdef CONFIG_APP_HEATPUMP_PERSIST
+    heatpumpProfile hp = s_hp.getProfile();
+    heatpump_profile_t profile;
+    profile.bitrate = (uint32_t)hp.bitrate;
+    profile.halfDegreeSetpoint = hp.tempMode;
+    profile.wideVaneAdjust = hp.wideVaneAdj;
+
+    heatpump_settings_t settings;
+    heatpump_status_t status;
+    heatpump_timers_t timers;
+    heatpump_state_get_settings(&state, &settings);
+    heatpump_state_get_status(&state, &status);
+    heatpump_state_get_timers(&state, &timers);
+    state_persist_update(settings_confirmed ? &settings : NULL,
+                         status_confirmed ? &status : NULL,
+                         status_confirmed ? &timers : NULL,
+                         &profile);
+#endif
+}
+
+/**
+ * @brief Read the published state; safe from any thread
+ */
+static heatpump_state_t hp_read_state(void)
+{
+    heatpump_state_t copy;
+    atomic_val_t seq;
+
+    do {
+        seq = atomic_get(&state_seq);
+        barrier_dmem_fence_full();
+        copy = state;
+        barrier_dmem_fence_full();
+    } while ((seq & 1) != 0 || atomic_get(&state_seq) != seq);
+    return copy;
+}
+
 /**
- * @brief HeatPump library callback: Connection established
+ * @brief Pack the library state into the published state
+ *
+ * Only parts the unit has confirmed are packed, so the defaults or the
+ * restored state stay in place until then. The library does not call
+ * back for every field (e.g. a compressor frequency change while
+ * operating), so the driver thread also publishes after each sync.
+ * Nothing is written and no one is called when no bit changed.
+ */
+static void hp_publish_state(void)
+{
+    heatpump_state_t next = state;
+
+    if (settings_confirmed) {
+        heatpumpSettings hs = s_hp.getSettings();
+        heatpump_settings_t settings = {
+            hs.power, hs.mode, hs.temperature, hs.fan, hs.vane, hs.wideVane, hs.iSee,
+            atomic_get(&connected) != 0, false,
+        };
+        heatpump_state_put_settings(&next, &settings);
+    }
+    if (status_confirmed) {
+        heatpumpStatus st = s_hp.getStatus();
+        heatpump_status_t status = {
+            st.roomTemperature, st.operating, st.compressorFrequency, false,
+        };
+        heatpump_timers_t timers = {
+            st.timers.mode, st.timers.onMinutesSet, st.timers.onMinutesRemaining,
+            st.timers.offMinutesSet, st.timers.offMinutesRemaining,
+        };
+        heatpump_state_put_status(&next, &status, &timers);
+    }
+    next.settings = heatpump_state_set(next.settings, HP_STATE_CONNECTED, atomic_get(&connected) != 0);
+    next.settings = heatpump_state_set(next.settings, HP_STATE_LINK_HEALTH,
+                                       (uint32_t)atomic_get(&link_health));
+
+    heatpump_state_t changed = heatpump_state_diff(&state, &next);
+    if (!heatpump_state_changed(&changed, UINT64_MAX, UINT64_MAX)) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&state_lock);
+    atomic_inc(&state_seq);
+    barrier_dmem_fence_full();
+    state = next;
+    barrier_dmem_fence_full();
+    atomic_inc(&state_seq);
+    k_spin_unlock(&state_lock, key);
+
+    if (state_callback) {
+        HP_TRACE_BEGIN(HP_TRACE_CALLBACK, HP_TRACE_CB_STATE, 0);
+        state_callback(&next, &changed);
+        HP_TRACE_END(HP_TRACE_CALLBACK, HP_TRACE_CB_STATE, 0);
+    }
+}
+
+/**
+ * @brief HeatPump library callback: Connection attempt started
  * 
- * Called when the heat pump handshake is successful
+ * Called once the UART is configured, before the CONNECT exchange;
+ * the link is only marked connected when the handshake succeeds
  */
 static void hp_on_connect_callback(void)
 {
-    LOG_INF("Heat pump connected");
-    connected = true;
+    LOG_INF("Heat pump UART configured, handshaking");
+#ifdef CONFIG_APP_LINK_WATCHDOG
+    /* The settle delay is not an exchange; CONNECT starts the next one */
+    link_watchdog_end(LINK_WATCHDOG_TRANSACTION);
+#endif
 }
 
 /**
@@ -85,23 +323,22 @@ static void hp_on_connect_callback(void)
  */
 static void hp_settings_changed_callback(void)
 {
-    LOG_INF("Heat pump settings changed");
+    APP_LOG_RATELIMITED(INF, "Heat pump settings changed");
     
     /* Update local cache */
-    heatpumpSettings hp = s_hp.getSettings();
-    current_settings.power = hp.power;
-    current_settings.mode = hp.mode;
-    current_settings.temperature = hp.temperature;
-    current_settings.fan = hp.fan;
-    current_settings.vane = hp.vane;
-    current_settings.wideVane = hp.wideVane;
-    current_settings.iSee = hp.iSee;
-    current_settings.connected = connected;
+    settings_confirmed = true;
+    hp_publish_state();
     
     /* Call registered application callback if present */
     if (settings_callback) {
-        settings_callback(current_settings);
+        heatpump_settings_t settings;
+        heatpump_state_get_settings(&state, &settings);
+        HP_TRACE_BEGIN(HP_TRACE_CALLBACK, HP_TRACE_CB_SETTINGS, 0);
+        settings_callback(settings);
+        HP_TRACE_END(HP_TRACE_CALLBACK, HP_TRACE_CB_SETTINGS, 0);
     }
+
+    hp_persist_state();
 }
 
 /**
@@ -113,24 +350,24 @@ static void hp_settings_changed_callback(void)
  */
 static void hp_status_changed_callback(heatpumpStatus newStatus)
 {
-    LOG_INF("Heat pump status changed");
-    
-    /* Update local cache */
-    current_status.roomTemperature = newStatus.roomTemperature;
-    current_status.operating = newStatus.operating;
-    current_status.compressorFrequency = newStatus.compressorFrequency;
+    ARG_UNUSED(newStatus);
+
+    APP_LOG_RATELIMITED(INF, "Heat pump status changed");
     
-    /* Update timers as well */
-    current_timers.mode = newStatus.timers.mode;
-    current_timers.onMinutesSet = newStatus.timers.onMinutesSet;
-    current_timers.onMinutesRemaining = newStatus.timers.onMinutesRemaining;
-    current_timers.offMinutesSet = newStatus.timers.offMinutesSet;
-    current_timers.offMinutesRemaining = newStatus.timers.offMinutesRemaining;
+    /* Update local cache, timers included */
+    status_confirmed = true;
+    hp_publish_state();
     
     /* Call registered application callback if present */
     if (status_callback) {
-        status_callback(current_status);
+        heatpump_status_t status;
+        heatpump_state_get_status(&state, &status);
+        HP_TRACE_BEGIN(HP_TRACE_CALLBACK, HP_TRACE_CB_STATUS, 0);
+        status_callback(status);
+        HP_TRACE_END(HP_TRACE_CALLBACK, HP_TRACE_CB_STATUS, 0);
     }
+
+    hp_persist_state();
 }
 
 /**
@@ -147,6 +384,15 @@ static void hp_packet_callback(uint8_t* packet, unsigned int length, char* packe
     if (packet && length > 0 && packetDirection) {
         LOG_DBG("Heat pump packet %s: %d bytes", packetDirection, length);
         /* Could log hex dump here for deeper debugging if needed */
+#ifdef CONFIG_APP_LATENCY_BENCH
+        latency_bench_on_frame(packet, length, strcmp(packetDirection, "packetSent") == 0);
+#endif
+#ifdef CONFIG_APP_LINK_WATCHDOG
+        /* Each frame sent restarts the exchange deadline */
+        if (strcmp(packetDirection, "packetSent") == 0) {
+            link_watchdog_begin(LINK_WATCHDOG_TRANSACTION);
+        }
+#endif
     }
 }
 
@@ -157,24 +403,475 @@ static void hp_packet_callback(uint8_t* packet, unsigned int length, char* packe
  * 
  * @param currentRoomTemperature The new room temperature
  */
-static void hp_room_temp_changed_callback(float currentRoomTemperature)
+static void hp_room_temp_changed_callback(hp_temp_t currentRoomTemperature)
 {
-    LOG_INF("Room temperature: %.1f°C", (double)currentRoomTemperature);
-    current_status.roomTemperature = currentRoomTemperature;
+    APP_LOG_RATELIMITED(INF, "Room temperature: " HP_TEMP_FMT "°C", HP_TEMP_ARGS(currentRoomTemperature));
+    status_confirmed = true;
+    hp_publish_state();
     
     /* Call registered application callback if present */
     if (status_callback) {
-        status_callback(current_status);
+        heatpump_status_t status;
+        heatpump_state_get_status(&state, &status);
+        HP_TRACE_BEGIN(HP_TRACE_CALLBACK, HP_TRACE_CB_STATUS, 0);
+        status_callback(status);
+        HP_TRACE_END(HP_TRACE_CALLBACK, HP_TRACE_CB_STATUS, 0);
+    }
+
+    hp_persist_state();
+}
+
+/**
+ * @brief Store function codes once the unit has confirmed them
+ */
+static void hp_persist_functions(const heatpumpFunctions &functions)
+{
+#ifdef CONFIG_APP_HEATPUMP_PERSIST
+    uint8_t raw[HP_FUNCTION_DATA_LEN];
+
+    functions.getData1(raw);
+    functions.getData2(raw + HP_FUNCTION_DATA_LEN / 2);
+    state_persist_update_functions(raw);
+#else
+    ARG_UNUSED(functions);
+#endif
+}
+
+/**
+ * @brief Execute a function code command on the driver thread
+ */
+static int hp_execute_function(struct hp_command *cmd)
+{
+    int64_t stamp = s_hp.getFunctionsStamp();
+    /* Writes start from codes confirmed by this unit, never from flash */
+    bool refresh = cmd->type == HP_CMD_FUNCTIONS_REFRESH ||
+                   (cmd->type == HP_CMD_FUNCTION_SET && stamp == 0);
+    heatpumpFunctions functions = s_hp.getFunctions(refresh);
+
+    if (!functions.isValid()) {
+        return -EIO;
+    }
+
+    switch (cmd->type) {
+        case HP_CMD_FUNCTION_GET:
+            *cmd->function_out = functions.getValue(cmd->function_code);
+            break;
+
+        case HP_CMD_FUNCTION_SET:
+            if (!functions.setValue(cmd->function_code, cmd->function_value)) {
+                return -EINVAL;
+            }
+            if (!s_hp.setFunctions(functions)) {
+                return -EIO;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    /* A read or an acked write moves the stamp: the unit confirmed them */
+    if (s_hp.getFunctionsStamp() != stamp) {
+        hp_persist_functions(s_hp.getFunctions());
+    }
+    return 0;
+}
+
+/**
+ * @brief Clear the link counters and take a new runtime baseline
+ */
+static void hp_reset_stats(void)
+{
+    s_hp.resetStats();
+#ifdef CONFIG_APP_LINK_WATCHDOG
+    memset(deadline_overruns, 0, sizeof(deadline_overruns));
+    loop_overruns = 0;
+#endif
+    queue_peak = k_msgq_num_used_get(&hp_command_queue);
+    stats_since_ms = k_uptime_get_32();
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+    k_thread_runtime_stats_t rt;
+    if (k_thread_runtime_stats_get(heatpump_thread_id, &rt) == 0) {
+        stats_thread_cycles = rt.execution_cycles;
+    }
+    if (k_thread_runtime_stats_all_get(&rt) == 0) {
+        stats_total_cycles = rt.execution_cycles;
+    }
+#endif
+}
+
+#ifdef CONFIG_APP_ICD
+/* Driver side of the ICD policy */
+static bool icd_active = true;     /* Mode on the last loop; hp_bring_up() fetched the state */
+static int64_t icd_next_window_ms; /* Next idle-mode CN105 window */
+
+/**
+ * @brief Follow the ICD mode
+ *
+ * On entering active mode the full state is fetched at once, so the
+ * first report of the window is current and sync() does not take the
+ * time since the last idle window for a lost link.
+ *
+ * @param activity A command is being executed
+ * @return true in active mode
+ */
+static bool hp_icd_active(bool activity)
+{
+    bool active = icd_poll(activity || s_hp.hasPendingWrite());
+
+    if (active && !icd_active && s_hp.isConnected()) {
+        s_hp.burstSync();
+    }
+    icd_active = active;
+    return active;
+}
+
+/**
+ * @brief How long the loop may wait for a command
+ */
+static k_timeout_t hp_wait_time(void)
+{
+    if (icd_active) {
+        return K_MSEC(HEATPUMP_UPDATE_INTERVAL_MS);
+    }
+    return K_MSEC(MAX(icd_next_window_ms - k_uptime_get(), 0));
+}
+
+/**
+ * @brief Poll the heat pump as the ICD mode allows
+ *
+ * Active mode polls at the normal rate. Idle mode fetches the full
+ * state in one burst per slow poll interval, or reconnects, and then
+ * lets the radio poll its parent in the same wakeup.
+ */
+static void hp_sync(void)
+{
+    if (hp_icd_active(false)) {
+        s_hp.sync();
+        return;
+    }
+
+    int64_t now = k_uptime_get();
+    if (now < icd_next_window_ms) {
+        return;
+    }
+    if (s_hp.linkHealth() == LINK_DOWN) {
+        s_hp.sync();
+    } else {
+        s_hp.burstSync();
+    }
+    icd_next_window_ms = now + CONFIG_APP_ICD_SLOW_POLL_INTERVAL_MS;
+    icd_idle_window_done();
+}
+#else
+static k_timeout_t hp_wait_time(void)
+{
+    return K_MSEC(HEATPUMP_UPDATE_INTERVAL_MS);
+}
+
+static void hp_sync(void)
+{
+    s_hp.sync();
+}
+#endif
+
+/**
+ * @brief Execute one queued command on the driver thread
+ */
+static void hp_execute(struct hp_command *cmd)
+{
+    int result = 0;
+
+    HP_TRACE_BEGIN(HP_TRACE_CMD, cmd->type, 0);
+
+#ifdef CONFIG_APP_ICD
+    /* Commands, schedule transitions included, keep the radio and the
+     * poll rate up until the change has been reported */
+    hp_icd_active(true);
+#endif
+
+    switch (cmd->type) {
+        case HP_CMD_SETTINGS:
+            if (!atomic_get(&connected)) {
+                result = -ENOTCONN;
+                break;
+            }
+            if (cmd->fields & HEATPUMP_FIELD_POWER) {
+                s_hp.setPowerSetting(cmd->settings.power);
+            }
+            if (cmd->fields & HEATPUMP_FIELD_MODE) {
+                s_hp.setModeSetting(cmd->settings.mode);
+            }
+            if (cmd->fields & HEATPUMP_FIELD_TEMP) {
+                s_hp.setTemperature(cmd->settings.temperature);
+            }
+            if (cmd->fields & HEATPUMP_FIELD_FAN) {
+                s_hp.setFanSpeed(cmd->settings.fan);
+            }
+            if (cmd->fields & HEATPUMP_FIELD_VANE) {
+                s_hp.setVaneSetting(cmd->settings.vane);
+            }
+            if (cmd->fields & HEATPUMP_FIELD_WIDE_VANE) {
+                s_hp.setWideVaneSetting(cmd->settings.wideVane);
+            }
+            result = s_hp.update() ? 0 : -EIO;
+            break;
+
+        case HP_CMD_REMOTE_TEMP:
+            s_hp.setRemoteTemperature(cmd->remote_temperature);
+            break;
+
+        case HP_CMD_SYNC:
+            s_hp.sync();
+            break;
+
+        case HP_CMD_FUNCTION_GET:
+        case HP_CMD_FUNCTION_SET:
+        case HP_CMD_FUNCTIONS_REFRESH:
+            result = atomic_get(&connected) ? hp_execute_function(cmd) : -ENOTCONN;
+            break;
+
+        case HP_CMD_RESET_STATS:
+            hp_reset_stats();
+            break;
+
+        default:
+            result = -EINVAL;
+            break;
+    }
+    HP_TRACE_END(HP_TRACE_CMD, result, 0);
+
+    if (cmd->done) {
+        *cmd->result = result;
+        k_sem_give(cmd->done);
+    }
+}
+
+/**
+ * @brief Complete every queued command with an error
+ *
+ * A remote temperature needs no bus slot when it is queued, so it is
+ * handed to the library instead, which sends it once the link is up.
+ */
+static void hp_fail_pending(int result)
+{
+    struct hp_command cmd;
+
+    while (k_msgq_get(&hp_command_queue, &cmd, K_NO_WAIT) == 0) {
+        if (cmd.type == HP_CMD_REMOTE_TEMP) {
+            hp_execute(&cmd);
+            continue;
+        }
+        if (cmd.done) {
+            *cmd.result = result;
+            k_sem_give(cmd.done);
+        }
+    }
+}
+
+/**
+ * @brief Post a command to the driver thread
+ *
+ * Commands issued from the driver thread itself (e.g. from a callback)
+ * are executed inline, since waiting on our own queue would deadlock.
+ *
+ * @param cmd Command to post
+ * @param wait Block until the command has been executed
+ * @return Command result if @a wait, otherwise 0 once queued
+ */
+static int hp_submit(struct hp_command *cmd, bool wait)
+{
+    struct k_sem done;
+    int result = -EIO;
+
+    if (!heatpump_thread_running) {
+        return -ENODEV;
+    }
+
+    if (k_current_get() == heatpump_thread_id) {
+        cmd->done = wait ? &done : NULL;
+        cmd->result = &result;
+        if (wait) {
+            k_sem_init(&done, 0, 1);
+        }
+        hp_execute(cmd);
+        return wait ? result : 0;
+    }
+
+    cmd->done = NULL;
+    cmd->result = NULL;
+    if (wait) {
+        k_sem_init(&done, 0, 1);
+        cmd->done = &done;
+        cmd->result = &result;
+    }
+
+    HpTraceSpan span = HP_TRACE_SPAN(HP_TRACE_SUBMIT);
+    span.begin(cmd->type);
+    if (k_msgq_put(&hp_command_queue, cmd, K_NO_WAIT) != 0) {
+        APP_LOG_RATELIMITED(WRN, "Heat pump command queue full");
+        span.setResult((uint32_t)-EBUSY);
+        return -EBUSY;
+    }
+    queue_peak = MAX(queue_peak, k_msgq_num_used_get(&hp_command_queue));
+    if (!wait) {
+        return 0;
+    }
+
+    /* The driver thread completes every command it dequeues, and fails
+     * queued ones while the link is down, so this wait is bounded */
+    k_sem_take(&done, K_FOREVER);
+    span.setResult((uint32_t)result);
+    return result;
+}
+
+/**
+ * @brief Post a settings command and wait for the SET exchange
+ */
+static int hp_submit_settings(uint8_t fields, const heatpumpSettings &settings)
+{
+    struct hp_command cmd = {};
+
+    cmd.type = HP_CMD_SETTINGS;
+    cmd.fields = fields;
+    cmd.settings = settings;
+    return hp_submit(&cmd, true);
+}
+
+#ifdef CONFIG_APP_LINK_WATCHDOG
+/**
+ * @brief Deadline expiry handler, in the watchdog timer's interrupt
+ *
+ * Makes the library's waits give up; hp_deadline_end() resets the link
+ * once the thread is back.
+ */
+static void hp_deadline_passed(link_watchdog_deadline_e deadline)
+{
+    ARG_UNUSED(deadline);
+    atomic_set(&overrun_frame, (atomic_val_t)s_hp.lastSentFrame());
+    s_hp.abortExchange();
+}
+
+static void hp_deadline_begin(void)
+{
+    link_watchdog_begin(LINK_WATCHDOG_LOOP);
+}
+
+/**
+ * @brief Stop the deadlines and recover from an overrun, if one passed
+ */
+static void hp_deadline_end(void)
+{
+    link_watchdog_end(LINK_WATCHDOG_TRANSACTION);
+    link_watchdog_end(LINK_WATCHDOG_LOOP);
+
+    /* Taken after the channels are gone, so no expiry can follow it */
+    int deadline = link_watchdog_take_overrun();
+    if (deadline < 0) {
+        return;
+    }
+
+    heatpumpFrameType frame = (heatpumpFrameType)atomic_get(&overrun_frame);
+    deadline_overruns[frame]++;
+    if (deadline == LINK_WATCHDOG_LOOP) {
+        loop_overruns++;
+    }
+    LOG_WRN("CN105 %s deadline passed after %s, resetting the link",
+            deadline == LINK_WATCHDOG_LOOP ? "loop" : "exchange",
+            heatpump_frame_type_name(frame));
+    s_hp.resetLink();
+    atomic_set(&connected, 0);
+}
+#else
+static inline void hp_deadline_begin(void) {}
+static inline void hp_deadline_end(void) {}
+#endif
+
+/**
+ * @brief Bring up the CN105 link and fetch the first full state
+ *
+ * Runs on the driver thread so the handshake (2 s settle plus the
+ * CONNECT exchange) overlaps with the network stack start-up. Once
+ * connected, the settings, room temperature, status and timers are
+ * requested back to back instead of one per info interval.
+ */
+static void hp_bring_up(void)
+{
+    int bitrate = s_hp.getProfile().bitrate;
+
+    while (heatpump_thread_running) {
+        bool ok;
+
+        hp_deadline_begin();
+        ok = s_hp.connect(bitrate);
+        hp_deadline_end();
+        if (ok) {
+            break;
+        }
+        APP_LOG_RATELIMITED(WRN, "Heat pump handshake failed, retrying in %d ms",
+                            HEATPUMP_CONNECT_RETRY_MS);
+        hp_fail_pending(-ENOTCONN);
+        k_msleep(HEATPUMP_CONNECT_RETRY_MS);
+        /* Probe 2400 and 9600 baud from now on */
+        bitrate = 0;
+    }
+    if (!heatpump_thread_running) {
+        return;
+    }
+
+    atomic_set(&connected, 1);
+    boot_metrics.connected_ms = k_uptime_get_32();
+
+    int64_t burst_start = k_uptime_get();
+    hp_deadline_begin();
+    int replies = s_hp.burstSync();
+    hp_deadline_end();
+    boot_metrics.burst_ms = (uint32_t)(k_uptime_get() - burst_start);
+
+    LOG_INF("Heat pump connected after %u ms, initial burst %d/4 replies in %u ms",
+            boot_metrics.connected_ms - boot_metrics.init_ms, replies, boot_metrics.burst_ms);
+}
+
+/**
+ * @brief Publish the link classification, logging changes
+ */
+static void hp_update_link_health(void)
+{
+    atomic_val_t health = (atomic_val_t)s_hp.linkHealth();
+    atomic_val_t old = atomic_set(&link_health, health);
+    static const char *const names[] = { "healthy", "degraded", "down" };
+
+    if (old != health) {
+        if (health == HP_LINK_HEALTHY) {
+            LOG_INF("CN105 link %s", names[health]);
+        } else {
+            LOG_WRN("CN105 link %s", names[health]);
+        }
+    }
+}
+
+/**
+ * @brief Record the time the first complete state became available
+ */
+static void hp_note_first_state(void)
+{
+    if (boot_metrics.first_state_ms == 0 && settings_confirmed && status_confirmed) {
+        boot_metrics.first_state_ms = k_uptime_get_32();
+        LOG_INF("Boot metric: first complete heat pump state %u ms after init",
+                boot_metrics.first_state_ms - boot_metrics.init_ms);
     }
 }
 
 /**
  * @brief Heatpump update thread
  * 
- * This thread runs periodically to:
- * - Transmit pending commands to the heat pump
- * - Read responses from the heat pump
- * - Invoke callbacks when state changes occur
+ * This thread owns the CN105 link:
+ * - Performs the handshake and initial burst in the background
+ * - Executes queued commands (settings, remote temperature)
+ * - Polls the heat pump and reads responses
+ * - Runs the on-device schedule (CONFIG_APP_SCHEDULE)
+ * - Shares wakeups with the radio in ICD idle mode (CONFIG_APP_ICD)
+ * - Invokes callbacks when state changes occur
  * 
  * This replaces the Arduino loop() paradigm with Zephyr threading
  * 
@@ -189,25 +886,40 @@ static void heatpump_update_thread(void *arg1, void *arg2, void *arg3)
     ARG_UNUSED(arg3);
     
     LOG_INF("Heat pump update thread started");
-    heatpump_thread_running = true;
+
+    hp_bring_up();
     
     /* Main update loop */
     while (heatpump_thread_running) {
-        /* Call the HeatPump library's update method */
-        /* This method handles:
-         * - Sending queued commands
-         * - Reading responses
-         * - Triggering registered callbacks
-         */
-        if (s_hp.update()) {
-            /* Update was successful */
-            LOG_DBG("Heat pump update completed");
+        struct hp_command cmd;
+
+        /* Wait for a command, at most one update interval (or until the
+         * next CN105 window in ICD idle mode) */
+        if (k_msgq_get(&hp_command_queue, &cmd, hp_wait_time()) == 0) {
+            hp_deadline_begin();
+            hp_execute(&cmd);
+        } else {
+            hp_deadline_begin();
         }
-        
-        /* Sleep for the configured update interval */
-        k_msleep(HEATPUMP_UPDATE_INTERVAL_MS);
+
+        /* Reconnects, reads responses, sends pending remote temperature
+         * and the periodic info requests */
+        hp_sync();
+        atomic_set(&connected, s_hp.isConnected() ? 1 : 0);
+        hp_update_link_health();
+        hp_publish_state();
+        hp_note_first_state();
+
+#ifdef CONFIG_APP_SCHEDULE
+        /* Due transitions are applied inline, as one SET each */
+        if (atomic_get(&connected)) {
+            schedule_poll();
+        }
+#endif
+        hp_deadline_end();
     }
-    
+
+    hp_fail_pending(-ESHUTDOWN);
     LOG_INF("Heat pump update thread stopped");
 }
 
@@ -218,6 +930,7 @@ static void heatpump_update_thread(void *arg1, void *arg2, void *arg3)
 int heatpump_init(void)
 {
     LOG_INF("Initializing heat pump driver");
+    boot_metrics.init_ms = k_uptime_get_32();
     
 #if DT_HAS_CHOSEN(heatpump_uart)
     uart_dev = DEVICE_DT_GET(DT_CHOSEN(heatpump_uart));
@@ -228,34 +941,70 @@ int heatpump_init(void)
         LOG_ERR("Heatpump UART device not ready");
         return -ENODEV;
     }
-    if (!s_hp.connect(uart_dev, HP_UART_BAUD_RATE)) {
-        LOG_ERR("Heat pump handshake failed");
-        return -EIO;
-    }
-    connected = s_hp.isConnected();
+    s_hp.getTransport().setDevice(uart_dev);
     
     /* Initialize settings to default values */
-    current_settings.power = "OFF";
-    current_settings.mode = "AUTO";
-    current_settings.temperature = 22.0f;
-    current_settings.fan = "AUTO";
-    current_settings.vane = "AUTO";
-    current_settings.wideVane = "|";
-    current_settings.iSee = false;
-    current_settings.connected = false;
+    heatpump_settings_t settings = {};
+    settings.power = "OFF";
+    settings.mode = "AUTO";
+    settings.temperature = HP_TEMP_C(22);
+    settings.fan = "AUTO";
+    settings.vane = "AUTO";
+    settings.wideVane = "|";
+    settings.iSee = false;
+    settings.connected = false;
+    settings.stale = true;
     
     /* Initialize status */
-    current_status.roomTemperature = 20.0f;
-    current_status.operating = false;
-    current_status.compressorFrequency = 0;
+    heatpump_status_t status = {};
+    status.roomTemperature = HP_TEMP_C(20);
+    status.operating = false;
+    status.compressorFrequency = 0;
+    status.stale = true;
     
     /* Initialize timers */
-    current_timers.mode = "NONE";
-    current_timers.onMinutesSet = 0;
-    current_timers.onMinutesRemaining = 0;
-    current_timers.offMinutesSet = 0;
-    current_timers.offMinutesRemaining = 0;
+    heatpump_timers_t timers = {};
+    timers.mode = "NONE";
+    timers.onMinutesSet = 0;
+    timers.onMinutesRemaining = 0;
+    timers.offMinutesSet = 0;
+    timers.offMinutesRemaining = 0;
+
+#ifdef CONFIG_APP_HEATPUMP_PERSIST
+    /* Replace the defaults with the last confirmed state, if any, so
+     * readers see realistic (stale) values before the unit answers */
+    if (state_persist_init() == 0) {
+        heatpump_profile_t profile = {};
+        if (state_persist_restore(&settings, &status, &timers, &profile) == 0) {
+            LOG_INF("Restored last known heat pump state");
+            if (profile.bitrate != 0) {
+                s_hp.setProfile({(int)profile.bitrate, profile.halfDegreeSetpoint,
+                                 profile.wideVaneAdjust});
+            }
+        }
+
+        uint8_t raw[HP_FUNCTION_DATA_LEN];
+        if (state_persist_restore_functions(raw) == 0) {
+            heatpumpFunctions functions;
+            functions.setData1(raw);
+            functions.setData2(raw + HP_FUNCTION_DATA_LEN / 2);
+            s_hp.restoreFunctions(functions);
+        }
+    }
+#endif
+
+    /* Published before the driver thread exists, so no reader can race */
+    heatpump_state_put_settings(&state, &settings);
+    heatpump_state_put_status(&state, &status, &timers);
+    state.settings = heatpump_state_set(state.settings, HP_STATE_LINK_HEALTH, HP_LINK_DOWN);
     
+#ifdef CONFIG_APP_LINK_WATCHDOG
+    /* Without it the thread runs unmonitored, as before */
+    if (link_watchdog_init(hp_deadline_passed) != 0) {
+        LOG_WRN("CN105 deadlines disabled");
+    }
+#endif
+
     /* Register HeatPump library callbacks for Zephyr integration */
     s_hp.setOnConnectCallback(hp_on_connect_callback);
     s_hp.setSettingsChangedCallback(hp_settings_changed_callback);
@@ -263,7 +1012,8 @@ int heatpump_init(void)
     s_hp.setPacketCallback(hp_packet_callback);
     s_hp.setRoomTempChangedCallback(hp_room_temp_changed_callback);
     
-    /* Start the heat pump update thread */
+    /* Start the heat pump update thread; it performs the handshake */
+    heatpump_thread_running = true;
     heatpump_thread_id = k_thread_create(&heatpump_thread_data,
                                          heatpump_stack,
                                          HEATPUMP_THREAD_STACK_SIZE,
@@ -275,6 +1025,7 @@ int heatpump_init(void)
     
     if (heatpump_thread_id == NULL) {
         LOG_ERR("Failed to create heat pump update thread");
+        heatpump_thread_running = false;
         return -EAGAIN;
     }
     
@@ -318,15 +1069,19 @@ int heatpump_shutdown(void)
  */
 int heatpump_connect(void)
 {
-    LOG_INF("Connecting to heat pump...");
-    if (!device_is_ready(uart_dev)) {
+    if (heatpump_thread_id == NULL) {
         return -ENODEV;
     }
-    if (!s_hp.connect(uart_dev, HP_UART_BAUD_RATE)) {
-        return -EIO;
+
+    /* The handshake runs on the driver thread; wait for it to finish */
+    int64_t deadline = k_uptime_get() + HEATPUMP_CONNECT_TIMEOUT_MS;
+    while (!atomic_get(&connected)) {
+        if (k_uptime_get() >= deadline) {
+            return -ETIMEDOUT;
+        }
+        k_msleep(50);
     }
-    connected = s_hp.isConnected();
-    return connected ? 0 : -EIO;
+    return 0;
 }
 
 /**
@@ -334,7 +1089,107 @@ int heatpump_connect(void)
  */
 void heatpump_sync(void)
 {
-    s_hp.sync();
+    struct hp_command cmd = {};
+
+    cmd.type = HP_CMD_SYNC;
+    (void)hp_submit(&cmd, false);
+}
+
+/**
+ * @brief Get boot timing metrics
+ */
+int heatpump_get_boot_metrics(heatpump_boot_metrics_t *metrics)
+{
+    if (metrics == NULL) {
+        return -EINVAL;
+    }
+    *metrics = boot_metrics;
+    return 0;
+}
+
+/**
+ * @brief Get CN105 link and driver counters
+ */
+int heatpump_get_stats(heatpump_stats_t *stats)
+{
+    if (stats == NULL) {
+        return -EINVAL;
+    }
+
+    heatpumpStats hp = s_hp.getStats();
+    for (int i = 0; i < HEATPUMP_FRAME_TYPES; i++) {
+        stats->sent[i] = hp.sent[i];
+        stats->received[i] = hp.received[i];
+    }
+    stats->checksum_errors = hp.checksumErrors;
+    stats->framing_errors = hp.framingErrors;
+    stats->timeouts = hp.timeouts;
+    stats->line_errors = hp.lineErrors;
+    stats->connect_attempts = hp.connectAttempts;
+    stats->reconnects = hp.reconnects;
+    stats->polls = hp.polls;
+    stats->command_wait_max_ms = hp.commandWaitMaxMs;
+    stats->set_confirmed = hp.setConfirmed;
+    stats->set_unconfirmed = hp.setUnconfirmed;
+    stats->set_failed = hp.setFailed;
+    stats->set_retries = hp.setRetries;
+#ifdef CONFIG_APP_LINK_WATCHDOG
+    memcpy(stats->overruns, deadline_overruns, sizeof(stats->overruns));
+    stats->loop_overruns = loop_overruns;
+#else
+    memset(stats->overruns, 0, sizeof(stats->overruns));
+    stats->loop_overruns = 0;
+#endif
+    stats->since_ms = stats_since_ms;
+    stats->queue_used = k_msgq_num_used_get(&hp_command_queue);
+    stats->queue_peak = queue_peak;
+    stats->queue_size = HEATPUMP_COMMAND_QUEUE_DEPTH;
+    stats->slab_used = k_mem_slab_num_used_get(&packet_slab);
+    stats->slab_size = NUM_PACKET_BUFFERS;
+#ifdef CONFIG_MEM_SLAB_TRACE_MAX_UTILIZATION
+    stats->slab_peak = k_mem_slab_max_used_get(&packet_slab);
+#else
+    stats->slab_peak = stats->slab_used;
+#endif
+    stats->thread_cycles = 0;
+    stats->total_cycles = 0;
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+    k_thread_runtime_stats_t rt;
+    if (heatpump_thread_id != NULL &&
+        k_thread_runtime_stats_get(heatpump_thread_id, &rt) == 0) {
+        stats->thread_cycles = rt.execution_cycles - stats_thread_cycles;
+    }
+    if (k_thread_runtime_stats_all_get(&rt) == 0) {
+        stats->total_cycles = rt.execution_cycles - stats_total_cycles;
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief Reset the link counters
+ */
+int heatpump_reset_stats(void)
+{
+    struct hp_command cmd = {};
+    cmd.type = HP_CMD_RESET_STATS;
+    return hp_submit(&cmd, true);
+}
+
+/**
+ * @brief Get the name of a frame type
+ */
+const char *heatpump_frame_type_name(int type)
+{
+    static const char *const names[HEATPUMP_FRAME_TYPES] = {
+        "connect", "set", "remote-temp", "settings", "room-temp",
+        "status", "timers", "functions", "other"
+    };
+
+    if (type < 0 || type >= HEATPUMP_FRAME_TYPES) {
+        return "?";
+    }
+    return names[type];
 }
 
 /**
@@ -345,15 +1200,8 @@ int heatpump_get_settings(heatpump_settings_t *settings)
     if (settings == NULL) {
         return -EINVAL;
     }
-    heatpumpSettings hp = s_hp.getSettings();
-    settings->power = hp.power;
-    settings->mode = hp.mode;
-    settings->temperature = hp.temperature;
-    settings->fan = hp.fan;
-    settings->vane = hp.vane;
-    settings->wideVane = hp.wideVane;
-    settings->iSee = hp.iSee;
-    settings->connected = connected;
+    heatpump_state_t copy = hp_read_state();
+    heatpump_state_get_settings(&copy, settings);
     return 0;
 }
 
@@ -365,10 +1213,37 @@ int heatpump_get_status(heatpump_status_t *status)
     if (status == NULL) {
         return -EINVAL;
     }
-    heatpumpStatus s = s_hp.getStatus();
-    status->roomTemperature = s.roomTemperature;
-    status->operating = s.operating;
-    status->compressorFrequency = s.compressorFrequency;
+    heatpump_state_t copy = hp_read_state();
+    heatpump_state_get_status(&copy, status);
+    return 0;
+}
+
+/**
+ * @brief Get the packed driver state
+ */
+int heatpump_get_state(heatpump_state_t *out)
+{
+    if (out == NULL) {
+        return -EINVAL;
+    }
+    *out = hp_read_state();
+    return 0;
+}
+
+/**
+ * @brief Get settings, status, timers and link health in one consistent copy
+ */
+int heatpump_get_snapshot(heatpump_snapshot_t *snapshot)
+{
+    if (snapshot == NULL) {
+        return -EINVAL;
+    }
+    heatpump_state_t copy = hp_read_state();
+    heatpump_state_get_settings(&copy, &snapshot->settings);
+    heatpump_state_get_status(&copy, &snapshot->status);
+    heatpump_state_get_timers(&copy, &snapshot->timers);
+    snapshot->link_health =
+        (heatpump_link_health_e)heatpump_state_get(copy.settings, HP_STATE_LINK_HEALTH);
     return 0;
 }
 
@@ -380,10 +1255,8 @@ int heatpump_get_timers(heatpump_timers_t *timers)
     if (timers == NULL) {
         return -EINVAL;
     }
-    /* The library exposes timers via getStatus parsing; no direct method */
-    heatpumpStatus s = s_hp.getStatus();
-    (void)s;
-    *timers = current_timers;
+    heatpump_state_t copy = hp_read_state();
+    heatpump_state_get_timers(&copy, timers);
     return 0;
 }
 
@@ -393,8 +1266,9 @@ int heatpump_get_timers(heatpump_timers_t *timers)
 int heatpump_set_power(const char *power)
 {
     LOG_INF("Setting power: %s", power);
-    s_hp.setPowerSetting((power && power[0] == 'O' && power[1] == 'N') ? true : false);
-    return s_hp.update() ? 0 : -EIO;
+    heatpumpSettings s = {};
+    s.power = (power && power[0] == 'O' && power[1] == 'N') ? "ON" : "OFF";
+    return hp_submit_settings(HEATPUMP_FIELD_POWER, s);
 }
 
 /**
@@ -403,18 +1277,20 @@ int heatpump_set_power(const char *power)
 int heatpump_set_mode(const char *mode)
 {
     LOG_INF("Setting mode: %s", mode);
-    s_hp.setModeSetting(mode);
-    return s_hp.update() ? 0 : -EIO;
+    heatpumpSettings s = {};
+    s.mode = mode;
+    return hp_submit_settings(HEATPUMP_FIELD_MODE, s);
 }
 
 /**
  * @brief Set target temperature
  */
-int heatpump_set_temperature(float temperature)
+int heatpump_set_temperature(hp_temp_t temperature)
 {
-    LOG_INF("Setting temperature: %.1f°C", (double)temperature);
-    s_hp.setTemperature(temperature);
-    return s_hp.update() ? 0 : -EIO;
+    LOG_INF("Setting temperature: " HP_TEMP_FMT "°C", HP_TEMP_ARGS(temperature));
+    heatpumpSettings s = {};
+    s.temperature = temperature;
+    return hp_submit_settings(HEATPUMP_FIELD_TEMP, s);
 }
 
 /**
@@ -423,8 +1299,9 @@ int heatpump_set_temperature(float temperature)
 int heatpump_set_fan(const char *fan)
 {
     LOG_INF("Setting fan: %s", fan);
-    s_hp.setFanSpeed(fan);
-    return s_hp.update() ? 0 : -EIO;
+    heatpumpSettings s = {};
+    s.fan = fan;
+    return hp_submit_settings(HEATPUMP_FIELD_FAN, s);
 }
 
 /**
@@ -433,8 +1310,9 @@ int heatpump_set_fan(const char *fan)
 int heatpump_set_vane(const char *vane)
 {
     LOG_INF("Setting vane: %s", vane);
-    s_hp.setVaneSetting(vane);
-    return s_hp.update() ? 0 : -EIO;
+    heatpumpSettings s = {};
+    s.vane = vane;
+    return hp_submit_settings(HEATPUMP_FIELD_VANE, s);
 }
 
 /**
@@ -443,8 +1321,23 @@ int heatpump_set_vane(const char *vane)
 int heatpump_set_wide_vane(const char *wide_vane)
 {
     LOG_INF("Setting wide vane: %s", wide_vane);
-    s_hp.setWideVaneSetting(wide_vane);
-    return s_hp.update() ? 0 : -EIO;
+    heatpumpSettings s = {};
+    s.wideVane = wide_vane;
+    return hp_submit_settings(HEATPUMP_FIELD_WIDE_VANE, s);
+}
+
+/**
+ * @brief Feed a remote room temperature to the heat pump
+ */
+int heatpump_set_remote_temperature(hp_temp_t temperature)
+{
+    if (temperature < 0) {
+        return -EINVAL;
+    }
+    struct hp_command cmd = {};
+    cmd.type = HP_CMD_REMOTE_TEMP;
+    cmd.remote_temperature = temperature;
+    return hp_submit(&cmd, false);
 }
 
 /**
@@ -456,15 +1349,66 @@ int heatpump_update_settings(const heatpump_settings_t *settings)
         return -EINVAL;
     }
     LOG_INF("Updating all settings");
-    heatpumpSettings s;
+    return heatpump_apply_settings(settings, HEATPUMP_FIELD_ALL);
+}
+
+/**
+ * @brief Update some settings in one SET frame
+ */
+int heatpump_apply_settings(const heatpump_settings_t *settings, uint32_t fields)
+{
+    if (settings == NULL || fields == 0 || (fields & ~HEATPUMP_FIELD_ALL) != 0) {
+        return -EINVAL;
+    }
+    heatpumpSettings s = {};
     s.power = settings->power;
     s.mode = settings->mode;
     s.temperature = settings->temperature;
     s.fan = settings->fan;
     s.vane = settings->vane;
     s.wideVane = settings->wideVane;
-    s_hp.setSettings(s);
-    return s_hp.update() ? 0 : -EIO;
+    return hp_submit_settings((uint8_t)fields, s);
+}
+
+/**
+ * @brief Read a function code setting
+ */
+int heatpump_get_function(int code, int *value)
+{
+    if (value == NULL || code < FUNCTION_CODE_FIRST || code > FUNCTION_CODE_LAST) {
+        return -EINVAL;
+    }
+    struct hp_command cmd = {};
+    cmd.type = HP_CMD_FUNCTION_GET;
+    cmd.function_code = code;
+    cmd.function_out = value;
+    return hp_submit(&cmd, true);
+}
+
+/**
+ * @brief Change a function code setting
+ */
+int heatpump_set_function(int code, int value)
+{
+    if (code < FUNCTION_CODE_FIRST || code > FUNCTION_CODE_LAST || value < 1 || value > 3) {
+        return -EINVAL;
+    }
+    LOG_INF("Setting function %d: %d", code, value);
+    struct hp_command cmd = {};
+    cmd.type = HP_CMD_FUNCTION_SET;
+    cmd.function_code = code;
+    cmd.function_value = value;
+    return hp_submit(&cmd, true);
+}
+
+/**
+ * @brief Re-read all function codes from the heat pump
+ */
+int heatpump_refresh_functions(void)
+{
+    struct hp_command cmd = {};
+    cmd.type = HP_CMD_FUNCTIONS_REFRESH;
+    return hp_submit(&cmd, true);
 }
 
 /**
@@ -483,10 +1427,26 @@ void heatpump_set_status_callback(heatpump_status_callback_t callback)
     status_callback = callback;
 }
 
+/**
+ * @brief Register callback for published state changes
+ */
+void heatpump_set_state_callback(heatpump_state_callback_t callback)
+{
+    state_callback = callback;
+}
+
 /**
  * @brief Check if connected to heat pump
  */
 bool heatpump_is_connected(void)
 {
-    return s_hp.isConnected();
+    return atomic_get(&connected) != 0;
+}
+
+/**
+ * @brief Get the CN105 link health
+ */
+heatpump_link_health_e heatpump_get_link_health(void)
+{
+    return (heatpump_link_health_e)atomic_get(&link_health);
 }
@@ -14,17 +14,22 @@
  *
  * @section threading Threading Model
  *
- * Runs a dedicated Zephyr thread for periodic heat pump polling:
+ * Runs a dedicated Zephyr thread that owns the CN105 link:
+ * - Performs the handshake in the background after heatpump_init()
  * - Update interval: 100ms (configurable)
  * - Priority: 5 (configurable)
  * - Stack size: 2048 bytes (configurable)
  * - Callbacks invoked from this thread context
+ *
+ * Setters post commands to the thread through a message queue and
+ * block until the SET exchange has completed.
  */
 
 #ifndef HEATPUMP_DRIVER_H
 #define HEATPUMP_DRIVER_H
 
 #include "heatpump_types.h"
+#include "heatpump_state.h"
 #include <zephyr/kernel.h>
 
 #ifdef __cplusplus
@@ -45,11 +50,98 @@ typedef void (*heatpump_settings_callback_t)(heatpump_settings_t settings);
  */
 typedef void (*heatpump_status_callback_t)(heatpump_status_t status);
 
+/**
+ * @brief Callback function type for published state changes
+ *
+ * Called from the driver thread each time the published state changes,
+ * with the new state and the bits that changed (heatpump_state_diff()).
+ * Link and connection changes are included.
+ */
+typedef void (*heatpump_state_callback_t)(const heatpump_state_t *state,
+                                          const heatpump_state_t *changed);
+
+/**
+ * @brief Boot timing metrics
+ *
+ * All values are system uptime in milliseconds; 0 means the event has
+ * not happened yet.
+ */
+typedef struct {
+    uint32_t init_ms;         /**< heatpump_init() called */
+    uint32_t connected_ms;    /**< CN105 handshake completed */
+    uint32_t first_state_ms;  /**< First complete settings and status received */
+    uint32_t burst_ms;        /**< Duration of the initial request burst */
+} heatpump_boot_metrics_t;
+
+/**
+ * @brief Settings fields for heatpump_apply_settings()
+ */
+#define HEATPUMP_FIELD_POWER     BIT(0)
+#define HEATPUMP_FIELD_MODE      BIT(1)
+#define HEATPUMP_FIELD_TEMP      BIT(2)
+#define HEATPUMP_FIELD_FAN       BIT(3)
+#define HEATPUMP_FIELD_VANE      BIT(4)
+#define HEATPUMP_FIELD_WIDE_VANE BIT(5)
+#define HEATPUMP_FIELD_ALL       (HEATPUMP_FIELD_POWER | HEATPUMP_FIELD_MODE | \
+                                  HEATPUMP_FIELD_TEMP | HEATPUMP_FIELD_FAN | \
+                                  HEATPUMP_FIELD_VANE | HEATPUMP_FIELD_WIDE_VANE)
+
+/**
+ * @brief Driver state taken at one instant
+ */
+typedef struct {
+    heatpump_settings_t settings;        /**< As heatpump_get_settings() */
+    heatpump_status_t status;            /**< As heatpump_get_status() */
+    heatpump_timers_t timers;            /**< As heatpump_get_timers() */
+    heatpump_link_health_e link_health;  /**< As heatpump_get_link_health() */
+} heatpump_snapshot_t;
+
+/**
+ * @brief Number of CN105 frame types counted in heatpump_stats_t
+ */
+#define HEATPUMP_FRAME_TYPES 9
+
+/**
+ * @brief CN105 link and driver counters
+ *
+ * Counters run from boot or the last heatpump_reset_stats(); the queue,
+ * slab and runtime fields are instantaneous or cumulative as noted.
+ */
+typedef struct {
+    uint32_t sent[HEATPUMP_FRAME_TYPES];      /**< Frames written, by type */
+    uint32_t received[HEATPUMP_FRAME_TYPES];  /**< Valid frames read, by type */
+    uint32_t checksum_errors;   /**< Frames dropped on a bad checksum */
+    uint32_t framing_errors;    /**< Frames dropped on a bad header */
+    uint32_t timeouts;          /**< Replies missing or cut short */
+    uint32_t line_errors;       /**< UART framing, parity, overrun or break errors */
+    uint32_t connect_attempts;  /**< CONNECT handshakes started */
+    uint32_t reconnects;        /**< Link losses recovered by reconnecting */
+    uint32_t polls;             /**< Info requests sent by the poll loop */
+    uint32_t command_wait_max_ms; /**< Longest a command waited for the bus */
+    uint32_t set_confirmed;     /**< Settings writes acked and seen applied */
+    uint32_t set_unconfirmed;   /**< Settings writes acked, not checked */
+    uint32_t set_failed;        /**< Settings writes not acked or not applied */
+    uint32_t set_retries;       /**< SET frames resent */
+    uint32_t overruns[HEATPUMP_FRAME_TYPES]; /**< Deadlines passed, by the last frame sent (CONFIG_APP_LINK_WATCHDOG) */
+    uint32_t loop_overruns;     /**< Of those, loop passes that ran too long */
+    uint32_t since_ms;          /**< Uptime of the last reset */
+    uint32_t queue_used;        /**< Commands waiting now */
+    uint32_t queue_peak;        /**< Most commands ever waiting */
+    uint32_t queue_size;        /**< Command queue depth */
+    uint32_t slab_used;         /**< Packet buffers in use */
+    uint32_t slab_size;         /**< Packet buffers in total */
+    uint32_t slab_peak;         /**< Most packet buffers ever in use (CONFIG_MEM_SLAB_TRACE_MAX_UTILIZATION) */
+    uint64_t thread_cycles;     /**< Driver thread execution cycles since reset (CONFIG_THREAD_RUNTIME_STATS) */
+    uint64_t total_cycles;      /**< All threads' execution cycles since reset (CONFIG_THREAD_RUNTIME_STATS) */
+} heatpump_stats_t;
+
 /**
  * @brief Initialize the heat pump driver
  * 
  * Sets up UART communication with the heat pump via CN105,
  * initializes memory pools, and starts the periodic update thread.
+ * Returns without waiting for the heat pump; the handshake and the
+ * first full state request run on the update thread.
  * 
  * @return 0 on success, negative errno on failure
  */
@@ -67,20 +159,52 @@ int heatpump_shutdown(void);
 /**
  * @brief Connect to the heat pump
  * 
- * Establishes communication and performs initial handshake
+ * Waits for the background handshake started by heatpump_init()
  * 
- * @return 0 on success, negative errno on failure
+ * @return 0 on success, -ETIMEDOUT if the heat pump has not answered,
+ *         negative errno on other failures
  */
 int heatpump_connect(void);
 
 /**
  * @brief Synchronize with the heat pump
  * 
- * Sends sync packets and waits for response
- * Should be called periodically to maintain connection
+ * Asks the update thread to poll the heat pump now. Periodic polling
+ * runs on its own; calling this is optional.
  */
 void heatpump_sync(void);
 
+/**
+ * @brief Get boot timing metrics
+ *
+ * @param metrics Pointer to metrics structure to fill
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_get_boot_metrics(heatpump_boot_metrics_t *metrics);
+
+/**
+ * @brief Get CN105 link and driver counters
+ *
+ * @param stats Pointer to stats structure to fill
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_get_stats(heatpump_stats_t *stats);
+
+/**
+ * @brief Reset the counters returned by heatpump_get_stats()
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_reset_stats(void);
+
+/**
+ * @brief Get the name of a frame type counted in heatpump_stats_t
+ *
+ * @param type Index into heatpump_stats_t::sent / ::received
+ * @return Short name, "?" for an unknown type
+ */
+const char *heatpump_frame_type_name(int type);
+
 /**
  * @brief Get current heat pump settings
  * 
@@ -97,6 +221,29 @@ int heatpump_get_settings(heatpump_settings_t *settings);
  */
 int heatpump_get_status(heatpump_status_t *status);
 
+/**
+ * @brief Get the packed driver state
+ *
+ * The cheapest way to read the state: two words copied without a lock
+ * and without string conversion. See heatpump_state.h for the fields.
+ *
+ * @param state Pointer to state to fill
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_get_state(heatpump_state_t *state);
+
+/**
+ * @brief Get settings, status, timers and link health in one consistent copy
+ *
+ * Served from the state the driver thread publishes after every
+ * exchange, without touching the bus. Attribute reads use this instead
+ * of keeping their own copy.
+ *
+ * @param snapshot Pointer to snapshot structure to fill
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_get_snapshot(heatpump_snapshot_t *snapshot);
+
 /**
  * @brief Get current heat pump timers
  * 
@@ -124,10 +271,11 @@ int heatpump_set_mode(const char *mode);
 /**
  * @brief Set target temperature
  * 
- * @param temperature Temperature in Celsius (16-31°C)
+ * @param temperature Temperature in 0.01°C (16-31°C), rounded to the
+ *                    unit's whole or half degree steps
  * @return 0 on success, negative errno on failure
  */
-int heatpump_set_temperature(float temperature);
+int heatpump_set_temperature(hp_temp_t temperature);
 
 /**
  * @brief Set fan speed
@@ -153,6 +301,19 @@ int heatpump_set_vane(const char *vane);
  */
 int heatpump_set_wide_vane(const char *wide_vane);
 
+/**
+ * @brief Feed a remote room temperature to the heat pump
+ *
+ * The reading is queued and sent as a 0x07 frame in the next free
+ * protocol slot; it does not block the caller. A newer value replaces
+ * one that has not been sent yet.
+ *
+ * @param temperature Room temperature in 0.01°C, or 0 to revert the
+ *                    unit to its internal sensor
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_set_remote_temperature(hp_temp_t temperature);
+
 /**
  * @brief Update all settings at once
  * 
@@ -163,6 +324,52 @@ int heatpump_set_wide_vane(const char *wide_vane);
  */
 int heatpump_update_settings(const heatpump_settings_t *settings);
 
+/**
+ * @brief Update some settings in one SET frame
+ *
+ * Only the fields selected in @a fields are read from @a settings and
+ * written; the others keep the unit's current value.
+ *
+ * @param settings Settings to apply
+ * @param fields HEATPUMP_FIELD_* mask
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_apply_settings(const heatpump_settings_t *settings, uint32_t fields);
+
+/**
+ * @brief Read a function code setting
+ *
+ * Function codes are read from the heat pump once and then served from
+ * a cache (kept in flash with CONFIG_APP_HEATPUMP_PERSIST), so this
+ * only causes bus traffic the first time.
+ *
+ * @param code Function code (101-128)
+ * @param value Receives the setting (1-3), or 0 if the unit does not
+ *              report this code
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_get_function(int code, int *value);
+
+/**
+ * @brief Change a function code setting
+ *
+ * Only the half of the function block (0x1F or 0x21 frame) that
+ * contains the code is written, and nothing is sent if the value is
+ * already set.
+ *
+ * @param code Function code (101-128)
+ * @param value New setting (1-3)
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_set_function(int code, int value);
+
+/**
+ * @brief Re-read all function codes from the heat pump
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int heatpump_refresh_functions(void);
+
 /**
  * @brief Register callback for settings changes
  * 
@@ -177,6 +384,13 @@ void heatpump_set_settings_callback(heatpump_settings_callback_t callback);
  */
 void heatpump_set_status_callback(heatpump_status_callback_t callback);
 
+/**
+ * @brief Register callback for published state changes
+ *
+ * @param callback Function to call with the new state and the changed bits
+ */
+void heatpump_set_state_callback(heatpump_state_callback_t callback);
+
 /**
  * @brief Check if connected to heat pump
  * 
@@ -184,19 +398,31 @@ void heatpump_set_status_callback(heatpump_status_callback_t callback);
  */
 bool heatpump_is_connected(void);
 
+/**
+ * @brief Get the CN105 link health
+ *
+ * Classified from the last few exchanges: down after three failed in a
+ * row (the driver reconnects at once), degraded with two failures among
+ * the last eight (polls run at half rate). UART framing, parity and
+ * overrun errors count as failures.
+ *
+ * @return HP_LINK_HEALTHY, HP_LINK_DEGRADED or HP_LINK_DOWN
+ */
+heatpump_link_health_e heatpump_get_link_health(void);
+
 /**
  * @section pool_config Memory Pool Configuration
  *
  * The driver uses a Zephyr memory pool for packet buffer allocation.
- * Configuration parameters in heatpump_driver.cpp:
  *
- * - PACKET_BUFFER_SIZE: Size of each buffer (default 64 bytes)
- * - NUM_PACKET_BUFFERS: Number of pre-allocated buffers (default 4)
+ * - PACKET_BUFFER_SIZE: Size of each buffer (64 bytes, heatpump_driver.cpp)
+ * - CONFIG_APP_HEATPUMP_PACKET_BUFFERS: Number of pre-allocated buffers
+ *   (default 4)
  *
  * To customize these values:
- * 1. Edit the #define values in heatpump_driver.cpp
- * 2. Adjust based on your application's packet throughput
- * 3. Monitor with pool statistics via logging/debug interface
+ * 1. Check the peak usage with the 'heatpump resources' shell command
+ *    or the periodic resource report in the log
+ * 2. Set CONFIG_APP_HEATPUMP_PACKET_BUFFERS to the suggested value
  *
  * Benefits of memory pools:
  * - Deterministic allocation time (O(1))
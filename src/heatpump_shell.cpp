@@ -0,0 +1,191 @@
+/**
+ * @file heatpump_shell.cpp
+ * @brief Zephyr shell commands for the heat pump driver
+ *
+ * Provides the `heatpump` command root for inspecting a running unit
+ * without a debugger:
+ * - `heatpump stats`: frame, error, queue and thread counters
+ * - `heatpump reset`: clear the counters
+ * - `heatpump watch [seconds|off]`: print a one-line delta periodically
+ *
+ * Other modules add their own subcommands with SHELL_SUBCMD_ADD().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include "heatpump_driver.h"
+
+#define WATCH_DEFAULT_S 5
+
+/* Watch mode state, only touched from the system workqueue once started */
+static struct k_work_delayable watch_work;
+static const struct shell *watch_shell;
+static uint32_t watch_interval_s;
+static heatpump_stats_t watch_prev;
+static uint32_t watch_prev_ms;
+static bool watch_initialized;
+
+static uint32_t stats_total(const uint32_t counts[HEATPUMP_FRAME_TYPES])
+{
+    uint32_t total = 0;
+
+    for (int i = 0; i < HEATPUMP_FRAME_TYPES; i++) {
+        total += counts[i];
+    }
+    return total;
+}
+
+/**
+ * @brief Share of @a whole taken by @a part, in tenths of a percent
+ */
+static inline uint32_t permille(uint64_t part, uint64_t whole)
+{
+    return whole > 0 ? (uint32_t)(part * 1000U / whole) : 0;
+}
+
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    heatpump_stats_t st;
+    heatpump_get_stats(&st);
+
+    uint32_t elapsed_ms = k_uptime_get_32() - st.since_ms;
+
+    static const char *const health[] = { "healthy", "degraded", "down" };
+    shell_print(sh, "link:        %s", health[heatpump_get_link_health()]);
+    shell_print(sh, "window:      %u s", elapsed_ms / 1000U);
+    shell_print(sh, "%-12s %8s %8s %8s", "frame", "sent", "recv", "stuck");
+    for (int i = 0; i < HEATPUMP_FRAME_TYPES; i++) {
+        if (st.sent[i] == 0 && st.received[i] == 0 && st.overruns[i] == 0) {
+            continue;
+        }
+        shell_print(sh, "%-12s %8u %8u %8u", heatpump_frame_type_name(i), st.sent[i], st.received[i],
+                    st.overruns[i]);
+    }
+    shell_print(sh, "%-12s %8u %8u %8u", "total", stats_total(st.sent), stats_total(st.received),
+                stats_total(st.overruns));
+    shell_print(sh, "checksum:    %u", st.checksum_errors);
+    shell_print(sh, "framing:     %u", st.framing_errors);
+    shell_print(sh, "timeouts:    %u", st.timeouts);
+    shell_print(sh, "line errors: %u", st.line_errors);
+    shell_print(sh, "connects:    %u (%u reconnects)", st.connect_attempts, st.reconnects);
+    shell_print(sh, "poll rate:   %u/min",
+                elapsed_ms > 0 ? (uint32_t)((uint64_t)st.polls * 60000U / elapsed_ms) : 0);
+    shell_print(sh, "cmd wait:    %u ms max", st.command_wait_max_ms);
+    shell_print(sh, "deadlines:   %u overruns (%u loop)", stats_total(st.overruns), st.loop_overruns);
+    shell_print(sh, "writes:      %u confirmed, %u unconfirmed, %u failed (%u resends)",
+                st.set_confirmed, st.set_unconfirmed, st.set_failed, st.set_retries);
+    shell_print(sh, "queue:       %u/%u (peak %u)", st.queue_used, st.queue_size, st.queue_peak);
+    shell_print(sh, "packet slab: %u/%u", st.slab_used, st.slab_size);
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+    uint32_t cpu = permille(st.thread_cycles, st.total_cycles);
+    shell_print(sh, "thread cpu:  %u.%u%% (%llu cycles)", cpu / 10U, cpu % 10U,
+                (unsigned long long)st.thread_cycles);
+#else
+    shell_print(sh, "thread cpu:  n/a (CONFIG_THREAD_RUNTIME_STATS disabled)");
+#endif
+    return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    int ret = heatpump_reset_stats();
+    if (ret) {
+        shell_error(sh, "Reset failed: %d", ret);
+        return ret;
+    }
+    if (watch_shell) {
+        heatpump_get_stats(&watch_prev);
+        watch_prev_ms = k_uptime_get_32();
+    }
+    shell_print(sh, "Counters cleared");
+    return 0;
+}
+
+/**
+ * @brief Print the change since the previous watch line
+ */
+static void watch_print(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    const struct shell *sh = watch_shell;
+    if (sh == NULL) {
+        return;
+    }
+
+    heatpump_stats_t st;
+    heatpump_get_stats(&st);
+    uint32_t now = k_uptime_get_32();
+    uint32_t elapsed_ms = MAX(now - watch_prev_ms, 1U);
+
+    uint32_t polls = st.polls - watch_prev.polls;
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+    uint32_t cpu = permille(st.thread_cycles - watch_prev.thread_cycles,
+                            st.total_cycles - watch_prev.total_cycles);
+#else
+    uint32_t cpu = 0;
+#endif
+
+    shell_print(sh, "tx %u rx %u crc %u frm %u to %u rc %u poll %u/min q %u/%u slab %u cpu %u.%u%%",
+                stats_total(st.sent) - stats_total(watch_prev.sent),
+                stats_total(st.received) - stats_total(watch_prev.received),
+                st.checksum_errors - watch_prev.checksum_errors,
+                st.framing_errors - watch_prev.framing_errors,
+                st.timeouts - watch_prev.timeouts,
+                st.reconnects - watch_prev.reconnects,
+                (uint32_t)((uint64_t)polls * 60000U / elapsed_ms),
+                st.queue_used, st.queue_peak, st.slab_used,
+                cpu / 10U, cpu % 10U);
+
+    watch_prev = st;
+    watch_prev_ms = now;
+    k_work_schedule(&watch_work, K_SECONDS(watch_interval_s));
+}
+
+static int cmd_watch(const struct shell *sh, size_t argc, char **argv)
+{
+    if (!watch_initialized) {
+        k_work_init_delayable(&watch_work, watch_print);
+        watch_initialized = true;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "off") == 0) {
+        watch_shell = NULL;
+        k_work_cancel_delayable(&watch_work);
+        shell_print(sh, "Watch stopped");
+        return 0;
+    }
+
+    uint32_t interval = WATCH_DEFAULT_S;
+    if (argc > 1) {
+        interval = (uint32_t)strtoul(argv[1], NULL, 10);
+        if (interval == 0) {
+            shell_error(sh, "Invalid interval: %s", argv[1]);
+            return -EINVAL;
+        }
+    }
+
+    heatpump_get_stats(&watch_prev);
+    watch_prev_ms = k_uptime_get_32();
+    watch_interval_s = interval;
+    watch_shell = sh;
+    k_work_reschedule(&watch_work, K_SECONDS(interval));
+    shell_print(sh, "Watching every %u s, 'heatpump watch off' to stop", interval);
+    return 0;
+}
+
+SHELL_SUBCMD_SET_CREATE(heatpump_cmds, (heatpump));
+SHELL_CMD_REGISTER(heatpump, &heatpump_cmds, "Heat pump driver commands", NULL);
+
+SHELL_SUBCMD_ADD((heatpump), stats, NULL, "Show CN105 link and driver counters", cmd_stats, 1, 0);
+SHELL_SUBCMD_ADD((heatpump), reset, NULL, "Clear the counters", cmd_reset, 1, 0);
+SHELL_SUBCMD_ADD((heatpump), watch, NULL, "Print counter deltas periodically: watch [seconds|off]",
+                 cmd_watch, 1, 1);
@@ -0,0 +1,427 @@
+/**
+ * @file history.cpp
+ * @brief On-device history of room temperature, setpoint and compressor
+ *
+ * A sampler on the system workqueue snapshots the driver state every
+ * 10 seconds. Each sample is appended to the 10 s tier and added to the
+ * running averages of the coarser tiers, which are appended when their
+ * period boundary is crossed. Nothing is recomputed from older samples,
+ * so the finer tiers can wrap without affecting the coarser ones.
+ */
+
+#include "history.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "heatpump_driver.h"
+#ifdef CONFIG_SHELL
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(history, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define HISTORY_BLOCK_SIZE     64
+#define HISTORY_BLOCK_HEADER   8
+#define HISTORY_BLOCK_DATA     (HISTORY_BLOCK_SIZE - HISTORY_BLOCK_HEADER)
+#define HISTORY_CHANNELS       4
+/* Worst case: four 16-bit zigzag values at 3 bytes each */
+#define HISTORY_RECORD_MAX     (HISTORY_CHANNELS * 3)
+
+#define HISTORY_EXPORT_VERSION 1
+#define HISTORY_EXPORT_HEADER  8
+
+/**
+ * @brief One encoded block: absolute values followed by deltas
+ *
+ * Samples are implicitly spaced by the tier period starting at t0.
+ */
+struct history_block {
+    uint32_t t0;       /* Uptime in seconds of the first sample */
+    uint16_t count;    /* Samples in the block */
+    uint8_t used;      /* Bytes of data[] in use */
+    uint8_t reserved;
+    uint8_t data[HISTORY_BLOCK_DATA];
+};
+
+BUILD_ASSERT(sizeof(struct history_block) == HISTORY_BLOCK_SIZE, "history block must be packed");
+
+/**
+ * @brief Running average feeding a tier
+ */
+struct history_accumulator {
+    uint32_t start;    /* Period start, uptime in seconds */
+    uint32_t count;
+    int32_t sum[HISTORY_CHANNELS];
+};
+
+struct history_tier {
+    struct history_block *blocks;
+    uint16_t num_blocks;
+    uint16_t head;     /* Index of the newest block */
+    uint16_t used;     /* Blocks holding data */
+    uint32_t period_s;
+    int32_t last[HISTORY_CHANNELS];  /* Last values appended, for deltas */
+    struct history_accumulator acc;
+};
+
+static struct history_block blocks_10s[CONFIG_APP_HISTORY_10S_BLOCKS];
+static struct history_block blocks_5min[CONFIG_APP_HISTORY_5MIN_BLOCKS];
+static struct history_block blocks_1h[CONFIG_APP_HISTORY_1H_BLOCKS];
+
+static struct history_tier tiers[HISTORY_TIER_COUNT] = {
+    { blocks_10s, CONFIG_APP_HISTORY_10S_BLOCKS, 0, 0, 10, {0}, {0} },
+    { blocks_5min, CONFIG_APP_HISTORY_5MIN_BLOCKS, 0, 0, 300, {0}, {0} },
+    { blocks_1h, CONFIG_APP_HISTORY_1H_BLOCKS, 0, 0, 3600, {0}, {0} },
+};
+
+static K_MUTEX_DEFINE(history_lock);
+static struct k_work_delayable sample_work;
+
+static inline uint32_t zigzag_encode(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t varint_put(uint8_t *buf, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t varint_get(const uint8_t *buf, size_t len, uint32_t *v)
+{
+    uint32_t result = 0;
+    for (size_t n = 0; n < len && n < 5; n++) {
+        result |= (uint32_t)(buf[n] & 0x7f) << (7 * n);
+        if (!(buf[n] & 0x80)) {
+            *v = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static void sample_to_values(const history_sample_t *s, int32_t values[HISTORY_CHANNELS])
+{
+    /* Stored in 0.1°C, which keeps half-degree steps to one delta byte */
+    values[0] = s->room_temp / 10;
+    values[1] = s->setpoint / 10;
+    values[2] = s->compressor_freq;
+    values[3] = s->operating_pct;
+}
+
+static void values_to_sample(const int32_t values[HISTORY_CHANNELS], uint32_t time_s,
+                             history_sample_t *s)
+{
+    s->time_s = time_s;
+    s->room_temp = (int16_t)(values[0] * 10);
+    s->setpoint = (int16_t)(values[1] * 10);
+    s->compressor_freq = (uint8_t)values[2];
+    s->operating_pct = (uint8_t)values[3];
+}
+
+/**
+ * @brief Append a sample to a tier
+ *
+ * Continues the newest block if the sample follows it at the tier
+ * period and fits, otherwise starts a new block with absolute values.
+ */
+static void history_append(struct history_tier *tier, uint32_t time_s,
+                           const int32_t values[HISTORY_CHANNELS])
+{
+    struct history_block *blk = &tier->blocks[tier->head];
+    bool contiguous = tier->used > 0 &&
+                      time_s == blk->t0 + blk->count * tier->period_s &&
+                      blk->used + HISTORY_RECORD_MAX <= HISTORY_BLOCK_DATA;
+
+    if (!contiguous) {
+        if (tier->used > 0) {
+            tier->head = (tier->head + 1) % tier->num_blocks;
+        }
+        if (tier->used < tier->num_blocks) {
+            tier->used++;
+        }
+        blk = &tier->blocks[tier->head];
+        blk->t0 = time_s;
+        blk->count = 0;
+        blk->used = 0;
+        memset(tier->last, 0, sizeof(tier->last));
+    }
+
+    for (int i = 0; i < HISTORY_CHANNELS; i++) {
+        blk->used += varint_put(&blk->data[blk->used], zigzag_encode(values[i] - tier->last[i]));
+        tier->last[i] = values[i];
+    }
+    blk->count++;
+}
+
+/**
+ * @brief Add a sample to a tier's running average
+ *
+ * Closes the average into the tier when @a time_s falls in a new period.
+ */
+static void history_accumulate(history_tier_e idx, uint32_t time_s,
+                               const int32_t values[HISTORY_CHANNELS])
+{
+    struct history_tier *tier = &tiers[idx];
+    struct history_accumulator *acc = &tier->acc;
+    uint32_t start = time_s - time_s % tier->period_s;
+
+    if (acc->count > 0 && acc->start != start) {
+        int32_t avg[HISTORY_CHANNELS];
+        for (int i = 0; i < HISTORY_CHANNELS; i++) {
+            int32_t half = (acc->sum[i] >= 0 ? 1 : -1) * (int32_t)(acc->count / 2);
+            avg[i] = (acc->sum[i] + half) / (int32_t)acc->count;
+        }
+        history_append(tier, acc->start, avg);
+        if (idx + 1 < HISTORY_TIER_COUNT) {
+            history_accumulate((history_tier_e)(idx + 1), acc->start, avg);
+        }
+        acc->count = 0;
+    }
+
+    if (acc->count == 0) {
+        acc->start = start;
+        memset(acc->sum, 0, sizeof(acc->sum));
+    }
+    for (int i = 0; i < HISTORY_CHANNELS; i++) {
+        acc->sum[i] += values[i];
+    }
+    acc->count++;
+}
+
+/**
+ * @brief Snapshot the driver state into the 10 s tier
+ *
+ * Nothing is recorded while the link is down or the state is still the
+ * unconfirmed copy restored from flash; the gap starts a new block.
+ */
+static void history_sample(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    /* Aim for the middle of the next period so workqueue latency never
+     * skips or doubles a slot, which would split the block */
+    uint32_t period_ms = tiers[HISTORY_TIER_10S].period_s * 1000U;
+    int64_t uptime = k_uptime_get();
+    k_work_schedule(&sample_work, K_MSEC(period_ms - uptime % period_ms + period_ms / 2));
+
+    heatpump_settings_t settings;
+    heatpump_status_t status;
+    if (!heatpump_is_connected() ||
+        heatpump_get_settings(&settings) != 0 || settings.stale ||
+        heatpump_get_status(&status) != 0 || status.stale) {
+        return;
+    }
+
+    history_sample_t sample;
+    sample.room_temp = status.roomTemperature;
+    sample.setpoint = settings.temperature;
+    sample.compressor_freq = (uint8_t)CLAMP(status.compressorFrequency, 0, UINT8_MAX);
+    sample.operating_pct = status.operating ? 100 : 0;
+
+    int32_t values[HISTORY_CHANNELS];
+    sample_to_values(&sample, values);
+
+    uint32_t now = (uint32_t)(uptime / 1000);
+    now -= now % tiers[HISTORY_TIER_10S].period_s;
+
+    k_mutex_lock(&history_lock, K_FOREVER);
+    history_append(&tiers[HISTORY_TIER_10S], now, values);
+    history_accumulate(HISTORY_TIER_5MIN, now, values);
+    k_mutex_unlock(&history_lock);
+}
+
+/**
+ * @brief Initialize history and start sampling
+ */
+int history_init(void)
+{
+    LOG_INF("Initializing history (%u bytes)",
+            (unsigned)(sizeof(blocks_10s) + sizeof(blocks_5min) + sizeof(blocks_1h)));
+
+    k_work_init_delayable(&sample_work, history_sample);
+    k_work_schedule(&sample_work, K_SECONDS(tiers[HISTORY_TIER_10S].period_s));
+    return 0;
+}
+
+/**
+ * @brief Get the sample period of a tier
+ */
+uint32_t history_period_s(history_tier_e tier)
+{
+    if (tier >= HISTORY_TIER_COUNT) {
+        return 0;
+    }
+    return tiers[tier].period_s;
+}
+
+/**
+ * @brief Visit samples of a tier, oldest first
+ */
+int history_for_each(history_tier_e idx, uint32_t since_s,
+                     history_visit_cb_t cb, void *user_data)
+{
+    if (idx >= HISTORY_TIER_COUNT || cb == NULL) {
+        return -EINVAL;
+    }
+
+    struct history_tier *tier = &tiers[idx];
+    int visited = 0;
+
+    k_mutex_lock(&history_lock, K_FOREVER);
+    uint16_t first = (tier->head + tier->num_blocks - tier->used + 1) % tier->num_blocks;
+    for (uint16_t b = 0; b < tier->used; b++) {
+        const struct history_block *blk = &tier->blocks[(first + b) % tier->num_blocks];
+        if (blk->t0 + blk->count * tier->period_s <= since_s) {
+            continue;
+        }
+
+        int32_t values[HISTORY_CHANNELS] = {0};
+        size_t pos = 0;
+        for (uint16_t n = 0; n < blk->count; n++) {
+            for (int i = 0; i < HISTORY_CHANNELS; i++) {
+                uint32_t raw;
+                size_t len = varint_get(&blk->data[pos], blk->used - pos, &raw);
+                if (len == 0) {
+                    k_mutex_unlock(&history_lock);
+                    return -EIO;
+                }
+                pos += len;
+                values[i] += zigzag_decode(raw);
+            }
+
+            uint32_t time_s = blk->t0 + n * tier->period_s;
+            if (time_s < since_s) {
+                continue;
+            }
+            history_sample_t sample;
+            values_to_sample(values, time_s, &sample);
+            visited++;
+            if (!cb(&sample, user_data)) {
+                k_mutex_unlock(&history_lock);
+                return visited;
+            }
+        }
+    }
+    k_mutex_unlock(&history_lock);
+
+    return visited;
+}
+
+static void put_le16(uint8_t *buf, uint16_t v)
+{
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *buf, uint32_t v)
+{
+    put_le16(buf, (uint16_t)v);
+    put_le16(buf + 2, (uint16_t)(v >> 16));
+}
+
+/**
+ * @brief Export a tier in its encoded form
+ */
+int history_export(history_tier_e idx, uint32_t since_s, uint8_t *buf, size_t len)
+{
+    if (idx >= HISTORY_TIER_COUNT || buf == NULL) {
+        return -EINVAL;
+    }
+    if (len < HISTORY_EXPORT_HEADER) {
+        return -ENOSPC;
+    }
+
+    struct history_tier *tier = &tiers[idx];
+
+    buf[0] = HISTORY_EXPORT_VERSION;
+    buf[1] = (uint8_t)idx;
+    put_le16(&buf[2], (uint16_t)tier->period_s);
+    put_le32(&buf[4], (uint32_t)(k_uptime_get() / 1000));
+    size_t pos = HISTORY_EXPORT_HEADER;
+
+    k_mutex_lock(&history_lock, K_FOREVER);
+    uint16_t first = (tier->head + tier->num_blocks - tier->used + 1) % tier->num_blocks;
+    for (uint16_t b = 0; b < tier->used; b++) {
+        const struct history_block *blk = &tier->blocks[(first + b) % tier->num_blocks];
+        if (blk->t0 + blk->count * tier->period_s <= since_s) {
+            continue;
+        }
+        size_t size = HISTORY_BLOCK_HEADER - 1 + blk->used;
+        if (pos + size > len) {
+            break;
+        }
+        put_le32(&buf[pos], blk->t0);
+        put_le16(&buf[pos + 4], blk->count);
+        buf[pos + 6] = blk->used;
+        memcpy(&buf[pos + 7], blk->data, blk->used);
+        pos += size;
+    }
+    k_mutex_unlock(&history_lock);
+
+    return (int)pos;
+}
+
+#ifdef CONFIG_SHELL
+static bool history_print_sample(const history_sample_t *sample, void *user_data)
+{
+    const struct shell *sh = (const struct shell *)user_data;
+
+    shell_print(sh, "%10u  %3d.%d  %3d.%d  %3u  %3u%%",
+                sample->time_s,
+                sample->room_temp / 100, abs(sample->room_temp % 100) / 10,
+                sample->setpoint / 100, abs(sample->setpoint % 100) / 10,
+                sample->compressor_freq, sample->operating_pct);
+    return true;
+}
+
+static int cmd_history(const struct shell *sh, size_t argc, char **argv)
+{
+    history_tier_e tier = HISTORY_TIER_10S;
+    uint32_t count = 30;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "10s") == 0) {
+            tier = HISTORY_TIER_10S;
+        } else if (strcmp(argv[1], "5m") == 0) {
+            tier = HISTORY_TIER_5MIN;
+        } else if (strcmp(argv[1], "1h") == 0) {
+            tier = HISTORY_TIER_1H;
+        } else {
+            shell_error(sh, "Unknown resolution: %s", argv[1]);
+            return -EINVAL;
+        }
+    }
+    if (argc > 2) {
+        count = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+
+    uint32_t now = (uint32_t)(k_uptime_get() / 1000);
+    uint32_t span = count * tiers[tier].period_s;
+    uint32_t since = now > span ? now - span : 0;
+
+    shell_print(sh, "    uptime   room    set  freq  op");
+    int ret = history_for_each(tier, since, history_print_sample, (void *)sh);
+    if (ret < 0) {
+        shell_error(sh, "History read failed: %d", ret);
+        return ret;
+    }
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((heatpump), history, NULL,
+                 "Show history: history [10s|5m|1h] [count]",
+                 cmd_history, 1, 2);
+#endif /* CONFIG_SHELL */
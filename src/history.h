@@ -0,0 +1,105 @@
+/**
+ * @file history.h
+ * @brief On-device history of room temperature, setpoint and compressor
+ *
+ * Samples the heat pump state every 10 seconds and keeps it at three
+ * resolutions (10 s, 5 min and 1 h) in fixed RAM rings. The coarser
+ * tiers are averaged incrementally as samples arrive, so a controller
+ * that lost its connection can backfill the gap with a single bulk
+ * read instead of holding a subscription open.
+ *
+ * Each tier is a ring of small blocks. A block starts with absolute
+ * values and continues with zigzag varint deltas at the tier period,
+ * which typically costs 4-5 bytes per sample. A gap in sampling (link
+ * down) starts a new block; when the ring is full the oldest block is
+ * dropped.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief History resolutions
+ */
+typedef enum {
+    HISTORY_TIER_10S = 0,   /**< 10 second samples */
+    HISTORY_TIER_5MIN,      /**< 5 minute averages */
+    HISTORY_TIER_1H,        /**< 1 hour averages */
+    HISTORY_TIER_COUNT
+} history_tier_e;
+
+/**
+ * @brief One history sample
+ */
+typedef struct {
+    uint32_t time_s;          /**< Uptime in seconds at the start of the period */
+    int16_t room_temp;        /**< Room temperature, 0.01°C (0.1°C resolution) */
+    int16_t setpoint;         /**< Target temperature, 0.01°C (0.1°C resolution) */
+    uint8_t compressor_freq;  /**< Compressor frequency, Hz */
+    uint8_t operating_pct;    /**< Share of the period spent operating, % */
+} history_sample_t;
+
+/**
+ * @brief Callback for history_for_each()
+ *
+ * @return true to continue, false to stop
+ */
+typedef bool (*history_visit_cb_t)(const history_sample_t *sample, void *user_data);
+
+/**
+ * @brief Initialize history and start sampling
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int history_init(void);
+
+/**
+ * @brief Get the sample period of a tier
+ *
+ * @param tier History tier
+ * @return Period in seconds, 0 for an invalid tier
+ */
+uint32_t history_period_s(history_tier_e tier);
+
+/**
+ * @brief Visit samples of a tier, oldest first
+ *
+ * @param tier History tier
+ * @param since_s Skip samples older than this uptime (seconds)
+ * @param cb Called for each sample
+ * @param user_data Passed to @a cb
+ * @return Number of samples visited, negative errno on failure
+ */
+int history_for_each(history_tier_e tier, uint32_t since_s,
+                     history_visit_cb_t cb, void *user_data);
+
+/**
+ * @brief Export a tier in its encoded form
+ *
+ * Produces the payload of the ReadHistory vendor command: a header
+ * followed by the encoded blocks that contain samples at or after
+ * @a since_s, oldest first. Blocks that do not fit in @a len are left
+ * out; the caller can page by asking again from the last time received.
+ * The format is described in docs/MATTER_CLUSTERS.md.
+ *
+ * @param tier History tier
+ * @param since_s Oldest uptime of interest (seconds)
+ * @param buf Output buffer
+ * @param len Size of @a buf
+ * @return Number of bytes written, negative errno on failure
+ */
+int history_export(history_tier_e tier, uint32_t since_s, uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HISTORY_H */
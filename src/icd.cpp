@@ -0,0 +1,225 @@
+/**
+ * @file icd.cpp
+ * @brief Intermittently Connected Device policy
+ *
+ * Active mode is kept as the uptime at which it ends, so activity from
+ * any thread only moves a deadline. The driver thread applies the
+ * transitions in icd_poll(): without the Matter SDK it sets the Thread
+ * poll period itself, the fast poll interval while active and the CN105
+ * window interval plus a guard while idle. With the SDK the ICD manager
+ * sets them from CONFIG_CHIP_ICD_*, which should match.
+ */
+
+#include "icd.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "heatpump_driver.h"
+#ifdef CONFIG_NET_L2_OPENTHREAD
+#include <zephyr/net/openthread.h>
+#include <openthread/link.h>
+#endif
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(icd, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* The idle Thread poll period runs this much longer than the CN105
+ * window interval, so the data request of a window always comes first */
+#define ICD_POLL_GUARD_MS 500
+
+static struct k_spinlock icd_lock;
+static int64_t active_until;  /* Uptime at which active mode ends, guarded by icd_lock */
+
+/* Written by the driver thread only */
+static bool active;
+static int64_t active_since;
+static icd_stats_t stats;
+
+/**
+ * @brief Start active mode, or extend it to at least the threshold
+ *
+ * @return true if this started active mode
+ */
+static bool icd_extend(int64_t now)
+{
+    k_spinlock_key_t key = k_spin_lock(&icd_lock);
+    bool started = now >= active_until;
+
+    if (started) {
+        active_until = now + CONFIG_APP_ICD_ACTIVE_MODE_DURATION_MS;
+    } else if (active_until < now + CONFIG_APP_ICD_ACTIVE_MODE_THRESHOLD_MS) {
+        active_until = now + CONFIG_APP_ICD_ACTIVE_MODE_THRESHOLD_MS;
+    }
+    k_spin_unlock(&icd_lock, key);
+    return started;
+}
+
+#ifdef CONFIG_NET_L2_OPENTHREAD
+static void icd_set_poll_period(uint32_t period_ms)
+{
+#ifndef CONFIG_CHIP
+    struct openthread_context *ot = openthread_get_default_context();
+
+    if (ot == NULL) {
+        return;
+    }
+    openthread_api_mutex_lock(ot);
+    otError err = otLinkSetPollPeriod(ot->instance, period_ms);
+    openthread_api_mutex_unlock(ot);
+    if (err != OT_ERROR_NONE) {
+        LOG_WRN("Thread poll period %u ms not set: %d", period_ms, err);
+    }
+#else
+    ARG_UNUSED(period_ms);
+#endif
+}
+#endif
+
+/**
+ * @brief Initialize the ICD policy
+ */
+int icd_init(void)
+{
+    int64_t now = k_uptime_get();
+
+    /* Commissioning and the first reports happen right after boot */
+    icd_extend(now);
+    active = true;
+    active_since = now;
+    stats.active_periods = 1;
+
+#ifdef CONFIG_NET_L2_OPENTHREAD
+    icd_set_poll_period(CONFIG_APP_ICD_FAST_POLL_INTERVAL_MS);
+#ifdef CONFIG_APP_ICD_CSL_PERIOD_MS
+    struct openthread_context *ot = openthread_get_default_context();
+
+    if (ot != NULL) {
+        openthread_api_mutex_lock(ot);
+        /* Downlink frames arrive in CSL slots, without waiting for a poll */
+        otError err = otLinkSetCslPeriod(ot->instance, CONFIG_APP_ICD_CSL_PERIOD_MS * 1000U);
+        openthread_api_mutex_unlock(ot);
+        if (err != OT_ERROR_NONE) {
+            LOG_WRN("CSL period not set: %d", err);
+        }
+    }
+#endif
+#endif
+
+    LOG_INF("ICD: windows every %d ms, active for %d ms after activity",
+            CONFIG_APP_ICD_SLOW_POLL_INTERVAL_MS, CONFIG_APP_ICD_ACTIVE_MODE_DURATION_MS);
+    return 0;
+}
+
+/**
+ * @brief Report activity from outside the driver thread
+ */
+void icd_notify_activity(void)
+{
+    if (icd_extend(k_uptime_get())) {
+        /* The driver sleeps until its next idle window otherwise */
+        heatpump_sync();
+    }
+}
+
+/**
+ * @brief Evaluate the mode on the driver thread
+ */
+bool icd_poll(bool activity)
+{
+    int64_t now = k_uptime_get();
+
+    if (activity) {
+        icd_extend(now);
+    }
+
+    bool now_active = icd_is_active();
+    if (now_active == active) {
+        return active;
+    }
+
+    active = now_active;
+    if (active) {
+        active_since = now;
+        stats.active_periods++;
+        LOG_DBG("ICD active");
+    } else {
+        stats.active_ms += (uint32_t)(now - active_since);
+        LOG_DBG("ICD idle after %u ms", (uint32_t)(now - active_since));
+    }
+
+#ifdef CONFIG_NET_L2_OPENTHREAD
+    icd_set_poll_period(active ? CONFIG_APP_ICD_FAST_POLL_INTERVAL_MS
+                               : CONFIG_APP_ICD_SLOW_POLL_INTERVAL_MS + ICD_POLL_GUARD_MS);
+#endif
+    return active;
+}
+
+/**
+ * @brief Check whether the device is in active mode
+ */
+bool icd_is_active(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&icd_lock);
+    bool result = k_uptime_get() < active_until;
+    k_spin_unlock(&icd_lock, key);
+    return result;
+}
+
+/**
+ * @brief Close an idle-mode CN105 window
+ */
+void icd_idle_window_done(void)
+{
+    stats.idle_windows++;
+
+#ifdef CONFIG_NET_L2_OPENTHREAD
+    struct openthread_context *ot = openthread_get_default_context();
+
+    if (ot == NULL) {
+        return;
+    }
+    openthread_api_mutex_lock(ot);
+    otError err = otLinkSendDataRequest(ot->instance);
+    openthread_api_mutex_unlock(ot);
+    if (err == OT_ERROR_NONE) {
+        stats.parent_polls++;
+    }
+#endif
+}
+
+/**
+ * @brief Get the ICD counters
+ */
+void icd_get_stats(icd_stats_t *out)
+{
+    *out = stats;
+    if (active) {
+        out->active_ms += (uint32_t)(k_uptime_get() - active_since);
+    }
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_icd(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    icd_stats_t s;
+    icd_get_stats(&s);
+
+    if (icd_is_active()) {
+        k_spinlock_key_t key = k_spin_lock(&icd_lock);
+        int64_t left = active_until - k_uptime_get();
+        k_spin_unlock(&icd_lock, key);
+        shell_print(sh, "Mode: active, %lld ms left", (long long)left);
+    } else {
+        shell_print(sh, "Mode: idle, CN105 window every %d ms", CONFIG_APP_ICD_SLOW_POLL_INTERVAL_MS);
+    }
+    shell_print(sh, "Active periods: %u (%u ms in total)", s.active_periods, s.active_ms);
+    shell_print(sh, "Idle windows:   %u (%u parent polls)", s.idle_windows, s.parent_polls);
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((heatpump), icd, NULL, "Show the ICD mode and counters", cmd_icd, 1, 0);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,93 @@
+/**
+ * @file icd.h
+ * @brief Intermittently Connected Device policy
+ *
+ * Runs the device as a Thread sleepy end device whose radio wakeups
+ * share awake periods with the CN105 exchanges. In idle mode the heat
+ * pump driver thread wakes once per slow poll interval, fetches the
+ * full state with one burst of info requests and then polls the Thread
+ * parent, so the MCU comes up once for both. A command, a write still
+ * pending on the CN105 link or a Matter interaction switches to active
+ * mode, in which the driver polls the unit at its normal rate and the
+ * radio fast-polls, so the confirming report goes out in the same
+ * window.
+ *
+ * Active mode follows the Matter ICD rules: it lasts the active mode
+ * duration and every activity extends it to at least the active mode
+ * threshold. With the Matter SDK the ICD manager owns the mode, the
+ * poll periods and Check-In (CONFIG_CHIP_ICD_*); the glue reports its
+ * transitions with icd_notify_activity().
+ */
+
+#ifndef ICD_H
+#define ICD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief ICD counters since boot
+ */
+typedef struct {
+    uint32_t active_periods;  /**< Transitions to active mode */
+    uint32_t active_ms;       /**< Time spent in active mode */
+    uint32_t idle_windows;    /**< Idle-mode CN105 exchange windows */
+    uint32_t parent_polls;    /**< Thread data requests sent from those windows */
+} icd_stats_t;
+
+/**
+ * @brief Start in active mode and set up the Thread poll and CSL periods
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int icd_init(void);
+
+/**
+ * @brief Report activity from outside the driver thread
+ *
+ * Called by the Matter glue on entering active mode (check-in, a
+ * subscription report, an incoming interaction). Starts or extends
+ * active mode and wakes the driver, so the unit is polled at once.
+ */
+void icd_notify_activity(void);
+
+/**
+ * @brief Evaluate the mode on the driver thread
+ *
+ * @param activity The driver saw activity since the last call (a
+ *        command, a write still pending on the CN105 link)
+ * @return true in active mode
+ */
+bool icd_poll(bool activity);
+
+/**
+ * @brief Check whether the device is in active mode
+ */
+bool icd_is_active(void);
+
+/**
+ * @brief Close an idle-mode CN105 window
+ *
+ * Polls the Thread parent for pending frames while the MCU is awake
+ * anyway. This also restarts the OpenThread poll timer, which runs a
+ * little longer than the window interval, so the radio follows the
+ * CN105 schedule instead of waking the MCU on its own.
+ */
+void icd_idle_window_done(void);
+
+/**
+ * @brief Get the ICD counters
+ *
+ * @param stats Output
+ */
+void icd_get_stats(icd_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ICD_H */
@@ -0,0 +1,328 @@
+/**
+ * @file latency_bench.cpp
+ * @brief Matter write to CN105 latency benchmark
+ *
+ * The benchmark thread calls the attribute handlers like the Matter
+ * glue would, while the driver thread reports every frame through
+ * latency_bench_on_frame(). A write can produce more than one SET
+ * (SystemMode also switches the power on), so every SET restarts the
+ * probe and the stages are measured for the last one.
+ */
+
+#include "latency_bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/printk.h>
+#include "attribute_handlers.h"
+#include "heatpump_driver.h"
+#include "matter_config.h"
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(latency_bench, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define BENCH_STACK_SIZE       2048
+#define BENCH_PRIORITY         7
+#define BENCH_CONNECT_WAIT_MS  60000
+#define BENCH_MAX_STEPS        CONFIG_APP_LATENCY_BENCH_STEPS
+
+enum bench_handler {
+    BENCH_MODE,
+    BENCH_SETPOINT,
+    BENCH_FAN,
+    BENCH_HANDLERS
+};
+
+enum bench_stage {
+    BENCH_WIRE,
+    BENCH_ACK,
+    BENCH_CONFIRM,
+    BENCH_STAGES
+};
+
+static const char *const handler_names[BENCH_HANDLERS] = { "mode", "setpoint", "fan" };
+static const char *const stage_names[BENCH_STAGES] = { "wire", "ack", "confirm" };
+
+/**
+ * @brief Frame timestamps of the step in progress, in cycles
+ */
+static struct {
+    bool armed;
+    bool has_wire;
+    bool has_ack;
+    bool has_confirm;
+    uint32_t wire;
+    uint32_t ack;
+    uint32_t confirm;
+} probe;
+
+static struct k_spinlock probe_lock;
+static K_SEM_DEFINE(confirm_sem, 0, 1);
+
+/* Latencies from handler entry in microseconds, per handler and stage */
+static uint32_t samples[BENCH_HANDLERS][BENCH_STAGES][BENCH_MAX_STEPS];
+static uint32_t sample_count[BENCH_HANDLERS][BENCH_STAGES];
+static uint32_t failures[BENCH_HANDLERS];
+static uint32_t missed_confirms[BENCH_HANDLERS];
+
+static K_THREAD_STACK_DEFINE(bench_stack, BENCH_STACK_SIZE);
+static struct k_thread bench_thread;
+static atomic_t bench_running;
+static uint32_t bench_steps;
+static uint32_t bench_interval_ms;
+
+/**
+ * @brief Frame hook, called by the driver for every frame sent or received
+ */
+void latency_bench_on_frame(const uint8_t *packet, unsigned int length, bool sent)
+{
+    if (!probe.armed || length < 6) {
+        return;
+    }
+
+    uint32_t now = k_cycle_get_32();
+    k_spinlock_key_t key = k_spin_lock(&probe_lock);
+
+    if (sent && packet[1] == 0x41 && packet[5] == 0x01) {
+        /* Settings SET, restart the probe */
+        probe.wire = now;
+        probe.has_wire = true;
+        probe.has_ack = false;
+        probe.has_confirm = false;
+    } else if (!sent && packet[1] == 0x61 && probe.has_wire && !probe.has_ack) {
+        probe.ack = now;
+        probe.has_ack = true;
+    } else if (!sent && packet[1] == 0x62 && packet[5] == 0x02 && probe.has_ack &&
+               !probe.has_confirm) {
+        probe.confirm = now;
+        probe.has_confirm = true;
+        k_sem_give(&confirm_sem);
+    }
+
+    k_spin_unlock(&probe_lock, key);
+}
+
+static int call_handler(int handler, uint32_t step)
+{
+    bool alt = (step & 1) != 0;
+
+    switch (handler) {
+        case BENCH_MODE:
+            return handle_thermostat_mode_write(alt ? MATTER_THERMOSTAT_MODE_COOL
+                                                    : MATTER_THERMOSTAT_MODE_HEAT);
+        case BENCH_SETPOINT:
+            return handle_temperature_setpoint_write(alt ? 2300 : 2100);
+        case BENCH_FAN:
+            return handle_fan_mode_write(alt ? MATTER_FAN_MODE_HIGH : MATTER_FAN_MODE_LOW);
+        default:
+            return -EINVAL;
+    }
+}
+
+static void record(int handler, int stage, uint32_t entry, uint32_t stamp)
+{
+    uint32_t n = sample_count[handler][stage];
+
+    if (n < BENCH_MAX_STEPS) {
+        samples[handler][stage][n] = k_cyc_to_us_floor32(stamp - entry);
+        sample_count[handler][stage] = n + 1;
+    }
+}
+
+/**
+ * @brief Run one write and wait for its confirming settings reply
+ */
+static void run_step(int handler, uint32_t step)
+{
+    k_spinlock_key_t key = k_spin_lock(&probe_lock);
+    probe.has_wire = false;
+    probe.has_ack = false;
+    probe.has_confirm = false;
+    probe.armed = true;
+    k_spin_unlock(&probe_lock, key);
+    k_sem_reset(&confirm_sem);
+
+    uint32_t entry = k_cycle_get_32();
+    int ret = call_handler(handler, step);
+    if (ret != 0) {
+        LOG_WRN("%s write failed: %d", handler_names[handler], ret);
+        failures[handler]++;
+        probe.armed = false;
+        return;
+    }
+
+    /* A settings reply seen before the last SET does not count, so
+     * recheck the flag after every wake-up */
+    int64_t deadline = k_uptime_get() + CONFIG_APP_LATENCY_BENCH_CONFIRM_TIMEOUT_MS;
+    bool confirmed = false;
+    while (!confirmed) {
+        key = k_spin_lock(&probe_lock);
+        confirmed = probe.has_confirm;
+        k_spin_unlock(&probe_lock, key);
+
+        int64_t left = deadline - k_uptime_get();
+        if (confirmed || left <= 0) {
+            break;
+        }
+        k_sem_take(&confirm_sem, K_MSEC(left));
+    }
+
+    key = k_spin_lock(&probe_lock);
+    probe.armed = false;
+    if (probe.has_wire) {
+        record(handler, BENCH_WIRE, entry, probe.wire);
+    }
+    if (probe.has_ack) {
+        record(handler, BENCH_ACK, entry, probe.ack);
+    }
+    if (probe.has_confirm) {
+        record(handler, BENCH_CONFIRM, entry, probe.confirm);
+    }
+    k_spin_unlock(&probe_lock, key);
+
+    if (!confirmed) {
+        missed_confirms[handler]++;
+    }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Nearest-rank percentile of sorted samples
+ */
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t pct)
+{
+    uint32_t rank = (pct * n + 99U) / 100U;
+
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void report(void)
+{
+    for (int h = 0; h < BENCH_HANDLERS; h++) {
+        for (int s = 0; s < BENCH_STAGES; s++) {
+            uint32_t n = sample_count[h][s];
+            uint32_t *v = samples[h][s];
+
+            if (n == 0) {
+                printk("latency: %s %s n=0\n", handler_names[h], stage_names[s]);
+                continue;
+            }
+            qsort(v, n, sizeof(v[0]), compare_u32);
+            printk("latency: %s %s n=%u p50=%u p95=%u p99=%u max=%u\n", handler_names[h],
+                   stage_names[s], n, percentile(v, n, 50), percentile(v, n, 95),
+                   percentile(v, n, 99), v[n - 1]);
+        }
+        printk("latency: %s failed=%u unconfirmed=%u\n", handler_names[h], failures[h],
+               missed_confirms[h]);
+    }
+    printk("latency: done\n");
+}
+
+static void bench_main(void *arg1, void *arg2, void *arg3)
+{
+    ARG_UNUSED(arg1);
+    ARG_UNUSED(arg2);
+    ARG_UNUSED(arg3);
+
+    int64_t wait_until = k_uptime_get() + BENCH_CONNECT_WAIT_MS;
+    while (!heatpump_is_connected()) {
+        if (k_uptime_get() > wait_until) {
+            printk("latency: heat pump not connected, aborted\n");
+            atomic_clear(&bench_running);
+            return;
+        }
+        k_msleep(100);
+    }
+
+    memset(sample_count, 0, sizeof(sample_count));
+    memset(failures, 0, sizeof(failures));
+    memset(missed_confirms, 0, sizeof(missed_confirms));
+
+    printk("latency: start steps=%u interval_ms=%u\n", bench_steps, bench_interval_ms);
+    int64_t next = k_uptime_get();
+    for (uint32_t step = 0; step < bench_steps; step++) {
+        for (int h = 0; h < BENCH_HANDLERS; h++) {
+            /* Fixed-rate schedule; a slow step delays the next one
+             * rather than overlapping it */
+            int64_t delay = next - k_uptime_get();
+            if (delay > 0) {
+                k_msleep((int32_t)delay);
+            }
+            next = MAX(next, k_uptime_get()) + bench_interval_ms;
+            run_step(h, step);
+        }
+    }
+
+    report();
+    atomic_clear(&bench_running);
+}
+
+/**
+ * @brief Start a run in the background
+ */
+int latency_bench_start(uint32_t steps, uint32_t interval_ms)
+{
+    if (steps == 0 || steps > BENCH_MAX_STEPS) {
+        return -EINVAL;
+    }
+    if (!atomic_cas(&bench_running, 0, 1)) {
+        return -EBUSY;
+    }
+
+    bench_steps = steps;
+    bench_interval_ms = interval_ms;
+    k_thread_create(&bench_thread, bench_stack, K_THREAD_STACK_SIZEOF(bench_stack), bench_main,
+                    NULL, NULL, NULL, BENCH_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&bench_thread, "latency_bench");
+    return 0;
+}
+
+/**
+ * @brief Start the benchmark at boot if CONFIG_APP_LATENCY_BENCH_AUTORUN
+ */
+int latency_bench_init(void)
+{
+#ifdef CONFIG_APP_LATENCY_BENCH_AUTORUN
+    return latency_bench_start(CONFIG_APP_LATENCY_BENCH_STEPS,
+                               CONFIG_APP_LATENCY_BENCH_INTERVAL_MS);
+#else
+    return 0;
+#endif
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_latency(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t steps = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10)
+                              : CONFIG_APP_LATENCY_BENCH_STEPS;
+    uint32_t interval = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10)
+                                 : CONFIG_APP_LATENCY_BENCH_INTERVAL_MS;
+
+    int ret = latency_bench_start(steps, interval);
+    if (ret == -EBUSY) {
+        shell_error(sh, "A run is already in progress");
+        return ret;
+    }
+    if (ret) {
+        shell_error(sh, "Steps must be 1 to %d", BENCH_MAX_STEPS);
+        return ret;
+    }
+    shell_print(sh, "Running %u steps every %u ms, results follow on the console", steps,
+                interval);
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((heatpump), latency, NULL,
+                 "Measure Matter write latency: latency [steps] [interval_ms]",
+                 cmd_latency, 1, 2);
+#endif /* CONFIG_SHELL */
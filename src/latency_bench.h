@@ -0,0 +1,61 @@
+/**
+ * @file latency_bench.h
+ * @brief Matter write to CN105 latency benchmark
+ *
+ * Drives handle_thermostat_mode_write(), handle_temperature_setpoint_write()
+ * and handle_fan_mode_write() at a fixed rate against a connected unit
+ * (or the emulator in scripts/latency_bench.py on native_sim) and
+ * measures, from handler entry:
+ * - wire: the last SET frame the write produced has been sent
+ * - ack: the unit acknowledged that frame (0x61)
+ * - confirm: the next 0x02 settings reply, which reflects the change
+ *
+ * Results are printed with printk as one line per handler and stage:
+ *   latency: <handler> <stage> n=<n> p50=<us> p95=<us> p99=<us> max=<us>
+ * followed by "latency: done".
+ */
+
+#ifndef LATENCY_BENCH_H
+#define LATENCY_BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the benchmark at boot if CONFIG_APP_LATENCY_BENCH_AUTORUN
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int latency_bench_init(void);
+
+/**
+ * @brief Start a run in the background
+ *
+ * Each step writes all three attributes once, alternating between two
+ * values so every write changes the unit state. A write that is still
+ * waiting for its confirmation delays the next one.
+ *
+ * @param steps Steps to run, at most CONFIG_APP_LATENCY_BENCH_STEPS
+ * @param interval_ms Time between the starts of consecutive writes
+ * @return 0 on success, -EBUSY if a run is in progress, -EINVAL for bad arguments
+ */
+int latency_bench_start(uint32_t steps, uint32_t interval_ms);
+
+/**
+ * @brief Frame hook, called by the driver for every frame sent or received
+ *
+ * @param packet Frame, starting with the 0xfc header
+ * @param length Frame length
+ * @param sent true for frames sent to the unit
+ */
+void latency_bench_on_frame(const uint8_t *packet, unsigned int length, bool sent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_BENCH_H */
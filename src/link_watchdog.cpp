@@ -0,0 +1,127 @@
+/**
+ * @file link_watchdog.cpp
+ * @brief Deadlines for the CN105 protocol thread
+ *
+ * A deadline is a task watchdog channel added when it starts and
+ * deleted when it ends. The first expiry calls the driver's handler
+ * and feeds the channel once more as a grace period; the thread ends
+ * that with link_watchdog_take_overrun(). A second expiry of the same
+ * channel means the thread did not come back and the MCU is reset.
+ */
+
+#include "link_watchdog.h"
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/reboot.h>
+#include <zephyr/task_wdt/task_wdt.h>
+
+LOG_MODULE_REGISTER(link_watchdog, CONFIG_LOG_DEFAULT_LEVEL);
+
+static const uint32_t periods_ms[LINK_WATCHDOG_DEADLINES] = {
+    CONFIG_APP_LINK_WATCHDOG_LOOP_MS,
+    CONFIG_APP_LINK_WATCHDOG_TRANSACTION_MS,
+};
+
+static link_watchdog_expired_t expired_handler;
+
+/* Channel of each running deadline, -1 when stopped; driver thread only */
+static int channels[LINK_WATCHDOG_DEADLINES] = { -1, -1 };
+
+/* Deadline the thread is recovering from, -1 if none */
+static atomic_t overrun = ATOMIC_INIT(-1);
+
+/**
+ * @brief Task watchdog callback, in the timer's interrupt context
+ */
+static void deadline_passed(int channel_id, void *user_data)
+{
+    atomic_val_t deadline = (atomic_val_t)(uintptr_t)user_data;
+
+    if (!atomic_cas(&overrun, -1, deadline)) {
+        if (atomic_get(&overrun) == deadline) {
+            /* The grace period passed too: the thread is wedged */
+            LOG_PANIC();
+            LOG_ERR("CN105 thread did not recover, rebooting");
+            sys_reboot(SYS_REBOOT_COLD);
+        }
+        /* The other deadline, while the thread is already unwinding */
+        task_wdt_feed(channel_id);
+        return;
+    }
+
+    if (expired_handler) {
+        expired_handler((link_watchdog_deadline_e)deadline);
+    }
+    task_wdt_feed(channel_id);
+}
+
+/**
+ * @brief Start the task watchdog
+ */
+int link_watchdog_init(link_watchdog_expired_t expired)
+{
+    const struct device *hw_wdt = NULL;
+
+#if DT_NODE_HAS_STATUS(DT_ALIAS(watchdog0), okay) && defined(CONFIG_WATCHDOG)
+    hw_wdt = DEVICE_DT_GET(DT_ALIAS(watchdog0));
+    if (!device_is_ready(hw_wdt)) {
+        LOG_WRN("Hardware watchdog not ready, task watchdog runs alone");
+        hw_wdt = NULL;
+    }
+#endif
+
+    int ret = task_wdt_init(hw_wdt);
+    if (ret) {
+        LOG_ERR("Task watchdog init failed: %d", ret);
+        return ret;
+    }
+    expired_handler = expired;
+    LOG_INF("CN105 deadlines: loop %u ms, exchange %u ms%s", periods_ms[LINK_WATCHDOG_LOOP],
+            periods_ms[LINK_WATCHDOG_TRANSACTION], hw_wdt ? ", hardware backed" : "");
+    return 0;
+}
+
+/**
+ * @brief Start a deadline, or restart it if it is running
+ */
+void link_watchdog_begin(link_watchdog_deadline_e deadline)
+{
+    if (expired_handler == NULL) {
+        return;
+    }
+    if (channels[deadline] >= 0) {
+        task_wdt_feed(channels[deadline]);
+        return;
+    }
+
+    int id = task_wdt_add(periods_ms[deadline], deadline_passed, (void *)(uintptr_t)deadline);
+    if (id < 0) {
+        /* Runs unmonitored; raise CONFIG_TASK_WDT_CHANNELS */
+        LOG_ERR("No task watchdog channel: %d", id);
+        return;
+    }
+    channels[deadline] = id;
+}
+
+/**
+ * @brief Stop a deadline
+ */
+void link_watchdog_end(link_watchdog_deadline_e deadline)
+{
+    if (channels[deadline] < 0) {
+        return;
+    }
+    (void)task_wdt_delete(channels[deadline]);
+    channels[deadline] = -1;
+}
+
+/**
+ * @brief Take the overrun the thread is recovering from
+ */
+int link_watchdog_take_overrun(void)
+{
+    return (int)atomic_set(&overrun, -1);
+}
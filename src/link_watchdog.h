@@ -0,0 +1,80 @@
+/**
+ * @file link_watchdog.h
+ * @brief Deadlines for the CN105 protocol thread
+ *
+ * The driver thread's waits on the heat pump are bounded one by one,
+ * but they nest: a reconnect probes two baud rates, a SET is retried
+ * with backoff, a function code read re-reads five times, and a line
+ * that keeps delivering bytes keeps the reader going. This module puts
+ * each pass of the driver loop and each exchange under a deadline on a
+ * task watchdog channel. When one passes, the expiry handler makes the
+ * thread give up (the driver aborts the exchange in flight) and the
+ * thread resets the link once it is back in its loop. Only if it does
+ * not come back within another deadline is the MCU reset.
+ *
+ * Channels exist only while a deadline runs, so the loop may wait for
+ * commands (or for the next ICD window) as long as it likes.
+ */
+
+#ifndef LINK_WATCHDOG_H
+#define LINK_WATCHDOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Deadlines, each on its own watchdog channel
+ */
+typedef enum {
+    LINK_WATCHDOG_LOOP = 0,     /**< One pass of the driver loop */
+    LINK_WATCHDOG_TRANSACTION,  /**< From a frame sent to the next one */
+    LINK_WATCHDOG_DEADLINES
+} link_watchdog_deadline_e;
+
+/**
+ * @brief Called when a deadline passes
+ *
+ * Runs in the watchdog timer's interrupt context; it must only make
+ * the thread return to its loop, not recover itself.
+ */
+typedef void (*link_watchdog_expired_t)(link_watchdog_deadline_e deadline);
+
+/**
+ * @brief Start the task watchdog
+ *
+ * Backed by the hardware watchdog when the devicetree has a watchdog0
+ * alias and CONFIG_WATCHDOG is enabled.
+ *
+ * @param expired Handler for a passed deadline
+ * @return 0 on success, negative errno on failure
+ */
+int link_watchdog_init(link_watchdog_expired_t expired);
+
+/**
+ * @brief Start a deadline, or restart it if it is running
+ *
+ * Does nothing until link_watchdog_init() has succeeded.
+ */
+void link_watchdog_begin(link_watchdog_deadline_e deadline);
+
+/**
+ * @brief Stop a deadline
+ */
+void link_watchdog_end(link_watchdog_deadline_e deadline);
+
+/**
+ * @brief Take the overrun the thread is recovering from
+ *
+ * Call from the monitored thread back in its loop; this ends the grace
+ * period that started when the deadline passed.
+ *
+ * @return The deadline that passed, -1 if none did
+ */
+int link_watchdog_take_overrun(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINK_WATCHDOG_H */
@@ -0,0 +1,85 @@
+/**
+ * @file log_ratelimit.h
+ * @brief Rate limit for log messages that repeat on the protocol path
+ *
+ * APP_LOG_RATELIMITED(INF, "...", ...) logs like LOG_INF() at most once
+ * per interval for each call site and counts the repeats in between;
+ * the next message that gets through reports how many were dropped.
+ * The interval is CONFIG_APP_LOG_RATELIMIT_MS unless the module defines
+ * APP_LOG_RATELIMIT_MS before including this header.
+ *
+ * Call sites keep their state in unlocked statics: two threads racing
+ * on one can both log, which costs a duplicate line and nothing else.
+ */
+
+#ifndef LOG_RATELIMIT_H
+#define LOG_RATELIMIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifndef APP_LOG_RATELIMIT_MS
+#ifdef CONFIG_APP_LOG_RATELIMIT_MS
+#define APP_LOG_RATELIMIT_MS CONFIG_APP_LOG_RATELIMIT_MS
+#else
+#define APP_LOG_RATELIMIT_MS 10000
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Per call site state
+ */
+typedef struct {
+    int64_t next;           /**< Uptime at which the next message may pass */
+    uint32_t suppressed;    /**< Repeats dropped since the last one passed */
+} log_ratelimit_t;
+
+/**
+ * @brief Check whether a message may pass
+ *
+ * @param rl Call site state
+ * @param interval_ms Minimum time between two messages
+ * @param suppressed Set to the repeats dropped before this one
+ * @return true to log the message
+ */
+static inline bool log_ratelimit_pass(log_ratelimit_t *rl, uint32_t interval_ms,
+                                      uint32_t *suppressed)
+{
+    int64_t now = k_uptime_get();
+
+    if (now < rl->next) {
+        rl->suppressed++;
+        return false;
+    }
+    rl->next = now + interval_ms;
+    *suppressed = rl->suppressed;
+    rl->suppressed = 0;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @brief Log at @a _level (ERR, WRN, INF, DBG) at most once per interval
+ */
+#define APP_LOG_RATELIMITED(_level, ...)                                                        \
+    do {                                                                                        \
+        static log_ratelimit_t _log_rl;                                                         \
+        uint32_t _log_dropped;                                                                  \
+        if (log_ratelimit_pass(&_log_rl, APP_LOG_RATELIMIT_MS, &_log_dropped)) {                \
+            if (_log_dropped > 0) {                                                             \
+                LOG_##_level("(%u similar messages suppressed)", _log_dropped);                 \
+            }                                                                                   \
+            LOG_##_level(__VA_ARGS__);                                                          \
+        }                                                                                       \
+    } while (0)
+
+#endif /* LOG_RATELIMIT_H */
@@ -9,6 +9,13 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include "heatpump_driver.h"
+#include "remote_temp.h"
+#include "history.h"
+#include "schedule.h"
+#include "icd.h"
+#include "ota_requestor.h"
+#include "resource_monitor.h"
+#include "latency_bench.h"
 
 LOG_MODULE_REGISTER(main, CONFIG_LOG_DEFAULT_LEVEL);
 
@@ -16,7 +23,14 @@ LOG_MODULE_REGISTER(main, CONFIG_LOG_DEFAULT_LEVEL);
  * @brief Main application entry point
  * 
  * Initializes all subsystems:
+ * - ICD policy, before the driver thread first asks for the mode
  * - Heat pump driver (UART communication)
+ * - Remote temperature feed
+ * - History sampling
+ * - Weekly schedule
+ * - OTA image confirmation
+ * - Resource high-water reporting
+ * - Latency benchmark (native_sim)
  * - Matter stack
  * - State synchronization
  * 
@@ -27,17 +41,43 @@ int main(void)
     LOG_INF("Matter CN105 Heat Pump Controller starting...");
     LOG_INF("Version: 0.1.0");
     
-    /* Initialize heat pump driver */
+#ifdef CONFIG_APP_ICD
+    icd_init();
+#endif
+
+    /* Initialize heat pump driver; the CN105 handshake runs in the
+     * background while the rest of the system comes up */
     LOG_INF("Initializing heat pump driver...");
     int ret = heatpump_init();
     if (ret) {
         LOG_ERR("heatpump_init failed: %d", ret);
     }
-    ret = heatpump_connect();
-    if (ret) {
-        LOG_WRN("heatpump_connect pending/not ready: %d", ret);
-    }
     
+#ifdef CONFIG_APP_REMOTE_TEMP
+    remote_temp_init();
+#endif
+
+#ifdef CONFIG_APP_HISTORY
+    history_init();
+#endif
+
+#ifdef CONFIG_APP_SCHEDULE
+    schedule_init();
+#endif
+
+#ifdef CONFIG_APP_OTA
+    /* The driver came up, so a freshly swapped image is good to keep */
+    ota_requestor_init();
+#endif
+
+#ifdef CONFIG_APP_RESOURCE_MONITOR
+    resource_monitor_init();
+#endif
+
+#ifdef CONFIG_APP_LATENCY_BENCH
+    latency_bench_init();
+#endif
+
     /* TODO: Initialize Matter stack */
     LOG_INF("Initializing Matter stack...");
     
@@ -46,17 +86,14 @@ int main(void)
     
     LOG_INF("Initialization complete");
     
-    /* Main loop - handle events and maintain state sync */
+    /* Main loop - the CN105 link is maintained by the driver thread */
     while (1) {
-        /* Maintain CN105 link */
-        heatpump_sync();
-        
         /* Optionally, log status periodically */
         if (heatpump_is_connected()) {
             heatpump_status_t status;
             if (heatpump_get_status(&status) == 0) {
-                LOG_DBG("HP: room=%.1fC operating=%d freq=%d",
-                        (double)status.roomTemperature,
+                LOG_DBG("HP: room=" HP_TEMP_FMT "C operating=%d freq=%d",
+                        HP_TEMP_ARGS(status.roomTemperature),
                         status.operating,
                         status.compressorFrequency);
             }
@@ -64,7 +101,7 @@ int main(void)
         /* TODO: Process Matter attribute changes */
         /* TODO: Synchronize state between heat pump and Matter */
         
-        k_sleep(K_MSEC(100));
+        k_sleep(K_MSEC(1000));
     }
     
     return 0;
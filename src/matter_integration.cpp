@@ -8,7 +8,9 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include "matter_integration.h"
 #include "matter_config.h"
+#include "attribute_handlers.h"
 #include "heatpump_driver.h"
 
 LOG_MODULE_REGISTER(matter_integration, CONFIG_LOG_DEFAULT_LEVEL);
@@ -26,6 +28,9 @@ int matter_init(void)
     
     /* TODO: Initialize Matter/CHIP stack */
     /* TODO: Set up thermostat device type */
+    /* TODO: Register an AttributeAccessInterface on the thermostat
+     *       endpoint for every cluster below that forwards to
+     *       matter_attribute_read() / matter_attribute_write() */
     /* TODO: Register standard clusters:
      *       - Identify
      *       - On/Off
@@ -33,12 +38,21 @@ int matter_init(void)
      *       - Fan Control
      *       - Temperature Measurement
      */
-    /* TODO: Register custom vendor clusters:
-     *       - Vane Control
-     *       - Wide Vane Control
-     *       - Heat Pump Status
-     *       - i-See Control
-     */
+    /* TODO: Register the heat pump extension cluster; FullState is
+     *       served by handle_full_state_read() */
+    /* TODO: With CONFIG_APP_ICD, register an ICDStateObserver whose
+     *       OnEnterActiveMode() calls icd_notify_activity(), so check-in
+     *       and controller interactions start a CN105 window at once */
+    /* TODO: With CONFIG_APP_REMOTE_TEMP, use the Binding cluster (or a
+     *       subscription) to Temperature Measurement servers, one source
+     *       slot each; call remote_temp_report() on every MeasuredValue
+     *       report and remote_temp_source_lost() on a null value, a
+     *       removed binding or a dropped subscription */
+    /* TODO: With CONFIG_APP_OTA, set up the OTA Requestor with an
+     *       OTAImageProcessorInterface whose PrepareDownload(),
+     *       ProcessBlock() (after OTAImageHeaderParser strips the Matter
+     *       header), Finalize(), Apply() and Abort() call ota_begin(),
+     *       ota_write(), ota_finish(), ota_apply() and ota_abort() */
     
     LOG_WRN("Matter initialization not yet implemented");
     return -ENOSYS;
@@ -79,49 +93,55 @@ int matter_handle_commissioning(void)
 }
 
 /**
- * @brief Update Matter attributes from heat pump state
+ * @brief Report changed heat pump attributes to Matter subscribers
  * 
- * Synchronizes Matter cluster attributes with current heat pump state
+ * Attributes backed by the heat pump are served from the driver
+ * snapshot by matter_attribute_read(), so nothing is copied here; the
+ * reporting engine is only told which clusters to read again.
  * 
  * @return 0 on success, negative errno on failure
  */
-int matter_update_attributes(void)
+int matter_update_attributes(const heatpump_state_t *changed)
 {
-    heatpump_settings_t settings;
-    heatpump_status_t status;
-    
-    /* Get current heat pump state */
-    if (heatpump_get_settings(&settings) != 0) {
-        LOG_ERR("Failed to get heat pump settings");
-        return -EIO;
-    }
-    
-    if (heatpump_get_status(&status) != 0) {
-        LOG_ERR("Failed to get heat pump status");
-        return -EIO;
+    /* Fields each cluster's attributes are derived from. FullState puts
+     * nearly all of them in the extension cluster. */
+    static const struct {
+        uint32_t cluster;
+        uint64_t settings;
+        uint64_t status;
+    } clusters[] = {
+        { MATTER_CLUSTER_ON_OFF, HP_STATE_POWER, 0 },
+        { MATTER_CLUSTER_THERMOSTAT,
+          HP_STATE_POWER | HP_STATE_MODE | HP_STATE_SETPOINT | HP_STATE_OPERATING,
+          HP_STATUS_ROOM_TEMP },
+        { MATTER_CLUSTER_FAN_CONTROL, HP_STATE_FAN, 0 },
+        { MATTER_CLUSTER_TEMP_MEASUREMENT, 0, HP_STATUS_ROOM_TEMP },
+        { MATTER_CLUSTER_HP_EXTENSION, UINT64_MAX,
+          ~(HP_STATUS_ON_SET | HP_STATUS_OFF_SET) },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(clusters); i++) {
+        if (changed != NULL &&
+            !heatpump_state_changed(changed, clusters[i].settings, clusters[i].status)) {
+            continue;
+        }
+        /* TODO: MatterReportingAttributeChangeCallback(MATTER_ENDPOINT_THERMOSTAT,
+         *       clusters[i].cluster) once the Matter stack is linked */
     }
     
-    /* TODO: Update Matter thermostat attributes */
-    /* TODO: Update Matter fan control attributes */
-    /* TODO: Update Matter custom cluster attributes */
-    
     return -ENOSYS;
 }
 
 /**
  * @brief Process Matter attribute write requests
  * 
- * Called when Matter controller writes to device attributes
- * Updates heat pump settings accordingly
+ * Writes to heat pump attributes are not buffered: the Matter glue
+ * calls matter_attribute_write(), which blocks until the driver has
+ * completed the SET exchange. Nothing is left to process here.
  * 
  * @return 0 on success, negative errno on failure
  */
 int matter_process_attribute_writes(void)
 {
-    /* TODO: Check for pending attribute write operations */
-    /* TODO: Validate attribute values */
-    /* TODO: Update heat pump via heatpump_driver */
-    /* TODO: Confirm attribute changes */
-    
-    return -ENOSYS;
+    return 0;
 }
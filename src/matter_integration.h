@@ -0,0 +1,59 @@
+/**
+ * @file matter_integration.h
+ * @brief Matter stack integration for heat pump controller
+ */
+
+#ifndef MATTER_INTEGRATION_H
+#define MATTER_INTEGRATION_H
+
+#include "heatpump_state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize Matter stack
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int matter_init(void);
+
+/**
+ * @brief Start Matter server
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int matter_start(void);
+
+/**
+ * @brief Handle Matter commissioning
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int matter_handle_commissioning(void);
+
+/**
+ * @brief Report changed heat pump attributes to Matter subscribers
+ *
+ * Call after the driver reported a state change. Only clusters with an
+ * attribute backed by one of the changed fields are reported. Values
+ * are read back through matter_attribute_read(), not copied.
+ *
+ * @param changed Changed bits (heatpump_state_diff()), NULL for all
+ * @return 0 on success, negative errno on failure
+ */
+int matter_update_attributes(const heatpump_state_t *changed);
+
+/**
+ * @brief Process Matter attribute write requests
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int matter_process_attribute_writes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATTER_INTEGRATION_H */
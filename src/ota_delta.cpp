@@ -0,0 +1,348 @@
+/**
+ * @file ota_delta.cpp
+ * @brief Streaming decoder for compressed and delta firmware images
+ *
+ * Three byte-at-a-time stages: the LZSS decoder feeds the operation
+ * parser, which produces the new image through a small staging buffer.
+ * Every stage keeps its position in ota_delta_t, so an image can be cut
+ * into blocks anywhere.
+ *
+ * LZSS items are announced by a flag byte, least significant bit first:
+ * 1 is a literal byte, 0 a match of two bytes b0, b1 with distance
+ * ((b1 >> 4) << 8 | b0) + 1 and length (b1 & 0x0F) + 3. A length nibble
+ * of 15 is followed by a byte added to the length, so runs of up to 273
+ * bytes (long stretches of unchanged DIFF bytes) take three bytes.
+ */
+
+#include "ota_delta.h"
+#include <errno.h>
+#include <string.h>
+
+enum {
+    LZ_FLAGS,       /* Next byte is a flag byte */
+    LZ_ITEM,        /* Next byte is a literal or the first match byte */
+    LZ_MATCH,       /* Second match byte */
+    LZ_MATCH_EXT    /* Match length extension */
+};
+
+enum {
+    OP_CODE,
+    OP_SEEK,
+    OP_LEN,
+    OP_BODY
+};
+
+enum {
+    OP_END = 0x00,
+    OP_COPY = 0x01,
+    OP_DIFF = 0x02,
+    OP_DATA = 0x03
+};
+
+static const uint32_t crc_table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+uint32_t ota_delta_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void fail(ota_delta_t *d, int error)
+{
+    if (d->error == 0) {
+        d->error = error;
+    }
+}
+
+static void out_flush(ota_delta_t *d)
+{
+    if (d->out_len == 0) {
+        return;
+    }
+    d->crc = ota_delta_crc32(d->crc, d->out_buf, d->out_len);
+    int ret = d->io.write(d->io.ctx, d->out_buf, d->out_len);
+    if (ret < 0) {
+        fail(d, ret);
+    }
+    d->out_len = 0;
+}
+
+static void out_byte(ota_delta_t *d, uint8_t c)
+{
+    if (d->written >= d->header.target_size) {
+        fail(d, -EBADMSG);
+        return;
+    }
+    d->out_buf[d->out_len++] = c;
+    d->written++;
+    if (d->out_len == sizeof(d->out_buf)) {
+        out_flush(d);
+    }
+}
+
+static uint8_t base_byte(ota_delta_t *d, uint32_t pos)
+{
+    if (pos >= d->header.base_size) {
+        fail(d, -EBADMSG);
+        return 0;
+    }
+    if (pos < d->base_buf_pos || pos >= d->base_buf_pos + d->base_buf_len) {
+        uint32_t n = d->header.base_size - pos;
+        if (n > sizeof(d->base_buf)) {
+            n = sizeof(d->base_buf);
+        }
+        int ret = d->io.read_base(d->io.ctx, pos, d->base_buf, n);
+        if (ret < 0) {
+            fail(d, ret);
+            return 0;
+        }
+        d->base_buf_pos = pos;
+        d->base_buf_len = (uint8_t)n;
+    }
+    return d->base_buf[pos - d->base_buf_pos];
+}
+
+/**
+ * @brief Accumulate a varint byte; true when the value is complete
+ */
+static bool varint_byte(ota_delta_t *d, uint8_t b)
+{
+    if (d->varint_shift > 28) {
+        fail(d, -EBADMSG);
+        return false;
+    }
+    d->varint |= (uint32_t)(b & 0x7F) << d->varint_shift;
+    d->varint_shift += 7;
+    return (b & 0x80) == 0;
+}
+
+static void op_expect_varint(ota_delta_t *d, uint8_t state)
+{
+    d->op_state = state;
+    d->varint = 0;
+    d->varint_shift = 0;
+}
+
+static void op_byte(ota_delta_t *d, uint8_t b)
+{
+    switch (d->op_state) {
+        case OP_CODE:
+            d->op = b;
+            if (b == OP_END) {
+                d->end = true;
+            } else if (b == OP_COPY || b == OP_DIFF) {
+                op_expect_varint(d, OP_SEEK);
+            } else if (b == OP_DATA) {
+                op_expect_varint(d, OP_LEN);
+            } else {
+                fail(d, -EBADMSG);
+            }
+            break;
+
+        case OP_SEEK:
+            if (varint_byte(d, b)) {
+                /* zigzag */
+                int64_t seek = (int64_t)(d->varint >> 1) ^ -(int64_t)(d->varint & 1);
+                int64_t pos = (int64_t)d->base_pos + seek;
+                if (pos < 0 || pos > (int64_t)d->header.base_size) {
+                    fail(d, -EBADMSG);
+                    break;
+                }
+                d->base_pos = (uint32_t)pos;
+                op_expect_varint(d, OP_LEN);
+            }
+            break;
+
+        case OP_LEN:
+            if (!varint_byte(d, b)) {
+                break;
+            }
+            d->remaining = d->varint;
+            d->op_state = OP_CODE;
+            if (d->op == OP_COPY) {
+                for (; d->remaining > 0 && d->error == 0; d->remaining--) {
+                    out_byte(d, base_byte(d, d->base_pos++));
+                }
+            } else if (d->remaining > 0) {
+                d->op_state = OP_BODY;
+            }
+            break;
+
+        case OP_BODY:
+            if (d->op == OP_DIFF) {
+                b = (uint8_t)(b + base_byte(d, d->base_pos++));
+            }
+            out_byte(d, b);
+            if (--d->remaining == 0) {
+                d->op_state = OP_CODE;
+            }
+            break;
+    }
+}
+
+/**
+ * @brief One byte of decompressed payload
+ */
+static void payload_byte(ota_delta_t *d, uint8_t b)
+{
+    if (d->end) {
+        fail(d, -EBADMSG);
+    } else if (d->header.flags & OTA_DELTA_FLAG_DELTA) {
+        op_byte(d, b);
+    } else {
+        out_byte(d, b);
+    }
+}
+
+static void lz_out(ota_delta_t *d, uint8_t c)
+{
+    d->window[d->window_pos] = c;
+    d->window_pos = (d->window_pos + 1) & (OTA_DELTA_WINDOW - 1);
+    payload_byte(d, c);
+}
+
+static void lz_next(ota_delta_t *d)
+{
+    d->lz_flags >>= 1;
+    d->lz_state = d->lz_flags == 1 ? LZ_FLAGS : LZ_ITEM;
+}
+
+static void lz_match(ota_delta_t *d, uint8_t extra)
+{
+    uint16_t distance = (uint16_t)((((d->lz_b1 >> 4) << 8) | d->lz_b0) + 1);
+    uint16_t len = (uint16_t)((d->lz_b1 & 0x0F) + 3 + extra);
+
+    for (uint16_t i = 0; i < len && d->error == 0; i++) {
+        lz_out(d, d->window[(d->window_pos - distance) & (OTA_DELTA_WINDOW - 1)]);
+    }
+    lz_next(d);
+}
+
+static void lz_byte(ota_delta_t *d, uint8_t b)
+{
+    switch (d->lz_state) {
+        case LZ_FLAGS:
+            d->lz_flags = (uint16_t)(b | 0x100);
+            d->lz_state = LZ_ITEM;
+            break;
+
+        case LZ_ITEM:
+            if (d->lz_flags & 1) {
+                lz_out(d, b);
+                lz_next(d);
+            } else {
+                d->lz_b0 = b;
+                d->lz_state = LZ_MATCH;
+            }
+            break;
+
+        case LZ_MATCH:
+            d->lz_b1 = b;
+            if ((b & 0x0F) == 0x0F) {
+                d->lz_state = LZ_MATCH_EXT;
+            } else {
+                lz_match(d, 0);
+            }
+            break;
+
+        case LZ_MATCH_EXT:
+            lz_match(d, b);
+            break;
+    }
+}
+
+/**
+ * @brief Parse the header and check the running image against it
+ */
+static void header_done(ota_delta_t *d)
+{
+    ota_delta_header_t *h = &d->header;
+    const uint8_t *p = d->head;
+
+    if (memcmp(p, OTA_DELTA_MAGIC, 4) != 0) {
+        fail(d, -ENOTSUP);
+        return;
+    }
+    h->version = p[4];
+    h->flags = p[5];
+    h->base_size = get_le32(&p[8]);
+    h->base_crc = get_le32(&p[12]);
+    h->target_size = get_le32(&p[16]);
+    h->target_crc = get_le32(&p[20]);
+    if (h->version != OTA_DELTA_VERSION ||
+        (h->flags & ~(OTA_DELTA_FLAG_COMPRESSED | OTA_DELTA_FLAG_DELTA)) != 0) {
+        fail(d, -ENOTSUP);
+        return;
+    }
+    if (!(h->flags & OTA_DELTA_FLAG_DELTA)) {
+        return;
+    }
+
+    uint32_t crc = 0;
+    for (uint32_t pos = 0; pos < h->base_size && d->error == 0; pos += d->base_buf_len) {
+        base_byte(d, pos);
+        crc = ota_delta_crc32(crc, d->base_buf, d->base_buf_len);
+    }
+    if (d->error == 0 && crc != h->base_crc) {
+        fail(d, -ESTALE);
+    }
+}
+
+void ota_delta_init(ota_delta_t *d, const ota_delta_io_t *io)
+{
+    memset(d, 0, sizeof(*d));
+    d->io = *io;
+    d->lz_state = LZ_FLAGS;
+    d->op_state = OP_CODE;
+}
+
+int ota_delta_feed(ota_delta_t *d, const uint8_t *data, size_t len)
+{
+    d->received += (uint32_t)len;
+
+    for (size_t i = 0; i < len && d->error == 0; i++) {
+        if (d->head_len < OTA_DELTA_HEADER_LEN) {
+            d->head[d->head_len++] = data[i];
+            if (d->head_len == OTA_DELTA_HEADER_LEN) {
+                header_done(d);
+            }
+        } else if (d->header.flags & OTA_DELTA_FLAG_COMPRESSED) {
+            lz_byte(d, data[i]);
+        } else {
+            payload_byte(d, data[i]);
+        }
+    }
+    return d->error;
+}
+
+int ota_delta_finish(ota_delta_t *d)
+{
+    if (d->error == 0) {
+        out_flush(d);
+    }
+    if (d->error != 0) {
+        return d->error;
+    }
+
+    bool complete = d->head_len == OTA_DELTA_HEADER_LEN &&
+                    d->lz_state != LZ_MATCH && d->lz_state != LZ_MATCH_EXT &&
+                    (d->end || !(d->header.flags & OTA_DELTA_FLAG_DELTA)) &&
+                    d->written == d->header.target_size && d->crc == d->header.target_crc;
+    if (!complete) {
+        fail(d, -EBADMSG);
+    }
+    return d->error;
+}
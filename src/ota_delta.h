@@ -0,0 +1,160 @@
+/**
+ * @file ota_delta.h
+ * @brief Streaming decoder for compressed and delta firmware images
+ *
+ * Pure code with no kernel dependencies, shared by the OTA requestor
+ * (ota_requestor.cpp) and the host tool (host/hp_ota.cpp). The image is
+ * decoded as it arrives, block by block, so neither the download nor the
+ * decompressed payload is ever held in RAM.
+ *
+ * Image layout, little endian:
+ *
+ *   magic "HPOD", version, flags, reserved (2 bytes),
+ *   base_size, base_crc, target_size, target_crc   (24 bytes)
+ *   payload
+ *
+ * With OTA_DELTA_FLAG_COMPRESSED the payload is LZSS compressed with a
+ * 4 KB window. Decompressed, it is the new image itself, or with
+ * OTA_DELTA_FLAG_DELTA a list of operations against the running image:
+ *
+ *   0x00 END
+ *   0x01 COPY  seek len         copy base bytes
+ *   0x02 DIFF  seek len bytes   base bytes plus the given bytes (mod 256)
+ *   0x03 DATA  len bytes        new bytes
+ *
+ * seek is a zigzag varint that moves the base position, which also
+ * advances past every COPY and DIFF; len is a varint. Code that moved
+ * keeps most bytes and changes a few addresses, so DIFF bytes are
+ * mostly zero and compress well. scripts/ota_delta.py builds images.
+ */
+
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_DELTA_MAGIC        "HPOD"
+#define OTA_DELTA_VERSION      1
+#define OTA_DELTA_HEADER_LEN   24
+
+/** Payload is LZSS compressed */
+#define OTA_DELTA_FLAG_COMPRESSED 0x01
+/** Payload is a list of operations against the running image */
+#define OTA_DELTA_FLAG_DELTA      0x02
+
+/** LZSS window, also the largest match distance */
+#define OTA_DELTA_WINDOW       4096
+
+/** Base and output staging buffer size */
+#define OTA_DELTA_CHUNK        64
+
+/**
+ * @brief Image header
+ */
+typedef struct {
+    uint8_t version;
+    uint8_t flags;          /**< OTA_DELTA_FLAG_* */
+    uint32_t base_size;     /**< Running image size, 0 unless DELTA */
+    uint32_t base_crc;      /**< CRC-32 of the running image */
+    uint32_t target_size;   /**< New image size */
+    uint32_t target_crc;    /**< CRC-32 of the new image */
+} ota_delta_header_t;
+
+/**
+ * @brief Storage callbacks
+ */
+typedef struct {
+    /** Read @a len bytes of the running image at @a offset */
+    int (*read_base)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+    /** Append @a len bytes to the new image */
+    int (*write)(void *ctx, const uint8_t *data, size_t len);
+    void *ctx;
+} ota_delta_io_t;
+
+/**
+ * @brief Decoder state
+ *
+ * About 4.3 KB, mostly the LZSS window; allocate it statically.
+ */
+typedef struct {
+    ota_delta_io_t io;
+    ota_delta_header_t header;
+    uint8_t head[OTA_DELTA_HEADER_LEN];
+    uint8_t head_len;
+
+    /* LZSS */
+    uint8_t window[OTA_DELTA_WINDOW];
+    uint16_t window_pos;
+    uint16_t lz_flags;      /* Flag bits left, with a marker bit above them */
+    uint8_t lz_state;
+    uint8_t lz_b0;
+    uint8_t lz_b1;
+
+    /* Operations */
+    uint8_t op;
+    uint8_t op_state;
+    uint8_t varint_shift;
+    uint32_t varint;
+    uint32_t remaining;
+    uint32_t base_pos;
+
+    /* Base read cache and output staging */
+    uint8_t base_buf[OTA_DELTA_CHUNK];
+    uint32_t base_buf_pos;
+    uint8_t base_buf_len;
+    uint8_t out_buf[OTA_DELTA_CHUNK];
+    uint8_t out_len;
+
+    uint32_t received;      /**< Image bytes fed, header included */
+    uint32_t written;       /**< New image bytes produced */
+    uint32_t crc;
+    bool end;
+    int error;
+} ota_delta_t;
+
+/**
+ * @brief CRC-32 (IEEE 802.3, as zlib), incremental
+ *
+ * @param crc 0 to start, or the previous result
+ */
+uint32_t ota_delta_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Start decoding an image
+ *
+ * @param d Decoder state
+ * @param io Storage callbacks, copied
+ */
+void ota_delta_init(ota_delta_t *d, const ota_delta_io_t *io);
+
+/**
+ * @brief Decode the next bytes of the image
+ *
+ * The base image is checked against the header as soon as the header is
+ * complete, before anything is written.
+ *
+ * @return 0 on success, -ENOTSUP for an unknown format, -ESTALE if the
+ *         running image is not the base of the delta, -EBADMSG for a
+ *         corrupt image, or the error of a storage callback; errors stick
+ */
+int ota_delta_feed(ota_delta_t *d, const uint8_t *data, size_t len);
+
+/**
+ * @brief Complete decoding and verify the new image
+ *
+ * @return 0 if the whole image was produced and its CRC matches,
+ *         -EBADMSG otherwise, or an earlier error
+ */
+int ota_delta_finish(ota_delta_t *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_DELTA_H */
@@ -0,0 +1,248 @@
+/**
+ * @file ota_requestor.cpp
+ * @brief OTA image processing for compressed and delta images
+ *
+ * The decoder runs on the thread that delivers the blocks. On the device
+ * the Matter SDK image processor is the only caller of ota_begin(),
+ * ota_write() and ota_finish(); the `heatpump ota` shell command only
+ * prints statistics, and the decoder is exercised on the host through
+ * host/hp_ota. It reads the running image straight from the primary slot
+ * and writes through flash_img, which erases the secondary slot page by
+ * page ahead of the data.
+ */
+
+#include "ota_requestor.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/dfu/flash_img.h>
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/storage/flash_map.h>
+#include "ota_delta.h"
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(ota, CONFIG_LOG_DEFAULT_LEVEL);
+
+static K_MUTEX_DEFINE(ota_lock);
+
+/* Guarded by ota_lock */
+static ota_delta_t decoder;
+static struct flash_img_context img;
+static const struct flash_area *running;
+static int64_t started;
+static ota_stats_t stats;
+
+static int read_running(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    ARG_UNUSED(ctx);
+    return flash_area_read(running, (off_t)offset, buf, len);
+}
+
+static int write_secondary(void *ctx, const uint8_t *data, size_t len)
+{
+    ARG_UNUSED(ctx);
+    return flash_img_buffered_write(&img, data, len, false);
+}
+
+/**
+ * @brief End the transfer; called with ota_lock held
+ */
+static void ota_end(int result)
+{
+    stats.active = false;
+    stats.result = result;
+    stats.duration_ms = (uint32_t)(k_uptime_get() - started);
+    if (running != NULL) {
+        flash_area_close(running);
+        running = NULL;
+    }
+}
+
+/**
+ * @brief Confirm the running image
+ */
+int ota_requestor_init(void)
+{
+    if (boot_is_img_confirmed()) {
+        return 0;
+    }
+
+    int ret = boot_write_img_confirmed();
+    if (ret) {
+        LOG_ERR("Image not confirmed: %d", ret);
+        return ret;
+    }
+    LOG_INF("OTA: new image confirmed");
+    return 0;
+}
+
+/**
+ * @brief Start a transfer into the secondary slot
+ */
+int ota_begin(void)
+{
+    static const ota_delta_io_t io = { read_running, write_secondary, NULL };
+
+    k_mutex_lock(&ota_lock, K_FOREVER);
+    if (stats.active) {
+        k_mutex_unlock(&ota_lock);
+        return -EBUSY;
+    }
+
+    int ret = flash_area_open(FIXED_PARTITION_ID(slot0_partition), &running);
+    if (ret == 0) {
+        ret = flash_img_init(&img);
+    }
+    if (ret) {
+        LOG_ERR("OTA: slots not available: %d", ret);
+        if (running != NULL) {
+            flash_area_close(running);
+            running = NULL;
+        }
+        k_mutex_unlock(&ota_lock);
+        return ret;
+    }
+
+    ota_delta_init(&decoder, &io);
+    stats = {};
+    stats.active = true;
+    started = k_uptime_get();
+    k_mutex_unlock(&ota_lock);
+
+    LOG_INF("OTA: download started");
+    return 0;
+}
+
+/**
+ * @brief Process the next block of the image
+ */
+int ota_write(const uint8_t *block, size_t len)
+{
+    k_mutex_lock(&ota_lock, K_FOREVER);
+    if (!stats.active) {
+        k_mutex_unlock(&ota_lock);
+        return -EINVAL;
+    }
+
+    bool had_header = decoder.head_len == OTA_DELTA_HEADER_LEN;
+    int ret = ota_delta_feed(&decoder, block, len);
+
+    stats.received = decoder.received;
+    stats.written = decoder.written;
+    if (!had_header && decoder.head_len == OTA_DELTA_HEADER_LEN) {
+        stats.image_size = decoder.header.target_size;
+        stats.delta = (decoder.header.flags & OTA_DELTA_FLAG_DELTA) != 0;
+        stats.compressed = (decoder.header.flags & OTA_DELTA_FLAG_COMPRESSED) != 0;
+    }
+    if (ret) {
+        LOG_ERR("OTA: image rejected at %u bytes: %d%s", decoder.received, ret,
+                ret == -ESTALE ? " (delta for another image)" : "");
+        ota_end(ret);
+    }
+    k_mutex_unlock(&ota_lock);
+    return ret;
+}
+
+/**
+ * @brief Complete the transfer and verify the new image
+ */
+int ota_finish(void)
+{
+    k_mutex_lock(&ota_lock, K_FOREVER);
+    if (!stats.active) {
+        k_mutex_unlock(&ota_lock);
+        return -EINVAL;
+    }
+
+    int ret = ota_delta_finish(&decoder);
+    if (ret == 0) {
+        ret = flash_img_buffered_write(&img, NULL, 0, true);
+    }
+    stats.written = decoder.written;
+    ota_end(ret);
+
+    if (ret) {
+        LOG_ERR("OTA: image incomplete or corrupt: %d", ret);
+    } else {
+        LOG_INF("OTA: %u byte %s image in %u bytes, %u ms, %d bytes saved", stats.image_size,
+                stats.delta ? "delta" : "full", stats.received, stats.duration_ms,
+                (int)(stats.image_size - stats.received));
+    }
+    k_mutex_unlock(&ota_lock);
+    return ret;
+}
+
+/**
+ * @brief Mark the new image for a test boot
+ */
+int ota_apply(void)
+{
+    k_mutex_lock(&ota_lock, K_FOREVER);
+    int ret = (stats.active || stats.result != 0 || stats.image_size == 0) ? -EINVAL : 0;
+    k_mutex_unlock(&ota_lock);
+
+    if (ret == 0) {
+        ret = boot_request_upgrade(BOOT_UPGRADE_TEST);
+    }
+    if (ret) {
+        LOG_ERR("OTA: upgrade not requested: %d", ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief Abandon the transfer
+ */
+void ota_abort(void)
+{
+    k_mutex_lock(&ota_lock, K_FOREVER);
+    if (stats.active) {
+        LOG_WRN("OTA: download aborted at %u bytes", stats.received);
+        ota_end(-ECANCELED);
+    }
+    k_mutex_unlock(&ota_lock);
+}
+
+/**
+ * @brief Get the transfer counters
+ */
+void ota_get_stats(ota_stats_t *out)
+{
+    k_mutex_lock(&ota_lock, K_FOREVER);
+    *out = stats;
+    if (stats.active) {
+        out->duration_ms = (uint32_t)(k_uptime_get() - started);
+    }
+    k_mutex_unlock(&ota_lock);
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_ota(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    ota_stats_t s;
+    ota_get_stats(&s);
+
+    if (!s.active && s.received == 0) {
+        shell_print(sh, "No transfer since boot");
+        return 0;
+    }
+    shell_print(sh, "Transfer: %s", s.active ? "in progress" : s.result == 0 ? "complete" : "failed");
+    shell_print(sh, "Image:    %u bytes, %s%s", s.image_size, s.delta ? "delta" : "full",
+                s.compressed ? ", compressed" : "");
+    shell_print(sh, "Received: %u bytes in %u ms, %u written", s.received, s.duration_ms, s.written);
+    if (s.image_size > 0) {
+        shell_print(sh, "Saved:    %d bytes", (int)(s.image_size - s.received));
+    }
+    if (!s.active && s.result != 0) {
+        shell_print(sh, "Result:   %d", s.result);
+    }
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((heatpump), ota, NULL, "Show the last OTA transfer", cmd_ota, 1, 0);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,98 @@
+/**
+ * @file ota_requestor.h
+ * @brief OTA image processing for compressed and delta images
+ *
+ * Backend of the Matter OTA Requestor's image processor. Each BDX block
+ * is decoded as it arrives (ota_delta.h) and the new image is written to
+ * the MCUboot secondary slot; a delta is patched against the image
+ * running from the primary slot, which stays untouched until MCUboot
+ * swaps the slots on the next boot. Delta images cut a full transfer
+ * of a few hundred kilobytes over Thread to a few kilobytes for a small
+ * change, so the transfer takes seconds instead of minutes.
+ */
+
+#ifndef OTA_REQUESTOR_H
+#define OTA_REQUESTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Last or current transfer
+ */
+typedef struct {
+    bool active;            /**< A transfer is in progress */
+    bool delta;             /**< Delta image */
+    bool compressed;        /**< Compressed image */
+    uint32_t received;      /**< Image bytes received */
+    uint32_t image_size;    /**< Size of the new firmware */
+    uint32_t written;       /**< Bytes written to the secondary slot */
+    uint32_t duration_ms;   /**< Transfer time, from begin to finish */
+    int result;             /**< 0, or the negative errno that ended it */
+} ota_stats_t;
+
+/**
+ * @brief Confirm the running image
+ *
+ * Call once the application is up; MCUboot reverts a test image that
+ * was never confirmed on the next reset.
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int ota_requestor_init(void);
+
+/**
+ * @brief Start a transfer into the secondary slot
+ *
+ * @return 0 on success, -EBUSY during a transfer, negative errno on failure
+ */
+int ota_begin(void);
+
+/**
+ * @brief Process the next block of the image
+ *
+ * @return 0 on success, or the decoder error (see ota_delta_feed()),
+ *         after which the transfer must be aborted
+ */
+int ota_write(const uint8_t *block, size_t len);
+
+/**
+ * @brief Complete the transfer and verify the new image
+ *
+ * @return 0 if the secondary slot holds the complete new image,
+ *         negative errno otherwise
+ */
+int ota_finish(void);
+
+/**
+ * @brief Mark the new image for a test boot
+ *
+ * MCUboot boots it once after the next reset; ota_requestor_init()
+ * confirms it from there.
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int ota_apply(void);
+
+/**
+ * @brief Abandon the transfer
+ */
+void ota_abort(void);
+
+/**
+ * @brief Get the transfer counters
+ *
+ * @param stats Output
+ */
+void ota_get_stats(ota_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_REQUESTOR_H */
@@ -0,0 +1,236 @@
+/**
+ * @file remote_temp.cpp
+ * @brief Remote room temperature feed for the heat pump
+ *
+ * Readings from Matter Temperature Measurement sources are stored per
+ * source slot and evaluated on the system workqueue. The evaluation
+ * combines the fresh sources, quantises the result to 0.5°C and hands
+ * it to the driver only when it differs from what the unit already has,
+ * or when the periodic refresh is due, never faster than the minimum
+ * send interval.
+ */
+
+#include "remote_temp.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "heatpump_driver.h"
+#include "log_ratelimit.h"
+
+LOG_MODULE_REGISTER(remote_temp, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* Range accepted by the CN105 0x07 frame, in Matter units (0.01°C) */
+#define REMOTE_TEMP_MIN   1000
+#define REMOTE_TEMP_MAX   4100
+#define REMOTE_TEMP_STEP  50     /* 0.5°C protocol resolution */
+
+/* Value sent to the unit to select its internal sensor */
+#define REMOTE_TEMP_INTERNAL 0
+/* Nothing sent yet, so the first evaluation always writes a frame */
+#define REMOTE_TEMP_UNKNOWN  INT16_MIN
+
+#define NUM_SOURCES CONFIG_APP_REMOTE_TEMP_MAX_SOURCES
+
+/**
+ * @brief Last reading from one temperature source
+ */
+struct remote_temp_source {
+    int64_t updated;  /* Uptime of the last report in ms */
+    int16_t value;    /* Matter units (0.01°C) */
+    bool valid;
+};
+
+static struct remote_temp_source sources[NUM_SOURCES];
+static K_MUTEX_DEFINE(sources_lock);
+
+#if defined(CONFIG_APP_REMOTE_TEMP_POLICY_MIN)
+static remote_temp_policy_e policy = REMOTE_TEMP_POLICY_MIN;
+#elif defined(CONFIG_APP_REMOTE_TEMP_POLICY_MAX)
+static remote_temp_policy_e policy = REMOTE_TEMP_POLICY_MAX;
+#elif defined(CONFIG_APP_REMOTE_TEMP_POLICY_PRIMARY)
+static remote_temp_policy_e policy = REMOTE_TEMP_POLICY_PRIMARY;
+#else
+static remote_temp_policy_e policy = REMOTE_TEMP_POLICY_AVERAGE;
+#endif
+
+/* Only touched from the workqueue */
+static int16_t last_sent = REMOTE_TEMP_UNKNOWN;
+static int64_t last_send_time = -CONFIG_APP_REMOTE_TEMP_MIN_INTERVAL_MS;
+
+static struct k_work_delayable eval_work;
+
+/**
+ * @brief Clamp and round a reading to the protocol resolution
+ */
+static int16_t remote_temp_quantize(int32_t value)
+{
+    value = CLAMP(value, REMOTE_TEMP_MIN, REMOTE_TEMP_MAX);
+    return (int16_t)(((value + REMOTE_TEMP_STEP / 2) / REMOTE_TEMP_STEP) * REMOTE_TEMP_STEP);
+}
+
+/**
+ * @brief Evaluate the sources and feed the heat pump if needed
+ *
+ * Reschedules itself for the next point in time at which the outcome
+ * can change without a new report: a source going stale, the rate
+ * limit expiring, the refresh interval elapsing or, after a frame the
+ * driver did not accept, the retry.
+ */
+static void remote_temp_evaluate(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    int64_t now = k_uptime_get();
+    int64_t next_check = INT64_MAX;
+    int32_t sum = 0;
+    int32_t lo = INT32_MAX;
+    int32_t hi = INT32_MIN;
+    int32_t primary = 0;
+    int count = 0;
+
+    k_mutex_lock(&sources_lock, K_FOREVER);
+    for (int i = 0; i < NUM_SOURCES; i++) {
+        struct remote_temp_source *src = &sources[i];
+        if (!src->valid) {
+            continue;
+        }
+        int64_t expiry = src->updated + CONFIG_APP_REMOTE_TEMP_STALE_MS;
+        if (now >= expiry) {
+            LOG_INF("Remote temperature source %d stale", i);
+            src->valid = false;
+            continue;
+        }
+        next_check = MIN(next_check, expiry);
+        if (count == 0) {
+            primary = src->value;
+        }
+        sum += src->value;
+        lo = MIN(lo, (int32_t)src->value);
+        hi = MAX(hi, (int32_t)src->value);
+        count++;
+    }
+    k_mutex_unlock(&sources_lock);
+
+    int16_t target = REMOTE_TEMP_INTERNAL;
+    if (count > 0) {
+        switch (policy) {
+            case REMOTE_TEMP_POLICY_MIN:
+                target = remote_temp_quantize(lo);
+                break;
+            case REMOTE_TEMP_POLICY_MAX:
+                target = remote_temp_quantize(hi);
+                break;
+            case REMOTE_TEMP_POLICY_PRIMARY:
+                target = remote_temp_quantize(primary);
+                break;
+            case REMOTE_TEMP_POLICY_AVERAGE:
+            default:
+                target = remote_temp_quantize(sum / count);
+                break;
+        }
+    }
+
+    bool refresh_due = CONFIG_APP_REMOTE_TEMP_REFRESH_MS > 0 &&
+                       target != REMOTE_TEMP_INTERNAL &&
+                       now - last_send_time >= CONFIG_APP_REMOTE_TEMP_REFRESH_MS;
+
+    if (target != last_sent || refresh_due) {
+        int64_t earliest = last_send_time + CONFIG_APP_REMOTE_TEMP_MIN_INTERVAL_MS;
+        if (now < earliest) {
+            next_check = MIN(next_check, earliest);
+        } else {
+            if (target == REMOTE_TEMP_INTERNAL) {
+                if (last_sent != REMOTE_TEMP_INTERNAL && last_sent != REMOTE_TEMP_UNKNOWN) {
+                    LOG_WRN("No fresh remote temperature, reverting to internal sensor");
+                }
+            } else if (target != last_sent) {
+                APP_LOG_RATELIMITED(INF, "Remote temperature %d.%d°C from %d source(s)",
+                                    target / 100, (target % 100) / 10, count);
+            }
+            int ret = heatpump_set_remote_temperature(target);
+            if (ret == 0) {
+                last_sent = target;
+                last_send_time = now;
+            } else {
+                /* Not queued (driver down, queue full): try again later */
+                APP_LOG_RATELIMITED(WRN, "Remote temperature not queued: %d", ret);
+                next_check = MIN(next_check, now + CONFIG_APP_REMOTE_TEMP_MIN_INTERVAL_MS);
+            }
+        }
+    }
+
+    if (CONFIG_APP_REMOTE_TEMP_REFRESH_MS > 0 && last_sent > REMOTE_TEMP_INTERNAL) {
+        next_check = MIN(next_check, last_send_time + CONFIG_APP_REMOTE_TEMP_REFRESH_MS);
+    }
+
+    if (next_check != INT64_MAX) {
+        k_work_reschedule(&eval_work, K_MSEC(MAX(next_check - now, (int64_t)0)));
+    }
+}
+
+/**
+ * @brief Initialize the remote temperature pipeline
+ */
+int remote_temp_init(void)
+{
+    LOG_INF("Initializing remote temperature feed (%d sources)", NUM_SOURCES);
+
+    k_work_init_delayable(&eval_work, remote_temp_evaluate);
+
+    /* Put the unit on a known sensor; a stale remote value may have
+     * survived our own reboot */
+    k_work_schedule(&eval_work, K_NO_WAIT);
+    return 0;
+}
+
+/**
+ * @brief Report a reading from a temperature source
+ */
+int remote_temp_report(uint8_t source, int16_t matter_temp)
+{
+    if (source >= NUM_SOURCES) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&sources_lock, K_FOREVER);
+    sources[source].value = matter_temp;
+    sources[source].updated = k_uptime_get();
+    sources[source].valid = true;
+    k_mutex_unlock(&sources_lock);
+
+    k_work_reschedule(&eval_work, K_NO_WAIT);
+    return 0;
+}
+
+/**
+ * @brief Drop a source immediately
+ */
+int remote_temp_source_lost(uint8_t source)
+{
+    if (source >= NUM_SOURCES) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&sources_lock, K_FOREVER);
+    sources[source].valid = false;
+    k_mutex_unlock(&sources_lock);
+
+    k_work_reschedule(&eval_work, K_NO_WAIT);
+    return 0;
+}
+
+/**
+ * @brief Select how fresh sources are combined
+ */
+void remote_temp_set_policy(remote_temp_policy_e new_policy)
+{
+    policy = new_policy;
+    k_work_reschedule(&eval_work, K_NO_WAIT);
+}
+
+/**
+ * @brief Check whether the unit is regulating on a remote reading
+ */
+bool remote_temp_is_active(void)
+{
+    return last_sent > REMOTE_TEMP_INTERNAL;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file remote_temp.h
+ * @brief Remote room temperature feed for the heat pump
+ *
+ * Collects readings from one or more Matter Temperature Measurement
+ * sources (bindings or subscriptions), combines them according to the
+ * configured policy and feeds the result to the heat pump through
+ * heatpump_set_remote_temperature().
+ *
+ * Readings are quantised to the 0.5°C resolution of the CN105 0x07
+ * frame, so sensor noise below that step never reaches the bus. Frames
+ * are rate limited and go out as low-priority items in the protocol
+ * schedule. When every source goes stale the unit is switched back to
+ * its internal sensor.
+ */
+
+#ifndef REMOTE_TEMP_H
+#define REMOTE_TEMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How readings from several fresh sources are combined
+ */
+typedef enum {
+    REMOTE_TEMP_POLICY_AVERAGE = 0,  /**< Mean of all fresh sources */
+    REMOTE_TEMP_POLICY_MIN,          /**< Coldest fresh source */
+    REMOTE_TEMP_POLICY_MAX,          /**< Warmest fresh source */
+    REMOTE_TEMP_POLICY_PRIMARY       /**< Lowest-numbered fresh source */
+} remote_temp_policy_e;
+
+/**
+ * @brief Initialize the remote temperature pipeline
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int remote_temp_init(void);
+
+/**
+ * @brief Report a reading from a temperature source
+ *
+ * Called from the Matter client side whenever a bound or subscribed
+ * Temperature Measurement MeasuredValue is received, including
+ * unchanged values, since each call also refreshes the source.
+ *
+ * @param source Source slot (0 to CONFIG_APP_REMOTE_TEMP_MAX_SOURCES - 1)
+ * @param matter_temp Temperature in Matter units (0.01°C)
+ * @return 0 on success, -EINVAL for an unknown source
+ */
+int remote_temp_report(uint8_t source, int16_t matter_temp);
+
+/**
+ * @brief Drop a source immediately
+ *
+ * Use when a binding is removed, a subscription is lost or the sensor
+ * reports a null MeasuredValue, rather than waiting for it to go stale.
+ *
+ * @param source Source slot
+ * @return 0 on success, -EINVAL for an unknown source
+ */
+int remote_temp_source_lost(uint8_t source);
+
+/**
+ * @brief Select how fresh sources are combined
+ *
+ * @param policy Combining policy
+ */
+void remote_temp_set_policy(remote_temp_policy_e policy);
+
+/**
+ * @brief Check whether the unit is regulating on a remote reading
+ *
+ * @return true if a remote temperature is being fed, false if the unit
+ *         uses its internal sensor
+ */
+bool remote_temp_is_active(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REMOTE_TEMP_H */
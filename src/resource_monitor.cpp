@@ -0,0 +1,199 @@
+/**
+ * @file resource_monitor.cpp
+ * @brief Stack, heap and packet slab high-water marks
+ *
+ * Stack peaks come from the fill pattern written by CONFIG_INIT_STACKS
+ * (k_thread_stack_space_get), the heap peak from the sys_heap runtime
+ * statistics and the slab peak from the driver. The interrupt stack is
+ * not covered since it is not a thread.
+ */
+
+#include "resource_monitor.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/sys_heap.h>
+#include "heatpump_driver.h"
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(resource_monitor, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define RESOURCE_MAX_ENTRIES 16
+#define STACK_ROUND          64
+#define HEAP_ROUND           1024
+
+#if defined(CONFIG_HEAP_MEM_POOL_SIZE) && CONFIG_HEAP_MEM_POOL_SIZE > 0
+/* Defined by the kernel for k_malloc() */
+extern "C" struct k_heap _system_heap;
+#endif
+
+/**
+ * @brief Kconfig symbols sizing well-known thread stacks
+ */
+static const struct {
+    const char *thread;
+    const char *kconfig;
+} stack_symbols[] = {
+    { "heatpump", "CONFIG_APP_HEATPUMP_THREAD_STACK_SIZE" },
+    { "main", "CONFIG_MAIN_STACK_SIZE" },
+    { "sysworkq", "CONFIG_SYSTEM_WORKQUEUE_STACK_SIZE" },
+    { "idle", "CONFIG_IDLE_STACK_SIZE" },
+    { "logging", "CONFIG_LOG_PROCESS_THREAD_STACK_SIZE" },
+    { "shell_uart", "CONFIG_SHELL_STACK_SIZE" },
+    { "openthread", "CONFIG_OPENTHREAD_THREAD_STACK_SIZE" },
+    { "matter", "CONFIG_APP_MATTER_THREAD_STACK_SIZE" },
+};
+
+struct collect_ctx {
+    resource_usage_t *out;
+    size_t max;
+    size_t count;
+};
+
+static struct k_work_delayable report_work;
+
+/**
+ * @brief Add the configured headroom and round up
+ */
+static uint32_t with_headroom(uint32_t peak, uint32_t round)
+{
+    uint64_t needed = (uint64_t)peak * (100U + CONFIG_APP_RESOURCE_HEADROOM_PCT) / 100U;
+    return (uint32_t)ROUND_UP(needed, round);
+}
+
+static const char *stack_symbol(const char *thread)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(stack_symbols); i++) {
+        if (strncmp(thread, stack_symbols[i].thread, strlen(stack_symbols[i].thread)) == 0) {
+            return stack_symbols[i].kconfig;
+        }
+    }
+    return NULL;
+}
+
+static void collect_thread(const struct k_thread *cthread, void *user_data)
+{
+    struct collect_ctx *ctx = (struct collect_ctx *)user_data;
+    struct k_thread *thread = (struct k_thread *)cthread;
+    size_t unused;
+
+    if (ctx->count >= ctx->max || k_thread_stack_space_get(thread, &unused) != 0) {
+        return;
+    }
+
+    const char *name = k_thread_name_get(thread);
+    resource_usage_t *u = &ctx->out[ctx->count++];
+    u->name = (name && name[0]) ? name : "?";
+    u->kconfig = stack_symbol(u->name);
+    u->unit = "B";
+    u->size = (uint32_t)thread->stack_info.size;
+    u->peak = (uint32_t)(thread->stack_info.size - unused);
+    u->suggested = with_headroom(u->peak, STACK_ROUND);
+}
+
+/**
+ * @brief Collect current high-water marks
+ */
+size_t resource_monitor_collect(resource_usage_t *out, size_t max)
+{
+    struct collect_ctx ctx = { out, max, 0 };
+
+    k_thread_foreach(collect_thread, &ctx);
+
+#if defined(CONFIG_HEAP_MEM_POOL_SIZE) && CONFIG_HEAP_MEM_POOL_SIZE > 0
+    struct sys_memory_stats heap;
+    if (ctx.count < max && sys_heap_runtime_stats_get(&_system_heap.heap, &heap) == 0) {
+        resource_usage_t *u = &out[ctx.count++];
+        u->name = "heap";
+        u->kconfig = "CONFIG_HEAP_MEM_POOL_SIZE";
+        u->unit = "B";
+        u->size = CONFIG_HEAP_MEM_POOL_SIZE;
+        u->peak = (uint32_t)heap.max_allocated_bytes;
+        u->suggested = with_headroom(u->peak, HEAP_ROUND);
+    }
+#endif
+
+    heatpump_stats_t st;
+    if (ctx.count < max && heatpump_get_stats(&st) == 0) {
+        resource_usage_t *u = &out[ctx.count++];
+        u->name = "packet_slab";
+        u->kconfig = "CONFIG_APP_HEATPUMP_PACKET_BUFFERS";
+        u->unit = "blk";
+        u->size = st.slab_size;
+        u->peak = st.slab_peak;
+        u->suggested = MAX(with_headroom(u->peak, 1), 1U);
+    }
+
+    return ctx.count;
+}
+
+/**
+ * @brief Log the report now
+ */
+void resource_monitor_log(void)
+{
+    resource_usage_t usage[RESOURCE_MAX_ENTRIES];
+    size_t n = resource_monitor_collect(usage, ARRAY_SIZE(usage));
+
+    LOG_INF("Resource high-water marks (%d%% headroom):", CONFIG_APP_RESOURCE_HEADROOM_PCT);
+    for (size_t i = 0; i < n; i++) {
+        const resource_usage_t *u = &usage[i];
+        if (u->kconfig) {
+            LOG_INF("  %-12s %6u/%6u %s -> %s=%u", u->name, u->peak, u->size, u->unit,
+                    u->kconfig, u->suggested);
+        } else {
+            LOG_INF("  %-12s %6u/%6u %s", u->name, u->peak, u->size, u->unit);
+        }
+    }
+}
+
+static void report_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    resource_monitor_log();
+    k_work_schedule(&report_work, K_SECONDS(CONFIG_APP_RESOURCE_REPORT_INTERVAL_S));
+}
+
+/**
+ * @brief Start the periodic report
+ */
+int resource_monitor_init(void)
+{
+    if (CONFIG_APP_RESOURCE_REPORT_INTERVAL_S > 0) {
+        k_work_init_delayable(&report_work, report_handler);
+        k_work_schedule(&report_work, K_SECONDS(CONFIG_APP_RESOURCE_REPORT_INTERVAL_S));
+    }
+    return 0;
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_resources(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    resource_usage_t usage[RESOURCE_MAX_ENTRIES];
+    size_t n = resource_monitor_collect(usage, ARRAY_SIZE(usage));
+
+    shell_print(sh, "%-12s %8s %8s %5s  %s (%d%% headroom)", "resource", "peak", "size", "use",
+                "suggested", CONFIG_APP_RESOURCE_HEADROOM_PCT);
+    for (size_t i = 0; i < n; i++) {
+        const resource_usage_t *u = &usage[i];
+        uint32_t pct = u->size > 0 ? u->peak * 100U / u->size : 0;
+        if (u->kconfig) {
+            shell_print(sh, "%-12s %8u %8u %4u%%  %s=%u", u->name, u->peak, u->size, pct,
+                        u->kconfig, u->suggested);
+        } else {
+            shell_print(sh, "%-12s %8u %8u %4u%%", u->name, u->peak, u->size, pct);
+        }
+    }
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((heatpump), resources, NULL,
+                 "Show stack, heap and slab high-water marks with suggested sizes",
+                 cmd_resources, 1, 0);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,63 @@
+/**
+ * @file resource_monitor.h
+ * @brief Stack, heap and packet slab high-water marks
+ *
+ * Collects the peak usage of every thread stack, the system heap and
+ * the driver packet slab, and suggests the Kconfig value that would
+ * cover the peak plus CONFIG_APP_RESOURCE_HEADROOM_PCT. The report is
+ * logged every CONFIG_APP_RESOURCE_REPORT_INTERVAL_S and printed by the
+ * `heatpump resources` shell command.
+ *
+ * Peaks only reflect the code paths exercised so far; take the report
+ * after the unit has run through connect, settings changes, function
+ * code access and Matter commissioning.
+ */
+
+#ifndef RESOURCE_MONITOR_H
+#define RESOURCE_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Usage of one monitored resource
+ */
+typedef struct {
+    const char *name;     /**< Thread name, "heap" or "packet_slab" */
+    const char *kconfig;  /**< Kconfig symbol sizing it, NULL if not ours to tune */
+    const char *unit;     /**< "B" for bytes, "blk" for slab blocks */
+    uint32_t size;        /**< Configured size */
+    uint32_t peak;        /**< High-water mark */
+    uint32_t suggested;   /**< Peak plus headroom, rounded up */
+} resource_usage_t;
+
+/**
+ * @brief Start the periodic report
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int resource_monitor_init(void);
+
+/**
+ * @brief Collect current high-water marks
+ *
+ * @param out Array to fill
+ * @param max Number of entries in @a out
+ * @return Number of entries filled
+ */
+size_t resource_monitor_collect(resource_usage_t *out, size_t max);
+
+/**
+ * @brief Log the report now
+ */
+void resource_monitor_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RESOURCE_MONITOR_H */
@@ -0,0 +1,840 @@
+/**
+ * @file schedule.cpp
+ * @brief On-device weekly thermostat schedule
+ *
+ * Two records live under the "sched" settings subtree:
+ * - sched/tr:  transitions and the enabled flag
+ * - sched/pre: preset setpoints, by scenario
+ *
+ * Transitions sharing time, mode and setpoints are stored once with
+ * their day bits combined. The driver thread calls schedule_poll() on
+ * every loop; once a minute it finds the transition in effect (the
+ * latest one at or before the current minute of the week) and applies
+ * it if it has not been applied yet, so a reboot or a late clock
+ * catches up with the current one but never replays older ones.
+ */
+
+#include "schedule.h"
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include "heatpump_driver.h"
+#include "matter_config.h"
+#include "matter_conversions.h"
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+LOG_MODULE_REGISTER(schedule, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* Bump when a record layout changes; older records are ignored */
+#define SCHEDULE_VERSION 1
+
+#define MAX_TRANSITIONS CONFIG_APP_SCHEDULE_MAX_TRANSITIONS
+
+#define MINUTES_PER_DAY  1440
+#define MINUTES_PER_WEEK (7 * MINUTES_PER_DAY)
+/* 1970-01-01 was a Thursday */
+#define EPOCH_WEEKDAY    4
+
+/* Nothing evaluated or applied yet */
+#define SCHEDULE_NONE    (-1)
+
+/**
+ * @brief Transition record (sched/tr)
+ */
+struct schedule_record {
+    schedule_transition_t transitions[MAX_TRANSITIONS];
+    uint8_t version;
+    uint8_t count;
+    uint8_t enabled;
+    uint8_t reserved;
+};
+
+/**
+ * @brief Preset record (sched/pre)
+ */
+struct preset_record {
+    int16_t heating[SCHEDULE_PRESET_COUNT];
+    int16_t cooling[SCHEDULE_PRESET_COUNT];
+    uint8_t version;
+    uint8_t reserved[3];
+};
+
+static struct schedule_record table;
+static struct preset_record presets;
+static bool have_table;
+static bool have_presets;
+static K_MUTEX_DEFINE(schedule_lock);
+
+/* Local time is time_offset_s plus the uptime in seconds */
+static int64_t time_offset_s;
+static bool time_valid;
+
+/* Evaluation state, guarded by schedule_lock */
+static int32_t last_minute = SCHEDULE_NONE;  /* Minute of the week last evaluated */
+static int32_t applied_key = SCHEDULE_NONE;  /* Minute of the week of the applied transition */
+static uint32_t generation;                  /* Bumped on every schedule change */
+
+static bool setpoint_valid(int16_t setpoint)
+{
+    hp_temp_t temp;
+
+    return setpoint == SCHEDULE_SETPOINT_NONE || matter_setpoint_to_hp(setpoint, &temp) == 0;
+}
+
+static bool mode_valid(uint8_t mode)
+{
+    return mode == SCHEDULE_MODE_KEEP || mode == MATTER_THERMOSTAT_MODE_OFF ||
+           matter_mode_to_hp(mode) != NULL;
+}
+
+static bool transition_equal(const schedule_transition_t *a, const schedule_transition_t *b)
+{
+    return a->transition_time == b->transition_time && a->system_mode == b->system_mode &&
+           a->preset == b->preset && a->heating_setpoint == b->heating_setpoint &&
+           a->cooling_setpoint == b->cooling_setpoint;
+}
+
+static int compare_transition_time(const void *a, const void *b)
+{
+    const schedule_transition_t *x = (const schedule_transition_t *)a;
+    const schedule_transition_t *y = (const schedule_transition_t *)b;
+
+    return (int)x->transition_time - (int)y->transition_time;
+}
+
+/**
+ * @brief Read one record from the settings backend
+ *
+ * Records of a different size or version are skipped, so a change of
+ * CONFIG_APP_SCHEDULE_MAX_TRANSITIONS starts with an empty schedule.
+ */
+static int schedule_read(size_t len, settings_read_cb read_cb, void *cb_arg,
+                         void *dst, size_t size, const uint8_t *version, bool *loaded)
+{
+    if (len != size) {
+        return 0;
+    }
+    ssize_t rc = read_cb(cb_arg, dst, size);
+    if (rc < 0) {
+        return (int)rc;
+    }
+    *loaded = ((size_t)rc == size && *version == SCHEDULE_VERSION);
+    return 0;
+}
+
+static int schedule_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                                 void *cb_arg)
+{
+    const char *next;
+
+    if (settings_name_steq(name, "tr", &next) && !next) {
+        return schedule_read(len, read_cb, cb_arg, &table, sizeof(table), &table.version,
+                             &have_table);
+    }
+    if (settings_name_steq(name, "pre", &next) && !next) {
+        return schedule_read(len, read_cb, cb_arg, &presets, sizeof(presets), &presets.version,
+                             &have_presets);
+    }
+    return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(schedule, "sched", NULL, schedule_settings_set, NULL, NULL);
+
+/**
+ * @brief Store the transitions and re-evaluate; call with schedule_lock held
+ *
+ * Schedule edits are rare and made by a user, so they are written
+ * through rather than batched.
+ */
+static int schedule_commit(void)
+{
+    table.version = SCHEDULE_VERSION;
+    generation++;
+    last_minute = SCHEDULE_NONE;
+    applied_key = SCHEDULE_NONE;
+
+    int ret = settings_save_one("sched/tr", &table, sizeof(table));
+    if (ret) {
+        LOG_ERR("Failed to store the schedule: %d", ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief Validate transitions for schedule_set_days()
+ */
+static int schedule_check(const schedule_transition_t *transitions, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const schedule_transition_t *t = &transitions[i];
+
+        if (t->transition_time >= MINUTES_PER_DAY || !mode_valid(t->system_mode) ||
+            t->preset > SCHEDULE_PRESET_COUNT || !setpoint_valid(t->heating_setpoint) ||
+            !setpoint_valid(t->cooling_setpoint)) {
+            return -EINVAL;
+        }
+        /* Two transitions at the same time of day would race */
+        for (size_t j = 0; j < i; j++) {
+            if (transitions[j].transition_time == t->transition_time) {
+                return -EINVAL;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Load the stored schedule and presets
+ */
+int schedule_init(void)
+{
+    int ret = settings_subsys_init();
+    if (ret) {
+        LOG_ERR("settings_subsys_init failed: %d", ret);
+        return ret;
+    }
+
+    ret = settings_load_subtree("sched");
+    if (ret) {
+        LOG_WRN("Failed to load the stored schedule: %d", ret);
+    }
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    if (!have_table || table.count > MAX_TRANSITIONS) {
+        memset(&table, 0, sizeof(table));
+        table.enabled = 1;
+    }
+    if (!have_presets) {
+        memset(&presets, 0, sizeof(presets));
+        for (int i = 0; i < SCHEDULE_PRESET_COUNT; i++) {
+            presets.heating[i] = SCHEDULE_SETPOINT_NONE;
+            presets.cooling[i] = SCHEDULE_SETPOINT_NONE;
+        }
+    }
+    LOG_INF("Schedule: %u transitions, %s", table.count, table.enabled ? "enabled" : "disabled");
+    k_mutex_unlock(&schedule_lock);
+    return 0;
+}
+
+/**
+ * @brief Replace the transitions of some days
+ */
+int schedule_set_days(uint8_t days, const schedule_transition_t *transitions, size_t count)
+{
+    if ((days & SCHEDULE_DAY_ALL) == 0 || (days & ~SCHEDULE_DAY_ALL) != 0 ||
+        (count > 0 && transitions == NULL)) {
+        return -EINVAL;
+    }
+    int ret = schedule_check(transitions, count);
+    if (ret) {
+        return ret;
+    }
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    struct schedule_record next = table;
+
+    /* Drop these days from the existing transitions */
+    size_t n = 0;
+    for (size_t i = 0; i < next.count; i++) {
+        schedule_transition_t t = next.transitions[i];
+        t.day_of_week &= ~days;
+        if (t.day_of_week != 0) {
+            next.transitions[n++] = t;
+        }
+    }
+
+    /* Add the new ones, sharing an entry with an identical transition */
+    for (size_t i = 0; i < count; i++) {
+        schedule_transition_t t = transitions[i];
+        t.day_of_week = days;
+        t.reserved = 0;
+        if (t.preset != SCHEDULE_PRESET_NONE) {
+            t.heating_setpoint = SCHEDULE_SETPOINT_NONE;
+            t.cooling_setpoint = SCHEDULE_SETPOINT_NONE;
+        }
+
+        size_t j;
+        for (j = 0; j < n; j++) {
+            if (transition_equal(&next.transitions[j], &t)) {
+                next.transitions[j].day_of_week |= days;
+                break;
+            }
+        }
+        if (j == n) {
+            if (n == MAX_TRANSITIONS) {
+                k_mutex_unlock(&schedule_lock);
+                return -ENOSPC;
+            }
+            next.transitions[n++] = t;
+        }
+    }
+
+    next.count = (uint8_t)n;
+    qsort(next.transitions, n, sizeof(next.transitions[0]), compare_transition_time);
+    table = next;
+    ret = schedule_commit();
+    k_mutex_unlock(&schedule_lock);
+
+    LOG_INF("Schedule for days 0x%02x: %u transitions, %u stored", days, (unsigned int)count,
+            (unsigned int)n);
+    return ret;
+}
+
+/**
+ * @brief Remove all transitions
+ */
+int schedule_clear(void)
+{
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    table.count = 0;
+    memset(table.transitions, 0, sizeof(table.transitions));
+    int ret = schedule_commit();
+    k_mutex_unlock(&schedule_lock);
+
+    LOG_INF("Schedule cleared");
+    return ret;
+}
+
+/**
+ * @brief Get the transitions of some days
+ */
+int schedule_get_days(uint8_t days, schedule_transition_t *transitions, size_t max)
+{
+    int n = 0;
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    for (size_t i = 0; i < table.count; i++) {
+        uint8_t match = table.transitions[i].day_of_week & days;
+        if (match == 0) {
+            continue;
+        }
+        if ((size_t)n == max) {
+            n = -ENOSPC;
+            break;
+        }
+        transitions[n] = table.transitions[i];
+        transitions[n].day_of_week = match;
+        n++;
+    }
+    k_mutex_unlock(&schedule_lock);
+    return n;
+}
+
+/**
+ * @brief Set the setpoints of a preset
+ */
+int schedule_set_preset(schedule_preset_e scenario, int16_t heating_setpoint,
+                        int16_t cooling_setpoint)
+{
+    if (scenario < 1 || scenario > SCHEDULE_PRESET_COUNT || !setpoint_valid(heating_setpoint) ||
+        !setpoint_valid(cooling_setpoint)) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    presets.version = SCHEDULE_VERSION;
+    presets.heating[scenario - 1] = heating_setpoint;
+    presets.cooling[scenario - 1] = cooling_setpoint;
+    /* Re-apply the transition in effect if it uses this preset */
+    generation++;
+    last_minute = SCHEDULE_NONE;
+    applied_key = SCHEDULE_NONE;
+    int ret = settings_save_one("sched/pre", &presets, sizeof(presets));
+    k_mutex_unlock(&schedule_lock);
+
+    if (ret) {
+        LOG_ERR("Failed to store preset %d: %d", scenario, ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief Get the setpoints of a preset
+ */
+int schedule_get_preset(schedule_preset_e scenario, int16_t *heating_setpoint,
+                        int16_t *cooling_setpoint)
+{
+    if (scenario < 1 || scenario > SCHEDULE_PRESET_COUNT) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    *heating_setpoint = presets.heating[scenario - 1];
+    *cooling_setpoint = presets.cooling[scenario - 1];
+    k_mutex_unlock(&schedule_lock);
+    return 0;
+}
+
+/**
+ * @brief Turn schedule execution on or off
+ */
+int schedule_set_enabled(bool enabled)
+{
+    int ret = 0;
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    if (table.enabled != (enabled ? 1 : 0)) {
+        table.enabled = enabled ? 1 : 0;
+        ret = schedule_commit();
+        LOG_INF("Schedule %s", enabled ? "enabled" : "disabled");
+    }
+    k_mutex_unlock(&schedule_lock);
+    return ret;
+}
+
+/**
+ * @brief Check whether schedule execution is on
+ */
+bool schedule_is_enabled(void)
+{
+    return table.enabled != 0;
+}
+
+/**
+ * @brief Set the local wall-clock time
+ */
+void schedule_set_local_time(int64_t local_s)
+{
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    time_offset_s = local_s - k_uptime_get() / 1000;
+    time_valid = true;
+    last_minute = SCHEDULE_NONE;
+    k_mutex_unlock(&schedule_lock);
+}
+
+/**
+ * @brief Get the local wall-clock time
+ */
+int schedule_get_local_time(int64_t *local_s)
+{
+    int ret = -EAGAIN;
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    if (time_valid) {
+        *local_s = time_offset_s + k_uptime_get() / 1000;
+        ret = 0;
+    }
+    k_mutex_unlock(&schedule_lock);
+    return ret;
+}
+
+/**
+ * @brief Minute of the week (0 = Sunday 00:00) of a local time
+ */
+static int32_t week_minute(int64_t local_s)
+{
+    int64_t days = local_s / 86400;
+    int32_t weekday = (int32_t)((days + EPOCH_WEEKDAY) % 7);
+
+    return weekday * MINUTES_PER_DAY + (int32_t)((local_s % 86400) / 60);
+}
+
+/**
+ * @brief Find the transition in effect; call with schedule_lock held
+ *
+ * @param minute Current minute of the week
+ * @param index Receives the index of the transition
+ * @return Minute of the week the transition started, SCHEDULE_NONE if
+ *         there are no transitions
+ */
+static int32_t schedule_active(int32_t minute, size_t *index)
+{
+    int32_t best_start = SCHEDULE_NONE;
+    int32_t best_age = MINUTES_PER_WEEK;
+
+    for (size_t i = 0; i < table.count; i++) {
+        const schedule_transition_t *t = &table.transitions[i];
+
+        for (int day = 0; day < 7; day++) {
+            if (!(t->day_of_week & BIT(day))) {
+                continue;
+            }
+            int32_t start = day * MINUTES_PER_DAY + t->transition_time;
+            int32_t age = (minute - start + MINUTES_PER_WEEK) % MINUTES_PER_WEEK;
+            if (age < best_age) {
+                best_age = age;
+                best_start = start;
+                *index = i;
+            }
+        }
+    }
+    return best_start;
+}
+
+/**
+ * @brief Setpoint to send for a system mode
+ *
+ * Auto uses the middle of the heating and cooling setpoints, since the
+ * unit has a single target temperature.
+ */
+static int16_t schedule_pick_setpoint(int mode, int16_t heating, int16_t cooling)
+{
+    switch (mode) {
+        case MATTER_THERMOSTAT_MODE_HEAT:
+            return heating;
+        case MATTER_THERMOSTAT_MODE_COOL:
+        case MATTER_THERMOSTAT_MODE_DRY:
+            return cooling;
+        case MATTER_THERMOSTAT_MODE_AUTO:
+            if (heating != SCHEDULE_SETPOINT_NONE && cooling != SCHEDULE_SETPOINT_NONE) {
+                return (int16_t)((heating + cooling) / 2);
+            }
+            return heating != SCHEDULE_SETPOINT_NONE ? heating : cooling;
+        default:
+            return SCHEDULE_SETPOINT_NONE;
+    }
+}
+
+/**
+ * @brief Apply one transition as a single SET frame
+ *
+ * Runs on the driver thread, so the settings command executes inline.
+ */
+static int schedule_apply(const schedule_transition_t *t)
+{
+    heatpump_settings_t s = {};
+    uint32_t fields = 0;
+    int mode = t->system_mode;
+
+    if (mode == SCHEDULE_MODE_KEEP) {
+        heatpump_settings_t current;
+        if (heatpump_get_settings(&current) != 0) {
+            return -EIO;
+        }
+        mode = matter_mode_from_hp(current.mode);
+    } else if (mode == MATTER_THERMOSTAT_MODE_OFF) {
+        s.power = "OFF";
+        fields |= HEATPUMP_FIELD_POWER;
+    } else {
+        s.power = "ON";
+        s.mode = matter_mode_to_hp((uint8_t)mode);
+        fields |= HEATPUMP_FIELD_POWER | HEATPUMP_FIELD_MODE;
+    }
+
+    int16_t setpoint = schedule_pick_setpoint(mode, t->heating_setpoint, t->cooling_setpoint);
+    if (setpoint != SCHEDULE_SETPOINT_NONE) {
+        (void)matter_setpoint_to_hp(setpoint, &s.temperature);
+        fields |= HEATPUMP_FIELD_TEMP;
+    }
+    if (fields == 0) {
+        return 0;
+    }
+
+    LOG_INF("Schedule step %02u:%02u: power %s mode %s setpoint %d", t->transition_time / 60,
+            t->transition_time % 60, s.power ? s.power : "-", s.mode ? s.mode : "-",
+            setpoint == SCHEDULE_SETPOINT_NONE ? 0 : setpoint);
+    return heatpump_apply_settings(&s, fields);
+}
+
+/**
+ * @brief Apply the transition in effect, if not applied yet
+ */
+void schedule_poll(void)
+{
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    if (!time_valid || !table.enabled || table.count == 0) {
+        k_mutex_unlock(&schedule_lock);
+        return;
+    }
+
+    int32_t minute = week_minute(time_offset_s + k_uptime_get() / 1000);
+    if (minute == last_minute) {
+        k_mutex_unlock(&schedule_lock);
+        return;
+    }
+    last_minute = minute;
+
+    size_t index = 0;
+    int32_t key = schedule_active(minute, &index);
+    if (key == SCHEDULE_NONE || key == applied_key) {
+        k_mutex_unlock(&schedule_lock);
+        return;
+    }
+
+    schedule_transition_t step = table.transitions[index];
+    if (step.preset != SCHEDULE_PRESET_NONE) {
+        step.heating_setpoint = presets.heating[step.preset - 1];
+        step.cooling_setpoint = presets.cooling[step.preset - 1];
+    }
+    uint32_t started = generation;
+    k_mutex_unlock(&schedule_lock);
+
+    /* The SET exchange blocks, so it runs without the lock */
+    int ret = schedule_apply(&step);
+
+    k_mutex_lock(&schedule_lock, K_FOREVER);
+    if (ret == 0 && generation == started) {
+        applied_key = key;
+    }
+    k_mutex_unlock(&schedule_lock);
+
+    if (ret) {
+        LOG_WRN("Schedule step failed: %d, retrying next minute", ret);
+    }
+}
+
+#ifdef CONFIG_SHELL
+static const struct {
+    const char *name;
+    uint8_t mode;
+} shell_modes[] = {
+    { "off", MATTER_THERMOSTAT_MODE_OFF },
+    { "heat", MATTER_THERMOSTAT_MODE_HEAT },
+    { "cool", MATTER_THERMOSTAT_MODE_COOL },
+    { "auto", MATTER_THERMOSTAT_MODE_AUTO },
+    { "dry", MATTER_THERMOSTAT_MODE_DRY },
+    { "fan", MATTER_THERMOSTAT_MODE_FAN_ONLY },
+    { "keep", SCHEDULE_MODE_KEEP },
+};
+
+static const char *shell_mode_name(uint8_t mode)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(shell_modes); i++) {
+        if (shell_modes[i].mode == mode) {
+            return shell_modes[i].name;
+        }
+    }
+    return "?";
+}
+
+static int shell_parse_days(const char *arg, uint8_t *days)
+{
+    if (strcmp(arg, "all") == 0) {
+        *days = SCHEDULE_DAY_ALL;
+    } else if (strcmp(arg, "weekdays") == 0) {
+        *days = SCHEDULE_DAY_ALL & ~(SCHEDULE_DAY_SATURDAY | SCHEDULE_DAY_SUNDAY);
+    } else if (strcmp(arg, "weekend") == 0) {
+        *days = SCHEDULE_DAY_SATURDAY | SCHEDULE_DAY_SUNDAY;
+    } else {
+        char *end;
+        unsigned long value = strtoul(arg, &end, 0);
+        if (*end != '\0' || value == 0 || value > SCHEDULE_DAY_ALL) {
+            return -EINVAL;
+        }
+        *days = (uint8_t)value;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse a setpoint in °C with an optional .5, or "-" for none
+ */
+static int shell_parse_setpoint(const char *arg, int16_t *setpoint)
+{
+    if (strcmp(arg, "-") == 0) {
+        *setpoint = SCHEDULE_SETPOINT_NONE;
+        return 0;
+    }
+    char *end;
+    long whole = strtol(arg, &end, 10);
+    long centi = whole * 100;
+    if (*end == '.' && end[1] >= '0' && end[1] <= '9' && end[2] == '\0') {
+        centi += (end[1] - '0') * 10;
+    } else if (*end != '\0') {
+        return -EINVAL;
+    }
+    *setpoint = (int16_t)CLAMP(centi, INT16_MIN + 1, INT16_MAX);
+    return 0;
+}
+
+static void shell_print_setpoint(const struct shell *sh, int16_t setpoint)
+{
+    if (setpoint == SCHEDULE_SETPOINT_NONE) {
+        shell_fprintf(sh, SHELL_NORMAL, "     -");
+    } else {
+        shell_fprintf(sh, SHELL_NORMAL, "  %2d.%02d", setpoint / 100, setpoint % 100);
+    }
+}
+
+static int cmd_schedule_show(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    static schedule_transition_t list[MAX_TRANSITIONS];
+    int n = schedule_get_days(SCHEDULE_DAY_ALL, list, ARRAY_SIZE(list));
+    int64_t now;
+
+    shell_print(sh, "Schedule %s, %d/%d transitions", schedule_is_enabled() ? "enabled" : "disabled",
+                n, MAX_TRANSITIONS);
+    if (schedule_get_local_time(&now) == 0) {
+        int32_t minute = week_minute(now);
+        shell_print(sh, "Local time: day %d %02d:%02d", minute / MINUTES_PER_DAY,
+                    (minute % MINUTES_PER_DAY) / 60, minute % 60);
+    } else {
+        shell_print(sh, "Local time: not set");
+    }
+
+    shell_print(sh, "days   time   mode    heat    cool  preset");
+    for (int i = 0; i < n; i++) {
+        const schedule_transition_t *t = &list[i];
+        shell_fprintf(sh, SHELL_NORMAL, "0x%02x  %02u:%02u  %-5s", t->day_of_week,
+                      t->transition_time / 60, t->transition_time % 60,
+                      shell_mode_name(t->system_mode));
+        shell_print_setpoint(sh, t->heating_setpoint);
+        shell_print_setpoint(sh, t->cooling_setpoint);
+        shell_print(sh, "  %u", t->preset);
+    }
+    return 0;
+}
+
+static int cmd_schedule_add(const struct shell *sh, size_t argc, char **argv)
+{
+    static schedule_transition_t list[MAX_TRANSITIONS + 1];
+    schedule_transition_t t = {};
+    uint8_t days;
+    unsigned int hour, minute;
+    char *end;
+
+    if (shell_parse_days(argv[1], &days) != 0) {
+        shell_error(sh, "Days: all, weekdays, weekend or a bitmap (0x01 Sunday .. 0x40 Saturday)");
+        return -EINVAL;
+    }
+    hour = (unsigned int)strtoul(argv[2], &end, 10);
+    if (*end != ':' || hour > 23) {
+        shell_error(sh, "Time must be HH:MM");
+        return -EINVAL;
+    }
+    minute = (unsigned int)strtoul(end + 1, &end, 10);
+    if (*end != '\0' || minute > 59) {
+        shell_error(sh, "Time must be HH:MM");
+        return -EINVAL;
+    }
+    t.transition_time = (uint16_t)(hour * 60 + minute);
+
+    size_t m;
+    for (m = 0; m < ARRAY_SIZE(shell_modes); m++) {
+        if (strcmp(argv[3], shell_modes[m].name) == 0) {
+            break;
+        }
+    }
+    if (m == ARRAY_SIZE(shell_modes)) {
+        shell_error(sh, "Mode: off, heat, cool, auto, dry, fan or keep");
+        return -EINVAL;
+    }
+    t.system_mode = shell_modes[m].mode;
+
+    t.heating_setpoint = SCHEDULE_SETPOINT_NONE;
+    t.cooling_setpoint = SCHEDULE_SETPOINT_NONE;
+    if (argc > 4 && argv[4][0] == 'p') {
+        t.preset = (uint8_t)strtoul(&argv[4][1], NULL, 10);
+    } else if ((argc > 4 && shell_parse_setpoint(argv[4], &t.heating_setpoint) != 0) ||
+               (argc > 5 && shell_parse_setpoint(argv[5], &t.cooling_setpoint) != 0)) {
+        shell_error(sh, "Setpoints in °C, e.g. 21.5, or - for none");
+        return -EINVAL;
+    }
+
+    /* Replace or add this time on each selected day, one day at a time
+     * since the days can have different transitions */
+    for (int day = 0; day < 7; day++) {
+        if (!(days & BIT(day))) {
+            continue;
+        }
+        int n = schedule_get_days((uint8_t)BIT(day), list, MAX_TRANSITIONS);
+        if (n < 0) {
+            return n;
+        }
+        int i;
+        for (i = 0; i < n && list[i].transition_time != t.transition_time; i++) {
+        }
+        list[i] = t;
+        n = MAX(n, i + 1);
+
+        int ret = schedule_set_days((uint8_t)BIT(day), list, (size_t)n);
+        if (ret) {
+            shell_error(sh, "Failed to store the transition: %d", ret);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static int cmd_schedule_clear(const struct shell *sh, size_t argc, char **argv)
+{
+    uint8_t days;
+
+    if (argc < 2) {
+        return schedule_clear();
+    }
+    if (shell_parse_days(argv[1], &days) != 0) {
+        shell_error(sh, "Days: all, weekdays, weekend or a bitmap");
+        return -EINVAL;
+    }
+    return schedule_set_days(days, NULL, 0);
+}
+
+static int cmd_schedule_preset(const struct shell *sh, size_t argc, char **argv)
+{
+    schedule_preset_e scenario = (schedule_preset_e)strtoul(argv[1], NULL, 10);
+    int16_t heating, cooling;
+
+    if (argc == 2) {
+        if (schedule_get_preset(scenario, &heating, &cooling) != 0) {
+            shell_error(sh, "Scenario must be 1 to %d", SCHEDULE_PRESET_COUNT);
+            return -EINVAL;
+        }
+        shell_fprintf(sh, SHELL_NORMAL, "Preset %d:", scenario);
+        shell_print_setpoint(sh, heating);
+        shell_print_setpoint(sh, cooling);
+        shell_print(sh, "");
+        return 0;
+    }
+
+    if (shell_parse_setpoint(argv[2], &heating) != 0 ||
+        (argc > 3 && shell_parse_setpoint(argv[3], &cooling) != 0)) {
+        shell_error(sh, "Setpoints in °C, e.g. 21.5, or - for none");
+        return -EINVAL;
+    }
+    if (argc < 4) {
+        cooling = SCHEDULE_SETPOINT_NONE;
+    }
+    int ret = schedule_set_preset(scenario, heating, cooling);
+    if (ret) {
+        shell_error(sh, "Failed to set preset: %d", ret);
+    }
+    return ret;
+}
+
+static int cmd_schedule_enable(const struct shell *sh, size_t argc, char **argv)
+{
+    if (strcmp(argv[1], "on") != 0 && strcmp(argv[1], "off") != 0) {
+        shell_error(sh, "Use on or off");
+        return -EINVAL;
+    }
+    return schedule_set_enabled(strcmp(argv[1], "on") == 0);
+}
+
+static int cmd_schedule_time(const struct shell *sh, size_t argc, char **argv)
+{
+    char *end;
+    long long local_s = strtoll(argv[1], &end, 10);
+
+    if (*end != '\0' || local_s <= 0) {
+        shell_error(sh, "Local time in seconds since 1970-01-01 00:00");
+        return -EINVAL;
+    }
+    schedule_set_local_time(local_s);
+    return cmd_schedule_show(sh, 1, argv);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(schedule_cmds,
+    SHELL_CMD_ARG(show, NULL, "List the transitions", cmd_schedule_show, 1, 0),
+    SHELL_CMD_ARG(add, NULL,
+                  "Add or replace a transition: add <days> <HH:MM> <mode> [heat|pN] [cool]",
+                  cmd_schedule_add, 4, 2),
+    SHELL_CMD_ARG(clear, NULL, "Remove transitions: clear [days]", cmd_schedule_clear, 1, 1),
+    SHELL_CMD_ARG(preset, NULL, "Show or set a preset: preset <1-6> [heat] [cool]",
+                  cmd_schedule_preset, 2, 2),
+    SHELL_CMD_ARG(enable, NULL, "Run the schedule: enable <on|off>", cmd_schedule_enable, 2, 0),
+    SHELL_CMD_ARG(time, NULL, "Set the local time: time <seconds since 1970>",
+                  cmd_schedule_time, 2, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_SUBCMD_ADD((heatpump), schedule, &schedule_cmds, "On-device weekly schedule",
+                 cmd_schedule_show, 1, 0);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,180 @@
+/**
+ * @file schedule.h
+ * @brief On-device weekly thermostat schedule
+ *
+ * Transitions follow the Matter Thermostat ScheduleTransitionStruct:
+ * a day-of-week bitmap, a time of day, an optional system mode and
+ * either a preset scenario or heating/cooling setpoints. They are kept
+ * in flash under the "sched" settings subtree and evaluated by the
+ * heat pump driver thread, which applies each due transition as a
+ * single SET frame, so the schedule keeps running without a hub.
+ *
+ * The engine needs local wall-clock time, e.g. from the Matter Time
+ * Synchronization cluster, and stays idle until it has been set with
+ * schedule_set_local_time().
+ */
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Day-of-week bits (Matter ScheduleDayOfWeekBitmap)
+ */
+#define SCHEDULE_DAY_SUNDAY    0x01
+#define SCHEDULE_DAY_MONDAY    0x02
+#define SCHEDULE_DAY_TUESDAY   0x04
+#define SCHEDULE_DAY_WEDNESDAY 0x08
+#define SCHEDULE_DAY_THURSDAY  0x10
+#define SCHEDULE_DAY_FRIDAY    0x20
+#define SCHEDULE_DAY_SATURDAY  0x40
+#define SCHEDULE_DAY_ALL       0x7F
+
+/** Setpoint not given */
+#define SCHEDULE_SETPOINT_NONE INT16_MIN
+/** Leave the system mode unchanged */
+#define SCHEDULE_MODE_KEEP     0xFF
+/** Use the setpoints of the transition, not a preset */
+#define SCHEDULE_PRESET_NONE   0
+
+/**
+ * @brief Preset scenarios (Matter PresetScenarioEnum)
+ */
+typedef enum {
+    SCHEDULE_PRESET_OCCUPIED = 1,
+    SCHEDULE_PRESET_UNOCCUPIED = 2,
+    SCHEDULE_PRESET_SLEEP = 3,
+    SCHEDULE_PRESET_WAKE = 4,
+    SCHEDULE_PRESET_VACATION = 5,
+    SCHEDULE_PRESET_GOING_TO_SLEEP = 6,
+    SCHEDULE_PRESET_COUNT = 6
+} schedule_preset_e;
+
+/**
+ * @brief One schedule transition
+ */
+typedef struct {
+    uint16_t transition_time;   /**< Minutes after local midnight (0-1439) */
+    int16_t heating_setpoint;   /**< 0.01°C, SCHEDULE_SETPOINT_NONE if not given */
+    int16_t cooling_setpoint;   /**< 0.01°C, SCHEDULE_SETPOINT_NONE if not given */
+    uint8_t day_of_week;        /**< SCHEDULE_DAY_* bitmap */
+    uint8_t system_mode;        /**< MATTER_THERMOSTAT_MODE_* or SCHEDULE_MODE_KEEP */
+    uint8_t preset;             /**< schedule_preset_e or SCHEDULE_PRESET_NONE */
+    uint8_t reserved;
+} schedule_transition_t;
+
+/**
+ * @brief Load the stored schedule and presets
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int schedule_init(void);
+
+/**
+ * @brief Replace the transitions of some days (Matter SetWeeklySchedule)
+ *
+ * Transitions on other days are kept. The day_of_week of the given
+ * transitions is ignored; they apply to every day in @a days. Passing
+ * no transitions clears those days.
+ *
+ * @param days SCHEDULE_DAY_* bitmap
+ * @param transitions Transitions for these days
+ * @param count Number of @a transitions
+ * @return 0 on success, -EINVAL for an invalid transition,
+ *         -ENOSPC if the store is full, negative errno on other failures
+ */
+int schedule_set_days(uint8_t days, const schedule_transition_t *transitions, size_t count);
+
+/**
+ * @brief Remove all transitions (Matter ClearWeeklySchedule)
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int schedule_clear(void);
+
+/**
+ * @brief Get the transitions of some days (Matter GetWeeklySchedule)
+ *
+ * Transitions are returned in order of time of day, with day_of_week
+ * narrowed to @a days.
+ *
+ * @param days SCHEDULE_DAY_* bitmap
+ * @param transitions Output buffer
+ * @param max Size of @a transitions
+ * @return Number of transitions written, -ENOSPC if @a max is too small
+ */
+int schedule_get_days(uint8_t days, schedule_transition_t *transitions, size_t max);
+
+/**
+ * @brief Set the setpoints of a preset
+ *
+ * @param scenario Preset scenario
+ * @param heating_setpoint 0.01°C, SCHEDULE_SETPOINT_NONE if not given
+ * @param cooling_setpoint 0.01°C, SCHEDULE_SETPOINT_NONE if not given
+ * @return 0 on success, -EINVAL if out of range, negative errno on failure
+ */
+int schedule_set_preset(schedule_preset_e scenario, int16_t heating_setpoint,
+                        int16_t cooling_setpoint);
+
+/**
+ * @brief Get the setpoints of a preset
+ *
+ * @return 0 on success, -EINVAL for an unknown scenario
+ */
+int schedule_get_preset(schedule_preset_e scenario, int16_t *heating_setpoint,
+                        int16_t *cooling_setpoint);
+
+/**
+ * @brief Turn schedule execution on or off; the transitions are kept
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int schedule_set_enabled(bool enabled);
+
+/**
+ * @brief Check whether schedule execution is on
+ */
+bool schedule_is_enabled(void);
+
+/**
+ * @brief Set the local wall-clock time
+ *
+ * Local time is seconds since 1970-01-01 00:00 in the local time zone,
+ * daylight saving included (Matter Time Synchronization LocalTime).
+ * Call again after a time zone or DST change. The transition in effect
+ * at this time is applied if it was not applied already.
+ *
+ * @param local_s Local time in seconds
+ */
+void schedule_set_local_time(int64_t local_s);
+
+/**
+ * @brief Get the local wall-clock time
+ *
+ * @param local_s Local time in seconds
+ * @return 0 on success, -EAGAIN if the time has not been set
+ */
+int schedule_get_local_time(int64_t *local_s);
+
+/**
+ * @brief Apply the transition in effect, if not applied yet
+ *
+ * Called by the heat pump driver thread while the link is up. Work is
+ * done at most once per minute, or after the schedule or the time
+ * changed. A transition that fails to apply is retried every minute
+ * until the next one takes over.
+ */
+void schedule_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHEDULE_H */
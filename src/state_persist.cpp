@@ -0,0 +1,398 @@
+/**
+ * @file state_persist.cpp
+ * @brief Last-known heat pump state kept in flash
+ *
+ * Three small records live under the "hp" settings subtree:
+ * - hp/cfg:    settings and capability profile (changes rarely)
+ * - hp/status: room temperature, operating state and timers
+ * - hp/fn:     function code block (0x20/0x22 replies)
+ *
+ * Strings are stored as indices into the CN105 value tables of
+ * heat_pump_schema.h, so a record is a few bytes and independent of
+ * where the library keeps its string constants.
+ */
+
+#include "state_persist.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <string.h>
+#include "heat_pump_schema.h"
+
+LOG_MODULE_REGISTER(state_persist, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* Bump when a record layout changes; older records are ignored */
+#define PERSIST_VERSION 1
+
+#define PERSIST_FLAG_ISEE          BIT(0)
+#define PERSIST_FLAG_HALF_DEGREE   BIT(1)
+#define PERSIST_FLAG_WIDE_VANE_ADJ BIT(2)
+#define PERSIST_FLAG_OPERATING     BIT(3)
+
+/**
+ * @brief Settings and profile record (hp/cfg)
+ */
+struct persist_cfg {
+    uint32_t bitrate;
+    int16_t setpoint;     /* 0.01°C */
+    uint8_t version;
+    uint8_t power;
+    uint8_t mode;
+    uint8_t fan;
+    uint8_t vane;
+    uint8_t wide_vane;
+    uint8_t flags;
+    uint8_t reserved[3];
+};
+
+/**
+ * @brief Status and timers record (hp/status)
+ */
+struct persist_status {
+    int16_t room_temp;    /* 0.01°C */
+    uint16_t on_minutes_set;
+    uint16_t on_minutes_remaining;
+    uint16_t off_minutes_set;
+    uint16_t off_minutes_remaining;
+    uint8_t version;
+    uint8_t flags;
+    uint8_t compressor_frequency;
+    uint8_t timer_mode;
+    uint8_t reserved[2];
+};
+
+/**
+ * @brief Function code record (hp/fn)
+ */
+struct persist_fn {
+    uint8_t raw[HP_FUNCTION_DATA_LEN];
+    uint8_t version;
+    uint8_t reserved;
+};
+
+static struct persist_cfg saved_cfg;
+static struct persist_cfg pending_cfg;
+static struct persist_status saved_status;
+static struct persist_status pending_status;
+static struct persist_fn saved_fn;
+static struct persist_fn pending_fn;
+static bool have_cfg;
+static bool have_status;
+static bool have_fn;
+
+static K_MUTEX_DEFINE(persist_lock);
+static struct k_work_delayable persist_work;
+
+/* Unknown names store, and out of range indices load, the first entry */
+template <typename Values>
+static uint8_t name_to_index(const char *name)
+{
+    int index = Values::indexOf(name);
+    return index < 0 ? 0 : (uint8_t)index;
+}
+
+template <typename Values>
+static const char *index_to_name(uint8_t index)
+{
+    return Values::at(index);
+}
+
+/**
+ * @brief Read one record from the settings backend
+ *
+ * Records of a different size or version are skipped, not treated as
+ * errors, so a firmware update with a new layout simply starts fresh.
+ */
+static int persist_read(size_t len, settings_read_cb read_cb, void *cb_arg,
+                        void *dst, size_t size, const uint8_t *version, bool *loaded)
+{
+    if (len != size) {
+        return 0;
+    }
+    ssize_t rc = read_cb(cb_arg, dst, size);
+    if (rc < 0) {
+        return (int)rc;
+    }
+    *loaded = ((size_t)rc == size && *version == PERSIST_VERSION);
+    return 0;
+}
+
+static int persist_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+
+    if (settings_name_steq(name, "cfg", &next) && !next) {
+        return persist_read(len, read_cb, cb_arg, &saved_cfg, sizeof(saved_cfg),
+                            &saved_cfg.version, &have_cfg);
+    }
+    if (settings_name_steq(name, "status", &next) && !next) {
+        return persist_read(len, read_cb, cb_arg, &saved_status, sizeof(saved_status),
+                            &saved_status.version, &have_status);
+    }
+    if (settings_name_steq(name, "fn", &next) && !next) {
+        return persist_read(len, read_cb, cb_arg, &saved_fn, sizeof(saved_fn),
+                            &saved_fn.version, &have_fn);
+    }
+    return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(heatpump_state, "hp", NULL, persist_set, NULL, NULL);
+
+/**
+ * @brief Write-behind handler, runs on the system workqueue
+ */
+static void persist_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+    (void)state_persist_flush();
+}
+
+/**
+ * @brief Schedule the write-behind, keeping an earlier deadline if set
+ */
+static void persist_schedule(int32_t delay_ms)
+{
+    if (k_work_delayable_is_pending(&persist_work)) {
+        int64_t remaining_ms = k_ticks_to_ms_floor64(k_work_delayable_remaining_get(&persist_work));
+        if (remaining_ms <= delay_ms) {
+            return;
+        }
+    }
+    k_work_reschedule(&persist_work, K_MSEC(delay_ms));
+}
+
+/**
+ * @brief Initialize the settings subsystem and load the stored state
+ */
+int state_persist_init(void)
+{
+    k_work_init_delayable(&persist_work, persist_work_handler);
+
+    int ret = settings_subsys_init();
+    if (ret) {
+        LOG_ERR("settings_subsys_init failed: %d", ret);
+        return ret;
+    }
+
+    ret = settings_load_subtree("hp");
+    if (ret) {
+        LOG_WRN("Failed to load stored heat pump state: %d", ret);
+    }
+
+    if (!have_cfg) {
+        memset(&saved_cfg, 0, sizeof(saved_cfg));
+    }
+    if (!have_status) {
+        memset(&saved_status, 0, sizeof(saved_status));
+    }
+    if (!have_fn) {
+        memset(&saved_fn, 0, sizeof(saved_fn));
+    }
+    pending_cfg = saved_cfg;
+    pending_status = saved_status;
+    pending_fn = saved_fn;
+
+    LOG_INF("Stored heat pump state: settings %s, status %s",
+            have_cfg ? "found" : "none", have_status ? "found" : "none");
+    return 0;
+}
+
+/**
+ * @brief Get the state loaded from flash
+ */
+int state_persist_restore(heatpump_settings_t *settings,
+                          heatpump_status_t *status,
+                          heatpump_timers_t *timers,
+                          heatpump_profile_t *profile)
+{
+    if (!have_cfg && !have_status) {
+        return -ENOENT;
+    }
+
+    if (have_cfg) {
+        if (settings) {
+            settings->power = index_to_name<cn105::Powers>(saved_cfg.power);
+            settings->mode = index_to_name<cn105::Modes>(saved_cfg.mode);
+            settings->temperature = saved_cfg.setpoint;
+            settings->fan = index_to_name<cn105::Fans>(saved_cfg.fan);
+            settings->vane = index_to_name<cn105::Vanes>(saved_cfg.vane);
+            settings->wideVane = index_to_name<cn105::WideVanes>(saved_cfg.wide_vane);
+            settings->iSee = (saved_cfg.flags & PERSIST_FLAG_ISEE) != 0;
+            settings->connected = false;
+            settings->stale = true;
+        }
+        if (profile) {
+            profile->bitrate = saved_cfg.bitrate;
+            profile->halfDegreeSetpoint = (saved_cfg.flags & PERSIST_FLAG_HALF_DEGREE) != 0;
+            profile->wideVaneAdjust = (saved_cfg.flags & PERSIST_FLAG_WIDE_VANE_ADJ) != 0;
+        }
+    }
+
+    if (have_status) {
+        if (status) {
+            status->roomTemperature = saved_status.room_temp;
+            status->operating = (saved_status.flags & PERSIST_FLAG_OPERATING) != 0;
+            status->compressorFrequency = saved_status.compressor_frequency;
+            status->stale = true;
+        }
+        if (timers) {
+            timers->mode = index_to_name<cn105::TimerModes>(saved_status.timer_mode);
+            timers->onMinutesSet = saved_status.on_minutes_set;
+            timers->onMinutesRemaining = saved_status.on_minutes_remaining;
+            timers->offMinutesSet = saved_status.off_minutes_set;
+            timers->offMinutesRemaining = saved_status.off_minutes_remaining;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Record the current confirmed state
+ */
+void state_persist_update(const heatpump_settings_t *settings,
+                          const heatpump_status_t *status,
+                          const heatpump_timers_t *timers,
+                          const heatpump_profile_t *profile)
+{
+    struct persist_cfg cfg;
+    struct persist_status st;
+
+    k_mutex_lock(&persist_lock, K_FOREVER);
+    cfg = pending_cfg;
+    st = pending_status;
+
+    if (settings) {
+        cfg.version = PERSIST_VERSION;
+        cfg.power = name_to_index<cn105::Powers>(settings->power);
+        cfg.mode = name_to_index<cn105::Modes>(settings->mode);
+        cfg.setpoint = settings->temperature;
+        cfg.fan = name_to_index<cn105::Fans>(settings->fan);
+        cfg.vane = name_to_index<cn105::Vanes>(settings->vane);
+        cfg.wide_vane = name_to_index<cn105::WideVanes>(settings->wideVane);
+        cfg.flags = (cfg.flags & ~PERSIST_FLAG_ISEE) | (settings->iSee ? PERSIST_FLAG_ISEE : 0);
+    }
+    if (profile) {
+        cfg.version = PERSIST_VERSION;
+        cfg.bitrate = profile->bitrate;
+        cfg.flags &= ~(PERSIST_FLAG_HALF_DEGREE | PERSIST_FLAG_WIDE_VANE_ADJ);
+        cfg.flags |= (profile->halfDegreeSetpoint ? PERSIST_FLAG_HALF_DEGREE : 0) |
+                     (profile->wideVaneAdjust ? PERSIST_FLAG_WIDE_VANE_ADJ : 0);
+    }
+    if (status) {
+        st.version = PERSIST_VERSION;
+        st.room_temp = status->roomTemperature;
+        st.compressor_frequency = (uint8_t)CLAMP(status->compressorFrequency, 0, UINT8_MAX);
+        st.flags = status->operating ? PERSIST_FLAG_OPERATING : 0;
+    }
+    if (timers) {
+        st.version = PERSIST_VERSION;
+        st.timer_mode = name_to_index<cn105::TimerModes>(timers->mode);
+        st.on_minutes_set = (uint16_t)timers->onMinutesSet;
+        st.on_minutes_remaining = (uint16_t)timers->onMinutesRemaining;
+        st.off_minutes_set = (uint16_t)timers->offMinutesSet;
+        st.off_minutes_remaining = (uint16_t)timers->offMinutesRemaining;
+    }
+
+    pending_cfg = cfg;
+    pending_status = st;
+
+    bool cfg_dirty = memcmp(&pending_cfg, &saved_cfg, sizeof(saved_cfg)) != 0;
+    bool status_dirty = memcmp(&pending_status, &saved_status, sizeof(saved_status)) != 0;
+    k_mutex_unlock(&persist_lock);
+
+    if (cfg_dirty) {
+        persist_schedule(CONFIG_APP_HEATPUMP_PERSIST_DELAY_MS);
+    } else if (status_dirty) {
+        persist_schedule(CONFIG_APP_HEATPUMP_PERSIST_STATUS_DELAY_MS);
+    }
+}
+
+/**
+ * @brief Get the function codes loaded from flash
+ */
+int state_persist_restore_functions(uint8_t raw[HP_FUNCTION_DATA_LEN])
+{
+    if (!have_fn) {
+        return -ENOENT;
+    }
+    memcpy(raw, saved_fn.raw, HP_FUNCTION_DATA_LEN);
+    return 0;
+}
+
+/**
+ * @brief Record function codes confirmed by the heat pump
+ */
+void state_persist_update_functions(const uint8_t raw[HP_FUNCTION_DATA_LEN])
+{
+    k_mutex_lock(&persist_lock, K_FOREVER);
+    pending_fn.version = PERSIST_VERSION;
+    memcpy(pending_fn.raw, raw, HP_FUNCTION_DATA_LEN);
+    bool dirty = memcmp(&pending_fn, &saved_fn, sizeof(saved_fn)) != 0;
+    k_mutex_unlock(&persist_lock);
+
+    if (dirty) {
+        persist_schedule(CONFIG_APP_HEATPUMP_PERSIST_DELAY_MS);
+    }
+}
+
+/**
+ * @brief Write any pending changes to flash now
+ */
+int state_persist_flush(void)
+{
+    struct persist_cfg cfg;
+    struct persist_status st;
+    struct persist_fn fn;
+    int ret = 0;
+
+    /* saved_* is only written here, so comparing against it unlocked is safe */
+    k_mutex_lock(&persist_lock, K_FOREVER);
+    cfg = pending_cfg;
+    st = pending_status;
+    fn = pending_fn;
+    k_mutex_unlock(&persist_lock);
+
+    if (cfg.version == PERSIST_VERSION && memcmp(&cfg, &saved_cfg, sizeof(cfg)) != 0) {
+        ret = settings_save_one("hp/cfg", &cfg, sizeof(cfg));
+        if (ret) {
+            LOG_WRN("Failed to store heat pump settings: %d", ret);
+        } else {
+            k_mutex_lock(&persist_lock, K_FOREVER);
+            saved_cfg = cfg;
+            have_cfg = true;
+            k_mutex_unlock(&persist_lock);
+            LOG_DBG("Stored heat pump settings");
+        }
+    }
+
+    if (st.version == PERSIST_VERSION && memcmp(&st, &saved_status, sizeof(st)) != 0) {
+        int rc = settings_save_one("hp/status", &st, sizeof(st));
+        if (rc) {
+            LOG_WRN("Failed to store heat pump status: %d", rc);
+            ret = ret ? ret : rc;
+        } else {
+            k_mutex_lock(&persist_lock, K_FOREVER);
+            saved_status = st;
+            have_status = true;
+            k_mutex_unlock(&persist_lock);
+            LOG_DBG("Stored heat pump status");
+        }
+    }
+
+    if (fn.version == PERSIST_VERSION && memcmp(&fn, &saved_fn, sizeof(fn)) != 0) {
+        int rc = settings_save_one("hp/fn", &fn, sizeof(fn));
+        if (rc) {
+            LOG_WRN("Failed to store heat pump function codes: %d", rc);
+            ret = ret ? ret : rc;
+        } else {
+            k_mutex_lock(&persist_lock, K_FOREVER);
+            saved_fn = fn;
+            have_fn = true;
+            k_mutex_unlock(&persist_lock);
+            LOG_DBG("Stored heat pump function codes");
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file state_persist.h
+ * @brief Last-known heat pump state kept in flash
+ *
+ * Stores the last confirmed settings, status, timers, capability
+ * profile and function codes through the Zephyr settings subsystem
+ * (NVS backend), so the driver can publish realistic values straight
+ * after a reboot instead of hard-coded defaults.
+ *
+ * Writes are coalesced: an update only marks the record dirty and the
+ * flash write happens later from the system workqueue. Settings changes
+ * are written after CONFIG_APP_HEATPUMP_PERSIST_DELAY_MS, status-only
+ * changes after CONFIG_APP_HEATPUMP_PERSIST_STATUS_DELAY_MS, and
+ * records identical to what is already in flash are never rewritten.
+ */
+
+#ifndef STATE_PERSIST_H
+#define STATE_PERSIST_H
+
+#include "heatpump_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the settings subsystem and load the stored state
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int state_persist_init(void);
+
+/**
+ * @brief Get the state loaded from flash
+ *
+ * Any pointer may be NULL. Restored settings and status are marked
+ * stale.
+ *
+ * @return 0 if a stored state was found, -ENOENT otherwise
+ */
+int state_persist_restore(heatpump_settings_t *settings,
+                          heatpump_status_t *status,
+                          heatpump_timers_t *timers,
+                          heatpump_profile_t *profile);
+
+/**
+ * @brief Record the current confirmed state
+ *
+ * Cheap to call on every change; the flash write is deferred and
+ * coalesced.
+ */
+void state_persist_update(const heatpump_settings_t *settings,
+                          const heatpump_status_t *status,
+                          const heatpump_timers_t *timers,
+                          const heatpump_profile_t *profile);
+
+/**
+ * @brief Get the function codes loaded from flash
+ *
+ * @param raw Receives HP_FUNCTION_DATA_LEN bytes of function code data
+ * @return 0 if stored function codes were found, -ENOENT otherwise
+ */
+int state_persist_restore_functions(uint8_t raw[HP_FUNCTION_DATA_LEN]);
+
+/**
+ * @brief Record function codes confirmed by the heat pump
+ *
+ * Written with the same write-behind delay as settings.
+ *
+ * @param raw HP_FUNCTION_DATA_LEN bytes of function code data
+ */
+void state_persist_update_functions(const uint8_t raw[HP_FUNCTION_DATA_LEN]);
+
+/**
+ * @brief Write any pending changes to flash now
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int state_persist_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATE_PERSIST_H */
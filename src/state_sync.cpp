@@ -10,6 +10,7 @@
 #include <zephyr/logging/log.h>
 #include "heatpump_driver.h"
 #include "matter_config.h"
+#include "matter_integration.h"
 
 LOG_MODULE_REGISTER(state_sync, CONFIG_LOG_DEFAULT_LEVEL);
 
@@ -17,32 +18,21 @@ LOG_MODULE_REGISTER(state_sync, CONFIG_LOG_DEFAULT_LEVEL);
 static bool sync_in_progress = false;
 
 /**
- * @brief Callback for heat pump settings changes
+ * @brief Callback for published heat pump state changes
  * 
- * Called by the heat pump driver when settings change
- * (either from physical controls or IR remote)
+ * Called by the heat pump driver when any field changed (from physical
+ * controls, the IR remote, a Matter write or the link), with the bits
+ * that changed
  */
-static void on_heatpump_settings_changed(heatpump_settings_t settings)
+static void on_heatpump_state_changed(const heatpump_state_t *state,
+                                      const heatpump_state_t *changed)
 {
-    LOG_INF("Heat pump settings changed");
+    LOG_DBG("Heat pump state %016llx %016llx, changed %016llx %016llx",
+            (unsigned long long)state->settings, (unsigned long long)state->status,
+            (unsigned long long)changed->settings, (unsigned long long)changed->status);
     
-    /* TODO: Update Matter attributes to reflect new settings */
-    /* TODO: This ensures Matter state stays in sync with physical device */
-}
-
-/**
- * @brief Callback for heat pump status changes
- * 
- * Called by the heat pump driver when status changes
- */
-static void on_heatpump_status_changed(heatpump_status_t status)
-{
-    const double temp_c = static_cast<double>(status.roomTemperature);
-    LOG_DBG("Heat pump status changed: temp=%.1f°C, operating=%d",
-            temp_c, status.operating);
-    
-    /* TODO: Update Matter temperature measurement */
-    /* TODO: Update Matter running state */
+    /* Subscribers read the new values from the driver snapshot */
+    (void)matter_update_attributes(changed);
 }
 
 /**
@@ -57,8 +47,7 @@ int state_sync_init(void)
     LOG_INF("Initializing state synchronization");
     
     /* Register callbacks with heat pump driver */
-    heatpump_set_settings_callback(on_heatpump_settings_changed);
-    heatpump_set_status_callback(on_heatpump_status_changed);
+    heatpump_set_state_callback(on_heatpump_state_changed);
     
     /* TODO: Set up periodic sync timer */
     